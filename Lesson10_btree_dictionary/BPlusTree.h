@@ -0,0 +1,665 @@
+// BPlusTree.h
+//
+// Ordered dictionary stored as a B+ tree with wide, cache-friendly nodes.
+//
+// BSTDictionary (Lesson 10) allocates one small node per key and follows one
+// pointer, and so takes one likely cache miss, per level. It is also never
+// rebalanced, so inserting keys in sorted order turns it into a linked list.
+//
+// A B+ tree fixes both problems:
+//
+//   - every node holds many keys in a contiguous array sized to a few cache
+//     lines (NodeBytes), and is searched with a branch-free binary search,
+//     so a tree of 100 million keys is only 4-5 levels deep
+//   - splits and merges keep every leaf at the same depth whatever the
+//     insertion order
+//   - values live only in the leaves and the leaves are linked in key order,
+//     so a range scan is a walk along contiguous arrays
+//
+// Keys need operator<; keys and values must be default constructible and
+// assignable because nodes store them in fixed-size arrays.
+
+#ifndef BPLUS_TREE_H
+#define BPLUS_TREE_H
+
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Ordered key-value dictionary implemented as a B+ tree.
+ *
+ * @tparam NodeBytes Approximate size of each node's key/value payload.
+ *         256-1024 bytes (a few cache lines) suits in-memory use; 4096
+ *         matches a page.
+ */
+template<typename K, typename V, size_t NodeBytes = 512>
+class BPlusTree {
+private:
+    static constexpr size_t LeafCapacity =
+        NodeBytes / (sizeof(K) + sizeof(V)) < 4 ? 4 : NodeBytes / (sizeof(K) + sizeof(V));
+    static constexpr size_t InnerCapacity =
+        NodeBytes / (sizeof(K) + sizeof(void*)) < 4 ? 4 : NodeBytes / (sizeof(K) + sizeof(void*));
+    static constexpr size_t MinLeaf = LeafCapacity / 2;
+    static constexpr size_t MinInner = InnerCapacity / 2;
+
+    struct Node {
+        bool isLeaf;
+        size_t count;       // number of keys in use
+
+        explicit Node(bool leaf) : isLeaf(leaf), count(0) {}
+    };
+
+    struct Leaf : Node {
+        K keys[LeafCapacity];
+        V values[LeafCapacity];
+        Leaf* prev;
+        Leaf* next;
+
+        Leaf() : Node(true), prev(nullptr), next(nullptr) {}
+    };
+
+    // children[i] holds keys < keys[i]; children[i + 1] holds keys >= keys[i]
+    struct Inner : Node {
+        K keys[InnerCapacity];
+        Node* children[InnerCapacity + 1];
+
+        Inner() : Node(false) {}
+    };
+
+public:
+    // Forward iterator over entries in ascending key order
+    class iterator {
+    public:
+        iterator() : leaf(nullptr), index(0) {}
+
+        const K& key() const { return leaf->keys[index]; }
+        V& value() const { return leaf->values[index]; }
+        std::pair<const K&, V&> operator*() const { return std::pair<const K&, V&>(leaf->keys[index], leaf->values[index]); }
+
+        iterator& operator++() {
+            if (++index == leaf->count) {
+                leaf = leaf->next;
+                index = 0;
+            }
+            return *this;
+        }
+
+        bool operator==(const iterator& other) const { return leaf == other.leaf && index == other.index; }
+        bool operator!=(const iterator& other) const { return !(*this == other); }
+
+    private:
+        friend class BPlusTree;
+        iterator(Leaf* l, size_t i) : leaf(l), index(i) {
+            // Step over the end of a leaf so every valid position is canonical
+            if (leaf != nullptr && index == leaf->count) {
+                leaf = leaf->next;
+                index = 0;
+            }
+        }
+
+        Leaf* leaf;
+        size_t index;
+    };
+
+    BPlusTree() : root(new Leaf()), size_(0) {
+        firstLeaf = static_cast<Leaf*>(root);
+    }
+
+    BPlusTree(const BPlusTree&) = delete;
+    BPlusTree& operator=(const BPlusTree&) = delete;
+
+    ~BPlusTree() {
+        destroy(root);
+    }
+
+    void clear() {
+        destroy(root);
+        root = firstLeaf = new Leaf();
+        size_ = 0;
+    }
+
+    /**
+     * @brief Replace the contents with a sorted range of (key, value) pairs.
+     *
+     * Builds the tree bottom-up in O(n): leaves are filled left to right,
+     * then each inner level is built over the one below. No key is ever
+     * searched for and no node is ever split.
+     *
+     * @param first, last Forward range of std::pair<K, V> (or any type with
+     *        .first and .second) in strictly ascending key order.
+     * @throws std::invalid_argument If the keys are not strictly ascending;
+     *         the tree is left empty, as it is when an allocation or a copy
+     *         of a key or value throws.
+     */
+    template<typename ForwardIt>
+    void bulk_load(ForwardIt first, ForwardIt last) {
+        size_t n = static_cast<size_t>(std::distance(first, last));
+        clear();
+        if (n == 0) {
+            return;
+        }
+
+        // Level 0: full leaves, with the last two evened out if needed so
+        // that no leaf is under half full
+        std::vector<Node*> level;
+        std::vector<K> lowKeys;     // smallest key under each node of the level
+        std::vector<size_t> sizes = groupSizes(n, LeafCapacity, MinLeaf);
+        level.reserve(sizes.size());
+        lowKeys.reserve(sizes.size());
+
+        // clear() left a single empty leaf; the loaded leaves replace it
+        delete static_cast<Leaf*>(root);
+        root = firstLeaf = nullptr;
+        Leaf* prev = nullptr;
+        try {
+            for (size_t count : sizes) {
+                Leaf* leaf = new Leaf();
+                level.push_back(leaf);
+                leaf->prev = prev;
+                if (prev != nullptr) {
+                    prev->next = leaf;
+                }
+                for (size_t i = 0; i < count; ++i, ++first) {
+                    if (size_ > 0 && !(lastKey(prev, leaf) < first->first)) {
+                        throw std::invalid_argument("BPlusTree::bulk_load: keys must be strictly ascending");
+                    }
+                    leaf->keys[i] = first->first;
+                    leaf->values[i] = first->second;
+                    leaf->count++;
+                    size_++;
+                }
+                lowKeys.push_back(leaf->keys[0]);
+                prev = leaf;
+            }
+        } catch (...) {
+            for (Node* leaf : level) {
+                delete static_cast<Leaf*>(leaf);
+            }
+            root = firstLeaf = new Leaf();
+            size_ = 0;
+            throw;
+        }
+        firstLeaf = static_cast<Leaf*>(level[0]);
+
+        // Inner levels: each node takes up to InnerCapacity + 1 children, and
+        // the separators are the low keys of every child but the first. On
+        // an exception the nodes of parents own no children yet: they are
+        // freed alone, and level frees the subtrees below
+        std::vector<Node*> parents;
+        try {
+            while (level.size() > 1) {
+                std::vector<size_t> groups = groupSizes(level.size(), InnerCapacity + 1, MinInner + 1);
+                std::vector<K> parentLowKeys;
+                parents.reserve(groups.size());
+                parentLowKeys.reserve(groups.size());
+
+                size_t child = 0;
+                for (size_t count : groups) {
+                    Inner* inner = new Inner();
+                    parents.push_back(inner);
+                    parentLowKeys.push_back(lowKeys[child]);
+                    inner->children[0] = level[child];
+                    for (size_t i = 1; i < count; i++) {
+                        inner->keys[i - 1] = lowKeys[child + i];
+                        inner->children[i] = level[child + i];
+                    }
+                    inner->count = count - 1;
+                    child += count;
+                }
+                level.swap(parents);
+                parents.clear();
+                lowKeys.swap(parentLowKeys);
+            }
+        } catch (...) {
+            for (Node* inner : parents) {
+                delete static_cast<Inner*>(inner);
+            }
+            for (Node* node : level) {
+                destroy(node);
+            }
+            root = firstLeaf = new Leaf();
+            size_ = 0;
+            throw;
+        }
+        root = level[0];
+    }
+
+    /**
+     * @brief Call fn(key, value) for every entry with lo <= key <= hi, in order.
+     *
+     * Streams straight from the leaves, so nothing is copied or allocated.
+     */
+    template<typename Fn>
+    void for_each_in_range(const K& lo, const K& hi, Fn fn) {
+        Leaf* leaf = findLeaf(lo);
+        size_t i = lowerBound(leaf->keys, leaf->count, lo);
+        while (leaf != nullptr) {
+            for (; i < leaf->count; i++) {
+                if (hi < leaf->keys[i]) {
+                    return;
+                }
+                fn(leaf->keys[i], leaf->values[i]);
+            }
+            leaf = leaf->next;
+            i = 0;
+        }
+    }
+
+    // Insert a new key or update the value of an existing one
+    void insert(const K& key, const V& value) {
+        K separator;
+        Node* right = insert(root, key, value, separator);
+        if (right != nullptr) {
+            // The root split: grow the tree by one level
+            Inner* newRoot = new Inner();
+            newRoot->keys[0] = separator;
+            newRoot->children[0] = root;
+            newRoot->children[1] = right;
+            newRoot->count = 1;
+            root = newRoot;
+        }
+    }
+
+    V* find(const K& key) {
+        Leaf* leaf = findLeaf(key);
+        size_t pos = lowerBound(leaf->keys, leaf->count, key);
+        if (pos < leaf->count && !(key < leaf->keys[pos])) {
+            return &leaf->values[pos];
+        }
+        return nullptr;
+    }
+
+    bool contains(const K& key) const {
+        Leaf* leaf = findLeaf(key);
+        size_t pos = lowerBound(leaf->keys, leaf->count, key);
+        return pos < leaf->count && !(key < leaf->keys[pos]);
+    }
+
+    bool remove(const K& key) {
+        if (!remove(root, key)) {
+            return false;
+        }
+        // An inner root left with a single child is no longer needed
+        if (!root->isLeaf && root->count == 0) {
+            Node* oldRoot = root;
+            root = static_cast<Inner*>(root)->children[0];
+            delete static_cast<Inner*>(oldRoot);
+        }
+        return true;
+    }
+
+    // First entry with key >= the given key
+    iterator lower_bound(const K& key) {
+        Leaf* leaf = findLeaf(key);
+        return iterator(leaf, lowerBound(leaf->keys, leaf->count, key));
+    }
+
+    // First entry with key > the given key
+    iterator upper_bound(const K& key) {
+        Leaf* leaf = findLeaf(key);
+        return iterator(leaf, upperBound(leaf->keys, leaf->count, key));
+    }
+
+    iterator begin() { return iterator(firstLeaf, 0); }
+    iterator end() { return iterator(); }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // Number of levels, including the leaf level
+    size_t height() const {
+        size_t levels = 1;
+        for (Node* node = root; !node->isLeaf; node = static_cast<Inner*>(node)->children[0]) {
+            levels++;
+        }
+        return levels;
+    }
+
+    static size_t leafCapacity() { return LeafCapacity; }
+    static size_t innerCapacity() { return InnerCapacity; }
+
+private:
+    Node* root;
+    Leaf* firstLeaf;
+    size_t size_;
+
+    // Branch-free binary search: the loop always runs log2(n) times and the
+    // comparison result selects the next base with a conditional move, so
+    // the CPU never mispredicts on the key data
+    static size_t lowerBound(const K* keys, size_t n, const K& key) {
+        if (n == 0) {
+            return 0;
+        }
+        const K* base = keys;
+        while (n > 1) {
+            size_t half = n / 2;
+            base = (base[half - 1] < key) ? base + half : base;
+            n -= half;
+        }
+        return (base - keys) + (*base < key);
+    }
+
+    static size_t upperBound(const K* keys, size_t n, const K& key) {
+        if (n == 0) {
+            return 0;
+        }
+        const K* base = keys;
+        while (n > 1) {
+            size_t half = n / 2;
+            base = (key < base[half - 1]) ? base : base + half;
+            n -= half;
+        }
+        return (base - keys) + !(key < *base);
+    }
+
+    Leaf* findLeaf(const K& key) const {
+        Node* node = root;
+        while (!node->isLeaf) {
+            Inner* inner = static_cast<Inner*>(node);
+            node = inner->children[upperBound(inner->keys, inner->count, key)];
+        }
+        return static_cast<Leaf*>(node);
+    }
+
+    // Insert into the subtree at node. If node had to split, the new right
+    // sibling is returned and separator is set to the smallest key it holds.
+    Node* insert(Node* node, const K& key, const V& value, K& separator) {
+        if (node->isLeaf) {
+            return insertIntoLeaf(static_cast<Leaf*>(node), key, value, separator);
+        }
+
+        Inner* inner = static_cast<Inner*>(node);
+        size_t childIndex = upperBound(inner->keys, inner->count, key);
+        K childSeparator;
+        Node* childRight = insert(inner->children[childIndex], key, value, childSeparator);
+        if (childRight == nullptr) {
+            return nullptr;
+        }
+        return insertIntoInner(inner, childIndex, childSeparator, childRight, separator);
+    }
+
+    Node* insertIntoLeaf(Leaf* leaf, const K& key, const V& value, K& separator) {
+        size_t pos = lowerBound(leaf->keys, leaf->count, key);
+        if (pos < leaf->count && !(key < leaf->keys[pos])) {
+            leaf->values[pos] = value;  // Update existing
+            return nullptr;
+        }
+
+        // size_ is counted once the entry is in, so a throwing new Leaf or
+        // key copy leaves it matching the tree
+        if (leaf->count < LeafCapacity) {
+            insertAt(leaf, pos, key, value);
+            size_++;
+            return nullptr;
+        }
+
+        // Full: move the upper half to a new leaf, then insert into whichever
+        // half the key belongs to
+        Leaf* right = new Leaf();
+        size_t mid = LeafCapacity / 2;
+        for (size_t i = mid; i < LeafCapacity; i++) {
+            right->keys[i - mid] = leaf->keys[i];
+            right->values[i - mid] = leaf->values[i];
+        }
+        right->count = LeafCapacity - mid;
+        leaf->count = mid;
+
+        right->next = leaf->next;
+        right->prev = leaf;
+        if (leaf->next != nullptr) {
+            leaf->next->prev = right;
+        }
+        leaf->next = right;
+
+        if (pos <= mid) {
+            insertAt(leaf, pos, key, value);
+        } else {
+            insertAt(right, pos - mid, key, value);
+        }
+        size_++;
+        separator = right->keys[0];
+        return right;
+    }
+
+    static void insertAt(Leaf* leaf, size_t pos, const K& key, const V& value) {
+        for (size_t i = leaf->count; i > pos; i--) {
+            leaf->keys[i] = leaf->keys[i - 1];
+            leaf->values[i] = leaf->values[i - 1];
+        }
+        leaf->keys[pos] = key;
+        leaf->values[pos] = value;
+        leaf->count++;
+    }
+
+    // Add (key, rightChild) after children[childIndex]; split inner if full
+    Node* insertIntoInner(Inner* inner, size_t childIndex, const K& key, Node* rightChild, K& separator) {
+        if (inner->count < InnerCapacity) {
+            for (size_t i = inner->count; i > childIndex; i--) {
+                inner->keys[i] = inner->keys[i - 1];
+                inner->children[i + 1] = inner->children[i];
+            }
+            inner->keys[childIndex] = key;
+            inner->children[childIndex + 1] = rightChild;
+            inner->count++;
+            return nullptr;
+        }
+
+        // Lay out all InnerCapacity + 1 keys in order, then promote the middle one
+        K keys[InnerCapacity + 1];
+        Node* children[InnerCapacity + 2];
+        for (size_t i = 0, j = 0; i <= InnerCapacity; i++) {
+            if (i == childIndex) {
+                keys[i] = key;
+            } else {
+                keys[i] = inner->keys[j++];
+            }
+        }
+        for (size_t i = 0, j = 0; i <= InnerCapacity + 1; i++) {
+            if (i == childIndex + 1) {
+                children[i] = rightChild;
+            } else {
+                children[i] = inner->children[j++];
+            }
+        }
+
+        size_t mid = (InnerCapacity + 1) / 2;
+        Inner* right = new Inner();
+        inner->count = mid;
+        for (size_t i = 0; i < mid; i++) {
+            inner->keys[i] = keys[i];
+            inner->children[i] = children[i];
+        }
+        inner->children[mid] = children[mid];
+
+        right->count = InnerCapacity - mid;
+        for (size_t i = 0; i < right->count; i++) {
+            right->keys[i] = keys[mid + 1 + i];
+            right->children[i] = children[mid + 1 + i];
+        }
+        right->children[right->count] = children[InnerCapacity + 1];
+
+        separator = keys[mid];
+        return right;
+    }
+
+    // Remove key from the subtree at node, repairing any child that drops
+    // below half full by borrowing from or merging with a sibling
+    bool remove(Node* node, const K& key) {
+        if (node->isLeaf) {
+            Leaf* leaf = static_cast<Leaf*>(node);
+            size_t pos = lowerBound(leaf->keys, leaf->count, key);
+            if (pos == leaf->count || key < leaf->keys[pos]) {
+                return false;
+            }
+            for (size_t i = pos + 1; i < leaf->count; i++) {
+                leaf->keys[i - 1] = leaf->keys[i];
+                leaf->values[i - 1] = leaf->values[i];
+            }
+            leaf->count--;
+            size_--;
+            return true;
+        }
+
+        Inner* inner = static_cast<Inner*>(node);
+        size_t childIndex = upperBound(inner->keys, inner->count, key);
+        if (!remove(inner->children[childIndex], key)) {
+            return false;
+        }
+        Node* child = inner->children[childIndex];
+        if (child->count < (child->isLeaf ? MinLeaf : MinInner)) {
+            rebalance(inner, childIndex);
+        }
+        return true;
+    }
+
+    void rebalance(Inner* parent, size_t childIndex) {
+        Node* child = parent->children[childIndex];
+        Node* left = childIndex > 0 ? parent->children[childIndex - 1] : nullptr;
+        Node* right = childIndex < parent->count ? parent->children[childIndex + 1] : nullptr;
+        size_t minimum = child->isLeaf ? MinLeaf : MinInner;
+
+        if (left != nullptr && left->count > minimum) {
+            borrowFromLeft(parent, childIndex);
+        } else if (right != nullptr && right->count > minimum) {
+            borrowFromRight(parent, childIndex);
+        } else if (left != nullptr) {
+            merge(parent, childIndex - 1);
+        } else {
+            merge(parent, childIndex);
+        }
+    }
+
+    void borrowFromLeft(Inner* parent, size_t childIndex) {
+        Node* child = parent->children[childIndex];
+        Node* left = parent->children[childIndex - 1];
+        if (child->isLeaf) {
+            Leaf* c = static_cast<Leaf*>(child);
+            Leaf* l = static_cast<Leaf*>(left);
+            insertAt(c, 0, l->keys[l->count - 1], l->values[l->count - 1]);
+            l->count--;
+            parent->keys[childIndex - 1] = c->keys[0];
+        } else {
+            Inner* c = static_cast<Inner*>(child);
+            Inner* l = static_cast<Inner*>(left);
+            for (size_t i = c->count; i > 0; i--) {
+                c->keys[i] = c->keys[i - 1];
+            }
+            for (size_t i = c->count + 1; i > 0; i--) {
+                c->children[i] = c->children[i - 1];
+            }
+            // Rotate through the parent separator
+            c->keys[0] = parent->keys[childIndex - 1];
+            c->children[0] = l->children[l->count];
+            c->count++;
+            parent->keys[childIndex - 1] = l->keys[l->count - 1];
+            l->count--;
+        }
+    }
+
+    void borrowFromRight(Inner* parent, size_t childIndex) {
+        Node* child = parent->children[childIndex];
+        Node* right = parent->children[childIndex + 1];
+        if (child->isLeaf) {
+            Leaf* c = static_cast<Leaf*>(child);
+            Leaf* r = static_cast<Leaf*>(right);
+            c->keys[c->count] = r->keys[0];
+            c->values[c->count] = r->values[0];
+            c->count++;
+            for (size_t i = 1; i < r->count; i++) {
+                r->keys[i - 1] = r->keys[i];
+                r->values[i - 1] = r->values[i];
+            }
+            r->count--;
+            parent->keys[childIndex] = r->keys[0];
+        } else {
+            Inner* c = static_cast<Inner*>(child);
+            Inner* r = static_cast<Inner*>(right);
+            c->keys[c->count] = parent->keys[childIndex];
+            c->children[c->count + 1] = r->children[0];
+            c->count++;
+            parent->keys[childIndex] = r->keys[0];
+            for (size_t i = 1; i < r->count; i++) {
+                r->keys[i - 1] = r->keys[i];
+            }
+            for (size_t i = 1; i <= r->count; i++) {
+                r->children[i - 1] = r->children[i];
+            }
+            r->count--;
+        }
+    }
+
+    // Merge children[index + 1] into children[index] and drop the separator
+    void merge(Inner* parent, size_t index) {
+        Node* left = parent->children[index];
+        Node* right = parent->children[index + 1];
+        if (left->isLeaf) {
+            Leaf* l = static_cast<Leaf*>(left);
+            Leaf* r = static_cast<Leaf*>(right);
+            for (size_t i = 0; i < r->count; i++) {
+                l->keys[l->count + i] = r->keys[i];
+                l->values[l->count + i] = r->values[i];
+            }
+            l->count += r->count;
+            l->next = r->next;
+            if (r->next != nullptr) {
+                r->next->prev = l;
+            }
+            delete r;
+        } else {
+            Inner* l = static_cast<Inner*>(left);
+            Inner* r = static_cast<Inner*>(right);
+            l->keys[l->count] = parent->keys[index];
+            for (size_t i = 0; i < r->count; i++) {
+                l->keys[l->count + 1 + i] = r->keys[i];
+            }
+            for (size_t i = 0; i <= r->count; i++) {
+                l->children[l->count + 1 + i] = r->children[i];
+            }
+            l->count += r->count + 1;
+            delete r;
+        }
+
+        for (size_t i = index + 1; i < parent->count; i++) {
+            parent->keys[i - 1] = parent->keys[i];
+            parent->children[i] = parent->children[i + 1];
+        }
+        parent->count--;
+    }
+
+    // Split total items into groups of at most capacity, evening out the
+    // last two groups when the final one would fall below minimum
+    static std::vector<size_t> groupSizes(size_t total, size_t capacity, size_t minimum) {
+        std::vector<size_t> sizes(total / capacity, capacity);
+        if (total % capacity != 0) {
+            sizes.push_back(total % capacity);
+        }
+        if (sizes.size() > 1 && sizes.back() < minimum) {
+            size_t pair = sizes[sizes.size() - 2] + sizes.back();
+            sizes[sizes.size() - 2] = pair - pair / 2;
+            sizes.back() = pair / 2;
+        }
+        return sizes;
+    }
+
+    // Largest key loaded so far during bulk_load
+    static const K& lastKey(Leaf* prev, Leaf* current) {
+        return current->count > 0 ? current->keys[current->count - 1] : prev->keys[prev->count - 1];
+    }
+
+    void destroy(Node* node) {
+        if (node->isLeaf) {
+            delete static_cast<Leaf*>(node);
+            return;
+        }
+        Inner* inner = static_cast<Inner*>(node);
+        for (size_t i = 0; i <= inner->count; i++) {
+            destroy(inner->children[i]);
+        }
+        delete inner;
+    }
+};
+
+#endif // BPLUS_TREE_H
@@ -0,0 +1,277 @@
+// Lesson10_btree_dictionary.cpp : This file contains the 'main' function. Program execution begins and ends there.
+//
+// Compares BPlusTree with the BSTDictionary from "Lesson10  dictionary types.md"
+// and with std::map, for random point lookups and for short range scans.
+//
+// Usage: Lesson10_btree_dictionary [keys]
+//   Default is 1000000 keys.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "BPlusTree.h"
+
+// The lesson's unbalanced BST, with find, a range scan, a depth query and
+// a destructor added so it can be benchmarked
+template<typename K, typename V>
+class BSTDictionary {
+private:
+    struct Node {
+        K key;
+        V value;
+        Node* left;
+        Node* right;
+
+        Node(const K& k, const V& v)
+            : key(k), value(v), left(nullptr), right(nullptr) {}
+    };
+
+    Node* root;
+
+    Node* insert(Node* node, const K& key, const V& value) {
+        if (node == nullptr) {
+            return new Node(key, value);
+        }
+
+        if (key < node->key) {
+            node->left = insert(node->left, key, value);
+        } else if (key > node->key) {
+            node->right = insert(node->right, key, value);
+        } else {
+            node->value = value;  // Update existing
+        }
+
+        return node;
+    }
+
+    // In-order walk of [lo, hi], skipping subtrees that cannot overlap
+    template<typename Fn>
+    void scan(Node* node, const K& lo, const K& hi, Fn& fn) const {
+        if (node == nullptr) return;
+        if (lo < node->key) scan(node->left, lo, hi, fn);
+        if (!(node->key < lo) && !(hi < node->key)) fn(node->key, node->value);
+        if (node->key < hi) scan(node->right, lo, hi, fn);
+    }
+
+    size_t depth(Node* node) const {
+        return node == nullptr ? 0 : 1 + std::max(depth(node->left), depth(node->right));
+    }
+
+    void destroy(Node* node) {
+        if (node == nullptr) return;
+        destroy(node->left);
+        destroy(node->right);
+        delete node;
+    }
+
+public:
+    BSTDictionary() : root(nullptr) {}
+    ~BSTDictionary() { destroy(root); }
+
+    void insert(const K& key, const V& value) {
+        root = insert(root, key, value);
+    }
+
+    V* find(const K& key) {
+        Node* node = root;
+        while (node != nullptr) {
+            if (key < node->key) node = node->left;
+            else if (node->key < key) node = node->right;
+            else return &node->value;
+        }
+        return nullptr;
+    }
+
+    template<typename Fn>
+    void forEachInRange(const K& lo, const K& hi, Fn fn) const {
+        scan(root, lo, hi, fn);
+    }
+
+    size_t depth() const { return depth(root); }
+};
+
+typedef std::chrono::steady_clock Clock;
+
+double nsPerOp(Clock::time_point start, size_t ops) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / ops;
+}
+
+// Insert and erase random keys and compare every result with std::map
+void sanityCheck() {
+    BPlusTree<int, int, 64> tree;   // tiny nodes so splits and merges happen often
+    std::map<int, int> reference;
+    std::mt19937 rng(5);
+
+    for (int i = 0; i < 200000; i++) {
+        int key = static_cast<int>(rng() % 20000);
+        if (rng() % 3 != 0) {
+            tree.insert(key, i);
+            reference[key] = i;
+        } else if (tree.remove(key) != (reference.erase(key) == 1)) {
+            throw std::logic_error("remove mismatch");
+        }
+    }
+
+    auto expected = reference.begin();
+    for (auto entry : tree) {
+        if (expected == reference.end() || entry.first != expected->first || entry.second != expected->second) {
+            throw std::logic_error("iteration mismatch");
+        }
+        ++expected;
+    }
+    for (int key = -1; key <= 20001; key++) {
+        auto lb = tree.lower_bound(key);
+        auto ub = tree.upper_bound(key);
+        auto rlb = reference.lower_bound(key);
+        auto rub = reference.upper_bound(key);
+        if ((lb == tree.end()) != (rlb == reference.end()) || (lb != tree.end() && lb.key() != rlb->first) ||
+            (ub == tree.end()) != (rub == reference.end()) || (ub != tree.end() && ub.key() != rub->first)) {
+            throw std::logic_error("bound mismatch at " + std::to_string(key));
+        }
+    }
+    if (expected != reference.end() || tree.size() != reference.size()) {
+        throw std::logic_error("size mismatch");
+    }
+
+    // A value whose assignment throws is not counted
+    struct ThrowingValue {
+        bool throws = false;
+        ThrowingValue() = default;
+        explicit ThrowingValue(bool throws) : throws(throws) {}
+        ThrowingValue& operator=(const ThrowingValue& other) {
+            if (other.throws) throw std::runtime_error("assign");
+            throws = other.throws;
+            return *this;
+        }
+    };
+    BPlusTree<int, ThrowingValue, 64> throwing;
+    for (int i = 0; i < 100; i++) {
+        try {
+            throwing.insert(i, ThrowingValue(i % 3 == 0));
+        } catch (const std::runtime_error&) {
+        }
+    }
+    if (throwing.size() != 66 || throwing.contains(0) || !throwing.contains(1)) {
+        throw std::logic_error("size counts an insert that threw");
+    }
+
+    std::cout << "Sanity check passed: " << tree.size() << " keys, height " << tree.height() << "\n\n";
+}
+
+int main(int argc, char* argv[]) {
+    size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    const size_t lookups = 1000000;
+    const size_t scans = 100000;
+    const uint64_t scanWidth = 100 * 16;    // keys are spaced ~16 apart, so ~100 hits per scan
+
+    sanityCheck();
+
+    // Keys are distinct multiples of 16 in random order
+    std::mt19937_64 rng(11);
+    std::vector<uint64_t> keys(n);
+    for (size_t i = 0; i < n; i++) {
+        keys[i] = i * 16;
+    }
+    std::shuffle(keys.begin(), keys.end(), rng);
+
+    std::vector<uint64_t> probes(lookups), scanStarts(scans);
+    for (uint64_t& p : probes) p = keys[rng() % n];
+    for (uint64_t& s : scanStarts) s = rng() % (n * 16);
+
+    BSTDictionary<uint64_t, uint64_t> bst;
+    std::map<uint64_t, uint64_t> stdMap;
+    BPlusTree<uint64_t, uint64_t> tree;
+
+    auto start = Clock::now();
+    for (uint64_t k : keys) bst.insert(k, k);
+    double bstInsert = nsPerOp(start, n);
+    start = Clock::now();
+    for (uint64_t k : keys) stdMap[k] = k;
+    double mapInsert = nsPerOp(start, n);
+    start = Clock::now();
+    for (uint64_t k : keys) tree.insert(k, k);
+    double treeInsert = nsPerOp(start, n);
+
+    uint64_t sumBst = 0, sumMap = 0, sumTree = 0;
+    start = Clock::now();
+    for (uint64_t k : probes) sumBst += *bst.find(k);
+    double bstFind = nsPerOp(start, lookups);
+    start = Clock::now();
+    for (uint64_t k : probes) sumMap += stdMap.find(k)->second;
+    double mapFind = nsPerOp(start, lookups);
+    start = Clock::now();
+    for (uint64_t k : probes) sumTree += *tree.find(k);
+    double treeFind = nsPerOp(start, lookups);
+
+    uint64_t scanBst = 0, scanMap = 0, scanTree = 0;
+    start = Clock::now();
+    for (uint64_t lo : scanStarts) {
+        bst.forEachInRange(lo, lo + scanWidth, [&scanBst](const uint64_t&, const uint64_t& v) { scanBst += v; });
+    }
+    double bstScan = nsPerOp(start, scans);
+    start = Clock::now();
+    for (uint64_t lo : scanStarts) {
+        for (auto it = stdMap.lower_bound(lo); it != stdMap.end() && it->first <= lo + scanWidth; ++it) {
+            scanMap += it->second;
+        }
+    }
+    double mapScan = nsPerOp(start, scans);
+    start = Clock::now();
+    for (uint64_t lo : scanStarts) {
+        for (auto it = tree.lower_bound(lo); it != tree.end() && it.key() <= lo + scanWidth; ++it) {
+            scanTree += it.value();
+        }
+    }
+    double treeScan = nsPerOp(start, scans);
+
+    if (sumBst != sumMap || sumMap != sumTree || scanBst != scanMap || scanMap != scanTree) {
+        throw std::logic_error("dictionaries disagree");
+    }
+
+    std::cout << n << " random keys, " << lookups << " lookups, " << scans << " scans of ~100 keys\n";
+    std::cout << "BPlusTree: " << tree.leafCapacity() << " entries per leaf, "
+              << tree.innerCapacity() << " keys per inner node, height " << tree.height()
+              << " (BSTDictionary depth " << bst.depth() << ")\n\n";
+    std::cout << std::left << std::setw(16) << "dictionary" << std::right
+              << std::setw(14) << "insert ns" << std::setw(14) << "lookup ns" << std::setw(14) << "scan ns" << "\n";
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << std::left << std::setw(16) << "BSTDictionary" << std::right
+              << std::setw(14) << bstInsert << std::setw(14) << bstFind << std::setw(14) << bstScan << "\n";
+    std::cout << std::left << std::setw(16) << "std::map" << std::right
+              << std::setw(14) << mapInsert << std::setw(14) << mapFind << std::setw(14) << mapScan << "\n";
+    std::cout << std::left << std::setw(16) << "BPlusTree" << std::right
+              << std::setw(14) << treeInsert << std::setw(14) << treeFind << std::setw(14) << treeScan << "\n";
+
+    // Sorted input: the BST degenerates into a list, the B+ tree stays shallow
+    const size_t sortedN = 10000;
+    BSTDictionary<uint64_t, uint64_t> sortedBst;
+    BPlusTree<uint64_t, uint64_t> sortedTree;
+    for (uint64_t k = 0; k < sortedN; k++) {
+        sortedBst.insert(k, k);
+        sortedTree.insert(k, k);
+    }
+    std::cout << "\nAfter " << sortedN << " sorted inserts: BSTDictionary depth " << sortedBst.depth()
+              << ", BPlusTree height " << sortedTree.height() << "\n";
+
+    return 0;
+}
+
+// Run program: Ctrl + F5 or Debug > Start Without Debugging menu
+// Debug program: F5 or Debug > Start Debugging menu
+
+// Tips for Getting Started:
+//   1. Use the Solution Explorer window to add/manage files
+//   2. Use the Team Explorer window to connect to source control
+//   3. Use the Output window to see build output and other messages
+//   4. Use the Error List window to view errors
+//   5. Go to Project > Add New Item to create new code files, or Project > Add Existing Item to add existing code files to the project
+//   6. In the future, to open this project again, go to File > Open > Project and select the .sln file
@@ -0,0 +1,266 @@
+// Lesson10_bulk_load.cpp : This file contains the 'main' function. Program execution begins and ends there.
+//
+// Loads a sorted "nightly snapshot" into each dictionary type twice: once a
+// key at a time through insert(), and once through bulk_load(). Then compares
+// a streaming for_each_in_range() scan with copying the range into a vector.
+//
+// Usage: Lesson10_bulk_load [keys]
+//   Default is 5000000 keys.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../Lesson10_btree_dictionary/BPlusTree.h"
+#include "../Lesson10_flat_hash_map/FlatHashMap.h"
+#include "../Lesson10_incremental_rehash/IncrementalHashTable.h"
+
+typedef std::chrono::steady_clock Clock;
+typedef std::vector<std::pair<uint64_t, uint64_t>> Snapshot;
+
+double msSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void printRow(const std::string& name, double insertMs, double bulkMs) {
+    std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(14) << insertMs << std::setw(14) << bulkMs
+              << std::setw(10) << insertMs / bulkMs << "x\n";
+}
+
+// A key whose copy after copiesLeft more throws; live counts instances, to
+// check that a failed bulk_load frees every node
+struct ThrowingKey {
+    static int live;
+    static int64_t copiesLeft;
+    uint64_t value;
+    ThrowingKey(uint64_t value = 0) : value(value) { live++; }
+    ThrowingKey(const ThrowingKey& other) : value(other.value) {
+        copied();
+        live++;
+    }
+    ThrowingKey& operator=(const ThrowingKey& other) {
+        copied();
+        value = other.value;
+        return *this;
+    }
+    ~ThrowingKey() { live--; }
+    bool operator<(const ThrowingKey& other) const { return value < other.value; }
+
+    static void copied() {
+        if (copiesLeft-- == 0) throw std::runtime_error("key copy failed");
+    }
+};
+int ThrowingKey::live = 0;
+int64_t ThrowingKey::copiesLeft = -1;
+
+// Compare a bulk-loaded tree with one built by insert(), including bounds
+// and range scans, on a size that exercises the uneven last leaf and node
+void sanityCheck() {
+    for (size_t n : { 0, 1, 31, 33, 1000, 54321 }) {
+        Snapshot data;
+        for (size_t i = 0; i < n; i++) {
+            data.push_back(std::make_pair(i * 3, i));
+        }
+        BPlusTree<uint64_t, uint64_t, 64> loaded, inserted;
+        loaded.bulk_load(data.begin(), data.end());
+        for (const auto& entry : data) {
+            inserted.insert(entry.first, entry.second);
+        }
+
+        for (uint64_t key = 0; key < n * 3 + 3; key++) {
+            uint64_t* a = loaded.find(key);
+            uint64_t* b = inserted.find(key);
+            if ((a == nullptr) != (b == nullptr) || (a != nullptr && *a != *b)) {
+                throw std::logic_error("bulk_load find mismatch at " + std::to_string(key));
+            }
+        }
+        uint64_t sumLoaded = 0, sumInserted = 0;
+        loaded.for_each_in_range(10, n, [&sumLoaded](const uint64_t& k, const uint64_t&) { sumLoaded += k; });
+        for (auto it = inserted.lower_bound(10); it != inserted.end() && it.key() <= n; ++it) {
+            sumInserted += it.key();
+        }
+        if (sumLoaded != sumInserted || loaded.size() != n) {
+            throw std::logic_error("bulk_load range mismatch");
+        }
+        // Both trees must stay fully usable after a bulk load
+        for (size_t i = 0; i < n; i += 2) {
+            loaded.remove(i * 3);
+        }
+        loaded.insert(1, 1);
+        if (loaded.size() != n - (n + 1) / 2 + 1) {
+            throw std::logic_error("bulk_load tree broken after updates");
+        }
+    }
+
+    Snapshot unsorted = { { 2, 0 }, { 1, 0 } };
+    BPlusTree<uint64_t, uint64_t> tree;
+    try {
+        tree.bulk_load(unsorted.begin(), unsorted.end());
+        throw std::logic_error("bulk_load accepted unsorted input");
+    } catch (const std::invalid_argument&) {
+    }
+
+    // A key copy that throws while the inner levels are built (the last
+    // copy is a separator of the root) leaves an empty, usable tree
+    {
+        std::vector<std::pair<ThrowingKey, uint64_t>> keys;
+        for (uint64_t i = 0; i < 5000; i++) {
+            keys.push_back(std::make_pair(ThrowingKey(i), i));
+        }
+        int before = ThrowingKey::live;
+        {
+            BPlusTree<ThrowingKey, uint64_t, 64> counted;
+            ThrowingKey::copiesLeft = int64_t{1} << 40;
+            counted.bulk_load(keys.begin(), keys.end());
+        }
+        int64_t copies = (int64_t{1} << 40) - ThrowingKey::copiesLeft;
+        {
+            BPlusTree<ThrowingKey, uint64_t, 64> failed;
+            ThrowingKey::copiesLeft = copies - 1;
+            try {
+                failed.bulk_load(keys.begin(), keys.end());
+                throw std::logic_error("bulk_load did not rethrow");
+            } catch (const std::runtime_error&) {
+            }
+            ThrowingKey::copiesLeft = -1;
+            failed.insert(ThrowingKey(7), 7);
+            if (failed.size() != 1 || failed.find(ThrowingKey(7)) == nullptr) {
+                throw std::logic_error("tree unusable after a failed bulk_load");
+            }
+        }
+        if (ThrowingKey::live != before) {
+            throw std::logic_error("failed bulk_load leaked nodes");
+        }
+    }
+    std::cout << "Sanity check passed\n\n";
+}
+
+int main(int argc, char* argv[]) {
+    size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 5000000;
+
+    sanityCheck();
+
+    Snapshot snapshot(n);
+    for (size_t i = 0; i < n; i++) {
+        snapshot[i] = std::make_pair(static_cast<uint64_t>(i) * 2, static_cast<uint64_t>(i));
+    }
+
+    std::cout << "Loading " << n << " sorted keys (ms)\n";
+    std::cout << std::left << std::setw(24) << "dictionary" << std::right
+              << std::setw(14) << "insert()" << std::setw(14) << "bulk_load()" << std::setw(11) << "speedup" << "\n";
+
+    double insertMs, bulkMs;
+    {
+        BPlusTree<uint64_t, uint64_t> tree;
+        auto start = Clock::now();
+        for (const auto& entry : snapshot) tree.insert(entry.first, entry.second);
+        insertMs = msSince(start);
+    }
+    {
+        BPlusTree<uint64_t, uint64_t> tree;
+        auto start = Clock::now();
+        tree.bulk_load(snapshot.begin(), snapshot.end());
+        bulkMs = msSince(start);
+    }
+    printRow("BPlusTree", insertMs, bulkMs);
+
+    {
+        std::map<uint64_t, uint64_t> map;
+        auto start = Clock::now();
+        for (const auto& entry : snapshot) map.insert(entry);
+        insertMs = msSince(start);
+    }
+    {
+        // The closest std::map gets: insert with an end() hint
+        std::map<uint64_t, uint64_t> map;
+        auto start = Clock::now();
+        for (const auto& entry : snapshot) map.insert(map.end(), entry);
+        bulkMs = msSince(start);
+    }
+    printRow("std::map (end hint)", insertMs, bulkMs);
+
+    {
+        FlatHashMap<uint64_t, uint64_t> map;
+        auto start = Clock::now();
+        for (const auto& entry : snapshot) map.insert(entry.first, entry.second);
+        insertMs = msSince(start);
+    }
+    {
+        FlatHashMap<uint64_t, uint64_t> map;
+        auto start = Clock::now();
+        map.bulk_load(snapshot.begin(), snapshot.end());
+        bulkMs = msSince(start);
+    }
+    printRow("FlatHashMap", insertMs, bulkMs);
+
+    {
+        IncrementalHashTable<uint64_t, uint64_t> table;
+        auto start = Clock::now();
+        for (const auto& entry : snapshot) table.insert(entry.first, entry.second);
+        insertMs = msSince(start);
+    }
+    {
+        IncrementalHashTable<uint64_t, uint64_t> table;
+        auto start = Clock::now();
+        table.bulk_load(snapshot.begin(), snapshot.end());
+        bulkMs = msSince(start);
+    }
+    printRow("IncrementalHashTable", insertMs, bulkMs);
+
+    // Range scans over the loaded tree: stream versus materialize
+    BPlusTree<uint64_t, uint64_t> tree;
+    tree.bulk_load(snapshot.begin(), snapshot.end());
+    std::mt19937_64 rng(3);
+    const size_t scans = 2000;
+    const uint64_t width = 20000;   // ~10000 entries per scan
+    std::vector<uint64_t> starts(scans);
+    for (uint64_t& s : starts) s = rng() % (2 * n);
+
+    uint64_t streamed = 0;
+    auto start = Clock::now();
+    for (uint64_t lo : starts) {
+        tree.for_each_in_range(lo, lo + width, [&streamed](const uint64_t&, const uint64_t& v) { streamed += v; });
+    }
+    double streamMs = msSince(start);
+
+    uint64_t copied = 0;
+    start = Clock::now();
+    for (uint64_t lo : starts) {
+        Snapshot result;
+        for (auto it = tree.lower_bound(lo); it != tree.end() && it.key() <= lo + width; ++it) {
+            result.push_back(std::make_pair(it.key(), it.value()));
+        }
+        for (const auto& entry : result) copied += entry.second;
+    }
+    double copyMs = msSince(start);
+
+    if (streamed != copied) {
+        throw std::logic_error("range scans disagree");
+    }
+    std::cout << "\n" << scans << " range scans of ~" << width / 2 << " entries (ms)\n";
+    std::cout << std::left << std::setw(24) << "for_each_in_range" << std::right << std::fixed << std::setprecision(1)
+              << std::setw(14) << streamMs << "\n";
+    std::cout << std::left << std::setw(24) << "copy into vector" << std::right << std::setw(14) << copyMs << "\n";
+
+    return 0;
+}
+
+// Run program: Ctrl + F5 or Debug > Start Without Debugging menu
+// Debug program: F5 or Debug > Start Debugging menu
+
+// Tips for Getting Started:
+//   1. Use the Solution Explorer window to add/manage files
+//   2. Use the Team Explorer window to connect to source control
+//   3. Use the Output window to see build output and other messages
+//   4. Use the Error List window to view errors
+//   5. Go to Project > Add New Item to create new code files, or Project > Add Existing Item to add existing code files to the project
+//   6. In the future, to open this project again, go to File > Open > Project and select the .sln file
@@ -0,0 +1,435 @@
+// FlatHashMap.h
+//
+// Header-only open-addressing hash map in the style of a "Swiss table".
+//
+// Instead of the `bool occupied` flag in every Entry of the Lesson 10
+// HashTable, the table keeps a separate array of one-byte control values:
+//
+//   kEmpty (0x80)   the slot is free
+//   0x00 - 0x7F     the slot is full; the byte holds 7 bits of the key's hash
+//
+// A lookup loads 16 control bytes at once and compares them all against the
+// 7-bit hash fragment with a single SSE2 instruction, so only slots whose
+// fragment matches ever have their keys compared.
+//
+// Probing is linear at slot granularity, which means deletion can shift the
+// following entries back into the hole ("backward shift deletion"). No
+// tombstones are ever left behind, so lookups never slow down after many
+// removals and the table never needs a cleanup rehash.
+//
+// Growing and bulk_load are PROFILE_ZONEs (ProfilerMacros.h), which cost
+// nothing unless the program is built with PROFILER_ENABLED.
+
+#ifndef FLAT_HASH_MAP_H
+#define FLAT_HASH_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FLAT_HASH_MAP_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "../Lesson15_profiler/ProfilerMacros.h"
+
+namespace flat_hash_detail {
+
+const int8_t kEmpty = -128;          // 0x80: high bit set means "no key here"
+const size_t kGroupWidth = 16;       // control bytes compared per probe step
+const size_t kMinCapacity = 16;
+
+// Index of the lowest set bit. The argument must be non-zero.
+inline unsigned countTrailingZeros(uint32_t x) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, x);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(x));
+#endif
+}
+
+// A window of 16 control bytes starting at an arbitrary slot.
+class ProbeGroup {
+public:
+    explicit ProbeGroup(const int8_t* ctrl) {
+#ifdef FLAT_HASH_MAP_SSE2
+        bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+#else
+        std::memcpy(bytes, ctrl, kGroupWidth);
+#endif
+    }
+
+    // Bit i is set when control byte i equals the hash fragment h2
+    uint32_t match(int8_t h2) const {
+#ifdef FLAT_HASH_MAP_SSE2
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), bytes)));
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < kGroupWidth; i++) {
+            if (bytes[i] == h2) mask |= 1u << i;
+        }
+        return mask;
+#endif
+    }
+
+    // Bit i is set when control byte i is kEmpty
+    uint32_t matchEmpty() const {
+#ifdef FLAT_HASH_MAP_SSE2
+        // Full slots hold 0x00-0x7F, so the sign bit alone identifies kEmpty
+        return static_cast<uint32_t>(_mm_movemask_epi8(bytes));
+#else
+        return match(kEmpty);
+#endif
+    }
+
+private:
+#ifdef FLAT_HASH_MAP_SSE2
+    __m128i bytes;
+#else
+    int8_t bytes[kGroupWidth];
+#endif
+};
+
+} // namespace flat_hash_detail
+
+/**
+ * @brief Open-addressing hash map with 16-wide SIMD group probing.
+ *
+ * Grows automatically (doubling) once size() would exceed
+ * capacity() * maxLoadFactor(). Pointers returned by find() are invalidated
+ * by any insert that grows the table and by remove().
+ */
+template<typename K, typename V, typename Hash = std::hash<K>, typename KeyEqual = std::equal_to<K>>
+class FlatHashMap {
+public:
+    explicit FlatHashMap(size_t initialCapacity = 0, float maxLoadFactor = 0.875f)
+        : ctrl(nullptr), slots(nullptr), capacity_(0), size_(0), growthLimit(0), maxLoad(maxLoadFactor) {
+        if (!(maxLoadFactor > 0.0f && maxLoadFactor < 1.0f)) {
+            throw std::invalid_argument("FlatHashMap: max load factor must be in (0, 1)");
+        }
+        if (initialCapacity > 0) {
+            reserve(initialCapacity);
+        }
+    }
+
+    FlatHashMap(const FlatHashMap& other)
+        : FlatHashMap(0, other.maxLoad) {
+        reserve(other.size_);
+        other.forEach([this](const K& key, const V& value) { insert(key, value); });
+    }
+
+    FlatHashMap(FlatHashMap&& other) noexcept
+        : ctrl(other.ctrl), slots(other.slots), capacity_(other.capacity_), size_(other.size_),
+          growthLimit(other.growthLimit), maxLoad(other.maxLoad), hasher(std::move(other.hasher)),
+          equal(std::move(other.equal)) {
+        other.ctrl = nullptr;
+        other.slots = nullptr;
+        other.capacity_ = other.size_ = other.growthLimit = 0;
+    }
+
+    FlatHashMap& operator=(FlatHashMap other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    ~FlatHashMap() {
+        destroyAll();
+        deallocate(ctrl, slots);
+    }
+
+    void swap(FlatHashMap& other) noexcept {
+        std::swap(ctrl, other.ctrl);
+        std::swap(slots, other.slots);
+        std::swap(capacity_, other.capacity_);
+        std::swap(size_, other.size_);
+        std::swap(growthLimit, other.growthLimit);
+        std::swap(maxLoad, other.maxLoad);
+        std::swap(hasher, other.hasher);
+        std::swap(equal, other.equal);
+    }
+
+    // Insert a new key or update the value of an existing one
+    void insert(const K& key, const V& value) {
+        size_t hash = hashOf(key);
+        size_t index = findIndex(key, hash);
+        if (index != npos) {
+            slots[index].second = value;
+            return;
+        }
+        index = prepareInsert(hash);
+        new (&slots[index]) Slot(key, value);
+        claim(index, hash);
+    }
+
+    void insert(K&& key, V&& value) {
+        size_t hash = hashOf(key);
+        size_t index = findIndex(key, hash);
+        if (index != npos) {
+            slots[index].second = std::move(value);
+            return;
+        }
+        index = prepareInsert(hash);
+        new (&slots[index]) Slot(std::move(key), std::move(value));
+        claim(index, hash);
+    }
+
+    // Returns a reference to the value for key, default-constructing it if absent
+    V& operator[](const K& key) {
+        size_t hash = hashOf(key);
+        size_t index = findIndex(key, hash);
+        if (index != npos) {
+            return slots[index].second;
+        }
+        index = prepareInsert(hash);
+        new (&slots[index]) Slot(key, V());
+        claim(index, hash);
+        return slots[index].second;
+    }
+
+    V* find(const K& key) {
+        size_t index = findIndex(key, hashOf(key));
+        return index == npos ? nullptr : &slots[index].second;
+    }
+
+    const V* find(const K& key) const {
+        size_t index = findIndex(key, hashOf(key));
+        return index == npos ? nullptr : &slots[index].second;
+    }
+
+    bool contains(const K& key) const {
+        return findIndex(key, hashOf(key)) != npos;
+    }
+
+    // Remove key; later entries of the same probe run are shifted back so no
+    // tombstone is needed
+    bool remove(const K& key) {
+        size_t hole = findIndex(key, hashOf(key));
+        if (hole == npos) {
+            return false;
+        }
+        const size_t mask = capacity_ - 1;
+        slots[hole].~Slot();
+
+        size_t next = hole;
+        while (true) {
+            next = (next + 1) & mask;
+            if (ctrl[next] == flat_hash_detail::kEmpty) {
+                break;
+            }
+            size_t home = (hashOf(slots[next].first) >> 7) & mask;
+            // The entry may fill the hole only if the hole lies on its probe
+            // path, i.e. between its home slot and where it currently sits
+            if (((next - home) & mask) >= ((next - hole) & mask)) {
+                new (&slots[hole]) Slot(std::move(slots[next]));
+                slots[next].~Slot();
+                setCtrl(hole, ctrl[next]);
+                hole = next;
+            }
+        }
+        setCtrl(hole, flat_hash_detail::kEmpty);
+        size_--;
+        return true;
+    }
+
+    // Make room for at least n entries without further growth
+    void reserve(size_t n) {
+        size_t needed = flat_hash_detail::kMinCapacity;
+        while (limitFor(needed) < n) {
+            needed *= 2;
+        }
+        if (needed > capacity_) {
+            resize(needed);
+        }
+    }
+
+    /**
+     * @brief Replace the contents with a range of (key, value) pairs.
+     *
+     * The table is sized for the whole range before the first insert, so it
+     * never grows part way through. Later duplicates overwrite earlier ones.
+     */
+    template<typename ForwardIt>
+    void bulk_load(ForwardIt first, ForwardIt last) {
+        PROFILE_ZONE("FlatHashMap::bulk_load");
+        clear();
+        reserve(static_cast<size_t>(std::distance(first, last)));
+        for (; first != last; ++first) {
+            insert(first->first, first->second);
+        }
+    }
+
+    void clear() {
+        destroyAll();
+        if (ctrl != nullptr) {
+            std::memset(ctrl, static_cast<unsigned char>(flat_hash_detail::kEmpty),
+                        capacity_ + flat_hash_detail::kGroupWidth - 1);
+        }
+        size_ = 0;
+    }
+
+    // Calls fn(key, value) for every entry, in table order
+    template<typename Fn>
+    void forEach(Fn fn) const {
+        for (size_t i = 0; i < capacity_; i++) {
+            if (ctrl[i] != flat_hash_detail::kEmpty) {
+                fn(slots[i].first, slots[i].second);
+            }
+        }
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_t capacity() const { return capacity_; }
+    float maxLoadFactor() const { return maxLoad; }
+
+    float loadFactor() const {
+        return capacity_ == 0 ? 0.0f : static_cast<float>(size_) / capacity_;
+    }
+
+private:
+    typedef std::pair<K, V> Slot;
+    static const size_t npos = static_cast<size_t>(-1);
+
+    int8_t* ctrl;        // capacity_ + kGroupWidth - 1 bytes (tail mirrors the head)
+    Slot* slots;         // raw storage; only slots whose ctrl byte is full are constructed
+    size_t capacity_;    // always 0 or a power of two >= kMinCapacity
+    size_t size_;
+    size_t growthLimit;
+    float maxLoad;
+    Hash hasher;
+    KeyEqual equal;
+
+    // std::hash of an integer is the identity on several standard libraries,
+    // so mix the bits before splitting into H1 (probe start) and H2 (tag)
+    size_t hashOf(const K& key) const {
+        uint64_t h = static_cast<uint64_t>(hasher(key));
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return static_cast<size_t>(h);
+    }
+
+    size_t limitFor(size_t capacity) const {
+        size_t limit = static_cast<size_t>(capacity * static_cast<double>(maxLoad));
+        // Always keep at least one empty slot so every probe terminates
+        return limit < capacity ? limit : capacity - 1;
+    }
+
+    size_t findIndex(const K& key, size_t hash) const {
+        if (capacity_ == 0) {
+            return npos;
+        }
+        const size_t mask = capacity_ - 1;
+        const int8_t h2 = static_cast<int8_t>(hash & 0x7F);
+        size_t pos = (hash >> 7) & mask;
+        while (true) {
+            flat_hash_detail::ProbeGroup group(ctrl + pos);
+            for (uint32_t m = group.match(h2); m != 0; m &= m - 1) {
+                size_t index = (pos + flat_hash_detail::countTrailingZeros(m)) & mask;
+                if (equal(slots[index].first, key)) {
+                    return index;
+                }
+            }
+            // An empty slot ends the probe run: the key cannot be further on
+            if (group.matchEmpty() != 0) {
+                return npos;
+            }
+            pos = (pos + flat_hash_detail::kGroupWidth) & mask;
+        }
+    }
+
+    // First empty slot on the probe path of hash; the table must have room
+    size_t findEmpty(size_t hash) const {
+        const size_t mask = capacity_ - 1;
+        size_t pos = (hash >> 7) & mask;
+        while (true) {
+            uint32_t m = flat_hash_detail::ProbeGroup(ctrl + pos).matchEmpty();
+            if (m != 0) {
+                return (pos + flat_hash_detail::countTrailingZeros(m)) & mask;
+            }
+            pos = (pos + flat_hash_detail::kGroupWidth) & mask;
+        }
+    }
+
+    // Empty slot for a key known to be absent, growing first if needed. The
+    // caller constructs the slot and then claim()s it, so a constructor that
+    // throws leaves the slot empty
+    size_t prepareInsert(size_t hash) {
+        if (size_ >= growthLimit) {
+            resize(capacity_ == 0 ? flat_hash_detail::kMinCapacity : capacity_ * 2);
+        }
+        return findEmpty(hash);
+    }
+
+    void claim(size_t index, size_t hash) {
+        setCtrl(index, static_cast<int8_t>(hash & 0x7F));
+        size_++;
+    }
+
+    void setCtrl(size_t index, int8_t value) {
+        ctrl[index] = value;
+        // Mirror the first group so a 16-byte load near the end wraps around
+        if (index < flat_hash_detail::kGroupWidth - 1) {
+            ctrl[capacity_ + index] = value;
+        }
+    }
+
+    void resize(size_t newCapacity) {
+        PROFILE_ZONE("FlatHashMap::resize");
+        int8_t* oldCtrl = ctrl;
+        Slot* oldSlots = slots;
+        size_t oldCapacity = capacity_;
+
+        ctrl = static_cast<int8_t*>(::operator new(newCapacity + flat_hash_detail::kGroupWidth - 1));
+        try {
+            slots = static_cast<Slot*>(::operator new(newCapacity * sizeof(Slot)));
+        } catch (...) {
+            ::operator delete(ctrl);
+            ctrl = oldCtrl;
+            throw;
+        }
+        std::memset(ctrl, static_cast<unsigned char>(flat_hash_detail::kEmpty),
+                    newCapacity + flat_hash_detail::kGroupWidth - 1);
+        capacity_ = newCapacity;
+        growthLimit = limitFor(newCapacity);
+
+        // Keys are already unique, so each one goes straight to an empty slot
+        for (size_t i = 0; i < oldCapacity; i++) {
+            if (oldCtrl[i] != flat_hash_detail::kEmpty) {
+                size_t hash = hashOf(oldSlots[i].first);
+                size_t index = findEmpty(hash);
+                setCtrl(index, static_cast<int8_t>(hash & 0x7F));
+                new (&slots[index]) Slot(std::move(oldSlots[i]));
+                oldSlots[i].~Slot();
+            }
+        }
+        deallocate(oldCtrl, oldSlots);
+    }
+
+    void destroyAll() {
+        for (size_t i = 0; i < capacity_; i++) {
+            if (ctrl[i] != flat_hash_detail::kEmpty) {
+                slots[i].~Slot();
+            }
+        }
+    }
+
+    static void deallocate(int8_t* c, Slot* s) {
+        ::operator delete(c);
+        ::operator delete(s);
+    }
+};
+
+#endif // FLAT_HASH_MAP_H
@@ -0,0 +1,299 @@
+// Lesson10_flat_hash_map.cpp : This file contains the 'main' function. Program execution begins and ends there.
+//
+// Benchmarks FlatHashMap against the HashTable and HashTableChaining classes
+// from "Lesson10  dictionary types.md" and against std::unordered_map.
+//
+// Usage: Lesson10_flat_hash_map [maxKeys]
+//   Runs 1M keys and then every 10x step up to maxKeys (default 1000000).
+//   Pass 100000000 for the full 1M - 100M sweep (needs several GB of RAM).
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "FlatHashMap.h"
+
+// Linear probing table from section 4.4 of the lesson, with a find() added
+// so it can be benchmarked. It cannot grow, so it is created pre-sized.
+template<typename K, typename V>
+class HashTable {
+private:
+    struct Entry {
+        K key;
+        V value;
+        bool occupied;
+
+        Entry() : occupied(false) {}
+    };
+
+    Entry* table;
+    size_t capacity;
+    size_t size;
+
+    size_t hash(const K& key) const {
+        return std::hash<K>{}(key) % capacity;
+    }
+
+    size_t probe(size_t index, size_t attempt) const {
+        return (index + attempt) % capacity;  // Linear probing
+    }
+
+public:
+    HashTable(size_t cap = 997) : capacity(cap), size(0) {
+        table = new Entry[capacity];
+    }
+
+    ~HashTable() {
+        delete[] table;
+    }
+
+    void insert(const K& key, const V& value) {
+        size_t index = hash(key);
+        size_t attempt = 0;
+
+        while (attempt < capacity) {
+            size_t curr = probe(index, attempt);
+
+            if (!table[curr].occupied) {
+                table[curr].key = key;
+                table[curr].value = value;
+                table[curr].occupied = true;
+                size++;
+                return;
+            }
+
+            if (table[curr].key == key) {
+                table[curr].value = value;
+                return;
+            }
+
+            attempt++;
+        }
+
+        throw std::runtime_error("Hash table is full");
+    }
+
+    V* find(const K& key) {
+        size_t index = hash(key);
+        for (size_t attempt = 0; attempt < capacity; attempt++) {
+            size_t curr = probe(index, attempt);
+            if (!table[curr].occupied) return nullptr;
+            if (table[curr].key == key) return &table[curr].value;
+        }
+        return nullptr;
+    }
+};
+
+// Separate chaining table from section 4.3 of the lesson, with the missing
+// hash(), a find() and a destructor added
+template<typename K, typename V>
+class HashTableChaining {
+private:
+    struct Node {
+        K key;
+        V value;
+        Node* next;
+        Node(const K& k, const V& v) : key(k), value(v), next(nullptr) {}
+    };
+
+    std::vector<Node*> table;
+    size_t size;
+
+    size_t hash(const K& key) const {
+        return std::hash<K>{}(key) % table.size();
+    }
+
+public:
+    HashTableChaining(size_t capacity = 997) : table(capacity, nullptr), size(0) {}
+
+    ~HashTableChaining() {
+        for (Node* head : table) {
+            while (head != nullptr) {
+                Node* next = head->next;
+                delete head;
+                head = next;
+            }
+        }
+    }
+
+    void insert(const K& key, const V& value) {
+        size_t index = hash(key);
+        Node* current = table[index];
+
+        // Check if key exists
+        while (current != nullptr) {
+            if (current->key == key) {
+                current->value = value;  // Update existing
+                return;
+            }
+            current = current->next;
+        }
+
+        // Insert new node at beginning of chain
+        Node* newNode = new Node(key, value);
+        newNode->next = table[index];
+        table[index] = newNode;
+        size++;
+    }
+
+    V* find(const K& key) {
+        for (Node* current = table[hash(key)]; current != nullptr; current = current->next) {
+            if (current->key == key) return &current->value;
+        }
+        return nullptr;
+    }
+};
+
+// Adapter so std::unordered_map exposes the same insert/find shape
+template<typename K, typename V>
+class StdUnorderedMap {
+public:
+    explicit StdUnorderedMap(size_t) {}
+    void insert(const K& key, const V& value) { map[key] = value; }
+    V* find(const K& key) {
+        auto it = map.find(key);
+        return it == map.end() ? nullptr : &it->second;
+    }
+private:
+    std::unordered_map<K, V> map;
+};
+
+template<typename K, typename V>
+class FlatAdapter {
+public:
+    explicit FlatAdapter(size_t) {}
+    void insert(const K& key, const V& value) { map.insert(key, value); }
+    V* find(const K& key) { return map.find(key); }
+private:
+    FlatHashMap<K, V> map;
+};
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Insert every key, look every key up, then look up keys that are absent.
+// The table capacity hint is only used by the fixed-size lesson tables.
+template<typename Table>
+void runBenchmark(const std::string& name, size_t capacityHint,
+                  const std::vector<uint64_t>& keys, const std::vector<uint64_t>& missing) {
+    Table* table = new Table(capacityHint);
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < keys.size(); i++) {
+        table->insert(keys[i], i);
+    }
+    double insertMs = millisecondsSince(start);
+
+    uint64_t checksum = 0;
+    start = std::chrono::steady_clock::now();
+    for (uint64_t key : keys) {
+        checksum += *table->find(key);
+    }
+    double hitMs = millisecondsSince(start);
+
+    size_t found = 0;
+    start = std::chrono::steady_clock::now();
+    for (uint64_t key : missing) {
+        found += table->find(key) != nullptr;
+    }
+    double missMs = millisecondsSince(start);
+
+    delete table;
+
+    double n = static_cast<double>(keys.size());
+    std::cout << std::left << std::setw(20) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(12) << insertMs * 1e6 / n
+              << std::setw(12) << hitMs * 1e6 / n
+              << std::setw(12) << missMs * 1e6 / n
+              << "   (checksum " << checksum << ", false hits " << found << ")\n";
+}
+
+void sanityCheck() {
+    FlatHashMap<int, std::string> map;
+    for (int i = 0; i < 1000; i++) {
+        map.insert(i, std::to_string(i));
+    }
+    for (int i = 0; i < 1000; i += 2) {
+        map.remove(i);
+    }
+    for (int i = 0; i < 1000; i++) {
+        const std::string* value = map.find(i);
+        if ((i % 2 == 0) != (value == nullptr) || (value != nullptr && *value != std::to_string(i))) {
+            throw std::logic_error("FlatHashMap sanity check failed at key " + std::to_string(i));
+        }
+    }
+
+    // A value whose copy throws leaves no half-inserted slot behind
+    struct ThrowingValue {
+        bool throws = false;
+        ThrowingValue() = default;
+        explicit ThrowingValue(bool throws) : throws(throws) {}
+        ThrowingValue(const ThrowingValue& other) : throws(other.throws) {
+            if (throws) throw std::runtime_error("copy");
+        }
+        ThrowingValue& operator=(const ThrowingValue&) = default;
+    };
+    FlatHashMap<int, ThrowingValue> throwing;
+    for (int i = 0; i < 100; i++) {
+        try {
+            throwing.insert(i, ThrowingValue(i % 3 == 0));
+        } catch (const std::runtime_error&) {
+        }
+    }
+    for (int i = 0; i < 100; i++) {
+        if ((i % 3 == 0) != (throwing.find(i) == nullptr)) {
+            throw std::logic_error("FlatHashMap kept a slot whose value threw at key " + std::to_string(i));
+        }
+    }
+    if (throwing.size() != 66) throw std::logic_error("FlatHashMap counted slots whose value threw");
+
+    std::cout << "Sanity check passed: " << map.size() << " keys, capacity " << map.capacity()
+              << ", load factor " << map.loadFactor() << "\n\n";
+}
+
+int main(int argc, char* argv[]) {
+    size_t maxKeys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+
+    sanityCheck();
+
+    for (size_t n = 1000000; n <= maxKeys; n *= 10) {
+        std::mt19937_64 rng(n);
+        std::vector<uint64_t> keys(n), missing(n);
+        for (size_t i = 0; i < n; i++) {
+            keys[i] = rng();
+            missing[i] = rng();
+        }
+
+        std::cout << n << " keys" << "\n";
+        std::cout << std::left << std::setw(20) << "table" << std::right
+                  << std::setw(12) << "insert ns" << std::setw(12) << "hit ns" << std::setw(12) << "miss ns" << "\n";
+
+        // The lesson tables cannot grow, so give them room up front
+        runBenchmark<HashTable<uint64_t, uint64_t>>("HashTable", n * 10 / 7 + 1, keys, missing);
+        runBenchmark<HashTableChaining<uint64_t, uint64_t>>("HashTableChaining", n, keys, missing);
+        runBenchmark<StdUnorderedMap<uint64_t, uint64_t>>("std::unordered_map", n, keys, missing);
+        runBenchmark<FlatAdapter<uint64_t, uint64_t>>("FlatHashMap", n, keys, missing);
+        std::cout << "\n";
+    }
+
+    return 0;
+}
+
+// Run program: Ctrl + F5 or Debug > Start Without Debugging menu
+// Debug program: F5 or Debug > Start Debugging menu
+
+// Tips for Getting Started:
+//   1. Use the Solution Explorer window to add/manage files
+//   2. Use the Team Explorer window to connect to source control
+//   3. Use the Output window to see build output and other messages
+//   4. Use the Error List window to view errors
+//   5. Go to Project > Add New Item to create new code files, or Project > Add Existing Item to add existing code files to the project
+//   6. In the future, to open this project again, go to File > Open > Project and select the .sln file
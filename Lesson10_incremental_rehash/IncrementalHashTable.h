@@ -0,0 +1,295 @@
+// IncrementalHashTable.h
+//
+// Separate-chaining hash table whose resize is spread across later operations.
+//
+// The rehash() in "Lesson10  dictionary types.md" re-inserts every entry in a
+// single call, so one unlucky insert pays O(n). Here a resize only allocates
+// the new bucket array; the old array stays live and each insert, find or
+// remove moves a small, fixed number of old buckets across.
+//
+// Bucket counts are powers of two, so old bucket b splits exactly into new
+// buckets b and b + oldCount. Old buckets [0, cursor) have been migrated and
+// the rest have not, which means every key lives in exactly one table and a
+// lookup never has to search both:
+//
+//   b = hash & (oldCount - 1)
+//   b <  cursor  ->  look in the new table at hash & (bucketCount - 1)
+//   b >= cursor  ->  look in the old table at b
+//
+// New buckets are only written when their old bucket is migrated, so the new
+// array does not even need to be cleared up front.
+
+#ifndef INCREMENTAL_HASH_TABLE_H
+#define INCREMENTAL_HASH_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+/**
+ * @brief Chaining hash table with amortized (incremental) rehashing.
+ *
+ * In ResizeMode::Incremental no single operation does more than
+ * migrateStep bucket moves of resize work. ResizeMode::StopTheWorld
+ * migrates everything at once, as the lesson's rehash() does, and exists
+ * so the two behaviours can be compared.
+ */
+template<typename K, typename V, typename Hash = std::hash<K>>
+class IncrementalHashTable {
+public:
+    enum class ResizeMode { Incremental, StopTheWorld };
+
+    explicit IncrementalHashTable(size_t initialBuckets = 1024,
+                                  ResizeMode mode = ResizeMode::Incremental,
+                                  float maxLoadFactor = 1.0f,
+                                  size_t migrateStep = 8)
+        : buckets(nullptr), bucketCount_(1), oldBuckets(nullptr), oldCount(0), cursor(0), size_(0),
+          mode_(mode), maxLoad(maxLoadFactor), step(migrateStep) {
+        if (!(maxLoadFactor > 0.0f)) {
+            throw std::invalid_argument("IncrementalHashTable: max load factor must be positive");
+        }
+        if (migrateStep == 0) {
+            throw std::invalid_argument("IncrementalHashTable: migrate step must be at least 1");
+        }
+        while (bucketCount_ < initialBuckets) {
+            bucketCount_ *= 2;
+        }
+        buckets = new Node*[bucketCount_]();
+    }
+
+    IncrementalHashTable(const IncrementalHashTable&) = delete;
+    IncrementalHashTable& operator=(const IncrementalHashTable&) = delete;
+
+    ~IncrementalHashTable() {
+        forEachNode([](Node* node) { delete node; });
+        delete[] buckets;
+        delete[] oldBuckets;
+    }
+
+    // Insert a new key or update the value of an existing one
+    void insert(const K& key, const V& value) {
+        migrateSome();
+        size_t hash = hashOf(key);
+        if (Node* node = findNode(key, hash)) {
+            node->value = value;
+            return;
+        }
+        if (!isRehashing() && size_ + 1 > maxLoad * bucketCount_) {
+            startResize();
+        }
+        Node** head = bucketFor(hash);
+        *head = new Node(key, value, hash, *head);
+        size_++;
+    }
+
+    /**
+     * @brief Replace the contents with a range of (key, value) pairs.
+     *
+     * The bucket array is sized for the whole range up front, so loading
+     * never triggers a rehash. Later duplicates overwrite earlier ones.
+     */
+    template<typename ForwardIt>
+    void bulk_load(ForwardIt first, ForwardIt last) {
+        clear();
+        size_t n = static_cast<size_t>(std::distance(first, last));
+        size_t needed = bucketCount_;
+        while (n > maxLoad * needed) {
+            needed *= 2;
+        }
+        if (needed != bucketCount_) {
+            Node** bigger = new Node*[needed]();
+            delete[] buckets;
+            buckets = bigger;
+            bucketCount_ = needed;
+        }
+        for (; first != last; ++first) {
+            insert(first->first, first->second);
+        }
+    }
+
+    // Remove every entry; the bucket count is kept
+    void clear() {
+        forEachNode([](Node* node) { delete node; });
+        delete[] oldBuckets;
+        oldBuckets = nullptr;
+        oldCount = 0;
+        cursor = 0;
+        // Buckets of a partly migrated table may be uninitialized
+        for (size_t b = 0; b < bucketCount_; b++) {
+            buckets[b] = nullptr;
+        }
+        size_ = 0;
+    }
+
+    V* find(const K& key) {
+        migrateSome();
+        Node* node = findNode(key, hashOf(key));
+        return node == nullptr ? nullptr : &node->value;
+    }
+
+    // Const lookup; does not advance a running migration
+    bool contains(const K& key) const {
+        return findNode(key, hashOf(key)) != nullptr;
+    }
+
+    bool remove(const K& key) {
+        migrateSome();
+        size_t hash = hashOf(key);
+        for (Node** link = bucketFor(hash); *link != nullptr; link = &(*link)->next) {
+            if ((*link)->hash == hash && (*link)->key == key) {
+                Node* dead = *link;
+                *link = dead->next;
+                delete dead;
+                size_--;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Calls fn(key, value) for every entry, in no particular order
+    template<typename Fn>
+    void forEach(Fn fn) const {
+        forEachNode([&fn](Node* node) { fn(node->key, node->value); });
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_t bucketCount() const { return bucketCount_; }
+    bool isRehashing() const { return oldBuckets != nullptr; }
+    ResizeMode mode() const { return mode_; }
+
+    float loadFactor() const {
+        return static_cast<float>(size_) / bucketCount_;
+    }
+
+private:
+    struct Node {
+        K key;
+        V value;
+        size_t hash;    // cached so migration never calls the hash function
+        Node* next;
+
+        Node(const K& k, const V& v, size_t h, Node* n) : key(k), value(v), hash(h), next(n) {}
+    };
+
+    Node** buckets;         // current table; only partly initialized while rehashing
+    size_t bucketCount_;
+    Node** oldBuckets;      // table being drained, or nullptr
+    size_t oldCount;
+    size_t cursor;          // old buckets below this index have been migrated
+    size_t size_;
+    ResizeMode mode_;
+    float maxLoad;
+    size_t step;
+    Hash hasher;
+
+    // Mix the bits so identity hashes of integers still spread over the
+    // power-of-two bucket mask
+    size_t hashOf(const K& key) const {
+        uint64_t h = static_cast<uint64_t>(hasher(key));
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return static_cast<size_t>(h);
+    }
+
+    // The chain that holds (or would hold) a key with this hash
+    Node** bucketFor(size_t hash) const {
+        if (oldBuckets != nullptr) {
+            size_t b = hash & (oldCount - 1);
+            if (b >= cursor) {
+                return &oldBuckets[b];
+            }
+        }
+        return &buckets[hash & (bucketCount_ - 1)];
+    }
+
+    Node* findNode(const K& key, size_t hash) const {
+        for (Node* node = *bucketFor(hash); node != nullptr; node = node->next) {
+            if (node->hash == hash && node->key == key) {
+                return node;
+            }
+        }
+        return nullptr;
+    }
+
+    void startResize() {
+        // Deliberately uninitialized: migrateBucket() writes both halves.
+        // Allocated before any member changes, so a throwing new leaves
+        // the table as it was
+        Node** bigger = new Node*[bucketCount_ * 2];
+        oldBuckets = buckets;
+        oldCount = bucketCount_;
+        cursor = 0;
+        bucketCount_ *= 2;
+        buckets = bigger;
+        if (mode_ == ResizeMode::StopTheWorld) {
+            while (isRehashing()) {
+                migrateBucket();
+            }
+        }
+    }
+
+    void migrateSome() {
+        for (size_t i = 0; i < step && isRehashing(); i++) {
+            migrateBucket();
+        }
+    }
+
+    // Split old bucket `cursor` into new buckets cursor and cursor + oldCount
+    void migrateBucket() {
+        size_t b = cursor;
+        buckets[b] = nullptr;
+        buckets[b + oldCount] = nullptr;
+
+        Node* node = oldBuckets[b];
+        while (node != nullptr) {
+            Node* next = node->next;
+            Node*& head = buckets[node->hash & (bucketCount_ - 1)];
+            node->next = head;
+            head = node;
+            node = next;
+        }
+
+        cursor++;
+        if (cursor == oldCount) {
+            delete[] oldBuckets;
+            oldBuckets = nullptr;
+            oldCount = 0;
+            cursor = 0;
+        }
+    }
+
+    // Visit every node exactly once, skipping new buckets not yet written
+    template<typename Fn>
+    void forEachNode(Fn fn) const {
+        if (oldBuckets != nullptr) {
+            for (size_t b = cursor; b < oldCount; b++) {
+                visitChain(oldBuckets[b], fn);
+            }
+            for (size_t b = 0; b < cursor; b++) {
+                visitChain(buckets[b], fn);
+                visitChain(buckets[b + oldCount], fn);
+            }
+        } else {
+            for (size_t b = 0; b < bucketCount_; b++) {
+                visitChain(buckets[b], fn);
+            }
+        }
+    }
+
+    template<typename Fn>
+    static void visitChain(Node* node, Fn& fn) {
+        while (node != nullptr) {
+            Node* next = node->next;    // fn may delete the node
+            fn(node);
+            node = next;
+        }
+    }
+};
+
+#endif // INCREMENTAL_HASH_TABLE_H
@@ -0,0 +1,140 @@
+// Lesson10_incremental_rehash.cpp : This file contains the 'main' function. Program execution begins and ends there.
+//
+// Measures the latency of every single insert while a table grows from 1K
+// entries, and reports the p50 / p99 / p99.9 / max. Stop-the-world rehashing
+// shows up as a huge max (and, at scale, p99.9); incremental rehashing keeps
+// every insert close to the median.
+//
+// Usage: Lesson10_incremental_rehash [maxKeys]
+//   Default is 5000000. Pass 50000000 for the full 1K - 50M growth
+//   (needs roughly 4 GB of RAM).
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "IncrementalHashTable.h"
+#include "../Lesson10_flat_hash_map/FlatHashMap.h"
+
+typedef IncrementalHashTable<uint64_t, uint64_t> Table;
+
+// Value at fraction p (0..1) of the sorted latencies
+uint64_t percentile(std::vector<uint32_t>& samples, double p) {
+    size_t index = static_cast<size_t>(p * (samples.size() - 1));
+    std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+    return samples[index];
+}
+
+// Time each insert on its own and print the latency distribution
+template<typename InsertFn>
+void measure(const std::string& name, const std::vector<uint64_t>& keys, InsertFn insert) {
+    std::vector<uint32_t> latencies(keys.size());
+
+    auto total = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < keys.size(); i++) {
+        auto start = std::chrono::steady_clock::now();
+        insert(keys[i], i);
+        auto end = std::chrono::steady_clock::now();
+        latencies[i] = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    }
+    double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - total).count();
+
+    uint64_t maxNs = *std::max_element(latencies.begin(), latencies.end());
+    uint64_t p50 = percentile(latencies, 0.50);
+    uint64_t p99 = percentile(latencies, 0.99);
+    uint64_t p999 = percentile(latencies, 0.999);
+
+    std::cout << std::left << std::setw(28) << name << std::right
+              << std::setw(10) << p50 << std::setw(10) << p99 << std::setw(10) << p999
+              << std::setw(14) << maxNs << std::setw(12) << std::fixed << std::setprecision(0) << totalMs << "\n";
+}
+
+// Mixed insert/find/remove against std::unordered_map while resizes are in flight
+void sanityCheck() {
+    Table table(16, Table::ResizeMode::Incremental, 1.0f, 1);
+    std::unordered_map<uint64_t, uint64_t> reference;
+    std::mt19937_64 rng(42);
+
+    for (int i = 0; i < 200000; i++) {
+        uint64_t key = rng() % 50000;
+        switch (rng() % 3) {
+        case 0:
+            table.insert(key, i);
+            reference[key] = i;
+            break;
+        case 1:
+            if (table.remove(key) != (reference.erase(key) == 1)) {
+                throw std::logic_error("remove mismatch");
+            }
+            break;
+        default: {
+            uint64_t* value = table.find(key);
+            auto it = reference.find(key);
+            if ((value != nullptr) != (it != reference.end()) || (value != nullptr && *value != it->second)) {
+                throw std::logic_error("find mismatch");
+            }
+        }
+        }
+    }
+
+    size_t visited = 0;
+    table.forEach([&visited](const uint64_t&, const uint64_t&) { visited++; });
+    if (visited != reference.size() || table.size() != reference.size()) {
+        throw std::logic_error("size mismatch");
+    }
+    std::cout << "Sanity check passed: " << table.size() << " keys in " << table.bucketCount() << " buckets\n\n";
+}
+
+int main(int argc, char* argv[]) {
+    size_t maxKeys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 5000000;
+
+    sanityCheck();
+
+    std::mt19937_64 rng(7);
+    std::vector<uint64_t> keys(maxKeys);
+    for (uint64_t& key : keys) {
+        key = rng();
+    }
+
+    std::cout << "Insert latency (ns) growing from 1K to " << maxKeys << " entries\n";
+    std::cout << std::left << std::setw(28) << "table" << std::right
+              << std::setw(10) << "p50" << std::setw(10) << "p99" << std::setw(10) << "p99.9"
+              << std::setw(14) << "max" << std::setw(12) << "total ms" << "\n";
+
+    {
+        Table table(1024, Table::ResizeMode::StopTheWorld);
+        measure("stop-the-world rehash", keys, [&table](uint64_t k, uint64_t v) { table.insert(k, v); });
+    }
+    {
+        Table table(1024, Table::ResizeMode::Incremental);
+        measure("incremental rehash", keys, [&table](uint64_t k, uint64_t v) { table.insert(k, v); });
+    }
+    {
+        FlatHashMap<uint64_t, uint64_t> table(1024);
+        measure("FlatHashMap (doubling)", keys, [&table](uint64_t k, uint64_t v) { table.insert(k, v); });
+    }
+    {
+        std::unordered_map<uint64_t, uint64_t> table(1024);
+        measure("std::unordered_map", keys, [&table](uint64_t k, uint64_t v) { table[k] = v; });
+    }
+
+    return 0;
+}
+
+// Run program: Ctrl + F5 or Debug > Start Without Debugging menu
+// Debug program: F5 or Debug > Start Debugging menu
+
+// Tips for Getting Started:
+//   1. Use the Solution Explorer window to add/manage files
+//   2. Use the Team Explorer window to connect to source control
+//   3. Use the Output window to see build output and other messages
+//   4. Use the Error List window to view errors
+//   5. Go to Project > Add New Item to create new code files, or Project > Add Existing Item to add existing code files to the project
+//   6. In the future, to open this project again, go to File > Open > Project and select the .sln file
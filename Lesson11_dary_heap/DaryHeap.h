@@ -0,0 +1,489 @@
+// DaryHeap.h
+//
+// d-ary heaps for priority queues with many elements.
+//
+//   DaryHeap<T, Arity, Compare>          drop-in for std::priority_queue
+//   IndexedDaryHeap<T, Arity, Compare>   adds handles, so an element can be
+//                                        re-prioritised (decreaseKey / update)
+//                                        or removed (erase) in O(log n)
+//
+// Like std::priority_queue and the Heap class in Lesson 11, top() is the
+// largest element under Compare; use std::greater<T> for a min-heap.
+//
+// Each node has Arity children instead of two. The tree is log2(Arity)
+// times shallower, so push moves elements fewer levels, and pop reads
+// Arity children per level from memory that is contiguous. The slots are
+// stored shifted so that every group of siblings starts on a 64-byte
+// boundary: with Arity * sizeof(T) == 64 (8 x 8-byte or 4 x 16-byte
+// elements) each pop level touches exactly one cache line.
+//
+// Elements are moved, never copied, so move-only payloads such as
+// std::unique_ptr work. The sift loops move a "hole" down or up the tree
+// instead of swapping, and are iterative rather than recursive.
+
+#ifndef DARY_HEAP_H
+#define DARY_HEAP_H
+
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace dary_heap_detail {
+
+const size_t kCacheLine = 64;
+
+/**
+ * @brief Growable array in one 64-byte-aligned allocation, with element 0
+ *        stored Offset slots past the start.
+ *
+ * With Offset = Arity - 1 the first child of node i, Arity * i + 1, lands
+ * on slot Arity * (i + 1): every sibling group starts on a multiple of
+ * Arity slots. The Offset slots before element 0 are never constructed.
+ */
+template<typename T, size_t Offset>
+class Slots {
+public:
+    Slots() : raw(nullptr), count(0), capacity(0) {}
+
+    Slots(const Slots& other) : raw(nullptr), count(0), capacity(0) {
+        reserve(other.count);
+        for (size_t i = 0; i < other.count; i++) emplaceBack(other[i]);
+    }
+
+    Slots(Slots&& other) noexcept : raw(other.raw), count(other.count), capacity(other.capacity) {
+        other.raw = nullptr;
+        other.count = other.capacity = 0;
+    }
+
+    Slots& operator=(Slots other) noexcept {
+        std::swap(raw, other.raw);
+        std::swap(count, other.count);
+        std::swap(capacity, other.capacity);
+        return *this;
+    }
+
+    ~Slots() {
+        clear();
+        release(raw);
+    }
+
+    T& operator[](size_t i) { return data()[i]; }
+    const T& operator[](size_t i) const { return data()[i]; }
+    size_t size() const { return count; }
+
+    template<typename... Args>
+    void emplaceBack(Args&&... args) {
+        if (count < capacity) {
+            new (data() + count) T(std::forward<Args>(args)...);
+        } else {
+            // Build the new element first: args may refer to an element being moved
+            T* fresh = allocate(capacity ? 2 * capacity : 16);
+            try {
+                new (fresh + Offset + count) T(std::forward<Args>(args)...);
+            } catch (...) {
+                release(fresh);
+                throw;
+            }
+            adopt(fresh, capacity ? 2 * capacity : 16);
+        }
+        count++;
+    }
+
+    void popBack() {
+        data()[--count].~T();
+    }
+
+    void reserve(size_t n) {
+        if (n > capacity) adopt(allocate(n), n);
+    }
+
+    void clear() {
+        while (count > 0) popBack();
+    }
+
+private:
+    void* raw;
+    size_t count;
+    size_t capacity;
+
+    static constexpr size_t alignment = alignof(T) > kCacheLine ? alignof(T) : kCacheLine;
+
+    T* data() const { return static_cast<T*>(raw) + Offset; }
+
+    static T* allocate(size_t n) {
+        return static_cast<T*>(::operator new((n + Offset) * sizeof(T), std::align_val_t(alignment)));
+    }
+
+    static void release(void* p) {
+        if (p) ::operator delete(p, std::align_val_t(alignment));
+    }
+
+    // Move the existing elements into fresh (which may already hold element
+    // count) and make it the storage. Element moves are assumed not to throw.
+    void adopt(T* fresh, size_t newCapacity) {
+        T* old = data();
+        for (size_t i = 0; i < count; i++) {
+            new (fresh + Offset + i) T(std::move(old[i]));
+            old[i].~T();
+        }
+        release(raw);
+        raw = fresh;
+        capacity = newCapacity;
+    }
+};
+
+} // namespace dary_heap_detail
+
+/**
+ * @brief Priority queue on a d-ary heap. top() is the largest element under Compare.
+ */
+template<typename T, size_t Arity = 4, typename Compare = std::less<T>>
+class DaryHeap {
+    static_assert(Arity >= 2, "a heap node needs at least two children");
+
+public:
+    explicit DaryHeap(const Compare& comp = Compare()) : comp(comp) {}
+
+    /**
+     * @brief Build a heap from [first, last) in O(n).
+     */
+    template<typename InputIt>
+    DaryHeap(InputIt first, InputIt last, const Compare& comp = Compare()) : comp(comp) {
+        assign(first, last);
+    }
+
+    /**
+     * @brief Replace the contents with [first, last), heapified bottom-up in O(n)
+     *        rather than n pushes in O(n log n). Leaves the heap empty if an
+     *        element's constructor throws.
+     */
+    template<typename InputIt>
+    void assign(InputIt first, InputIt last) {
+        slots.clear();
+        try {
+            for (; first != last; ++first) slots.emplaceBack(*first);
+        } catch (...) {
+            slots.clear();
+            throw;
+        }
+        heapify();
+    }
+
+    void push(const T& value) {
+        slots.emplaceBack(value);
+        siftUp(slots.size() - 1);
+    }
+
+    void push(T&& value) {
+        slots.emplaceBack(std::move(value));
+        siftUp(slots.size() - 1);
+    }
+
+    template<typename... Args>
+    void emplace(Args&&... args) {
+        slots.emplaceBack(std::forward<Args>(args)...);
+        siftUp(slots.size() - 1);
+    }
+
+    const T& top() const {
+        if (slots.size() == 0) throw std::runtime_error("Heap is empty");
+        return slots[0];
+    }
+
+    void pop() {
+        if (slots.size() == 0) throw std::runtime_error("Heap is empty");
+        removeTop();
+    }
+
+    /**
+     * @brief Remove the top element and return it by move.
+     */
+    T extractTop() {
+        if (slots.size() == 0) throw std::runtime_error("Heap is empty");
+        T result = std::move(slots[0]);
+        removeTop();
+        return result;
+    }
+
+    bool empty() const { return slots.size() == 0; }
+    size_t size() const { return slots.size(); }
+    void clear() { slots.clear(); }
+    void reserve(size_t n) { slots.reserve(n); }
+
+private:
+    dary_heap_detail::Slots<T, Arity - 1> slots;
+    Compare comp;
+
+    static size_t parent(size_t i) { return (i - 1) / Arity; }
+    static size_t firstChild(size_t i) { return Arity * i + 1; }
+
+    void removeTop() {
+        size_t last = slots.size() - 1;
+        if (last > 0) {
+            slots[0] = std::move(slots[last]);
+            slots.popBack();
+            siftDown(0);
+        } else {
+            slots.popBack();
+        }
+    }
+
+    void heapify() {
+        size_t n = slots.size();
+        if (n < 2) return;
+        for (size_t i = parent(n - 1) + 1; i-- > 0;) siftDown(i);
+    }
+
+    void siftUp(size_t index) {
+        T value = std::move(slots[index]);
+        while (index > 0 && comp(slots[parent(index)], value)) {
+            slots[index] = std::move(slots[parent(index)]);
+            index = parent(index);
+        }
+        slots[index] = std::move(value);
+    }
+
+    void siftDown(size_t index) {
+        size_t n = slots.size();
+        T value = std::move(slots[index]);
+        for (;;) {
+            size_t first = firstChild(index);
+            if (first >= n) break;
+            size_t best = first;
+            if (first + Arity <= n) {
+                // A full sibling group: a fixed-length loop the compiler unrolls
+                for (size_t c = first + 1; c < first + Arity; c++) {
+                    if (comp(slots[best], slots[c])) best = c;
+                }
+            } else {
+                for (size_t c = first + 1; c < n; c++) {
+                    if (comp(slots[best], slots[c])) best = c;
+                }
+            }
+            if (!comp(value, slots[best])) break;
+            slots[index] = std::move(slots[best]);
+            index = best;
+        }
+        slots[index] = std::move(value);
+    }
+};
+
+/**
+ * @brief d-ary heap whose elements can be found again through a handle.
+ *
+ * push returns a Handle that stays valid until its element leaves the heap
+ * (pop, extractTop, erase or clear); after that the number may be reused
+ * for a new element. A table maps each handle to its current heap
+ * position, which is what makes decreaseKey, update and erase O(log n).
+ */
+template<typename T, size_t Arity = 4, typename Compare = std::less<T>>
+class IndexedDaryHeap {
+    static_assert(Arity >= 2, "a heap node needs at least two children");
+
+public:
+    typedef size_t Handle;
+
+    explicit IndexedDaryHeap(const Compare& comp = Compare()) : comp(comp) {}
+
+    /**
+     * @brief Replace the contents with [first, last) in O(n). The element at
+     *        offset i gets handle i. Leaves the heap empty if an element's
+     *        constructor throws.
+     */
+    template<typename InputIt>
+    void assign(InputIt first, InputIt last) {
+        clear();
+        try {
+            for (; first != last; ++first) {
+                Handle handle = positions.size();
+                positions.push_back(slots.size());
+                slots.emplaceBack(Entry{ T(*first), handle });
+            }
+        } catch (...) {
+            // positions may hold one more entry than slots
+            clear();
+            throw;
+        }
+        size_t n = slots.size();
+        if (n < 2) return;
+        for (size_t i = parent(n - 1) + 1; i-- > 0;) siftDown(i);
+    }
+
+    Handle push(const T& value) { return emplace(value); }
+    Handle push(T&& value) { return emplace(std::move(value)); }
+
+    template<typename... Args>
+    Handle emplace(Args&&... args) {
+        Handle handle = newHandle();
+        try {
+            slots.emplaceBack(Entry{ T(std::forward<Args>(args)...), handle });
+        } catch (...) {
+            freeHandles.push_back(handle);
+            throw;
+        }
+        positions[handle] = slots.size() - 1;
+        siftUp(slots.size() - 1);
+        return handle;
+    }
+
+    const T& top() const {
+        if (slots.size() == 0) throw std::runtime_error("Heap is empty");
+        return slots[0].value;
+    }
+
+    Handle topHandle() const {
+        if (slots.size() == 0) throw std::runtime_error("Heap is empty");
+        return slots[0].handle;
+    }
+
+    void pop() {
+        if (slots.size() == 0) throw std::runtime_error("Heap is empty");
+        removeAt(0);
+    }
+
+    T extractTop() {
+        if (slots.size() == 0) throw std::runtime_error("Heap is empty");
+        T result = std::move(slots[0].value);
+        removeAt(0);
+        return result;
+    }
+
+    bool contains(Handle handle) const {
+        return handle < positions.size() && positions[handle] != kAbsent;
+    }
+
+    const T& value(Handle handle) const {
+        return slots[checkedPosition(handle)].value;
+    }
+
+    /**
+     * @brief Give handle's element a value that does not belong further from
+     *        the top, i.e. !comp(value, current); in a min-heap, a smaller key.
+     *        Only sifts up.
+     */
+    void decreaseKey(Handle handle, T value) {
+        size_t pos = checkedPosition(handle);
+        if (comp(value, slots[pos].value)) throw std::invalid_argument("decreaseKey would move the element down");
+        slots[pos].value = std::move(value);
+        siftUp(pos);
+    }
+
+    /**
+     * @brief Give handle's element any new value.
+     */
+    void update(Handle handle, T value) {
+        size_t pos = checkedPosition(handle);
+        slots[pos].value = std::move(value);
+        restore(pos);
+    }
+
+    void erase(Handle handle) {
+        removeAt(checkedPosition(handle));
+    }
+
+    bool empty() const { return slots.size() == 0; }
+    size_t size() const { return slots.size(); }
+
+    void clear() {
+        slots.clear();
+        positions.clear();
+        freeHandles.clear();
+    }
+
+    void reserve(size_t n) {
+        slots.reserve(n);
+        positions.reserve(n);
+    }
+
+private:
+    // The handle travels with the value, so moving an entry can update positions
+    struct Entry {
+        T value;
+        Handle handle;
+    };
+
+    static constexpr size_t kAbsent = std::numeric_limits<size_t>::max();
+
+    dary_heap_detail::Slots<Entry, Arity - 1> slots;
+    std::vector<size_t> positions;      // heap position of each handle, or kAbsent
+    std::vector<Handle> freeHandles;
+    Compare comp;
+
+    static size_t parent(size_t i) { return (i - 1) / Arity; }
+    static size_t firstChild(size_t i) { return Arity * i + 1; }
+
+    Handle newHandle() {
+        if (!freeHandles.empty()) {
+            Handle handle = freeHandles.back();
+            freeHandles.pop_back();
+            return handle;
+        }
+        positions.push_back(kAbsent);
+        return positions.size() - 1;
+    }
+
+    size_t checkedPosition(Handle handle) const {
+        if (!contains(handle)) throw std::out_of_range("handle is not in the heap");
+        return positions[handle];
+    }
+
+    void place(size_t pos, Entry&& entry) {
+        slots[pos] = std::move(entry);
+        positions[slots[pos].handle] = pos;
+    }
+
+    // Move the last entry into pos and sift it whichever way it belongs
+    void removeAt(size_t pos) {
+        positions[slots[pos].handle] = kAbsent;
+        freeHandles.push_back(slots[pos].handle);
+        size_t last = slots.size() - 1;
+        if (pos != last) {
+            place(pos, std::move(slots[last]));
+            slots.popBack();
+            restore(pos);
+        } else {
+            slots.popBack();
+        }
+    }
+
+    void restore(size_t pos) {
+        if (pos > 0 && comp(slots[parent(pos)].value, slots[pos].value)) {
+            siftUp(pos);
+        } else {
+            siftDown(pos);
+        }
+    }
+
+    void siftUp(size_t index) {
+        Entry entry = std::move(slots[index]);
+        while (index > 0 && comp(slots[parent(index)].value, entry.value)) {
+            place(index, std::move(slots[parent(index)]));
+            index = parent(index);
+        }
+        place(index, std::move(entry));
+    }
+
+    void siftDown(size_t index) {
+        size_t n = slots.size();
+        Entry entry = std::move(slots[index]);
+        for (;;) {
+            size_t first = firstChild(index);
+            if (first >= n) break;
+            size_t best = first;
+            size_t end = first + Arity <= n ? first + Arity : n;
+            for (size_t c = first + 1; c < end; c++) {
+                if (comp(slots[best].value, slots[c].value)) best = c;
+            }
+            if (!comp(entry.value, slots[best].value)) break;
+            place(index, std::move(slots[best]));
+            index = best;
+        }
+        place(index, std::move(entry));
+    }
+};
+
+#endif // DARY_HEAP_H
@@ -0,0 +1,458 @@
+// Lesson11_dary_heap.cpp : This file contains the 'main' function. Program execution begins and ends there.
+//
+// Compares the d-ary heaps in DaryHeap.h with std::priority_queue and with
+// the Heap class from "Lesson11 heaps.md" on three push/pop mixes:
+//
+//   push + pop     push n random keys, then pop them all
+//   heapify + pop  build from the whole array at once, then pop them all
+//   hold           a heap of n keys where each step pops the minimum and
+//                  pushes a later key - the pattern of an event scheduler
+//
+// and runs Dijkstra's shortest paths with IndexedDaryHeap::decreaseKey
+// against the usual std::priority_queue with stale entries skipped.
+//
+// Usage: Lesson11_dary_heap [maxSize]
+//   Sizes 1K, 10K, ... up to maxSize (default 10000000). Pass 100000000
+//   for the 100M case (needs about 2 GB of RAM).
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <queue>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "DaryHeap.h"
+
+// The lesson's heap, unchanged: recursive heapifyDown, pop returns a copy
+template<typename T, typename Compare = std::less<T>>
+class LessonHeap {
+private:
+    std::vector<T> data;
+    Compare comp;
+
+    void heapifyDown(size_t index) {
+        size_t size = data.size();
+        size_t largest = index;
+        size_t left = 2 * index + 1;
+        size_t right = 2 * index + 2;
+
+        if (left < size && comp(data[largest], data[left]))
+            largest = left;
+
+        if (right < size && comp(data[largest], data[right]))
+            largest = right;
+
+        if (largest != index) {
+            std::swap(data[index], data[largest]);
+            heapifyDown(largest);
+        }
+    }
+
+    void heapifyUp(size_t index) {
+        while (index > 0) {
+            size_t parent = (index - 1) / 2;
+            if (comp(data[parent], data[index])) {
+                std::swap(data[parent], data[index]);
+                index = parent;
+            } else {
+                break;
+            }
+        }
+    }
+
+public:
+    void push(const T& value) {
+        data.push_back(value);
+        heapifyUp(data.size() - 1);
+    }
+
+    T pop() {
+        if (data.empty()) throw std::runtime_error("Heap is empty");
+
+        T result = data[0];
+        data[0] = data.back();
+        data.pop_back();
+
+        if (!data.empty()) {
+            heapifyDown(0);
+        }
+
+        return result;
+    }
+
+    const T& top() const {
+        if (data.empty()) throw std::runtime_error("Heap is empty");
+        return data[0];
+    }
+
+    bool empty() const { return data.empty(); }
+    size_t size() const { return data.size(); }
+};
+
+typedef std::chrono::steady_clock Clock;
+typedef std::greater<uint64_t> MinFirst;
+
+double msSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// A scheduler job that owns its payload and cannot be copied
+struct Job {
+    uint64_t due;
+    std::unique_ptr<int> payload;
+};
+
+struct JobDueLater {
+    bool operator()(const Job& a, const Job& b) const { return a.due > b.due; }
+};
+
+// Built from an int, refusing negative ones
+struct Picky {
+    int value;
+    Picky(int value) : value(value) {
+        if (value < 0) throw std::invalid_argument("negative");
+    }
+    bool operator<(const Picky& other) const { return value < other.value; }
+};
+
+template<size_t Arity>
+void checkArity() {
+    std::mt19937_64 rng(Arity);
+    DaryHeap<uint64_t, Arity, MinFirst> heap;
+    std::priority_queue<uint64_t, std::vector<uint64_t>, MinFirst> reference;
+    for (int step = 0; step < 200000; step++) {
+        if (rng() % 3 != 0 || reference.empty()) {
+            uint64_t key = rng() % 1000;
+            heap.push(key);
+            reference.push(key);
+        } else {
+            if (heap.extractTop() != reference.top()) throw std::logic_error("DaryHeap pop order wrong");
+            reference.pop();
+        }
+        if (heap.size() != reference.size()) throw std::logic_error("DaryHeap size wrong");
+    }
+
+    for (size_t n : { 0, 1, 2, 3, 9, 10, 1000, 4097 }) {
+        std::vector<uint64_t> keys(n);
+        for (uint64_t& k : keys) k = rng() % 500;
+        DaryHeap<uint64_t, Arity, MinFirst> built(keys.begin(), keys.end());
+        std::sort(keys.begin(), keys.end());
+        for (uint64_t k : keys) {
+            if (built.extractTop() != k) throw std::logic_error("heapify order wrong");
+        }
+        if (!built.empty()) throw std::logic_error("heapify size wrong");
+    }
+}
+
+// Random pushes, pops, updates, decreaseKeys and erases, checked against a
+// map from handle to value
+template<size_t Arity>
+void checkIndexed() {
+    std::mt19937_64 rng(Arity + 100);
+    IndexedDaryHeap<uint64_t, Arity, MinFirst> heap;
+    std::map<size_t, uint64_t> live;
+    auto minimum = [&live]() {
+        uint64_t best = UINT64_MAX;
+        for (const auto& entry : live) best = std::min(best, entry.second);
+        return best;
+    };
+    for (int step = 0; step < 20000; step++) {
+        unsigned op = rng() % 6;
+        if (live.empty() || op < 2) {
+            uint64_t key = rng() % 10000;
+            live[heap.push(key)] = key;
+        } else {
+            auto it = live.begin();
+            std::advance(it, rng() % live.size());
+            size_t handle = it->first;
+            if (heap.value(handle) != it->second) throw std::logic_error("handle lost its value");
+            if (op == 2) {
+                if (heap.top() != minimum()) throw std::logic_error("indexed top wrong");
+                live.erase(heap.topHandle());
+                heap.pop();
+            } else if (op == 3) {
+                it->second = rng() % 10000;
+                heap.update(handle, it->second);
+            } else if (op == 4) {
+                it->second -= std::min<uint64_t>(it->second, rng() % 100);
+                heap.decreaseKey(handle, it->second);
+            } else {
+                heap.erase(handle);
+                live.erase(it);
+                if (heap.contains(handle)) throw std::logic_error("erased handle still present");
+            }
+        }
+        if (heap.size() != live.size() || (!live.empty() && heap.top() != minimum())) {
+            throw std::logic_error("indexed heap wrong");
+        }
+    }
+
+    std::vector<uint64_t> keys = { 5, 3, 9, 1, 7 };
+    heap.assign(keys.begin(), keys.end());
+    heap.decreaseKey(2, 0);         // 9 -> 0 becomes the top
+    if (heap.topHandle() != 2 || heap.value(4) != 7) throw std::logic_error("indexed assign wrong");
+    bool threw = false;
+    try {
+        heap.decreaseKey(2, 50);    // would move down
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    if (!threw) throw std::logic_error("bad decreaseKey accepted");
+}
+
+void sanityCheck() {
+    checkArity<2>();
+    checkArity<3>();
+    checkArity<4>();
+    checkArity<8>();
+    checkIndexed<2>();
+    checkIndexed<4>();
+    checkIndexed<8>();
+
+    // Move-only payloads, moved in with push and out with extractTop
+    DaryHeap<Job, 4, JobDueLater> jobs;
+    IndexedDaryHeap<Job, 4, JobDueLater> indexedJobs;
+    for (int i = 0; i < 100; i++) {
+        uint64_t due = (i * 37) % 100;
+        jobs.push(Job{ due, std::unique_ptr<int>(new int(i)) });
+        indexedJobs.emplace(Job{ due, std::unique_ptr<int>(new int(i)) });
+    }
+    for (uint64_t due = 0; due < 100; due++) {
+        Job job = jobs.extractTop();
+        Job indexedJob = indexedJobs.extractTop();
+        if (job.due != due || !job.payload || indexedJob.due != due || !indexedJob.payload) {
+            throw std::logic_error("move-only payload heap wrong");
+        }
+    }
+
+    bool threw = false;
+    try {
+        jobs.pop();
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    if (!threw) throw std::logic_error("pop on an empty heap accepted");
+
+    // An assign that throws part way leaves an empty, usable heap
+    std::vector<int> picky = { 4, 2, -1, 3 };
+    DaryHeap<Picky> plain;
+    IndexedDaryHeap<Picky> indexed;
+    for (int attempt = 0; attempt < 2; attempt++) {
+        try {
+            if (attempt == 0) plain.assign(picky.begin(), picky.end());
+            else indexed.assign(picky.begin(), picky.end());
+        } catch (const std::invalid_argument&) {
+        }
+    }
+    plain.push(Picky(8));
+    if (plain.size() != 1 || indexed.size() != 0 || indexed.push(Picky(8)) != 0 || indexed.top().value != 8) {
+        throw std::logic_error("heap wrong after a throwing assign");
+    }
+    std::cout << "Sanity check passed\n\n";
+}
+
+// The heaps under test, behind one interface
+template<typename Heap>
+struct HeapOps {
+    static void push(Heap& heap, uint64_t key) { heap.push(key); }
+    static uint64_t popTop(Heap& heap) { return heap.extractTop(); }
+    static void build(Heap& heap, const std::vector<uint64_t>& keys) { heap.assign(keys.begin(), keys.end()); }
+};
+
+template<>
+struct HeapOps<std::priority_queue<uint64_t, std::vector<uint64_t>, MinFirst>> {
+    typedef std::priority_queue<uint64_t, std::vector<uint64_t>, MinFirst> Heap;
+    static void push(Heap& heap, uint64_t key) { heap.push(key); }
+    static uint64_t popTop(Heap& heap) {
+        uint64_t key = heap.top();
+        heap.pop();
+        return key;
+    }
+    static void build(Heap& heap, const std::vector<uint64_t>& keys) { heap = Heap(keys.begin(), keys.end()); }
+};
+
+template<>
+struct HeapOps<LessonHeap<uint64_t, MinFirst>> {
+    typedef LessonHeap<uint64_t, MinFirst> Heap;
+    static void push(Heap& heap, uint64_t key) { heap.push(key); }
+    static uint64_t popTop(Heap& heap) { return heap.pop(); }
+    static void build(Heap& heap, const std::vector<uint64_t>& keys) {
+        for (uint64_t k : keys) heap.push(k);       // the lesson's heap has no heapify
+    }
+};
+
+// ns per element for each mix; checks that the pops came out in order
+template<typename Heap>
+void benchmarkHeap(const std::string& name, const std::vector<uint64_t>& keys) {
+    typedef HeapOps<Heap> Ops;
+    size_t n = keys.size();
+    size_t reps = std::max<size_t>(1, 10000000 / n);
+    bool ordered = true;
+
+    auto start = Clock::now();
+    for (size_t r = 0; r < reps; r++) {
+        Heap heap;
+        for (uint64_t k : keys) Ops::push(heap, k);
+        uint64_t previous = 0;
+        for (size_t i = 0; i < n; i++) {
+            uint64_t k = Ops::popTop(heap);
+            ordered &= k >= previous;
+            previous = k;
+        }
+    }
+    double pushPopNs = msSince(start) * 1e6 / (reps * n);
+
+    start = Clock::now();
+    for (size_t r = 0; r < reps; r++) {
+        Heap heap;
+        Ops::build(heap, keys);
+        uint64_t previous = 0;
+        for (size_t i = 0; i < n; i++) {
+            uint64_t k = Ops::popTop(heap);
+            ordered &= k >= previous;
+            previous = k;
+        }
+    }
+    double heapifyNs = msSince(start) * 1e6 / (reps * n);
+
+    // Hold model: n keys in the heap, each step moves the minimum to a later time
+    Heap heap;
+    Ops::build(heap, keys);
+    std::mt19937_64 rng(7);
+    size_t steps = std::max<size_t>(n, 1000000);
+    start = Clock::now();
+    for (size_t i = 0; i < steps; i++) {
+        uint64_t k = Ops::popTop(heap);
+        Ops::push(heap, k + (rng() >> 44));
+    }
+    double holdNs = msSince(start) * 1e6 / steps;
+
+    if (!ordered) throw std::logic_error(name + " popped out of order");
+    std::cout << std::left << std::setw(26) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(12) << pushPopNs << std::setw(15) << heapifyNs << std::setw(12) << holdNs << "\n";
+}
+
+struct Graph {
+    std::vector<size_t> offsets;        // edges of node v are [offsets[v], offsets[v + 1])
+    std::vector<uint32_t> targets;
+    std::vector<uint32_t> weights;
+};
+
+Graph randomGraph(size_t nodes, size_t degree, unsigned seed) {
+    std::mt19937_64 rng(seed);
+    Graph g;
+    g.offsets.resize(nodes + 1);
+    for (size_t v = 0; v <= nodes; v++) g.offsets[v] = v * degree;
+    g.targets.resize(nodes * degree);
+    g.weights.resize(nodes * degree);
+    for (size_t e = 0; e < g.targets.size(); e++) {
+        g.targets[e] = static_cast<uint32_t>(rng() % nodes);
+        g.weights[e] = static_cast<uint32_t>(1 + rng() % 1000);
+    }
+    return g;
+}
+
+// The textbook version: push a new entry on every improvement and skip the stale ones
+std::vector<uint64_t> dijkstraLazy(const Graph& g, size_t source) {
+    std::vector<uint64_t> dist(g.offsets.size() - 1, UINT64_MAX);
+    typedef std::pair<uint64_t, uint32_t> Item;
+    std::priority_queue<Item, std::vector<Item>, std::greater<Item>> queue;
+    dist[source] = 0;
+    queue.push(Item(0, static_cast<uint32_t>(source)));
+    while (!queue.empty()) {
+        Item item = queue.top();
+        queue.pop();
+        if (item.first != dist[item.second]) continue;
+        for (size_t e = g.offsets[item.second]; e < g.offsets[item.second + 1]; e++) {
+            uint64_t d = item.first + g.weights[e];
+            if (d < dist[g.targets[e]]) {
+                dist[g.targets[e]] = d;
+                queue.push(Item(d, g.targets[e]));
+            }
+        }
+    }
+    return dist;
+}
+
+// One heap entry per node, moved up with decreaseKey. Handles are node
+// numbers because every node is pushed once, in order.
+template<size_t Arity>
+std::vector<uint64_t> dijkstraIndexed(const Graph& g, size_t source) {
+    size_t nodes = g.offsets.size() - 1;
+    std::vector<uint64_t> dist(nodes, UINT64_MAX);
+    dist[source] = 0;
+    IndexedDaryHeap<uint64_t, Arity, MinFirst> queue;
+    queue.assign(dist.begin(), dist.end());
+    std::vector<bool> done(nodes, false);
+    while (!queue.empty() && queue.top() != UINT64_MAX) {
+        size_t v = queue.topHandle();
+        queue.pop();
+        done[v] = true;
+        for (size_t e = g.offsets[v]; e < g.offsets[v + 1]; e++) {
+            uint32_t w = g.targets[e];
+            uint64_t d = dist[v] + g.weights[e];
+            if (!done[w] && d < dist[w]) {
+                dist[w] = d;
+                queue.decreaseKey(w, d);
+            }
+        }
+    }
+    return dist;
+}
+
+int main(int argc, char* argv[]) {
+    size_t maxSize = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+
+    sanityCheck();
+
+    std::cout << "ns per element, uint64_t keys, smallest first\n";
+    std::cout << std::left << std::setw(26) << "heap" << std::right << std::setw(12) << "push+pop"
+              << std::setw(15) << "heapify+pop" << std::setw(12) << "hold" << "\n";
+    for (size_t n = 1000; n <= maxSize; n *= 10) {
+        std::cout << "n = " << n << "\n";
+        std::vector<uint64_t> keys(n);
+        std::mt19937_64 rng(n);
+        for (uint64_t& k : keys) k = rng();
+        benchmarkHeap<std::priority_queue<uint64_t, std::vector<uint64_t>, MinFirst>>("  std::priority_queue", keys);
+        benchmarkHeap<LessonHeap<uint64_t, MinFirst>>("  lesson Heap", keys);
+        benchmarkHeap<DaryHeap<uint64_t, 2, MinFirst>>("  DaryHeap<2>", keys);
+        benchmarkHeap<DaryHeap<uint64_t, 4, MinFirst>>("  DaryHeap<4>", keys);
+        benchmarkHeap<DaryHeap<uint64_t, 8, MinFirst>>("  DaryHeap<8>", keys);
+    }
+
+    size_t nodes = std::min<size_t>(maxSize / 10, 2000000);
+    Graph g = randomGraph(nodes, 8, 3);
+    std::cout << "\nDijkstra, " << nodes << " nodes, 8 edges each\n";
+    auto start = Clock::now();
+    std::vector<uint64_t> expected = dijkstraLazy(g, 0);
+    std::cout << "  std::priority_queue, lazy     " << std::fixed << std::setprecision(1) << msSince(start) << " ms\n";
+    start = Clock::now();
+    std::vector<uint64_t> indexed4 = dijkstraIndexed<4>(g, 0);
+    std::cout << "  IndexedDaryHeap<4> decreaseKey " << msSince(start) << " ms\n";
+    start = Clock::now();
+    std::vector<uint64_t> indexed8 = dijkstraIndexed<8>(g, 0);
+    std::cout << "  IndexedDaryHeap<8> decreaseKey " << msSince(start) << " ms\n";
+    if (indexed4 != expected || indexed8 != expected) throw std::logic_error("Dijkstra distances differ");
+
+    return 0;
+}
+
+// Run program: Ctrl + F5 or Debug > Start Without Debugging menu
+// Debug program: F5 or Debug > Start Debugging menu
+
+// Tips for Getting Started:
+//   1. Use the Solution Explorer window to add/manage files
+//   2. Use the Team Explorer window to connect to source control
+//   3. Use the Output window to see build output and other messages
+//   4. Use the Error List window to view errors
+//   5. Go to Project > Add New Item to create new code files, or Project > Add Existing Item to add existing code files to the project
+//   6. In the future, to open this project again, go to File > Open > Project and select the .sln file
@@ -0,0 +1,572 @@
+// ExternalSort.h
+//
+// External merge sort for binary record files larger than memory.
+//
+// Phase 1 (runs): the input is read in chunks that fit the memory budget,
+// each chunk is sorted with parallelMergeSort from ParallelSort.h, and the
+// sorted chunk is spilled to a temporary "run" file.
+//
+// Phase 2 (merge): the runs are merged k at a time. A min-heap, as in
+// Lesson 11, holds the smallest unmerged record of each run; the heap's
+// minimum is written out and replaced by the next record of the same run.
+// If there are more runs than fit in memory at once, intermediate passes
+// merge groups of them into longer runs first.
+//
+// All file access goes through one background I/O thread and every file has
+// two buffers: while the sorting thread sorts or merges one buffer, the I/O
+// thread fills or drains the other, so the disk and the CPU work at the
+// same time.
+//
+// Records are any trivially copyable type, stored back to back with no
+// header. The sort is stable: runs are cut in input order, each run is
+// sorted stably, and the heap breaks ties in favour of the earlier run.
+
+#ifndef EXTERNAL_SORT_H
+#define EXTERNAL_SORT_H
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../Lesson12_parallel_sort/ParallelSort.h"
+
+struct ExternalSortOptions {
+    size_t memoryBudget = 256u << 20;       // bytes of record buffers, in both phases
+    size_t ioBlockBytes = 1u << 20;         // smallest merge buffer; smaller blocks allow a wider merge
+    std::string tempDirectory = ".";        // where the runs are written
+    ThreadPool* pool = nullptr;             // sorts the chunks in parallel; nullptr sorts on the caller
+};
+
+struct ExternalSortStats {
+    uint64_t records = 0;
+    uint64_t bytesRead = 0;                 // over all passes, including temporary runs
+    uint64_t bytesWritten = 0;
+    size_t runs = 0;                        // runs written by phase 1
+    size_t fanIn = 0;                       // most runs merged at once
+    size_t mergePasses = 0;                 // passes over the data in phase 2
+    double runPhaseMs = 0;
+    double mergePhaseMs = 0;
+    double sortMs = 0;                      // part of runPhaseMs spent sorting chunks
+    double ioWaitMs = 0;                    // time the sorting thread waited for the disk, both phases
+};
+
+namespace external_sort_detail {
+
+typedef std::chrono::steady_clock Clock;
+
+inline double msSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+struct FileCloser {
+    void operator()(std::FILE* file) const { std::fclose(file); }
+};
+
+typedef std::unique_ptr<std::FILE, FileCloser> FilePtr;
+
+inline FilePtr openFile(const std::string& path, const char* mode) {
+    std::FILE* file = nullptr;
+#ifdef _MSC_VER
+    if (fopen_s(&file, path.c_str(), mode) != 0) file = nullptr;
+#else
+    file = std::fopen(path.c_str(), mode);
+#endif
+    if (!file) throw std::runtime_error("cannot open " + path);
+    // Every transfer is a whole block already; stdio's buffer would only add a copy
+    std::setvbuf(file, nullptr, _IONBF, 0);
+    return FilePtr(file);
+}
+
+// fclose reports write errors that fwrite did not, so it is checked too
+inline void closeFile(FilePtr& file, const std::string& path) {
+    if (std::fclose(file.release()) != 0) throw std::runtime_error("error closing " + path);
+}
+
+template<typename Record>
+size_t readRecords(std::FILE* file, Record* buffer, size_t capacity, const std::string& path) {
+    if (capacity == 0) return 0;
+    size_t bytes = std::fread(buffer, 1, capacity * sizeof(Record), file);
+    if (std::ferror(file)) throw std::runtime_error("error reading " + path);
+    if (bytes % sizeof(Record) != 0) throw std::runtime_error(path + " ends with a partial record");
+    return bytes / sizeof(Record);
+}
+
+template<typename Record>
+void writeRecords(std::FILE* file, const Record* buffer, size_t count, const std::string& path) {
+    if (count == 0) return;
+    if (std::fwrite(buffer, sizeof(Record), count, file) != count) {
+        throw std::runtime_error("error writing " + path);
+    }
+}
+
+/**
+ * @brief One background thread that runs reads and writes in submission order.
+ *
+ * Each job returns the number of records it transferred through a future;
+ * an exception thrown by the job is rethrown by future::get().
+ */
+class IoThread {
+public:
+    IoThread() : stopping(false) {
+        thread = std::thread([this]() { loop(); });
+    }
+
+    IoThread(const IoThread&) = delete;
+    IoThread& operator=(const IoThread&) = delete;
+
+    // Runs every job still queued before returning
+    ~IoThread() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        available.notify_one();
+        thread.join();
+    }
+
+    template<typename Fn>
+    std::future<size_t> submit(Fn job) {
+        std::packaged_task<size_t()> task(std::move(job));
+        std::future<size_t> result = task.get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(task));
+        }
+        available.notify_one();
+        return result;
+    }
+
+private:
+    std::deque<std::packaged_task<size_t()>> jobs;
+    std::mutex mutex;
+    std::condition_variable available;
+    bool stopping;
+    std::thread thread;
+
+    void loop() {
+        for (;;) {
+            std::packaged_task<size_t()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                available.wait(lock, [this]() { return stopping || !jobs.empty(); });
+                if (jobs.empty()) return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job();
+        }
+    }
+};
+
+// Wait for an I/O job, charging the time to stats.ioWaitMs
+inline size_t await(std::future<size_t>& job, ExternalSortStats& stats) {
+    Clock::time_point start = Clock::now();
+    size_t records = job.get();
+    stats.ioWaitMs += msSince(start);
+    return records;
+}
+
+/**
+ * @brief Names the run files and deletes the ones still present when it is
+ *        destroyed, so an exception does not leave runs behind.
+ */
+class TempFiles {
+public:
+    explicit TempFiles(const std::string& directory) : directory(directory), counter(0) {
+        std::ostringstream name;
+        name << "extsort_" << std::hex << std::random_device()() << "_";
+        prefix = name.str();
+    }
+
+    TempFiles(const TempFiles&) = delete;
+    TempFiles& operator=(const TempFiles&) = delete;
+
+    ~TempFiles() {
+        for (const std::string& path : live) std::remove(path.c_str());
+    }
+
+    std::string create() {
+        std::string path = directory + "/" + prefix + std::to_string(counter++) + ".run";
+        live.insert(path);
+        return path;
+    }
+
+    void remove(const std::string& path) {
+        std::remove(path.c_str());
+        live.erase(path);
+    }
+
+private:
+    std::string directory;
+    std::string prefix;
+    size_t counter;
+    std::set<std::string> live;
+};
+
+/**
+ * @brief Reads a run one block at a time, with the next block already on its way.
+ */
+template<typename Record>
+class RunReader {
+public:
+    RunReader(const std::string& path, size_t blockRecords, IoThread& io, ExternalSortStats& stats)
+        : path(path), file(openFile(path, "rb")), io(io), stats(stats), current(0), pos(0), count(0) {
+        blocks[0].resize(blockRecords);
+        blocks[1].resize(blockRecords);
+        requestBlock(1);
+    }
+
+    RunReader(const RunReader&) = delete;
+    RunReader& operator=(const RunReader&) = delete;
+
+    // The I/O thread may still be filling a buffer
+    ~RunReader() {
+        if (pending.valid()) pending.wait();
+    }
+
+    // Copy the next record into value; false at the end of the run
+    bool next(Record& value) {
+        if (pos == count) {
+            if (!pending.valid()) return false;
+            count = await(pending, stats);
+            stats.bytesRead += count * sizeof(Record);
+            if (count == 0) return false;
+            current ^= 1;
+            pos = 0;
+            requestBlock(current ^ 1);
+        }
+        value = blocks[current][pos++];
+        return true;
+    }
+
+private:
+    std::string path;
+    FilePtr file;
+    IoThread& io;
+    ExternalSortStats& stats;
+    std::vector<Record> blocks[2];
+    std::future<size_t> pending;
+    size_t current;
+    size_t pos;
+    size_t count;
+
+    void requestBlock(size_t block) {
+        pending = io.submit([this, block]() {
+            return readRecords(file.get(), blocks[block].data(), blocks[block].size(), path);
+        });
+    }
+};
+
+/**
+ * @brief Writes records one block at a time; a full block is written while the other fills.
+ */
+template<typename Record>
+class RunWriter {
+public:
+    RunWriter(const std::string& path, size_t blockRecords, IoThread& io, ExternalSortStats& stats)
+        : path(path), file(openFile(path, "wb")), io(io), stats(stats), current(0), fill(0) {
+        blocks[0].resize(blockRecords);
+        blocks[1].resize(blockRecords);
+    }
+
+    RunWriter(const RunWriter&) = delete;
+    RunWriter& operator=(const RunWriter&) = delete;
+
+    ~RunWriter() {
+        if (pending.valid()) pending.wait();
+    }
+
+    void push(const Record& value) {
+        blocks[current][fill++] = value;
+        if (fill == blocks[current].size()) flush();
+    }
+
+    // Write what is left and close the file
+    void close() {
+        flush();
+        if (pending.valid()) stats.bytesWritten += await(pending, stats) * sizeof(Record);
+        closeFile(file, path);
+    }
+
+private:
+    std::string path;
+    FilePtr file;
+    IoThread& io;
+    ExternalSortStats& stats;
+    std::vector<Record> blocks[2];
+    std::future<size_t> pending;
+    size_t current;
+    size_t fill;
+
+    void flush() {
+        if (fill == 0) return;
+        // The other block must be on disk before it can be refilled
+        if (pending.valid()) stats.bytesWritten += await(pending, stats) * sizeof(Record);
+        size_t block = current, records = fill;
+        pending = io.submit([this, block, records]() {
+            writeRecords(file.get(), blocks[block].data(), records, path);
+            return records;
+        });
+        current ^= 1;
+        fill = 0;
+    }
+};
+
+/**
+ * @brief The merge heap: a binary min-heap in an array, as in Lesson 11,
+ *        holding the smallest unmerged record of each run.
+ *
+ * Records that compare equal are ordered by run number, which keeps the
+ * merge stable.
+ */
+template<typename Record, typename Compare>
+class MergeHeap {
+public:
+    struct Entry {
+        Record value;
+        size_t run;
+    };
+
+    explicit MergeHeap(Compare comp) : comp(comp) {}
+
+    void insert(const Record& value, size_t run) {
+        heap.push_back(Entry{ value, run });
+        percolateUp(heap.size() - 1);
+    }
+
+    const Entry& getMin() const { return heap[0]; }
+
+    // Give the minimum's run its next record: one percolateDown instead of
+    // an extractMin followed by an insert
+    void replaceMin(const Record& value) {
+        heap[0].value = value;
+        percolateDown(0);
+    }
+
+    void extractMin() {
+        heap[0] = heap.back();
+        heap.pop_back();
+        if (!heap.empty()) percolateDown(0);
+    }
+
+    bool isEmpty() const { return heap.empty(); }
+    size_t size() const { return heap.size(); }
+
+private:
+    std::vector<Entry> heap;
+    Compare comp;
+
+    static size_t parent(size_t i) { return (i - 1) / 2; }
+    static size_t leftChild(size_t i) { return 2 * i + 1; }
+
+    bool before(const Entry& a, const Entry& b) {
+        if (comp(a.value, b.value)) return true;
+        if (comp(b.value, a.value)) return false;
+        return a.run < b.run;
+    }
+
+    void percolateUp(size_t index) {
+        Entry temp = heap[index];
+        while (index > 0 && before(temp, heap[parent(index)])) {
+            heap[index] = heap[parent(index)];
+            index = parent(index);
+        }
+        heap[index] = temp;
+    }
+
+    void percolateDown(size_t index) {
+        Entry temp = heap[index];
+        size_t size = heap.size();
+        for (;;) {
+            size_t child = leftChild(index);
+            if (child >= size) break;
+            if (child + 1 < size && before(heap[child + 1], heap[child])) child++;
+            if (!before(heap[child], temp)) break;
+            heap[index] = heap[child];
+            index = child;
+        }
+        heap[index] = temp;
+    }
+};
+
+// Phase 1. Three chunk buffers rotate: while one is sorted, the next is
+// being read and the previous one is being written. A first chunk that
+// holds the whole input is written straight to outputPath.
+template<typename Record, typename Compare>
+std::vector<std::string> generateRuns(const std::string& inputPath, const std::string& outputPath,
+                                      size_t chunkRecords, Compare comp, ThreadPool& pool,
+                                      TempFiles& temp, IoThread& io, ExternalSortStats& stats) {
+    FilePtr input = openFile(inputPath, "rb");
+    std::vector<Record> chunks[3];
+    std::vector<Record> scratch;
+    std::vector<std::string> runs;
+
+    // jobs[i] writes chunks[i] and jobs[3] reads. Jobs still in flight when
+    // an exception leaves this function use the buffers, so they are waited for.
+    struct Jobs {
+        std::future<size_t> job[4];
+        ~Jobs() {
+            for (std::future<size_t>& j : job) {
+                if (j.valid()) j.wait();
+            }
+        }
+    } jobs;
+    std::future<size_t>& reading = jobs.job[3];
+
+    for (std::vector<Record>& chunk : chunks) chunk.resize(chunkRecords);
+    size_t cur = 0;
+    reading = io.submit([&, cur]() { return readRecords(input.get(), chunks[cur].data(), chunkRecords, inputPath); });
+    for (;;) {
+        size_t n = await(reading, stats);
+        stats.bytesRead += n * sizeof(Record);
+        stats.records += n;
+        if (n == 0) break;
+
+        size_t next = (cur + 1) % 3;
+        if (jobs.job[next].valid()) stats.bytesWritten += await(jobs.job[next], stats) * sizeof(Record);
+        bool last = n < chunkRecords;
+        if (!last) {
+            reading = io.submit([&, next]() {
+                return readRecords(input.get(), chunks[next].data(), chunkRecords, inputPath);
+            });
+        }
+
+        Clock::time_point start = Clock::now();
+        parallelMergeSort(chunks[cur].begin(), chunks[cur].begin() + n, pool, scratch, comp);
+        stats.sortMs += msSince(start);
+
+        std::string path = runs.empty() && last ? outputPath : temp.create();
+        runs.push_back(path);
+        jobs.job[cur] = io.submit([&, cur, n, path]() {
+            FilePtr file = openFile(path, "wb");
+            writeRecords(file.get(), chunks[cur].data(), n, path);
+            closeFile(file, path);
+            return n;
+        });
+        if (last) break;
+        cur = next;
+    }
+    for (size_t i = 0; i < 3; i++) {
+        if (jobs.job[i].valid()) stats.bytesWritten += await(jobs.job[i], stats) * sizeof(Record);
+    }
+    return runs;
+}
+
+// Blocks as large as the budget allows for a merge of runs inputs
+template<typename Record>
+size_t mergeBlockRecords(size_t memoryBudget, size_t runs) {
+    return std::max<size_t>(memoryBudget / (2 * (runs + 1)) / sizeof(Record), 1);
+}
+
+// Phase 2, one group: k-way merge of the runs in inputs into outputPath
+template<typename Record, typename Compare>
+void mergeRuns(const std::vector<std::string>& inputs, const std::string& outputPath, size_t blockRecords,
+               Compare comp, IoThread& io, ExternalSortStats& stats) {
+    std::vector<std::unique_ptr<RunReader<Record>>> readers;
+    MergeHeap<Record, Compare> heap(comp);
+    Record value;
+    for (size_t run = 0; run < inputs.size(); run++) {
+        readers.emplace_back(new RunReader<Record>(inputs[run], blockRecords, io, stats));
+        if (readers[run]->next(value)) heap.insert(value, run);
+    }
+
+    RunWriter<Record> writer(outputPath, blockRecords, io, stats);
+    while (!heap.isEmpty()) {
+        const typename MergeHeap<Record, Compare>::Entry& min = heap.getMin();
+        writer.push(min.value);
+        if (readers[min.run]->next(value)) {
+            heap.replaceMin(value);
+        } else {
+            heap.extractMin();
+        }
+    }
+    writer.close();
+}
+
+} // namespace external_sort_detail
+
+/**
+ * @brief Sort the records in the file inputPath into the file outputPath. Stable.
+ *
+ * Both files hold Record values back to back; outputPath is overwritten and
+ * must differ from inputPath. Throws std::runtime_error on an I/O error or if
+ * the input ends with a partial record, and std::invalid_argument if the
+ * memory budget cannot hold the buffers.
+ */
+template<typename Record, typename Compare = std::less<>>
+ExternalSortStats externalSort(const std::string& inputPath, const std::string& outputPath,
+                               const ExternalSortOptions& options = ExternalSortOptions(),
+                               Compare comp = Compare()) {
+    static_assert(std::is_trivially_copyable<Record>::value, "records are read and written as raw bytes");
+    using namespace external_sort_detail;
+
+    // Phase 1 holds three chunks plus merge sort's scratch buffer
+    size_t chunkRecords = options.memoryBudget / 4 / sizeof(Record);
+    if (chunkRecords == 0) throw std::invalid_argument("memory budget is smaller than four records");
+    // Phase 2 holds two blocks per input run and two for the output, each
+    // at least ioBlockBytes unless the budget cannot fit a 2-way merge
+    size_t minBlockBytes = std::max(options.ioBlockBytes, sizeof(Record));
+    size_t fanIn = std::max<size_t>(options.memoryBudget / (2 * minBlockBytes), 3) - 1;
+    ThreadPool callerOnly(0);
+    ThreadPool& pool = options.pool ? *options.pool : callerOnly;
+    ExternalSortStats stats;
+    TempFiles temp(options.tempDirectory);
+    IoThread io;
+
+    Clock::time_point start = Clock::now();
+    std::vector<std::string> runs =
+        generateRuns<Record>(inputPath, outputPath, chunkRecords, comp, pool, temp, io, stats);
+    stats.runs = runs.size();
+    stats.runPhaseMs = msSince(start);
+
+    start = Clock::now();
+    if (runs.empty()) {
+        FilePtr empty = openFile(outputPath, "wb");
+        closeFile(empty, outputPath);
+    }
+    // Intermediate passes until one merge can take every run
+    while (runs.size() > fanIn) {
+        std::vector<std::string> merged;
+        for (size_t first = 0; first < runs.size(); first += fanIn) {
+            std::vector<std::string> group(runs.begin() + first, runs.begin() + std::min(first + fanIn, runs.size()));
+            if (group.size() == 1) {
+                merged.push_back(group[0]);
+                continue;
+            }
+            std::string path = temp.create();
+            mergeRuns<Record>(group, path, mergeBlockRecords<Record>(options.memoryBudget, group.size()), comp, io, stats);
+            for (const std::string& run : group) temp.remove(run);
+            merged.push_back(path);
+        }
+        runs.swap(merged);
+        stats.fanIn = fanIn;
+        stats.mergePasses++;
+    }
+    if (!runs.empty() && runs[0] != outputPath) {
+        mergeRuns<Record>(runs, outputPath, mergeBlockRecords<Record>(options.memoryBudget, runs.size()), comp, io, stats);
+        for (const std::string& run : runs) temp.remove(run);
+        stats.fanIn = std::max(stats.fanIn, runs.size());
+        stats.mergePasses++;
+    }
+    stats.mergePhaseMs = msSince(start);
+    return stats;
+}
+
+#endif // EXTERNAL_SORT_H
@@ -0,0 +1,214 @@
+// Lesson12_external_sort.cpp : This file contains the 'main' function. Program execution begins and ends there.
+//
+// Sorts binary record files larger than the memory budget with externalSort
+// (ExternalSort.h) and reports the bytes moved and the time of each phase.
+// The same data is also sorted entirely in memory for comparison.
+//
+// Usage: Lesson12_external_sort [fileMB] [budgetMB] [tempDirectory]
+//   Defaults: a 1024 MB file, a 64 MB budget, runs in the current directory.
+//   The input, output and runs together need about 3x fileMB of disk.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "ExternalSort.h"
+
+// A key with a payload, ordered by key only
+struct Record16 {
+    uint64_t key;
+    uint64_t payload;
+};
+
+struct ByKey {
+    bool operator()(const Record16& a, const Record16& b) const { return a.key < b.key; }
+};
+
+typedef std::chrono::steady_clock Clock;
+
+double msSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+template<typename Record>
+void writeFile(const std::string& path, const std::vector<Record>& records) {
+    external_sort_detail::FilePtr file = external_sort_detail::openFile(path, "wb");
+    external_sort_detail::writeRecords(file.get(), records.data(), records.size(), path);
+    external_sort_detail::closeFile(file, path);
+}
+
+template<typename Record>
+std::vector<Record> readFile(const std::string& path) {
+    std::vector<Record> records(std::filesystem::file_size(path) / sizeof(Record));
+    external_sort_detail::FilePtr file = external_sort_detail::openFile(path, "rb");
+    external_sort_detail::readRecords(file.get(), records.data(), records.size(), path);
+    return records;
+}
+
+size_t leftoverRuns(const std::string& directory) {
+    size_t count = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        if (entry.path().filename().string().rfind("extsort_", 0) == 0) count++;
+    }
+    return count;
+}
+
+bool sameRecords(const std::vector<Record16>& a, const std::vector<Record16>& b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](const Record16& x, const Record16& y) {
+               return x.key == y.key && x.payload == y.payload;
+           });
+}
+
+// Small files with budgets tiny enough to force many runs and several merge
+// passes; the result must equal std::stable_sort and no run may be left over
+void sanityCheck(const std::string& directory, ThreadPool& pool) {
+    std::string input = directory + "/sanity_input.bin", output = directory + "/sanity_output.bin";
+    std::mt19937_64 rng(4);
+    for (size_t n : { 0, 1, 1000, 1024, 100003 }) {
+        std::vector<Record16> records(n);
+        for (size_t i = 0; i < n; i++) records[i] = Record16{ rng() % 1000, i };    // many equal keys
+        writeFile(input, records);
+        std::stable_sort(records.begin(), records.end(), ByKey());
+
+        for (size_t blockBytes : { 1024, 16384 }) {
+            ExternalSortOptions options;
+            options.memoryBudget = 64 * 1024;
+            options.ioBlockBytes = blockBytes;
+            options.tempDirectory = directory;
+            options.pool = &pool;
+            ExternalSortStats stats = externalSort<Record16>(input, output, options, ByKey());
+            if (!sameRecords(readFile<Record16>(output), records) || stats.records != n) {
+                throw std::logic_error("external sort wrong for n=" + std::to_string(n));
+            }
+        }
+    }
+
+    std::vector<uint64_t> keys(50000);
+    for (uint64_t& k : keys) k = rng();
+    writeFile(input, keys);
+    ExternalSortOptions options;
+    options.memoryBudget = 32 * 1024;
+    options.ioBlockBytes = 512;
+    options.tempDirectory = directory;
+    externalSort<uint64_t>(input, output, options);
+    std::sort(keys.begin(), keys.end());
+    if (readFile<uint64_t>(output) != keys) throw std::logic_error("external sort of uint64_t wrong");
+
+    // A truncated record must be reported, and its runs cleaned up
+    std::vector<uint32_t> odd(100001, 7);
+    writeFile(input, odd);
+    bool threw = false;
+    try {
+        externalSort<uint64_t>(input, output, options);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    if (!threw) throw std::logic_error("partial record not reported");
+    if (leftoverRuns(directory) != 0) throw std::logic_error("run files left behind");
+
+    std::remove(input.c_str());
+    std::remove(output.c_str());
+    std::cout << "Sanity check passed\n\n";
+}
+
+void printStats(const std::string& name, const ExternalSortStats& stats) {
+    double totalMs = stats.runPhaseMs + stats.mergePhaseMs;
+    std::cout << std::left << std::setw(36) << name << std::right << std::fixed << std::setprecision(0)
+              << std::setw(6) << stats.runs << std::setw(5) << stats.fanIn << std::setw(7) << stats.mergePasses
+              << std::setw(9) << stats.bytesRead / 1048576.0 << std::setw(9) << stats.bytesWritten / 1048576.0
+              << std::setw(9) << stats.sortMs << std::setw(9) << stats.runPhaseMs << std::setw(9) << stats.mergePhaseMs
+              << std::setw(9) << stats.ioWaitMs << std::setw(9) << totalMs << std::setprecision(1)
+              << std::setw(9) << (stats.bytesRead + stats.bytesWritten) / 1048576.0 / (totalMs / 1000.0) << "\n";
+}
+
+// Read the whole file, sort it with parallelMergeSort and write it back: the
+// lower bound when the data does fit in memory
+template<typename Record, typename Compare>
+void inMemoryBaseline(const std::string& name, const std::string& input, const std::string& output,
+                      ThreadPool& pool, Compare comp) {
+    auto start = Clock::now();
+    std::vector<Record> records = readFile<Record>(input);
+    double readMs = msSince(start);
+    start = Clock::now();
+    parallelMergeSort(records.begin(), records.end(), pool, comp);
+    double sortMs = msSince(start);
+    start = Clock::now();
+    writeFile(output, records);
+    double writeMs = msSince(start);
+    std::cout << std::left << std::setw(36) << name << std::right << std::fixed << std::setprecision(0)
+              << "  read " << readMs << " ms, sort " << sortMs << " ms, write " << writeMs << " ms\n";
+}
+
+template<typename Record, typename Compare>
+void benchmarkRecords(const std::string& name, const std::string& input, const std::string& output,
+                      size_t budget, const std::string& directory, ThreadPool& pool, Compare comp) {
+    ExternalSortOptions options;
+    options.memoryBudget = budget;
+    options.tempDirectory = directory;
+    options.pool = &pool;
+    printStats(name, externalSort<Record>(input, output, options, comp));
+
+    std::vector<Record> sorted = readFile<Record>(output);
+    if (!std::is_sorted(sorted.begin(), sorted.end(), comp)) throw std::logic_error(name + " output not sorted");
+
+    // Merge buffers so large that only three runs fit in one merge: more passes
+    options.ioBlockBytes = budget / 8;
+    printStats(name + ", fan-in 3", externalSort<Record>(input, output, options, comp));
+
+    inMemoryBaseline<Record>(name + ", in memory", input, output, pool, comp);
+}
+
+int main(int argc, char* argv[]) {
+    size_t fileMB = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1024;
+    size_t budgetMB = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 64;
+    std::string directory = argc > 3 ? argv[3] : ".";
+
+    ThreadPool pool;
+    sanityCheck(directory, pool);
+
+    std::string input = directory + "/external_input.bin", output = directory + "/external_output.bin";
+    std::cout << fileMB << " MB files, " << budgetMB << " MB memory budget, " << pool.workerCount() + 1
+              << " threads sorting the runs\n";
+    std::cout << std::left << std::setw(36) << "records" << std::right << std::setw(6) << "runs" << std::setw(5)
+              << "k" << std::setw(7) << "passes" << std::setw(9) << "read MB" << std::setw(9) << "write MB"
+              << std::setw(9) << "sort ms" << std::setw(9) << "runs ms" << std::setw(9) << "merge ms"
+              << std::setw(9) << "I/O wait" << std::setw(9) << "total ms" << std::setw(9) << "MB/s" << "\n";
+
+    std::mt19937_64 rng(1);
+    std::vector<uint64_t> block(1 << 20);
+    {
+        external_sort_detail::FilePtr file = external_sort_detail::openFile(input, "wb");
+        for (size_t written = 0; written < fileMB * 1048576; written += block.size() * sizeof(uint64_t)) {
+            for (uint64_t& v : block) v = rng();
+            external_sort_detail::writeRecords(file.get(), block.data(), block.size(), input);
+        }
+        external_sort_detail::closeFile(file, input);
+    }
+    // The same bytes read as uint64_t keys, then as 16-byte records
+    benchmarkRecords<uint64_t>("uint64_t", input, output, budgetMB << 20, directory, pool, std::less<>());
+    benchmarkRecords<Record16>("16-byte records by key", input, output, budgetMB << 20, directory, pool, ByKey());
+
+    std::remove(input.c_str());
+    std::remove(output.c_str());
+    return 0;
+}
+
+// Run program: Ctrl + F5 or Debug > Start Without Debugging menu
+// Debug program: F5 or Debug > Start Debugging menu
+
+// Tips for Getting Started:
+//   1. Use the Solution Explorer window to add/manage files
+//   2. Use the Team Explorer window to connect to source control
+//   3. Use the Output window to see build output and other messages
+//   4. Use the Error List window to view errors
+//   5. Go to Project > Add New Item to create new code files, or Project > Add Existing Item to add existing code files to the project
+//   6. In the future, to open this project again, go to File > Open > Project and select the .sln file
@@ -0,0 +1,188 @@
+// Lesson12_parallel_sort.cpp : This file contains the 'main' function. Program execution begins and ends there.
+//
+// Sweeps array size, thread count and input distribution for
+// parallelMergeSort and parallelIntrosort (ParallelSort.h), with std::sort
+// as the single-threaded reference.
+//
+// Usage: Lesson12_parallel_sort [maxSize]
+//   Sorts 1M and then every 10x step up to maxSize ints (default 10000000).
+//   Pass 100000000 for the 100M case (needs about 1.5 GB of RAM).
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ParallelSort.h"
+
+typedef std::chrono::steady_clock Clock;
+
+double msSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+enum class Distribution { Random, Sorted, Reversed, NearlySorted, FewUnique, OrganPipe };
+
+const Distribution kDistributions[] = {
+    Distribution::Random, Distribution::Sorted, Distribution::Reversed,
+    Distribution::NearlySorted, Distribution::FewUnique, Distribution::OrganPipe
+};
+
+std::string nameOf(Distribution d) {
+    switch (d) {
+    case Distribution::Random: return "random";
+    case Distribution::Sorted: return "sorted";
+    case Distribution::Reversed: return "reversed";
+    case Distribution::NearlySorted: return "nearly sorted";
+    case Distribution::FewUnique: return "16 unique";
+    case Distribution::OrganPipe: return "organ pipe";
+    }
+    return "";
+}
+
+std::vector<int> makeInput(size_t n, Distribution d, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::vector<int> data(n);
+    for (size_t i = 0; i < n; i++) {
+        switch (d) {
+        case Distribution::Random: data[i] = static_cast<int>(rng()); break;
+        case Distribution::Sorted:
+        case Distribution::NearlySorted: data[i] = static_cast<int>(i); break;
+        case Distribution::Reversed: data[i] = static_cast<int>(n - i); break;
+        case Distribution::FewUnique: data[i] = static_cast<int>(rng() % 16); break;
+        case Distribution::OrganPipe: data[i] = static_cast<int>(i < n / 2 ? i : n - i); break;
+        }
+    }
+    if (d == Distribution::NearlySorted) {
+        // Swap 1% of the elements with a neighbour up to 100 places away
+        for (size_t k = 0; k < n / 100; k++) {
+            size_t i = rng() % n;
+            size_t j = std::min(n - 1, i + rng() % 100);
+            std::swap(data[i], data[j]);
+        }
+    }
+    return data;
+}
+
+// Stability check: sort (key, original index) pairs by key only
+struct Tagged {
+    int key;
+    size_t index;
+};
+
+void sanityCheck() {
+    ThreadPool pool(3);
+    for (size_t n : { 0, 1, 2, 23, 24, 25, 1000, 40000, 300001 }) {
+        for (Distribution d : kDistributions) {
+            std::vector<int> expected = makeInput(n, d, 1);
+            std::vector<int> a = expected, b = expected, c = expected, e = expected;
+            std::sort(expected.begin(), expected.end());
+            parallelMergeSort(a.begin(), a.end(), pool);
+            parallelIntrosort(b.begin(), b.end(), pool);
+            introsort(c.begin(), c.end());
+            if (n <= 1000) insertionSort(e.begin(), e.end());
+            else e = expected;
+            if (a != expected || b != expected || c != expected || e != expected) {
+                throw std::logic_error("wrong result for " + nameOf(d) + " n=" + std::to_string(n));
+            }
+        }
+    }
+
+    std::vector<Tagged> tagged(500000);
+    std::mt19937 rng(2);
+    for (size_t i = 0; i < tagged.size(); i++) {
+        tagged[i].key = static_cast<int>(rng() % 1000);
+        tagged[i].index = i;
+    }
+    parallelMergeSort(tagged.begin(), tagged.end(), pool,
+                      [](const Tagged& x, const Tagged& y) { return x.key < y.key; });
+    for (size_t i = 1; i < tagged.size(); i++) {
+        if (tagged[i - 1].key > tagged[i].key ||
+            (tagged[i - 1].key == tagged[i].key && tagged[i - 1].index > tagged[i].index)) {
+            throw std::logic_error("parallelMergeSort is not stable");
+        }
+    }
+
+    // Descending order through a comparator
+    std::vector<int> desc = makeInput(100000, Distribution::Random, 3);
+    parallelIntrosort(desc.begin(), desc.end(), pool, std::greater<int>());
+    if (!std::is_sorted(desc.begin(), desc.end(), std::greater<int>())) {
+        throw std::logic_error("comparator ignored");
+    }
+    std::cout << "Sanity check passed\n\n";
+}
+
+int main(int argc, char* argv[]) {
+    size_t maxSize = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+
+    sanityCheck();
+
+    unsigned int hw = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<size_t> threadCounts;
+    for (size_t t = 1; t < hw; t *= 2) threadCounts.push_back(t);
+    threadCounts.push_back(hw);
+
+    std::cout << std::fixed << std::setprecision(1);
+    for (size_t n = 1000000; n <= maxSize; n *= 10) {
+        std::cout << n << " ints (ms; speedup over the same sort on 1 thread in brackets)\n";
+        std::cout << std::left << std::setw(15) << "distribution" << std::setw(18) << "sort" << std::right
+                  << std::setw(10) << "std::sort";
+        for (size_t t : threadCounts) std::cout << std::setw(14) << (std::to_string(t) + " thr");
+        std::cout << "\n";
+
+        std::vector<int> scratch(n);
+        for (Distribution d : kDistributions) {
+            std::vector<int> input = makeInput(n, d, 42);
+            std::vector<int> reference = input;
+            auto start = Clock::now();
+            std::sort(reference.begin(), reference.end());
+            double stdMs = msSince(start);
+
+            for (int method = 0; method < 2; method++) {
+                std::cout << std::left << std::setw(15) << (method == 0 ? nameOf(d) : "")
+                          << std::setw(18) << (method == 0 ? "parallelMergeSort" : "parallelIntrosort")
+                          << std::right << std::setw(10) << stdMs;
+                double oneThread = 0;
+                for (size_t t : threadCounts) {
+                    ThreadPool pool(t - 1);     // the calling thread is the t-th
+                    std::vector<int> data = input;
+                    start = Clock::now();
+                    if (method == 0) {
+                        parallelMergeSort(data.begin(), data.end(), pool, scratch);
+                    } else {
+                        parallelIntrosort(data.begin(), data.end(), pool);
+                    }
+                    double ms = msSince(start);
+                    if (data != reference) {
+                        throw std::logic_error("sort produced a wrong result");
+                    }
+                    if (t == 1) oneThread = ms;
+                    std::string cell = std::to_string(static_cast<int>(ms + 0.5)) + " (" +
+                                       std::to_string(oneThread / ms).substr(0, 4) + ")";
+                    std::cout << std::setw(14) << cell;
+                }
+                std::cout << "\n";
+            }
+        }
+        std::cout << "\n";
+    }
+
+    return 0;
+}
+
+// Run program: Ctrl + F5 or Debug > Start Without Debugging menu
+// Debug program: F5 or Debug > Start Debugging menu
+
+// Tips for Getting Started:
+//   1. Use the Solution Explorer window to add/manage files
+//   2. Use the Team Explorer window to connect to source control
+//   3. Use the Output window to see build output and other messages
+//   4. Use the Error List window to view errors
+//   5. Go to Project > Add New Item to create new code files, or Project > Add Existing Item to add existing code files to the project
+//   6. In the future, to open this project again, go to File > Open > Project and select the .sln file
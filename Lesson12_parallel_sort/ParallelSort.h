@@ -0,0 +1,330 @@
+// ParallelSort.h
+//
+// Templated, in-place sorting engine built from the Lesson 12 algorithms.
+//
+//   insertionSort      the lesson's insertion sort on any random-access range
+//   introsort          quicksort with median-of-three pivots, insertion sort
+//                      for small partitions and a heapsort fallback that caps
+//                      the worst case at O(n log n)
+//   parallelIntrosort  introsort whose partitions are sorted as pool tasks;
+//                      needs no extra memory
+//   parallelMergeSort  stable merge sort; both the recursive halves and the
+//                      merges themselves run in parallel
+//
+// Everything sorts the caller's range in place - nothing is copied or
+// returned by value. Merge sort needs one scratch buffer of n elements,
+// allocated once per call (or passed in by the caller to reuse it).
+//
+// Work is only forked for pieces above a grain of at least 16K elements, so
+// task overhead stays negligible. Below the grain both sorts recurse depth
+// first on one thread: once a sub-range fits in cache it is finished there
+// before the thread moves on, instead of streaming the whole array through
+// memory once per level.
+//
+// Ranges of int32_t, float or int64_t in contiguous memory, sorted with
+// std::less, finish their small partitions with the SIMD sorting networks
+// from SortingNetworks.h instead of insertion sort. Merge sort only does so
+// for the integer types, where an unstable leaf is indistinguishable from a
+// stable one (for float, -0.0 and +0.0 compare equal but are different).
+//
+// The sorts and their parallel tasks are PROFILE_ZONEs (ProfilerMacros.h),
+// which cost nothing unless the program is built with PROFILER_ENABLED.
+
+#ifndef PARALLEL_SORT_H
+#define PARALLEL_SORT_H
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../Lesson15_profiler/ProfilerMacros.h"
+#include "SortingNetworks.h"
+#include "ThreadPool.h"
+
+namespace parallel_sort_detail {
+
+const size_t kInsertionThreshold = 24;      // partitions this small use insertion sort
+const size_t kNetworkThreshold = 64;        // ... or a sorting network, where one applies
+
+inline size_t log2Floor(size_t n) {
+    size_t k = 0;
+    while (n > 1) {
+        n >>= 1;
+        k++;
+    }
+    return k;
+}
+
+// Smallest piece worth a task: ~8 pieces per thread, but never tiny
+inline size_t grainFor(size_t n, const ThreadPool& pool) {
+    size_t pieces = 8 * (pool.workerCount() + 1);
+    return std::max<size_t>(n / pieces, 16384);
+}
+
+// Move the median of a, b, c into result (which must be none of them)
+template<typename It, typename Compare>
+void moveMedianToFirst(It result, It a, It b, It c, Compare& comp) {
+    if (comp(*a, *b)) {
+        if (comp(*b, *c)) std::iter_swap(result, b);
+        else if (comp(*a, *c)) std::iter_swap(result, c);
+        else std::iter_swap(result, a);
+    } else if (comp(*a, *c)) {
+        std::iter_swap(result, a);
+    } else if (comp(*b, *c)) {
+        std::iter_swap(result, c);
+    } else {
+        std::iter_swap(result, b);
+    }
+}
+
+// Hoare partition around a median-of-three pivot stored at *first. Both
+// scans stop on elements equal to the pivot, so runs of duplicates are split
+// evenly instead of degrading to O(n^2).
+template<typename It, typename Compare>
+It partitionPivot(It first, It last, Compare& comp) {
+    It mid = first + (last - first) / 2;
+    moveMedianToFirst(first, first + 1, mid, last - 1, comp);
+    It lo = first + 1;
+    It hi = last;
+    for (;;) {
+        while (comp(*lo, *first)) ++lo;
+        --hi;
+        while (comp(*first, *hi)) --hi;
+        if (!(lo < hi)) return lo;
+        std::iter_swap(lo, hi);
+        ++lo;
+    }
+}
+
+template<typename It, typename Compare>
+void heapSort(It first, It last, Compare& comp) {
+    std::make_heap(first, last, comp);
+    std::sort_heap(first, last, comp);
+}
+
+template<typename It, typename Compare>
+void insertionSortRange(It first, It last, Compare& comp) {
+    if (first == last) return;
+    for (It i = first + 1; i != last; ++i) {
+        auto key = std::move(*i);
+        It j = i;
+        // Move elements greater than key one position ahead
+        while (j != first && comp(key, *(j - 1))) {
+            *j = std::move(*(j - 1));
+            --j;
+        }
+        *j = std::move(key);
+    }
+}
+
+// Whether [first, last) with comp can be handed to networkSort: the elements
+// are contiguous, of a type with kernels, and compared with plain operator<
+template<typename It, typename Compare>
+struct UsesNetworkLeaves {
+    typedef typename std::iterator_traits<It>::value_type T;
+    static const bool value = SortingNetworkTraits<T>::supported &&
+                              (std::is_same<It, T*>::value || std::is_same<It, typename std::vector<T>::iterator>::value) &&
+                              (std::is_same<Compare, std::less<>>::value || std::is_same<Compare, std::less<T>>::value);
+};
+
+template<typename It, typename Compare>
+struct UsesStableNetworkLeaves {
+    static const bool value = UsesNetworkLeaves<It, Compare>::value &&
+                              std::is_integral<typename std::iterator_traits<It>::value_type>::value;
+};
+
+template<typename It, typename Compare>
+void introsortLoop(It first, It last, size_t depthLimit, Compare& comp) {
+    const bool network = UsesNetworkLeaves<It, Compare>::value;
+    while (static_cast<size_t>(last - first) > (network ? kNetworkThreshold : kInsertionThreshold)) {
+        if (depthLimit == 0) {
+            heapSort(first, last, comp);
+            return;
+        }
+        depthLimit--;
+        It cut = partitionPivot(first, last, comp);
+        // Recurse into the smaller side, loop on the larger: O(log n) stack
+        if (cut - first < last - cut) {
+            introsortLoop(first, cut, depthLimit, comp);
+            first = cut;
+        } else {
+            introsortLoop(cut, last, depthLimit, comp);
+            last = cut;
+        }
+    }
+    if constexpr (UsesNetworkLeaves<It, Compare>::value) {
+        if (last - first > 1) networkSort(&*first, last - first);
+    } else {
+        insertionSortRange(first, last, comp);
+    }
+}
+
+template<typename It, typename Compare>
+void parallelIntrosortLoop(It first, It last, size_t depthLimit, Compare comp,
+                           TaskGroup& group, size_t grain) {
+    PROFILE_ZONE("parallelIntrosortLoop");
+    while (static_cast<size_t>(last - first) > grain) {
+        if (depthLimit == 0) {
+            heapSort(first, last, comp);
+            return;
+        }
+        depthLimit--;
+        It cut = partitionPivot(first, last, comp);
+        // Hand the right side to the pool and keep partitioning the left
+        group.run([cut, last, depthLimit, comp, &group, grain]() {
+            parallelIntrosortLoop(cut, last, depthLimit, comp, group, grain);
+        });
+        last = cut;
+    }
+    introsortLoop(first, last, depthLimit, comp);
+}
+
+// Stable merge of [first1, last1) and [first2, last2) into out (by move)
+template<typename In1, typename In2, typename Out, typename Compare>
+void serialMerge(In1 first1, In1 last1, In2 first2, In2 last2, Out out, Compare& comp) {
+    while (first1 != last1 && first2 != last2) {
+        if (comp(*first2, *first1)) {
+            *out = std::move(*first2);
+            ++first2;
+        } else {
+            *out = std::move(*first1);
+            ++first1;
+        }
+        ++out;
+    }
+    out = std::move(first1, last1, out);
+    std::move(first2, last2, out);
+}
+
+// Split the merge at the middle of the longer input, binary-search the
+// matching split point in the other, and merge the two halves in parallel.
+// lower_bound / upper_bound are chosen so equal keys keep their order.
+template<typename In1, typename In2, typename Out, typename Compare>
+void parallelMerge(In1 first1, In1 last1, In2 first2, In2 last2, Out out,
+                   Compare comp, ThreadPool& pool, size_t grain) {
+    size_t n1 = last1 - first1;
+    size_t n2 = last2 - first2;
+    if (n1 + n2 <= grain) {
+        PROFILE_ZONE("serialMerge");
+        serialMerge(first1, last1, first2, last2, out, comp);
+        return;
+    }
+    In1 mid1;
+    In2 mid2;
+    if (n1 >= n2) {
+        mid1 = first1 + n1 / 2;
+        mid2 = std::lower_bound(first2, last2, *mid1, comp);
+    } else {
+        mid2 = first2 + n2 / 2;
+        mid1 = std::upper_bound(first1, last1, *mid2, comp);
+    }
+    Out outMid = out + (mid1 - first1) + (mid2 - first2);
+    TaskGroup group(pool);
+    group.run([=, &pool]() { parallelMerge(first1, mid1, first2, mid2, out, comp, pool, grain); });
+    parallelMerge(mid1, last1, mid2, last2, outMid, comp, pool, grain);
+    group.wait();
+}
+
+// Sort data[0, n). The result ends up in buffer if intoBuffer, otherwise in
+// data. Each level sorts its halves into the *other* array and merges them
+// back, so elements are moved once per level and never copied to temporaries.
+// Leaves use insertion sort, which (unlike introsort) keeps the sort stable,
+// or a sorting network for integers.
+template<typename It, typename Buf, typename Compare>
+void mergeSortRec(It data, Buf buffer, size_t n, bool intoBuffer, Compare comp,
+                  ThreadPool& pool, size_t grain) {
+    const bool network = UsesStableNetworkLeaves<It, Compare>::value;
+    if (n <= (network ? kNetworkThreshold : kInsertionThreshold)) {
+        if constexpr (UsesStableNetworkLeaves<It, Compare>::value) {
+            if (n > 1) networkSort(&*data, n);
+        } else {
+            insertionSortRange(data, data + n, comp);
+        }
+        if (intoBuffer) std::move(data, data + n, buffer);
+        return;
+    }
+    size_t half = n / 2;
+    if (n > grain) {
+        PROFILE_ZONE("mergeSortRec fork");
+        TaskGroup group(pool);
+        group.run([=, &pool]() { mergeSortRec(data, buffer, half, !intoBuffer, comp, pool, grain); });
+        mergeSortRec(data + half, buffer + half, n - half, !intoBuffer, comp, pool, grain);
+        group.wait();
+    } else {
+        mergeSortRec(data, buffer, half, !intoBuffer, comp, pool, grain);
+        mergeSortRec(data + half, buffer + half, n - half, !intoBuffer, comp, pool, grain);
+    }
+    if (intoBuffer) {
+        parallelMerge(data, data + half, data + half, data + n, buffer, comp, pool, grain);
+    } else {
+        parallelMerge(buffer, buffer + half, buffer + half, buffer + n, data, comp, pool, grain);
+    }
+}
+
+} // namespace parallel_sort_detail
+
+/**
+ * @brief Insertion sort on [first, last). O(n^2); best for small or nearly sorted ranges.
+ */
+template<typename RandomIt, typename Compare = std::less<>>
+void insertionSort(RandomIt first, RandomIt last, Compare comp = Compare()) {
+    parallel_sort_detail::insertionSortRange(first, last, comp);
+}
+
+/**
+ * @brief Serial introsort on [first, last). Not stable; O(n log n) worst case.
+ */
+template<typename RandomIt, typename Compare = std::less<>>
+void introsort(RandomIt first, RandomIt last, Compare comp = Compare()) {
+    size_t n = last - first;
+    parallel_sort_detail::introsortLoop(first, last, 2 * parallel_sort_detail::log2Floor(n), comp);
+}
+
+/**
+ * @brief Introsort whose partitions run as tasks on pool. Not stable; no extra memory.
+ *
+ * The first partition passes are serial, so this scales less well than
+ * parallelMergeSort on many cores, but it needs no scratch buffer.
+ */
+template<typename RandomIt, typename Compare = std::less<>>
+void parallelIntrosort(RandomIt first, RandomIt last, ThreadPool& pool, Compare comp = Compare()) {
+    PROFILE_ZONE("parallelIntrosort");
+    size_t n = last - first;
+    TaskGroup group(pool);
+    parallel_sort_detail::parallelIntrosortLoop(first, last, 2 * parallel_sort_detail::log2Floor(n), comp,
+                                                group, parallel_sort_detail::grainFor(n, pool));
+    group.wait();
+}
+
+/**
+ * @brief Stable parallel merge sort of [first, last) using a caller-owned scratch buffer.
+ *
+ * scratch is grown to n elements if needed and can be reused across calls.
+ * The element type must be default constructible and move assignable.
+ */
+template<typename RandomIt, typename Compare = std::less<>>
+void parallelMergeSort(RandomIt first, RandomIt last, ThreadPool& pool,
+                       std::vector<typename std::iterator_traits<RandomIt>::value_type>& scratch,
+                       Compare comp = Compare()) {
+    PROFILE_ZONE("parallelMergeSort");
+    size_t n = last - first;
+    if (n < 2) return;
+    if (scratch.size() < n) scratch.resize(n);
+    parallel_sort_detail::mergeSortRec(first, scratch.data(), n, false, comp, pool,
+                                       parallel_sort_detail::grainFor(n, pool));
+}
+
+/**
+ * @brief Stable parallel merge sort of [first, last); allocates its scratch buffer.
+ */
+template<typename RandomIt, typename Compare = std::less<>>
+void parallelMergeSort(RandomIt first, RandomIt last, ThreadPool& pool, Compare comp = Compare()) {
+    std::vector<typename std::iterator_traits<RandomIt>::value_type> scratch;
+    parallelMergeSort(first, last, pool, scratch, comp);
+}
+
+#endif // PARALLEL_SORT_H
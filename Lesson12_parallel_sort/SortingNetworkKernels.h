@@ -0,0 +1,118 @@
+// SortingNetworkKernels.h
+//
+// Bitonic sorting-network kernels, written once against a "register
+// traits" type V that supplies:
+//
+//   T, Reg, W                 element type, vector register type, lanes per register
+//   load, store               unaligned W-element load / store
+//   min, max                  lane-wise minimum / maximum
+//   permXor<J>                lane i receives lane i ^ J (J < W)
+//   blend<Mask>(a, b)         lane i comes from b when bit i of Mask is set
+//   reverse                   lanes in reverse order
+//
+// A block of N = R * W elements lives in R registers. The steps of the
+// bitonic network that compare elements at least W apart compare whole
+// registers with one min and one max; the steps closer than that permute
+// lanes inside each register. Every loop bound, register index and blend
+// mask is a template argument, so each kernel compiles to a straight run of
+// vector instructions with no branches.
+//
+// SortingNetworks.h includes this file several times, each inside its own
+// namespace and compiler target region, so the same code is built for AVX2,
+// SSE4.1 and plain scalar registers. It therefore has no include guard and
+// should not be included on its own.
+
+// Lanes of register r that keep the larger value in the step that compares
+// element i with element i ^ j, inside a bitonic phase of width k
+constexpr int takeMaxMask(int w, int r, int j, int k) {
+    int mask = 0;
+    for (int lane = 0; lane < w; lane++) {
+        int i = r * w + lane;
+        bool ascending = (i & k) == 0;
+        bool upper = (lane & j) != 0;
+        if (ascending == upper) mask |= 1 << lane;
+    }
+    return mask;
+}
+
+template<typename V, int J, int K, int Rg>
+inline typename V::Reg laneStep(typename V::Reg v) {
+    typename V::Reg partner = V::template permXor<J>(v);
+    return V::template blend<takeMaxMask(V::W, Rg, J, K)>(V::min(v, partner), V::max(v, partner));
+}
+
+template<typename V, int K, int A, int B>
+inline void crossStep(typename V::Reg* v) {
+    if constexpr (A < B) {
+        typename V::Reg lo = V::min(v[A], v[B]);
+        typename V::Reg hi = V::max(v[A], v[B]);
+        constexpr bool ascending = ((A * V::W) & K) == 0;
+        v[A] = ascending ? lo : hi;
+        v[B] = ascending ? hi : lo;
+    }
+}
+
+template<typename V, int K, int J, int... Rs>
+inline void step(typename V::Reg* v, std::integer_sequence<int, Rs...>) {
+    if constexpr (J >= V::W) {
+        (crossStep<V, K, Rs, (Rs ^ (J / V::W))>(v), ...);
+    } else {
+        ((v[Rs] = laneStep<V, J, K, Rs>(v[Rs])), ...);
+    }
+}
+
+// Steps J, J/2, ..., 1 of the bitonic phase of width K
+template<typename V, int R, int K, int J>
+inline void phase(typename V::Reg* v) {
+    step<V, K, J>(v, std::make_integer_sequence<int, R>());
+    if constexpr (J > 1) phase<V, R, K, J / 2>(v);
+}
+
+// Phases of width K, 2K, ..., R * W: a full bitonic sort
+template<typename V, int R, int K>
+inline void sortPhases(typename V::Reg* v) {
+    phase<V, R, K, K / 2>(v);
+    if constexpr (K < R * V::W) sortPhases<V, R, K * 2>(v);
+}
+
+template<typename V, int R>
+inline void sortBlock(typename V::T* data) {
+    typename V::Reg v[R];
+    for (int r = 0; r < R; r++) v[r] = V::load(data + r * V::W);
+    sortPhases<V, R, 2>(v);
+    for (int r = 0; r < R; r++) V::store(data + r * V::W, v[r]);
+}
+
+// Merge two sorted blocks of R registers each. Reversing b makes a + b one
+// bitonic sequence, which a single phase of half-cleaners sorts.
+template<typename V, int R>
+inline void mergeBlocks(const typename V::T* a, const typename V::T* b, typename V::T* out) {
+    typename V::Reg v[2 * R];
+    for (int r = 0; r < R; r++) {
+        v[r] = V::load(a + r * V::W);
+        v[2 * R - 1 - r] = V::reverse(V::load(b + r * V::W));
+    }
+    phase<V, 2 * R, 2 * R * V::W, R * V::W>(v);
+    for (int r = 0; r < 2 * R; r++) V::store(out + r * V::W, v[r]);
+}
+
+// size must be 8, 16, 32 or 64
+template<typename V>
+void sortAnyBlock(typename V::T* data, size_t size) {
+    switch (size) {
+    case 8: sortBlock<V, 8 / V::W>(data); break;
+    case 16: sortBlock<V, 16 / V::W>(data); break;
+    case 32: sortBlock<V, 32 / V::W>(data); break;
+    default: sortBlock<V, 64 / V::W>(data); break;
+    }
+}
+
+// size (of each input) must be 8, 16 or 32
+template<typename V>
+void mergeAnyBlocks(const typename V::T* a, const typename V::T* b, typename V::T* out, size_t size) {
+    switch (size) {
+    case 8: mergeBlocks<V, 8 / V::W>(a, b, out); break;
+    case 16: mergeBlocks<V, 16 / V::W>(a, b, out); break;
+    default: mergeBlocks<V, 32 / V::W>(a, b, out); break;
+    }
+}
@@ -0,0 +1,295 @@
+// SortingNetworks.h
+//
+// Sorting networks for small blocks of int32_t, float and int64_t.
+//
+// Insertion sort, the usual base case of merge sort and quicksort, spends
+// its time on a data-dependent branch per element that the CPU mispredicts
+// about half the time on random data. A sorting network performs a fixed
+// sequence of compare-exchange steps instead, so it never branches on the
+// data, and with SIMD registers each step handles 4 or 8 pairs at once.
+//
+//   networkSort(data, n)          sort up to 64 elements (padded up to 8/16/32/64)
+//   bitonicMerge(a, b, out, n)    merge two sorted blocks of 8, 16 or 32
+//
+// The instruction set is picked at run time (SimdDispatch.h): AVX2 if the
+// CPU has it, then SSE4.1 (int32_t and float only - 64-bit compares need
+// SSE4.2), otherwise the same network on scalar values, which the compiler
+// turns into branch-free conditional moves. Every entry point also takes an
+// explicit SimdLevel so the variants can be compared.
+//
+// Networks are not stable. For plain numbers compared with operator< that
+// is only visible for float -0.0 / +0.0, which may swap places. As with
+// std::sort, NaNs are not supported.
+
+#ifndef SORTING_NETWORKS_H
+#define SORTING_NETWORKS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#include "../common/SimdDispatch.h"
+
+namespace sorting_network_scalar {
+
+template<typename Element>
+struct Lanes {
+    typedef Element T;
+    typedef Element Reg;
+    static constexpr int W = 1;
+    static Reg load(const T* p) { return *p; }
+    static void store(T* p, Reg v) { *p = v; }
+    static Reg min(Reg a, Reg b) { return b < a ? b : a; }
+    static Reg max(Reg a, Reg b) { return b < a ? a : b; }
+    static Reg reverse(Reg v) { return v; }
+};
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+// The compiler turns the float ternaries above into compares and selects;
+// minss / maxss (which every SSE CPU has) do each in one instruction
+template<>
+inline float Lanes<float>::min(float a, float b) { return _mm_cvtss_f32(_mm_min_ss(_mm_set_ss(a), _mm_set_ss(b))); }
+template<>
+inline float Lanes<float>::max(float a, float b) { return _mm_cvtss_f32(_mm_max_ss(_mm_set_ss(a), _mm_set_ss(b))); }
+#endif
+
+#include "SortingNetworkKernels.h"
+
+} // namespace sorting_network_scalar
+
+#ifdef SIMD_X86
+
+SIMD_BEGIN_AVX2
+namespace sorting_network_avx2 {
+
+struct Int32 {
+    typedef int32_t T;
+    typedef __m256i Reg;
+    static constexpr int W = 8;
+    static Reg load(const T* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    static void store(T* p, Reg v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+    static Reg min(Reg a, Reg b) { return _mm256_min_epi32(a, b); }
+    static Reg max(Reg a, Reg b) { return _mm256_max_epi32(a, b); }
+    template<int J> static Reg permXor(Reg v) {
+        if constexpr (J == 1) return _mm256_shuffle_epi32(v, 0xB1);
+        else if constexpr (J == 2) return _mm256_shuffle_epi32(v, 0x4E);
+        else return _mm256_permute2x128_si256(v, v, 1);
+    }
+    template<int Mask> static Reg blend(Reg a, Reg b) { return _mm256_blend_epi32(a, b, Mask); }
+    static Reg reverse(Reg v) { return _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0)); }
+};
+
+struct Float {
+    typedef float T;
+    typedef __m256 Reg;
+    static constexpr int W = 8;
+    static Reg load(const T* p) { return _mm256_loadu_ps(p); }
+    static void store(T* p, Reg v) { _mm256_storeu_ps(p, v); }
+    static Reg min(Reg a, Reg b) { return _mm256_min_ps(a, b); }
+    static Reg max(Reg a, Reg b) { return _mm256_max_ps(a, b); }
+    template<int J> static Reg permXor(Reg v) {
+        if constexpr (J == 1) return _mm256_permute_ps(v, 0xB1);
+        else if constexpr (J == 2) return _mm256_permute_ps(v, 0x4E);
+        else return _mm256_permute2f128_ps(v, v, 1);
+    }
+    template<int Mask> static Reg blend(Reg a, Reg b) { return _mm256_blend_ps(a, b, Mask); }
+    static Reg reverse(Reg v) { return _mm256_permutevar8x32_ps(v, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0)); }
+};
+
+// AVX2 has no 64-bit min/max, so both are built from a compare and a blend
+struct Int64 {
+    typedef int64_t T;
+    typedef __m256i Reg;
+    static constexpr int W = 4;
+    static Reg load(const T* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    static void store(T* p, Reg v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+    static Reg min(Reg a, Reg b) { return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(a, b)); }
+    static Reg max(Reg a, Reg b) { return _mm256_blendv_epi8(b, a, _mm256_cmpgt_epi64(a, b)); }
+    template<int J> static Reg permXor(Reg v) {
+        if constexpr (J == 1) return _mm256_shuffle_epi32(v, 0x4E);
+        else return _mm256_permute2x128_si256(v, v, 1);
+    }
+    // Each 64-bit lane is two 32-bit lanes of the blend mask
+    template<int Mask> static Reg blend(Reg a, Reg b) {
+        return _mm256_blend_epi32(a, b, ((Mask & 1) ? 0x03 : 0) | ((Mask & 2) ? 0x0C : 0) |
+                                        ((Mask & 4) ? 0x30 : 0) | ((Mask & 8) ? 0xC0 : 0));
+    }
+    static Reg reverse(Reg v) { return _mm256_permute4x64_epi64(v, 0x1B); }
+};
+
+#include "SortingNetworkKernels.h"
+
+} // namespace sorting_network_avx2
+SIMD_END_TARGET
+
+SIMD_BEGIN_SSE41
+namespace sorting_network_sse41 {
+
+struct Int32 {
+    typedef int32_t T;
+    typedef __m128i Reg;
+    static constexpr int W = 4;
+    static Reg load(const T* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+    static void store(T* p, Reg v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+    static Reg min(Reg a, Reg b) { return _mm_min_epi32(a, b); }
+    static Reg max(Reg a, Reg b) { return _mm_max_epi32(a, b); }
+    template<int J> static Reg permXor(Reg v) {
+        if constexpr (J == 1) return _mm_shuffle_epi32(v, 0xB1);
+        else return _mm_shuffle_epi32(v, 0x4E);
+    }
+    // Each 32-bit lane is two 16-bit lanes of the blend mask
+    template<int Mask> static Reg blend(Reg a, Reg b) {
+        return _mm_blend_epi16(a, b, ((Mask & 1) ? 0x03 : 0) | ((Mask & 2) ? 0x0C : 0) |
+                                     ((Mask & 4) ? 0x30 : 0) | ((Mask & 8) ? 0xC0 : 0));
+    }
+    static Reg reverse(Reg v) { return _mm_shuffle_epi32(v, 0x1B); }
+};
+
+struct Float {
+    typedef float T;
+    typedef __m128 Reg;
+    static constexpr int W = 4;
+    static Reg load(const T* p) { return _mm_loadu_ps(p); }
+    static void store(T* p, Reg v) { _mm_storeu_ps(p, v); }
+    static Reg min(Reg a, Reg b) { return _mm_min_ps(a, b); }
+    static Reg max(Reg a, Reg b) { return _mm_max_ps(a, b); }
+    template<int J> static Reg permXor(Reg v) {
+        if constexpr (J == 1) return _mm_shuffle_ps(v, v, 0xB1);
+        else return _mm_shuffle_ps(v, v, 0x4E);
+    }
+    template<int Mask> static Reg blend(Reg a, Reg b) { return _mm_blend_ps(a, b, Mask); }
+    static Reg reverse(Reg v) { return _mm_shuffle_ps(v, v, 0x1B); }
+};
+
+#include "SortingNetworkKernels.h"
+
+} // namespace sorting_network_sse41
+SIMD_END_TARGET
+
+#endif // SIMD_X86
+
+/**
+ * @brief Which kernels exist for an element type. Only specialized types
+ *        can be passed to networkSort and bitonicMerge.
+ */
+template<typename T>
+struct SortingNetworkTraits {
+    static const bool supported = false;
+};
+
+template<>
+struct SortingNetworkTraits<int32_t> {
+    static const bool supported = true;
+    static const bool hasSse41 = true;
+    static const size_t avx2MinBlock = 8;
+#ifdef SIMD_X86
+    typedef sorting_network_avx2::Int32 Avx2;
+    typedef sorting_network_sse41::Int32 Sse41;
+#endif
+};
+
+template<>
+struct SortingNetworkTraits<float> {
+    static const bool supported = true;
+    static const bool hasSse41 = true;
+    static const size_t avx2MinBlock = 8;
+#ifdef SIMD_X86
+    typedef sorting_network_avx2::Float Avx2;
+    typedef sorting_network_sse41::Float Sse41;
+#endif
+};
+
+template<>
+struct SortingNetworkTraits<int64_t> {
+    static const bool supported = true;
+    static const bool hasSse41 = false;
+    // Smaller blocks sort faster with the scalar network: AVX2 has no
+    // 64-bit min / max, and two registers leave too little to do in parallel
+    static const size_t avx2MinBlock = 64;
+#ifdef SIMD_X86
+    typedef sorting_network_avx2::Int64 Avx2;
+#endif
+};
+
+namespace sorting_network_detail {
+
+// Sort a block whose size is exactly 8, 16, 32 or 64
+template<typename T>
+void sortExactBlock(T* data, size_t size, SimdLevel level) {
+#ifdef SIMD_X86
+    typedef SortingNetworkTraits<T> Traits;
+    if (level == SimdLevel::AVX2 && size >= Traits::avx2MinBlock) {
+        sorting_network_avx2::sortAnyBlock<typename Traits::Avx2>(data, size);
+        return;
+    }
+    if constexpr (Traits::hasSse41) {
+        if (level != SimdLevel::Scalar) {
+            sorting_network_sse41::sortAnyBlock<typename Traits::Sse41>(data, size);
+            return;
+        }
+    }
+#else
+    (void)level;
+#endif
+    sorting_network_scalar::sortAnyBlock<sorting_network_scalar::Lanes<T>>(data, size);
+}
+
+template<typename T>
+T largestValue() {
+    return std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+}
+
+} // namespace sorting_network_detail
+
+/**
+ * @brief Sort data[0, n) in ascending order with a sorting network. n must be at most 64.
+ *
+ * Sizes other than 8, 16, 32 and 64 are padded up to the next one with the
+ * largest value of T, sorted in a local buffer and copied back.
+ */
+template<typename T>
+void networkSort(T* data, size_t n, SimdLevel level = detectSimdLevel()) {
+    static_assert(SortingNetworkTraits<T>::supported, "networkSort supports int32_t, float and int64_t");
+    if (n < 2) return;
+    size_t size = n <= 8 ? 8 : n <= 16 ? 16 : n <= 32 ? 32 : 64;
+    if (n == size) {
+        sorting_network_detail::sortExactBlock(data, size, level);
+        return;
+    }
+    T padded[64];
+    std::memcpy(padded, data, n * sizeof(T));
+    T fill = sorting_network_detail::largestValue<T>();
+    for (size_t i = n; i < size; i++) padded[i] = fill;
+    sorting_network_detail::sortExactBlock(padded, size, level);
+    std::memcpy(data, padded, n * sizeof(T));
+}
+
+/**
+ * @brief Merge sorted a[0, n) and b[0, n) into out[0, 2n). n must be 8, 16 or 32.
+ *
+ * out must not overlap a or b.
+ */
+template<typename T>
+void bitonicMerge(const T* a, const T* b, T* out, size_t n, SimdLevel level = detectSimdLevel()) {
+    static_assert(SortingNetworkTraits<T>::supported, "bitonicMerge supports int32_t, float and int64_t");
+#ifdef SIMD_X86
+    typedef SortingNetworkTraits<T> Traits;
+    if (level == SimdLevel::AVX2) {
+        sorting_network_avx2::mergeAnyBlocks<typename Traits::Avx2>(a, b, out, n);
+        return;
+    }
+    if constexpr (Traits::hasSse41) {
+        if (level == SimdLevel::SSE41) {
+            sorting_network_sse41::mergeAnyBlocks<typename Traits::Sse41>(a, b, out, n);
+            return;
+        }
+    }
+#endif
+    (void)level;
+    sorting_network_scalar::mergeAnyBlocks<sorting_network_scalar::Lanes<T>>(a, b, out, n);
+}
+
+#endif // SORTING_NETWORKS_H
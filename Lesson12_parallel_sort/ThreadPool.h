@@ -0,0 +1,186 @@
+// ThreadPool.h
+//
+// A small fork-join thread pool for divide-and-conquer algorithms.
+//
+// Tasks go into one queue guarded by a mutex and condition variable, the
+// same pattern as the ThreadSafeQueue in Lesson 16.5. A TaskGroup tracks a
+// batch of tasks; TaskGroup::wait() does not block while tasks are still
+// queued - the waiting thread runs queued tasks itself. That matters for
+// recursive algorithms: a task that forks sub-tasks and waits for them keeps
+// a thread busy instead of parking it, so nested waits can never deadlock
+// the pool.
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class ThreadPool {
+public:
+    /**
+     * @param workers Number of worker threads. A thread waiting on a
+     *        TaskGroup also runs tasks, so ThreadPool(n - 1) plus the caller
+     *        keeps n cores busy, and ThreadPool(0) runs everything on the
+     *        caller.
+     */
+    explicit ThreadPool(size_t workers = defaultWorkers()) : stopping(false) {
+        for (size_t i = 0; i < workers; i++) {
+            threads.emplace_back([this]() { workerLoop(); });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        available.notify_all();
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        available.notify_one();
+    }
+
+    // Run one queued task on the calling thread. Returns false if the queue
+    // was empty.
+    bool tryRunOne() {
+        std::function<void()> task;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (tasks.empty()) return false;
+            task = std::move(tasks.back());     // newest first: the smallest, most cache-warm piece
+            tasks.pop_back();
+        }
+        task();
+        return true;
+    }
+
+    size_t workerCount() const { return threads.size(); }
+
+    // One worker per hardware thread besides the caller's
+    static size_t defaultWorkers() {
+        unsigned int hw = std::thread::hardware_concurrency();
+        return hw > 1 ? hw - 1 : 0;
+    }
+
+private:
+    std::vector<std::thread> threads;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable available;
+    bool stopping;
+
+    void workerLoop() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                available.wait(lock, [this]() { return stopping || !tasks.empty(); });
+                if (tasks.empty()) return;  // stopping and drained
+                task = std::move(tasks.front());    // oldest first: the biggest piece of work
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+};
+
+/**
+ * @brief A batch of tasks that can be waited on together.
+ *
+ * The first exception thrown by any task is rethrown from wait().
+ */
+class TaskGroup {
+public:
+    explicit TaskGroup(ThreadPool& pool) : pool(pool), pending(0) {}
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    // A group must not be destroyed while its tasks still reference it
+    ~TaskGroup() {
+        waitAll();
+    }
+
+    template<typename Fn>
+    void run(Fn fn) {
+        pending.fetch_add(1, std::memory_order_relaxed);
+        pool.submit([this, fn]() mutable {
+            try {
+                fn();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error) error = std::current_exception();
+            }
+            pending.fetch_sub(1, std::memory_order_release);
+        });
+    }
+
+    void wait() {
+        waitAll();
+        if (error) {
+            std::exception_ptr e = error;
+            error = nullptr;
+            std::rethrow_exception(e);
+        }
+    }
+
+private:
+    ThreadPool& pool;
+    std::atomic<size_t> pending;
+    std::mutex errorMutex;
+    std::exception_ptr error;
+
+    void waitAll() {
+        while (pending.load(std::memory_order_acquire) != 0) {
+            if (!pool.tryRunOne()) {
+                std::this_thread::yield();
+            }
+        }
+    }
+};
+
+namespace thread_pool_detail {
+
+// Elements per slice of forSlices at least, so that a task is worth its cost
+const size_t kMinSlice = 1 << 15;
+
+/**
+ * @brief Runs fn(begin, end) over slices of [0, n), one per pool thread and
+ * the caller, and waits for them. Slice boundaries are multiples of align.
+ */
+template<typename Fn>
+void forSlices(size_t n, ThreadPool& pool, const Fn& fn, size_t align = 1) {
+    size_t slices = std::min(pool.workerCount() + 1, std::max<size_t>(1, n / kMinSlice));
+    size_t slice = ((n + slices - 1) / slices + align - 1) / align * align;
+    TaskGroup group(pool);
+    for (size_t begin = 0; begin < n; begin += slice) {
+        size_t end = std::min(n, begin + slice);
+        group.run([=, &fn]() { fn(begin, end); });
+    }
+    group.wait();
+}
+
+} // namespace thread_pool_detail
+
+#endif // THREAD_POOL_H
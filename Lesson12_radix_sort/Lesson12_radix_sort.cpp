@@ -0,0 +1,244 @@
+// Lesson12_radix_sort.cpp : This file contains the 'main' function. Program execution begins and ends there.
+//
+// Benchmarks the radix sorts in RadixSort.h against std::sort and against
+// the decimal RadixSort class from "Lesson12 sorting.md", for 32/64-bit
+// signed and unsigned integers, float, double and (key, payload) pairs.
+//
+// Usage: Lesson12_radix_sort [elements]
+//   Default is 10000000 elements.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "RadixSort.h"
+
+// The lesson's radix sort with the per-pass printing removed. Base 10, and
+// only correct for non-negative ints.
+class LessonRadixSort {
+private:
+    static int getMax(const std::vector<int>& arr) {
+        return *std::max_element(arr.begin(), arr.end());
+    }
+
+    static void countingSort(std::vector<int>& arr, int exp) {
+        std::vector<int> output(arr.size());
+        std::vector<int> count(10, 0);
+
+        for (size_t i = 0; i < arr.size(); i++) {
+            count[(arr[i] / exp) % 10]++;
+        }
+        for (int i = 1; i < 10; i++) {
+            count[i] += count[i - 1];
+        }
+        for (size_t i = arr.size(); i-- > 0;) {
+            output[count[(arr[i] / exp) % 10] - 1] = arr[i];
+            count[(arr[i] / exp) % 10]--;
+        }
+        for (size_t i = 0; i < arr.size(); i++) {
+            arr[i] = output[i];
+        }
+    }
+
+public:
+    static void sort(std::vector<int>& arr) {
+        int max = getMax(arr);
+        for (long long exp = 1; max / exp > 0; exp *= 10) {
+            countingSort(arr, static_cast<int>(exp));
+        }
+    }
+};
+
+typedef std::chrono::steady_clock Clock;
+
+double msSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+template<typename T>
+std::vector<T> randomValues(size_t n, unsigned seed) {
+    std::mt19937_64 rng(seed);
+    std::vector<T> values(n);
+    for (T& v : values) {
+        uint64_t bits = rng();
+        if (std::is_floating_point<T>::value) {
+            // Spread over many magnitudes and both signs
+            double mantissa = static_cast<double>(bits >> 11) / 9007199254740992.0;
+            double value = (mantissa - 0.5) * std::pow(10.0, static_cast<int>(rng() % 40) - 20);
+            v = static_cast<T>(value);
+        } else {
+            v = static_cast<T>(bits);
+        }
+    }
+    return values;
+}
+
+// Every sort must agree with std::sort, including at the extremes of the type
+template<typename T>
+void checkType(ThreadPool& pool, const std::string& name) {
+    for (size_t n : { 0, 1, 2, 64, 65, 1000, 300000 }) {
+        std::vector<T> expected = randomValues<T>(n, 5);
+        if (n > 10) {
+            expected[3] = std::numeric_limits<T>::lowest();
+            expected[4] = std::numeric_limits<T>::max();
+            expected[5] = T(0);
+        }
+        std::vector<T> a = expected, b = expected, c = expected;
+        std::sort(expected.begin(), expected.end());
+        radixSort<8>(a);
+        radixSort<11>(b);
+        parallelRadixSort(c, pool);
+        if (a != expected || b != expected || c != expected) {
+            throw std::logic_error("radix sort wrong for " + name + " n=" + std::to_string(n));
+        }
+    }
+}
+
+void sanityCheck() {
+    ThreadPool pool(3);
+    checkType<uint32_t>(pool, "uint32_t");
+    checkType<int32_t>(pool, "int32_t");
+    checkType<uint64_t>(pool, "uint64_t");
+    checkType<int64_t>(pool, "int64_t");
+    checkType<int16_t>(pool, "int16_t");
+    checkType<float>(pool, "float");
+    checkType<double>(pool, "double");
+
+    // Stability: payloads of equal keys stay in input order
+    std::vector<std::pair<int32_t, uint32_t>> pairs(400000);
+    std::mt19937 rng(8);
+    for (uint32_t i = 0; i < pairs.size(); i++) {
+        pairs[i] = std::make_pair(static_cast<int32_t>(rng() % 2000) - 1000, i);
+    }
+    std::vector<std::pair<int32_t, uint32_t>> serial = pairs, parallel = pairs;
+    std::stable_sort(pairs.begin(), pairs.end(),
+                     [](const std::pair<int32_t, uint32_t>& x, const std::pair<int32_t, uint32_t>& y) { return x.first < y.first; });
+    std::vector<std::pair<int32_t, uint32_t>> scratch;
+    radixSortPairs(serial, scratch);
+    parallelRadixSortBy(parallel, scratch, pool, [](const std::pair<int32_t, uint32_t>& p) { return p.first; });
+    if (serial != pairs || parallel != pairs) {
+        throw std::logic_error("pair sort not stable");
+    }
+
+    // Keys that only differ in their low bits, and keys that are all equal
+    std::vector<uint64_t> narrow(500000), same(500000, 7);
+    for (uint64_t& v : narrow) v = 0xABCD000000000000ull | (rng() % 5000);
+    std::vector<uint64_t> narrowExpected = narrow;
+    std::sort(narrowExpected.begin(), narrowExpected.end());
+    parallelRadixSort(narrow, pool);
+    parallelRadixSort(same, pool);
+    if (narrow != narrowExpected || same != std::vector<uint64_t>(500000, 7)) {
+        throw std::logic_error("narrow or constant keys sorted wrongly");
+    }
+    std::cout << "Sanity check passed\n\n";
+}
+
+template<typename Fn>
+double timeSort(Fn fn) {
+    auto start = Clock::now();
+    fn();
+    return msSince(start);
+}
+
+void printRow(const std::string& name, size_t n, double ms) {
+    std::cout << std::left << std::setw(38) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << ms << std::setw(12) << n / ms / 1000.0 << "\n";
+}
+
+// std::sort, LSD with 8- and 11-bit digits, and the parallel MSD sort on
+// the same input; every result is checked against std::sort
+template<typename T>
+void benchmarkType(const std::string& name, const std::vector<T>& input, ThreadPool& pool) {
+    std::vector<T> reference = input, data, scratch(input.size());
+    printRow(name + " std::sort", input.size(), timeSort([&]() { std::sort(reference.begin(), reference.end()); }));
+
+    data = input;
+    printRow(name + " radixSort<8>", input.size(), timeSort([&]() { radixSort<8>(data, scratch); }));
+    if (data != reference) throw std::logic_error("radixSort<8> wrong");
+    data = input;
+    printRow(name + " radixSort<11>", input.size(), timeSort([&]() { radixSort<11>(data, scratch); }));
+    if (data != reference) throw std::logic_error("radixSort<11> wrong");
+    data = input;
+    printRow(name + " parallelRadixSort", input.size(), timeSort([&]() { parallelRadixSort(data, scratch, pool); }));
+    if (data != reference) throw std::logic_error("parallelRadixSort wrong");
+}
+
+int main(int argc, char* argv[]) {
+    size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+
+    sanityCheck();
+
+    ThreadPool pool;
+    std::cout << n << " elements, " << pool.workerCount() + 1 << " threads for parallelRadixSort\n";
+    std::cout << std::left << std::setw(38) << "sort" << std::right << std::setw(10) << "ms"
+              << std::setw(12) << "M keys/s" << "\n";
+
+    // The lesson's version only handles non-negative ints
+    std::vector<int> positive(n);
+    std::mt19937 rng(1);
+    for (int& v : positive) v = static_cast<int>(rng() >> 1);
+    std::vector<int> lesson = positive;
+    printRow("int >= 0 lesson RadixSort (base 10)", n, timeSort([&]() { LessonRadixSort::sort(lesson); }));
+    std::vector<int> small = positive;
+    for (int& v : small) v &= 0xFFFF;
+    benchmarkType("int >= 0", positive, pool);
+    benchmarkType("int < 65536", small, pool);    // the top passes are skipped
+
+    benchmarkType("uint32_t", randomValues<uint32_t>(n, 2), pool);
+    benchmarkType("int32_t", randomValues<int32_t>(n, 3), pool);
+    benchmarkType("uint64_t", randomValues<uint64_t>(n, 4), pool);
+    benchmarkType("int64_t", randomValues<int64_t>(n, 5), pool);
+    benchmarkType("float", randomValues<float>(n, 6), pool);
+    benchmarkType("double", randomValues<double>(n, 7), pool);
+
+    // (key, payload) pairs, compared with std::stable_sort
+    typedef std::pair<uint32_t, uint32_t> Pair32;
+    typedef std::pair<uint64_t, uint64_t> Pair64;
+    std::vector<uint64_t> keys = randomValues<uint64_t>(n, 9);
+    std::vector<Pair32> pairs32(n), scratch32(n);
+    std::vector<Pair64> pairs64(n), scratch64(n);
+    for (size_t i = 0; i < n; i++) {
+        pairs32[i] = Pair32(static_cast<uint32_t>(keys[i]), static_cast<uint32_t>(i));
+        pairs64[i] = Pair64(keys[i], i);
+    }
+    std::vector<Pair32> reference32 = pairs32;
+    std::vector<Pair64> reference64 = pairs64;
+    printRow("pair<u32,u32> std::stable_sort", n, timeSort([&]() {
+        std::stable_sort(reference32.begin(), reference32.end(),
+                         [](const Pair32& a, const Pair32& b) { return a.first < b.first; });
+    }));
+    printRow("pair<u32,u32> radixSortPairs", n, timeSort([&]() { radixSortPairs(pairs32, scratch32); }));
+    printRow("pair<u64,u64> std::stable_sort", n, timeSort([&]() {
+        std::stable_sort(reference64.begin(), reference64.end(),
+                         [](const Pair64& a, const Pair64& b) { return a.first < b.first; });
+    }));
+    printRow("pair<u64,u64> radixSortPairs", n, timeSort([&]() { radixSortPairs(pairs64, scratch64); }));
+    if (pairs32 != reference32 || pairs64 != reference64) {
+        throw std::logic_error("radixSortPairs wrong");
+    }
+
+    return 0;
+}
+
+// Run program: Ctrl + F5 or Debug > Start Without Debugging menu
+// Debug program: F5 or Debug > Start Debugging menu
+
+// Tips for Getting Started:
+//   1. Use the Solution Explorer window to add/manage files
+//   2. Use the Team Explorer window to connect to source control
+//   3. Use the Output window to see build output and other messages
+//   4. Use the Error List window to view errors
+//   5. Go to Project > Add New Item to create new code files, or Project > Add Existing Item to add existing code files to the project
+//   6. In the future, to open this project again, go to File > Open > Project and select the .sln file
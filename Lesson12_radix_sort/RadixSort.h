@@ -0,0 +1,353 @@
+// RadixSort.h
+//
+// LSD radix sort for integers, floating-point numbers and (key, payload)
+// records, plus a multi-threaded MSD front end for very large inputs.
+//
+// Compared with the RadixSort class in "Lesson12 sorting.md":
+//   - digits are 8 or 11 bits wide instead of decimal, extracted with a
+//     shift and a mask instead of `/ exp % 10`
+//   - one read of the input builds the histograms for every pass at once
+//   - a pass whose digit is the same for every element is skipped
+//   - passes ping-pong between the data and one scratch buffer, which the
+//     caller can pass in and reuse, instead of allocating `output` each pass
+//   - signed integers, float and double work through order-preserving key
+//     transforms (RadixTraits), and records are sorted by a key extractor
+//
+// Every sort here is stable.
+
+#ifndef RADIX_SORT_H
+#define RADIX_SORT_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../Lesson12_parallel_sort/ThreadPool.h"
+
+/**
+ * @brief Maps a key type to an unsigned integer with the same ordering.
+ *
+ * Signed integers flip the sign bit, so negatives come first. IEEE floats
+ * flip all bits of negatives and only the sign bit of positives, giving
+ * -inf < ... < -0.0 < +0.0 < ... < +inf (NaNs go to the far ends by sign).
+ */
+template<typename T, typename Enable = void>
+struct RadixTraits;
+
+template<typename T>
+struct RadixTraits<T, typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value>::type> {
+    typedef T Unsigned;
+    static Unsigned toKey(T value) { return value; }
+};
+
+template<typename T>
+struct RadixTraits<T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type> {
+    typedef typename std::make_unsigned<T>::type Unsigned;
+    static Unsigned toKey(T value) {
+        return static_cast<Unsigned>(static_cast<Unsigned>(value) ^ (Unsigned(1) << (8 * sizeof(T) - 1)));
+    }
+};
+
+template<>
+struct RadixTraits<float> {
+    typedef uint32_t Unsigned;
+    static Unsigned toKey(float value) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        uint32_t mask = static_cast<uint32_t>(-static_cast<int32_t>(bits >> 31)) | 0x80000000u;
+        return bits ^ mask;
+    }
+};
+
+template<>
+struct RadixTraits<double> {
+    typedef uint64_t Unsigned;
+    static Unsigned toKey(double value) {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        uint64_t mask = static_cast<uint64_t>(-static_cast<int64_t>(bits >> 63)) | 0x8000000000000000ull;
+        return bits ^ mask;
+    }
+};
+
+namespace radix_detail {
+
+const size_t kSmallSort = 64;           // below this, insertion sort beats building histograms
+const size_t kParallelMin = 1 << 18;    // below this, the MSD variant just runs the serial sort
+const unsigned kMsdBits = 8;
+
+// Digit width when the caller does not choose: 11 bits gives 32-bit keys
+// three passes instead of four and 64-bit keys six instead of eight, while
+// a 2048-entry histogram still fits in L1/L2. Narrow keys use 8 bits.
+template<typename U>
+struct DefaultDigitBits {
+    static const unsigned value = sizeof(U) >= 4 ? 11 : 8;
+};
+
+template<typename E, typename KeyOf>
+struct KeyTypes {
+    typedef typename std::decay<decltype(std::declval<KeyOf&>()(std::declval<const E&>()))>::type Key;
+    typedef RadixTraits<Key> Traits;
+    typedef typename Traits::Unsigned Unsigned;
+};
+
+template<typename E, typename KeyOf>
+typename KeyTypes<E, KeyOf>::Unsigned keyBits(const E& element, KeyOf& keyOf) {
+    return KeyTypes<E, KeyOf>::Traits::toKey(keyOf(element));
+}
+
+template<typename E, typename KeyOf>
+void insertionSortByKey(E* data, size_t n, KeyOf& keyOf) {
+    for (size_t i = 1; i < n; i++) {
+        E value = std::move(data[i]);
+        auto key = keyBits(value, keyOf);
+        size_t j = i;
+        while (j > 0 && key < keyBits(data[j - 1], keyOf)) {
+            data[j] = std::move(data[j - 1]);
+            j--;
+        }
+        data[j] = std::move(value);
+    }
+}
+
+// Sort src[0, n) by the low `bits` bits of its keys, using tmp as the other
+// half of the ping-pong. Returns whichever of src/tmp holds the result.
+template<unsigned DigitBits, typename E, typename KeyOf>
+E* lsdPasses(E* src, E* tmp, size_t n, unsigned bits, KeyOf& keyOf) {
+    typedef typename KeyTypes<E, KeyOf>::Unsigned U;
+    const size_t radix = size_t(1) << DigitBits;
+    const U mask = static_cast<U>(radix - 1);
+    const unsigned passes = (bits + DigitBits - 1) / DigitBits;
+
+    // One read of the input fills the histograms of every pass
+    std::vector<size_t> counts(passes * radix, 0);
+    for (size_t i = 0; i < n; i++) {
+        U key = keyBits(src[i], keyOf);
+        for (unsigned p = 0; p < passes; p++) {
+            counts[p * radix + ((key >> (p * DigitBits)) & mask)]++;
+        }
+    }
+
+    U firstKey = keyBits(src[0], keyOf);
+    for (unsigned p = 0; p < passes; p++) {
+        unsigned shift = p * DigitBits;
+        size_t* count = &counts[p * radix];
+        if (count[(firstKey >> shift) & mask] == n) {
+            continue;   // every element has the same digit here: nothing to do
+        }
+        size_t offset = 0;
+        for (size_t d = 0; d < radix; d++) {
+            size_t c = count[d];
+            count[d] = offset;
+            offset += c;
+        }
+        for (size_t i = 0; i < n; i++) {
+            size_t digit = (keyBits(src[i], keyOf) >> shift) & mask;
+            tmp[count[digit]++] = std::move(src[i]);
+        }
+        std::swap(src, tmp);
+    }
+    return src;
+}
+
+template<typename U>
+unsigned highestBit(U value) {
+    unsigned bit = 0;
+    while (value >>= 1) bit++;
+    return bit;
+}
+
+} // namespace radix_detail
+
+/**
+ * @brief Stable LSD radix sort of data[0, n) by keyOf(element).
+ *
+ * keyOf must return an integer, float or double. scratch must hold n
+ * elements; its contents on return are unspecified.
+ * @tparam DigitBits Bits per pass (typically 8 or 11); 0 picks a default for the key width.
+ */
+template<unsigned DigitBits = 0, typename E, typename KeyOf>
+void radixSortBy(E* data, size_t n, E* scratch, KeyOf keyOf) {
+    typedef typename radix_detail::KeyTypes<E, KeyOf>::Unsigned U;
+    constexpr unsigned bits = DigitBits != 0 ? DigitBits : radix_detail::DefaultDigitBits<U>::value;
+    if (n <= radix_detail::kSmallSort) {
+        radix_detail::insertionSortByKey(data, n, keyOf);
+        return;
+    }
+    E* result = radix_detail::lsdPasses<bits>(data, scratch, n, 8 * sizeof(U), keyOf);
+    if (result != data) {
+        std::move(result, result + n, data);
+    }
+}
+
+/**
+ * @brief Stable radix sort of records by key, reusing the caller's scratch vector.
+ */
+template<unsigned DigitBits = 0, typename E, typename KeyOf>
+void radixSortBy(std::vector<E>& data, std::vector<E>& scratch, KeyOf keyOf) {
+    if (scratch.size() < data.size()) scratch.resize(data.size());
+    radixSortBy<DigitBits>(data.data(), data.size(), scratch.data(), keyOf);
+}
+
+template<unsigned DigitBits = 0, typename E, typename KeyOf>
+void radixSortBy(std::vector<E>& data, KeyOf keyOf) {
+    std::vector<E> scratch;
+    radixSortBy<DigitBits>(data, scratch, keyOf);
+}
+
+/**
+ * @brief Radix sort of integers, floats or doubles.
+ */
+template<unsigned DigitBits = 0, typename T>
+void radixSort(std::vector<T>& data, std::vector<T>& scratch) {
+    radixSortBy<DigitBits>(data, scratch, [](const T& value) { return value; });
+}
+
+template<unsigned DigitBits = 0, typename T>
+void radixSort(std::vector<T>& data) {
+    std::vector<T> scratch;
+    radixSort<DigitBits>(data, scratch);
+}
+
+/**
+ * @brief Sort (key, payload) pairs by key; pairs with equal keys keep their order.
+ */
+template<unsigned DigitBits = 0, typename K, typename V>
+void radixSortPairs(std::vector<std::pair<K, V>>& pairs, std::vector<std::pair<K, V>>& scratch) {
+    radixSortBy<DigitBits>(pairs, scratch, [](const std::pair<K, V>& p) { return p.first; });
+}
+
+template<unsigned DigitBits = 0, typename K, typename V>
+void radixSortPairs(std::vector<std::pair<K, V>>& pairs) {
+    std::vector<std::pair<K, V>> scratch;
+    radixSortPairs<DigitBits>(pairs, scratch);
+}
+
+/**
+ * @brief Multi-threaded MSD radix sort of data[0, n) by keyOf(element). Stable.
+ *
+ * 1. Find the highest key bit that is not the same everywhere, so keys that
+ *    only use their low bits still split into many buckets.
+ * 2. Every thread histograms its own slice on the 8 bits below that point,
+ *    then scatters its slice into scratch at offsets computed from all the
+ *    histograms - no locks, no atomics, and the order within a bucket is kept.
+ * 3. Each bucket is finished independently as a pool task with the serial LSD
+ *    sort over the remaining low bits.
+ */
+template<unsigned DigitBits = 0, typename E, typename KeyOf>
+void parallelRadixSortBy(E* data, size_t n, E* scratch, ThreadPool& pool, KeyOf keyOf) {
+    typedef typename radix_detail::KeyTypes<E, KeyOf>::Unsigned U;
+    constexpr unsigned bits = DigitBits != 0 ? DigitBits : radix_detail::DefaultDigitBits<U>::value;
+    const size_t buckets = size_t(1) << radix_detail::kMsdBits;
+
+    size_t slices = pool.workerCount() + 1;
+    if (n < radix_detail::kParallelMin || slices == 1) {
+        radixSortBy<DigitBits>(data, n, scratch, keyOf);
+        return;
+    }
+    size_t sliceSize = (n + slices - 1) / slices;
+
+    // 1. Which bits differ anywhere?
+    U firstKey = radix_detail::keyBits(data[0], keyOf);
+    std::vector<U> differs(slices, 0);
+    {
+        TaskGroup group(pool);
+        for (size_t s = 0; s < slices; s++) {
+            group.run([&, s]() {
+                U acc = 0;
+                size_t end = std::min(n, (s + 1) * sliceSize);
+                for (size_t i = s * sliceSize; i < end; i++) acc |= radix_detail::keyBits(data[i], keyOf) ^ firstKey;
+                differs[s] = acc;
+            });
+        }
+        group.wait();
+    }
+    U allDiffer = 0;
+    for (U d : differs) allDiffer |= d;
+    if (allDiffer == 0) return;     // every key is equal
+    unsigned top = radix_detail::highestBit(allDiffer) + 1;
+    unsigned shift = top > radix_detail::kMsdBits ? top - radix_detail::kMsdBits : 0;
+
+    // 2. Per-slice histograms, then a stable parallel scatter into scratch
+    std::vector<size_t> counts(slices * buckets, 0);
+    {
+        TaskGroup group(pool);
+        for (size_t s = 0; s < slices; s++) {
+            group.run([&, s]() {
+                size_t* count = &counts[s * buckets];
+                size_t end = std::min(n, (s + 1) * sliceSize);
+                for (size_t i = s * sliceSize; i < end; i++) {
+                    count[(radix_detail::keyBits(data[i], keyOf) >> shift) & (buckets - 1)]++;
+                }
+            });
+        }
+        group.wait();
+    }
+    std::vector<size_t> bucketStart(buckets + 1, 0);
+    size_t offset = 0;
+    for (size_t b = 0; b < buckets; b++) {
+        bucketStart[b] = offset;
+        for (size_t s = 0; s < slices; s++) {
+            size_t c = counts[s * buckets + b];
+            counts[s * buckets + b] = offset;   // now: where slice s writes bucket b
+            offset += c;
+        }
+    }
+    bucketStart[buckets] = n;
+    {
+        TaskGroup group(pool);
+        for (size_t s = 0; s < slices; s++) {
+            group.run([&, s]() {
+                size_t* next = &counts[s * buckets];
+                size_t end = std::min(n, (s + 1) * sliceSize);
+                for (size_t i = s * sliceSize; i < end; i++) {
+                    size_t b = (radix_detail::keyBits(data[i], keyOf) >> shift) & (buckets - 1);
+                    scratch[next[b]++] = std::move(data[i]);
+                }
+            });
+        }
+        group.wait();
+    }
+
+    // 3. Finish each bucket on the bits below the MSD digit
+    TaskGroup group(pool);
+    for (size_t b = 0; b < buckets; b++) {
+        size_t lo = bucketStart[b], m = bucketStart[b + 1] - lo;
+        if (m == 0) continue;
+        group.run([&, lo, m]() {
+            E* result = scratch + lo;
+            if (shift > 0 && m > radix_detail::kSmallSort) {
+                result = radix_detail::lsdPasses<bits>(scratch + lo, data + lo, m, shift, keyOf);
+            } else if (shift > 0) {
+                radix_detail::insertionSortByKey(scratch + lo, m, keyOf);
+            }
+            if (result != data + lo) {
+                std::move(result, result + m, data + lo);
+            }
+        });
+    }
+    group.wait();
+}
+
+template<unsigned DigitBits = 0, typename E, typename KeyOf>
+void parallelRadixSortBy(std::vector<E>& data, std::vector<E>& scratch, ThreadPool& pool, KeyOf keyOf) {
+    if (scratch.size() < data.size()) scratch.resize(data.size());
+    parallelRadixSortBy<DigitBits>(data.data(), data.size(), scratch.data(), pool, keyOf);
+}
+
+template<unsigned DigitBits = 0, typename T>
+void parallelRadixSort(std::vector<T>& data, std::vector<T>& scratch, ThreadPool& pool) {
+    parallelRadixSortBy<DigitBits>(data, scratch, pool, [](const T& value) { return value; });
+}
+
+template<unsigned DigitBits = 0, typename T>
+void parallelRadixSort(std::vector<T>& data, ThreadPool& pool) {
+    std::vector<T> scratch;
+    parallelRadixSort<DigitBits>(data, scratch, pool);
+}
+
+#endif // RADIX_SORT_H
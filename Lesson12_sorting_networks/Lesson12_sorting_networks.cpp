@@ -0,0 +1,219 @@
+// Lesson12_sorting_networks.cpp : This file contains the 'main' function. Program execution begins and ends there.
+//
+// Benchmarks the sorting networks in SortingNetworks.h on the small blocks
+// that are the base case of merge sort and quicksort, against the lesson's
+// insertionSort and std::sort, for every instruction set this CPU supports.
+// Then sorts whole arrays with introsort and parallelMergeSort, whose leaves
+// use the networks, to show what the faster base case is worth overall.
+//
+// Usage: Lesson12_sorting_networks [elements]
+//   Elements per measurement, default 4000000.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../Lesson12_parallel_sort/ParallelSort.h"
+#include "../Lesson12_parallel_sort/SortingNetworks.h"
+
+typedef std::chrono::steady_clock Clock;
+
+double msSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+template<typename T>
+std::vector<T> randomValues(size_t n, unsigned seed) {
+    std::mt19937_64 rng(seed);
+    std::vector<T> values(n);
+    for (T& v : values) v = static_cast<T>(static_cast<int64_t>(rng() % 2000000001) - 1000000000);
+    return values;
+}
+
+std::vector<SimdLevel> supportedLevels() {
+    std::vector<SimdLevel> levels = { SimdLevel::Scalar };
+    if (detectSimdLevel() >= SimdLevel::SSE41) levels.push_back(SimdLevel::SSE41);
+    if (detectSimdLevel() >= SimdLevel::AVX2) levels.push_back(SimdLevel::AVX2);
+    return levels;
+}
+
+// Every size up to 64 and every merge size, at every level, must agree with the standard library
+template<typename T>
+void checkType(const std::string& name) {
+    std::mt19937 rng(3);
+    for (SimdLevel level : supportedLevels()) {
+        for (size_t n = 0; n <= 64; n++) {
+            for (int round = 0; round < 50; round++) {
+                std::vector<T> data = randomValues<T>(n, rng());
+                if (round % 2 == 1) {
+                    for (T& v : data) v = static_cast<T>(static_cast<int64_t>(v) % 4);    // many duplicates
+                }
+                if (round == 2 && n >= 2) {
+                    data[0] = std::numeric_limits<T>::max();
+                    data[1] = std::numeric_limits<T>::lowest();
+                }
+                std::vector<T> expected = data;
+                std::sort(expected.begin(), expected.end());
+                networkSort(data.data(), n, level);
+                if (data != expected) {
+                    throw std::logic_error(std::string("networkSort wrong for ") + name + " n=" + std::to_string(n) +
+                                           " " + simdLevelName(level));
+                }
+            }
+        }
+        for (size_t n : { 8, 16, 32 }) {
+            std::vector<T> a = randomValues<T>(n, rng()), b = randomValues<T>(n, rng());
+            std::vector<T> out(2 * n), expected(2 * n);
+            std::sort(a.begin(), a.end());
+            std::sort(b.begin(), b.end());
+            std::merge(a.begin(), a.end(), b.begin(), b.end(), expected.begin());
+            bitonicMerge(a.data(), b.data(), out.data(), n, level);
+            if (out != expected) {
+                throw std::logic_error(std::string("bitonicMerge wrong for ") + name + " n=" + std::to_string(n));
+            }
+        }
+    }
+
+    // The whole-array sorts with network leaves, including a vector iterator range
+    ThreadPool pool(3);
+    for (size_t n : { 0, 1, 63, 64, 65, 1000, 100000 }) {
+        std::vector<T> expected = randomValues<T>(n, 9);
+        std::vector<T> a = expected, b = expected;
+        std::sort(expected.begin(), expected.end());
+        introsort(a.begin(), a.end());
+        parallelMergeSort(b.data(), b.data() + n, pool);
+        if (a != expected || b != expected) {
+            throw std::logic_error(std::string("sort with network leaves wrong for ") + name);
+        }
+    }
+}
+
+void sanityCheck() {
+    checkType<int32_t>("int32_t");
+    checkType<float>("float");
+    checkType<int64_t>("int64_t");
+    std::cout << "Sanity check passed (" << simdLevelName(detectSimdLevel()) << " detected)\n\n";
+}
+
+void printRow(const std::string& name, size_t n, double ms) {
+    std::cout << std::left << std::setw(44) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << ms << std::setw(12) << ms * 1e6 / n << "\n";
+}
+
+// Sort input as consecutive blocks of the given size with sortBlock, and
+// check every block came out sorted
+template<typename T, typename SortBlock>
+void timeBlocks(const std::string& name, const std::vector<T>& input, size_t blockSize, SortBlock sortBlock) {
+    std::vector<T> data = input;
+    size_t blocks = data.size() / blockSize;
+    auto start = Clock::now();
+    for (size_t b = 0; b < blocks; b++) sortBlock(data.data() + b * blockSize, blockSize);
+    printRow(name, blocks * blockSize, msSince(start));
+    for (size_t b = 0; b < blocks; b++) {
+        if (!std::is_sorted(data.begin() + b * blockSize, data.begin() + (b + 1) * blockSize)) {
+            throw std::logic_error(name + " left a block unsorted");
+        }
+    }
+}
+
+template<typename T>
+void benchmarkBlocks(const std::string& name, size_t n) {
+    std::vector<T> input = randomValues<T>(n, 1);
+    for (size_t blockSize : { 8, 16, 32, 64 }) {
+        std::string prefix = name + " x" + std::to_string(blockSize) + " ";
+        timeBlocks(prefix + "insertionSort", input, blockSize, [](T* p, size_t m) { insertionSort(p, p + m); });
+        timeBlocks(prefix + "std::sort", input, blockSize, [](T* p, size_t m) { std::sort(p, p + m); });
+        for (SimdLevel level : supportedLevels()) {
+            timeBlocks(prefix + "network " + simdLevelName(level), input, blockSize,
+                       [level](T* p, size_t m) { networkSort(p, m, level); });
+        }
+    }
+
+    // Merging pairs of sorted 16-element blocks
+    std::vector<T> sorted = input, out(n);
+    for (size_t b = 0; b + 16 <= n; b += 16) std::sort(sorted.begin() + b, sorted.begin() + b + 16);
+    auto start = Clock::now();
+    for (size_t b = 0; b + 32 <= n; b += 32) {
+        std::merge(sorted.begin() + b, sorted.begin() + b + 16, sorted.begin() + b + 16, sorted.begin() + b + 32,
+                   out.begin() + b);
+    }
+    printRow(name + " 16+16 std::merge", n, msSince(start));
+    for (SimdLevel level : supportedLevels()) {
+        start = Clock::now();
+        for (size_t b = 0; b + 32 <= n; b += 32) {
+            bitonicMerge(sorted.data() + b, sorted.data() + b + 16, out.data() + b, 16, level);
+        }
+        printRow(name + " 16+16 bitonicMerge " + simdLevelName(level), n, msSince(start));
+    }
+}
+
+// A comparator other than std::less turns the network leaves off, so the
+// lambda rows show the same sorts with the lesson's insertion sort leaves
+template<typename T>
+void benchmarkArrays(const std::string& name, size_t n, ThreadPool& pool) {
+    std::vector<T> input = randomValues<T>(n, 2), data, scratch(n);
+    auto less = [](T a, T b) { return a < b; };
+    Clock::time_point start;
+
+    data = input;
+    start = Clock::now();
+    std::sort(data.begin(), data.end());
+    printRow(name + " std::sort", n, msSince(start));
+    data = input;
+    start = Clock::now();
+    introsort(data.begin(), data.end(), less);
+    printRow(name + " introsort, insertion leaves", n, msSince(start));
+    data = input;
+    start = Clock::now();
+    introsort(data.begin(), data.end());
+    printRow(name + " introsort, network leaves", n, msSince(start));
+    data = input;
+    start = Clock::now();
+    parallelMergeSort(data.begin(), data.end(), pool, scratch, less);
+    printRow(name + " parallelMergeSort, insertion leaves", n, msSince(start));
+    data = input;
+    start = Clock::now();
+    parallelMergeSort(data.begin(), data.end(), pool, scratch);
+    printRow(name + " parallelMergeSort, network leaves", n, msSince(start));
+}
+
+int main(int argc, char* argv[]) {
+    size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 4000000;
+
+    sanityCheck();
+
+    std::cout << n << " elements per row\n";
+    std::cout << std::left << std::setw(44) << "sort" << std::right << std::setw(10) << "ms"
+              << std::setw(12) << "ns/elem" << "\n";
+    benchmarkBlocks<int32_t>("int32_t", n);
+    benchmarkBlocks<float>("float", n);
+    benchmarkBlocks<int64_t>("int64_t", n);
+
+    // float is left out of parallelMergeSort's network leaves (see ParallelSort.h)
+    ThreadPool pool;
+    std::cout << "\nWhole arrays, " << pool.workerCount() + 1 << " threads for parallelMergeSort\n";
+    benchmarkArrays<int32_t>("int32_t", n, pool);
+    benchmarkArrays<float>("float", n, pool);
+    benchmarkArrays<int64_t>("int64_t", n, pool);
+
+    return 0;
+}
+
+// Run program: Ctrl + F5 or Debug > Start Without Debugging menu
+// Debug program: F5 or Debug > Start Debugging menu
+
+// Tips for Getting Started:
+//   1. Use the Solution Explorer window to add/manage files
+//   2. Use the Team Explorer window to connect to source control
+//   3. Use the Output window to see build output and other messages
+//   4. Use the Error List window to view errors
+//   5. Go to Project > Add New Item to create new code files, or Project > Add Existing Item to add existing code files to the project
+//   6. In the future, to open this project again, go to File > Open > Project and select the .sln file
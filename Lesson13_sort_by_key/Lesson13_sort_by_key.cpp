@@ -0,0 +1,260 @@
+// Lesson13_sort_by_key.cpp : This file contains the 'main' function. Program execution begins and ends there.
+//
+// Sorts Points (Lesson13_operator_overload.md) by distance from the origin:
+// with std::sort and std::stable_sort on Point::operator<, which computes
+// two square roots per comparison, against sortByKey() from SortByKey.h,
+// which computes one per point. Reports the time and the number of square
+// roots of each, also for sortByKey with a user comparator (the comparison
+// path instead of the radix sort) and on a ThreadPool.
+//
+// Usage: Lesson13_sort_by_key [points]
+//   Default: 10000000 points.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SortByKey.h"
+
+typedef std::chrono::steady_clock Clock;
+
+// From Lesson13_operator_overload.md
+class Point {
+private:
+    double x;
+    double y;
+
+public:
+    Point(double x_coord = 0.0, double y_coord = 0.0) : x(x_coord), y(y_coord) {}
+
+    double getX() const { return x; }
+    double getY() const { return y; }
+
+    double distanceFromOrigin() const {
+        return std::sqrt(x * x + y * y);
+    }
+
+    bool operator<(const Point& other) const {
+        return distanceFromOrigin() < other.distanceFromOrigin();
+    }
+
+    bool operator==(const Point& other) const {
+        return x == other.x && y == other.y;
+    }
+};
+
+struct CompareByX {
+    bool operator()(const Point& p1, const Point& p2) const {
+        return p1.getX() < p2.getX();
+    }
+};
+
+// From "Lesson11 heaps.md.md"; its operator() is not const
+struct Task {
+    int priority;
+    std::string name;
+};
+
+struct Compare {
+    bool operator()(const Task& a, const Task& b) {
+        return a.priority < b.priority;
+    }
+};
+
+std::vector<Point> randomPoints(size_t n, unsigned seed) {
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> coordinate(-1000, 1000);
+    std::vector<Point> points;
+    points.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        double x = coordinate(rng);
+        points.emplace_back(x, coordinate(rng));
+    }
+    return points;
+}
+
+void sanityCheck() {
+    ThreadPool pool(3);
+    auto distance = [](const Point& p) { return p.distanceFromOrigin(); };
+    for (size_t n : { 0, 1, 2, 3, 10, 64, 65, 1000, 300000 }) {
+        std::vector<Point> points = randomPoints(n, static_cast<unsigned>(n));
+        // Rounded coordinates repeat, so that stability matters
+        for (Point& p : points) p = Point(std::round(p.getX() / 100), std::round(p.getY() / 100));
+        std::vector<Point> expected = points;
+        std::stable_sort(expected.begin(), expected.end());
+
+        std::vector<Point> radix = points, compared = points, parallel = points, parallelCompared = points;
+        sortByKey(radix, distance);
+        sortByKey(compared, distance, [](double a, double b) { return a < b; });
+        parallelSortByKey(parallel, pool, distance);
+        parallelSortByKey(parallelCompared.begin(), parallelCompared.end(), pool, distance,
+                          [](double a, double b) { return a < b; });
+        if (radix != expected || compared != expected || parallel != expected || parallelCompared != expected) {
+            throw std::logic_error("sortByKey of " + std::to_string(n) + " points wrong");
+        }
+
+        // Descending is the stable sort on the reversed comparison
+        std::vector<Point> descending = points;
+        std::stable_sort(expected.begin(), expected.end(), [](const Point& a, const Point& b) { return b < a; });
+        sortByKey(descending.begin(), descending.end(), distance, std::greater<double>());
+        if (descending != expected) throw std::logic_error("descending sortByKey wrong");
+
+        // A comparator on whole Points, with the Point itself as the key
+        std::vector<Point> byX = points;
+        expected = points;
+        std::stable_sort(expected.begin(), expected.end(), CompareByX());
+        sortByKey(byX, [](const Point& p) { return p; }, CompareByX());
+        if (byX != expected) throw std::logic_error("sortByKey with CompareByX wrong");
+    }
+
+    // Integer keys, and a Lesson11 Compare on Task keys
+    std::vector<Task> tasks;
+    std::mt19937 rng(5);
+    for (int i = 0; i < 1000; i++) tasks.push_back(Task{ static_cast<int>(rng() % 50) - 25, std::to_string(i) });
+    std::vector<Task> expected = tasks;
+    std::stable_sort(expected.begin(), expected.end(), Compare());
+    auto sameOrder = [&](const std::vector<Task>& got) {
+        for (size_t i = 0; i < got.size(); i++) {
+            if (got[i].name != expected[i].name) return false;
+        }
+        return got.size() == expected.size();
+    };
+    std::vector<Task> byPriority = tasks, byCompare = tasks, parallelByCompare = tasks;
+    sortByKey(byPriority, [](const Task& t) { return t.priority; });
+    sortByKey(byCompare, [](const Task& t) { return Task{ t.priority, std::string() }; }, Compare());
+    parallelSortByKey(parallelByCompare, pool, [](const Task& t) { return Task{ t.priority, std::string() }; },
+                      Compare());
+    if (!sameOrder(byPriority) || !sameOrder(byCompare) || !sameOrder(parallelByCompare)) {
+        throw std::logic_error("sortByKey of Tasks wrong");
+    }
+
+    // A key the radix sort does not handle falls back to the stable sort
+    std::vector<Task> byLongDouble = tasks, parallelByLongDouble = tasks;
+    auto longDoublePriority = [](const Task& t) { return static_cast<long double>(t.priority); };
+    sortByKey(byLongDouble, longDoublePriority);
+    parallelSortByKey(parallelByLongDouble, pool, longDoublePriority, std::less<long double>());
+    if (!sameOrder(byLongDouble) || !sameOrder(parallelByLongDouble)) {
+        throw std::logic_error("sortByKey by long double keys wrong");
+    }
+
+    // Elements whose move may throw are permuted by following cycles
+    struct MayThrow {
+        int key;
+        int id;
+        MayThrow(int key, int id) : key(key), id(id) {}
+        MayThrow(const MayThrow&) = default;
+        MayThrow(MayThrow&& other) : key(other.key), id(other.id) {}
+        MayThrow& operator=(const MayThrow&) = default;
+    };
+    static_assert(!std::is_nothrow_move_constructible<MayThrow>::value, "MayThrow must not be nothrow");
+    std::vector<MayThrow> mayThrow;
+    for (int i = 0; i < 5000; i++) mayThrow.emplace_back(static_cast<int>(rng() % 100), i);
+    std::vector<MayThrow> expectedMayThrow = mayThrow;
+    auto byKey = [](const MayThrow& a, const MayThrow& b) { return a.key < b.key; };
+    std::stable_sort(expectedMayThrow.begin(), expectedMayThrow.end(), byKey);
+    parallelSortByKey(mayThrow, pool, [](const MayThrow& m) { return m.key; });
+    for (size_t i = 0; i < mayThrow.size(); i++) {
+        if (mayThrow[i].id != expectedMayThrow[i].id) throw std::logic_error("sortByKey by cycles wrong");
+    }
+
+    // One key computation per element
+    std::vector<Point> points = randomPoints(10000, 9);
+    std::atomic<int> keys(0);
+    auto countedDistance = [&](const Point& p) {
+        keys++;
+        return p.distanceFromOrigin();
+    };
+    sortByKey(points, countedDistance);
+    parallelSortByKey(points, pool, countedDistance);
+    if (keys != 20000) throw std::logic_error("keys computed more than once");
+
+    std::cout << "Sanity check passed\n\n";
+}
+
+int main(int argc, char* argv[]) {
+    size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+
+    sanityCheck();
+
+    std::vector<Point> original = randomPoints(n, 1);
+    std::vector<Point> reference = original;
+    std::stable_sort(reference.begin(), reference.end());
+    ThreadPool pool;
+    auto distance = [](const Point& p) { return p.distanceFromOrigin(); };
+
+    std::cout << "Hardware threads: " << std::thread::hardware_concurrency() << ", "
+              << simdLevelName(detectSimdLevel()) << "\n";
+    std::cout << "Sorting " << n << " Points by distance from the origin\n\n";
+    std::cout << std::left << std::setw(40) << "" << std::right << std::setw(10) << "ms" << std::setw(16)
+              << "square roots" << "\n";
+
+    // The square roots are counted in a separate run, so that counting
+    // does not slow the timed runs
+    std::atomic<long long> squareRoots(0);
+    auto countedLess = [&](const Point& a, const Point& b) {
+        squareRoots.fetch_add(2, std::memory_order_relaxed);
+        return a < b;
+    };
+    auto countedDistance = [&](const Point& p) {
+        squareRoots.fetch_add(1, std::memory_order_relaxed);
+        return p.distanceFromOrigin();
+    };
+    auto byValue = [](double a, double b) { return a < b; };
+
+    auto row = [&](const std::string& name, const std::function<void(std::vector<Point>&, bool)>& sort, bool stable) {
+        double best = 1e300;
+        for (int repeat = 0; repeat < 4; repeat++) {
+            std::vector<Point> points = original;
+            squareRoots = 0;
+            bool counted = repeat == 3;
+            auto start = Clock::now();
+            sort(points, counted);
+            if (!counted) best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+            // Unstable sorts may order points at the same distance differently
+            bool sorted = stable ? points == reference : std::is_sorted(points.begin(), points.end());
+            if (!sorted) throw std::logic_error(name + " did not sort");
+        }
+        std::cout << std::left << std::setw(40) << name << std::right << std::fixed << std::setprecision(0)
+                  << std::setw(10) << best << std::setw(16) << squareRoots << std::endl;
+    };
+
+    row("std::sort, operator<", [&](std::vector<Point>& p, bool counted) {
+        counted ? std::sort(p.begin(), p.end(), countedLess) : std::sort(p.begin(), p.end());
+    }, false);
+    row("std::stable_sort, operator<", [&](std::vector<Point>& p, bool counted) {
+        counted ? std::stable_sort(p.begin(), p.end(), countedLess) : std::stable_sort(p.begin(), p.end());
+    }, true);
+    row("sortByKey (radix)", [&](std::vector<Point>& p, bool counted) {
+        counted ? sortByKey(p, countedDistance) : sortByKey(p, distance);
+    }, true);
+    row("sortByKey, comparator on keys", [&](std::vector<Point>& p, bool counted) {
+        counted ? sortByKey(p, countedDistance, byValue) : sortByKey(p, distance, byValue);
+    }, true);
+    row("parallelSortByKey (radix), threads: " + std::to_string(pool.workerCount() + 1),
+        [&](std::vector<Point>& p, bool counted) {
+            counted ? parallelSortByKey(p, pool, countedDistance) : parallelSortByKey(p, pool, distance);
+        }, true);
+
+    return 0;
+}
+
+// Run program: Ctrl + F5 or Debug > Start Without Debugging menu
+// Debug program: F5 or Debug > Start Debugging menu
+
+// Tips for Getting Started:
+//   1. Use the Solution Explorer window to add/manage files
+//   2. Use the Team Explorer window to connect to source control
+//   3. Use the Output window to see build output and other messages
+//   4. Use the Error List window to view errors
+//   5. Go to Project > Add New Item to create new code files, or Project > Add Existing Item to add existing code files to the project
+//   6. In the future, to open this project again, go to File > Open > Project and select the .sln file
@@ -0,0 +1,243 @@
+// SortByKey.h
+//
+// Sorting by a computed key, computing each key once (the "Schwartzian
+// transform" of Perl, "decorate-sort-undecorate" in Python).
+//
+// Point::operator< in Lesson13_operator_overload.md compares
+// distanceFromOrigin() of both points, so std::sort performs two square
+// roots per comparison: about 2 n log2 n of them, over 900 million for 10
+// million points. sortByKey(points, keyFn) instead
+//
+//   1. computes key = keyFn(element) once per element into a compact array
+//      of (key, index) records - 16 bytes for a double key, however large
+//      the elements are
+//   2. sorts the records: with the LSD radix sort of RadixSort.h when the
+//      key is an integer, float or double and the order is std::less or
+//      std::greater, otherwise with std::stable_sort on the precomputed
+//      keys and any comparator on them - a lambda, a function, or a
+//      Compare functor like those of "Lesson11 heaps.md.md" (its
+//      operator() need not be const)
+//   3. rearranges the caller's elements into the sorted order: gathers them
+//      into a buffer of n elements in sorted order, then moves them back.
+//      The gather reads the elements in random order, but the reads are
+//      independent, so the CPU (helped by prefetches) overlaps their cache
+//      misses. Elements whose move constructor may throw are instead
+//      permuted without a buffer by following the cycles of the
+//      permutation. That needs no memory, but each step of a cycle must
+//      wait for the previous one's cache miss, which makes it several
+//      times slower for large arrays
+//
+// With a ThreadPool the keys are computed, the records sorted (with
+// parallelRadixSortBy or parallelMergeSort) and the elements gathered and
+// moved back in parallel slices.
+//
+// The sort is stable: elements with equal keys keep their order. As in
+// RadixSort.h, the radix path orders -0.0 before +0.0, which std::less
+// considers equal, and NaN keys are not supported.
+
+#ifndef SORT_BY_KEY_H
+#define SORT_BY_KEY_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../Lesson12_parallel_sort/ParallelSort.h"
+#include "../Lesson12_parallel_sort/ThreadPool.h"
+#include "../Lesson12_radix_sort/RadixSort.h"
+
+namespace sort_by_key_detail {
+
+// How far ahead the gather prefetches the elements it will move
+const size_t kPrefetchDistance = 16;
+
+template<typename Key, typename Index>
+struct KeyIndex {
+    Key key;
+    Index index;     // position of the element before sorting
+};
+
+inline void prefetch(const void* address) {
+#if defined(SIMD_X86)
+    _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#elif defined(__GNUC__)
+    __builtin_prefetch(address);
+#endif
+}
+
+// Ascending or descending std:: order on a key the radix sort handles: the
+// integers but bool, float and double (RadixTraits has no long double)
+template<typename Key, typename Compare>
+struct RadixOrder {
+    static constexpr bool radixKey = (std::is_integral<Key>::value && !std::is_same<Key, bool>::value) ||
+                                     std::is_same<Key, float>::value || std::is_same<Key, double>::value;
+    static constexpr bool ascending =
+        radixKey && (std::is_same<Compare, std::less<>>::value || std::is_same<Compare, std::less<Key>>::value);
+    static constexpr bool descending =
+        radixKey && (std::is_same<Compare, std::greater<>>::value || std::is_same<Compare, std::greater<Key>>::value);
+};
+
+template<typename Record, typename Compare>
+void sortRecords(std::vector<Record>& records, Compare& comp, ThreadPool* pool) {
+    typedef decltype(Record::key) Key;
+    typedef RadixOrder<Key, Compare> Order;
+    if constexpr (Order::ascending || Order::descending) {
+        typedef typename RadixTraits<Key>::Unsigned U;
+        auto keyOf = [](const Record& record) {
+            U bits = RadixTraits<Key>::toKey(record.key);
+            return Order::ascending ? bits : static_cast<U>(~bits);
+        };
+        std::vector<Record> scratch(records.size());
+        if (pool != nullptr) {
+            parallelRadixSortBy(records, scratch, *pool, keyOf);
+        } else {
+            radixSortBy(records, scratch, keyOf);
+        }
+    } else {
+        auto byKey = [&comp](const Record& a, const Record& b) { return comp(a.key, b.key); };
+        if (pool != nullptr) {
+            parallelMergeSort(records.begin(), records.end(), *pool, byKey);
+        } else {
+            std::stable_sort(records.begin(), records.end(), byKey);
+        }
+    }
+}
+
+// Moves element records[i].index to position i, one cycle of the
+// permutation at a time; every element is moved once, plus one move per
+// cycle into and out of a temporary
+template<typename RandomIt, typename Record>
+void permuteInPlace(RandomIt first, std::vector<Record>& records) {
+    typedef typename std::iterator_traits<RandomIt>::value_type T;
+    size_t n = records.size();
+    for (size_t i = 0; i < n; i++) {
+        if (records[i].index == i) continue;
+        T value = std::move(first[i]);
+        size_t j = i;
+        for (;;) {
+            size_t k = records[j].index;
+            records[j].index = static_cast<decltype(records[j].index)>(j);     // done
+            if (k == i) {
+                first[j] = std::move(value);
+                break;
+            }
+            first[j] = std::move(first[k]);
+            j = k;
+        }
+    }
+}
+
+// Gathers the elements in sorted order into a buffer, then moves them back
+template<typename RandomIt, typename Record>
+void permuteByGather(RandomIt first, const std::vector<Record>& records, ThreadPool* pool) {
+    typedef typename std::iterator_traits<RandomIt>::value_type T;
+    size_t n = records.size();
+    std::allocator<T> allocator;
+    T* buffer = allocator.allocate(n);
+    auto gather = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            if (i + kPrefetchDistance < end) prefetch(std::addressof(first[records[i + kPrefetchDistance].index]));
+            ::new (static_cast<void*>(buffer + i)) T(std::move(first[records[i].index]));
+        }
+    };
+    auto moveBack = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            first[i] = std::move(buffer[i]);
+            buffer[i].~T();
+        }
+    };
+    if (pool != nullptr) {
+        thread_pool_detail::forSlices(n, *pool, gather);
+        thread_pool_detail::forSlices(n, *pool, moveBack);
+    } else {
+        gather(0, n);
+        moveBack(0, n);
+    }
+    allocator.deallocate(buffer, n);
+}
+
+template<typename Index, typename RandomIt, typename KeyFn, typename Compare>
+void sortByKeyWith(RandomIt first, size_t n, KeyFn& keyFn, Compare& comp, ThreadPool* pool) {
+    typedef typename std::iterator_traits<RandomIt>::value_type T;
+    typedef typename std::decay<decltype(keyFn(*first))>::type Key;
+    typedef KeyIndex<Key, Index> Record;
+
+    std::vector<Record> records(n);
+    auto decorate = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) records[i] = Record{ keyFn(first[i]), static_cast<Index>(i) };
+    };
+    if (pool != nullptr) {
+        thread_pool_detail::forSlices(n, *pool, decorate);
+    } else {
+        decorate(0, n);
+    }
+
+    sortRecords(records, comp, pool);
+
+    if (std::is_nothrow_move_constructible<T>::value) {
+        permuteByGather(first, records, pool);
+    } else {
+        permuteInPlace(first, records);
+    }
+}
+
+template<typename RandomIt, typename KeyFn, typename Compare>
+void sortByKey(RandomIt first, RandomIt last, KeyFn& keyFn, Compare& comp, ThreadPool* pool) {
+    size_t n = last - first;
+    if (n < 2) return;
+    if (n <= std::numeric_limits<uint32_t>::max()) {
+        sortByKeyWith<uint32_t>(first, n, keyFn, comp, pool);
+    } else {
+        sortByKeyWith<uint64_t>(first, n, keyFn, comp, pool);
+    }
+}
+
+} // namespace sort_by_key_detail
+
+/**
+ * @brief Stable sort of [first, last) by keyFn(element), computing each
+ * key once; keys are ordered by comp.
+ *
+ * keyFn is called once per element. Keys must be default constructible
+ * and copyable; the elements must be move constructible and assignable.
+ * Besides the (key, index) records, uses a buffer of n elements unless the
+ * element's move constructor may throw.
+ */
+template<typename RandomIt, typename KeyFn, typename Compare = std::less<>>
+void sortByKey(RandomIt first, RandomIt last, KeyFn keyFn, Compare comp = Compare()) {
+    sort_by_key_detail::sortByKey(first, last, keyFn, comp, nullptr);
+}
+
+/**
+ * @brief sortByKey with the keys computed, the records sorted and the
+ * elements moved into place on pool. keyFn is called from several threads
+ * at once.
+ */
+template<typename RandomIt, typename KeyFn, typename Compare = std::less<>>
+void parallelSortByKey(RandomIt first, RandomIt last, ThreadPool& pool, KeyFn keyFn, Compare comp = Compare()) {
+    sort_by_key_detail::sortByKey(first, last, keyFn, comp, &pool);
+}
+
+/**
+ * @brief sortByKey over a whole container, e.g. a std::vector.
+ */
+template<typename Range, typename KeyFn, typename Compare = std::less<>,
+         typename = decltype(std::begin(std::declval<Range&>()))>
+void sortByKey(Range& range, KeyFn keyFn, Compare comp = Compare()) {
+    sortByKey(std::begin(range), std::end(range), keyFn, comp);
+}
+
+template<typename Range, typename KeyFn, typename Compare = std::less<>,
+         typename = decltype(std::begin(std::declval<Range&>()))>
+void parallelSortByKey(Range& range, ThreadPool& pool, KeyFn keyFn, Compare comp = Compare()) {
+    parallelSortByKey(std::begin(range), std::end(range), pool, keyFn, comp);
+}
+
+#endif // SORT_BY_KEY_H
@@ -0,0 +1,462 @@
+// FastDistributions.h
+//
+// Sampling weighted discrete outcomes, normal and exponential values at
+// tens or hundreds of millions per second.
+//
+// std::discrete_distribution, used for the even/odd exercise in "Lesson14
+// Exercises.md", finds each outcome by binary search over the cumulative
+// weights: O(log n) with a hard-to-predict branch per step.
+// std::normal_distribution typically uses the Marsaglia polar method, with
+// a logarithm and a square root for every pair of values. This header
+// provides:
+//
+//   AliasTable          Walker / Vose alias method: O(1) per sample for
+//                       any number of outcomes - one table lookup and one
+//                       comparison
+//   ZigguratNormal      Marsaglia & Tsang's ziggurat: about 99% of samples
+//   ZigguratExponential cost one table lookup, one multiply and one
+//                       comparison; only the rest need exp() or log()
+//
+// Each has operator()(rng) for one value, like the std:: distributions,
+// and sampleN(rng, out, n) for many. sampleN() draws its random bits with
+// rng.fill() when the generator has one (see FastRandom.h), then converts
+// 8 (alias) or 4 (ziggurat) values at a time with AVX2 if the CPU has it.
+// The scalar and AVX2 paths return exactly the same values.
+//
+// Precision: the alias table stores each bucket's split point as a 32-bit
+// fraction, so an outcome's probability can be off by up to (table size) /
+// 2^32 - far below what any test of a few billion samples can detect. The
+// table size is the number of outcomes rounded up to a power of two so that
+// choosing a bucket needs no multiply. Ziggurat values have 52 random bits.
+
+#ifndef FAST_DISTRIBUTIONS_H
+#define FAST_DISTRIBUTIONS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../Lesson14_fast_random/FastRandom.h"
+
+namespace distribution_detail {
+
+const size_t kChunk = 256;     // random words drawn per rng.fill() call
+
+// rng.fill(out, n) if the generator has it, otherwise n calls to rng()
+template<typename Rng>
+auto fillBits(Rng& rng, uint64_t* out, size_t n, int) -> decltype(rng.fill(out, n), void()) {
+    rng.fill(out, n);
+}
+
+template<typename Rng>
+void fillBits(Rng& rng, uint64_t* out, size_t n, long) {
+    for (size_t i = 0; i < n; i++) out[i] = rng();
+}
+
+template<typename Rng>
+void fillBits(Rng& rng, uint64_t* out, size_t n) {
+    static_assert(Rng::min() == 0 && Rng::max() == std::numeric_limits<uint64_t>::max(),
+                  "the samplers need a generator of full 64-bit values");
+    fillBits(rng, out, n, 0);
+}
+
+// The top 52 bits as a double in [0, 1): the bits become the mantissa of a
+// number in [1, 2), which AVX2 can do too (it has no 64-bit int -> double)
+inline double unitFrom52(uint64_t bits) {
+    uint64_t asDouble = (bits >> 12) | 0x3FF0000000000000ull;
+    double d;
+    std::memcpy(&d, &asDouble, sizeof(d));
+    return d - 1.0;
+}
+
+// Ziggurat of 256 layers of equal area v under f(x) = exp(-x^2 / 2) or
+// exp(-x), from Marsaglia & Tsang, "The Ziggurat Method for Generating
+// Random Variables" (2000). Layer 0 is the base, including the tail beyond
+// r; layer i >= 1 spans heights f(x[i]) to f(x[i + 1]).
+struct ZigguratTables {
+    double x[257];
+    double f[257];
+    double r;
+};
+
+template<bool Normal>
+const ZigguratTables& zigguratTables() {
+    static const ZigguratTables tables = []() {
+        ZigguratTables t;
+        const double r = Normal ? 3.6541528853610088 : 7.69711747013104972;
+        const double v = Normal ? 0.00492867323399 : 0.0039496598225815571993;
+        auto f = [](double x) { return Normal ? std::exp(-0.5 * x * x) : std::exp(-x); };
+        auto fInverse = [](double y) { return Normal ? std::sqrt(-2.0 * std::log(y)) : -std::log(y); };
+        t.r = r;
+        t.x[0] = v / f(r);
+        t.x[1] = r;
+        for (int i = 1; i < 255; i++) t.x[i + 1] = fInverse(v / t.x[i] + f(t.x[i]));
+        t.x[256] = 0;
+        for (int i = 0; i <= 256; i++) t.f[i] = f(t.x[i]);
+        return t;
+    }();
+    return tables;
+}
+
+// The rest of one ziggurat sample after its fast path (accept if the point
+// lies left of the layer above) failed for the draw bits: the tail or a
+// wedge, then new draws from rng until one is accepted. Returns |value|.
+template<bool Normal, typename Rng>
+double zigguratSlow(uint64_t bits, Rng& rng) {
+    const ZigguratTables& t = zigguratTables<Normal>();
+    for (;;) {
+        int i = static_cast<int>(bits & 255);
+        double x = unitFrom52(bits) * t.x[i];
+        if (x < t.x[i + 1]) return x;
+        if (i == 0) {
+            // The tail beyond r. For exp(-x) it is r plus another exponential
+            // value; for the normal, Marsaglia's method.
+            if (!Normal) return t.r - std::log(1.0 - unitFrom52(rng()));
+            for (;;) {
+                double a = -std::log(1.0 - unitFrom52(rng())) / t.r;
+                double b = -std::log(1.0 - unitFrom52(rng()));
+                if (b + b > a * a) return t.r + a;
+            }
+        }
+        double y = t.f[i] + unitFrom52(rng()) * (t.f[i + 1] - t.f[i]);
+        if (y < (Normal ? std::exp(-0.5 * x * x) : std::exp(-x))) return x;
+        bits = rng();
+    }
+}
+
+} // namespace distribution_detail
+
+/**
+ * @brief O(1) sampling of outcome i with probability weights[i] / sum.
+ */
+class AliasTable {
+private:
+    std::vector<uint32_t> threshold;    // keep the bucket if 32 random bits are below this
+    std::vector<uint32_t> alias;        // otherwise return this
+    size_t outcomes;
+    int shift;                          // 32 - log2(table size): bucket = top bits >> shift
+
+    void sampleScalar(const uint64_t* bits, uint32_t* out, size_t n) const {
+        for (size_t i = 0; i < n; i++) out[i] = fromBits(bits[i]);
+    }
+
+#ifdef SIMD_X86
+    void sampleAvx2(const uint64_t* bits, uint32_t* out, size_t n) const;
+#endif
+
+public:
+    /**
+     * @brief Build the table in O(n). Throws std::invalid_argument unless
+     *        the weights are finite, non-negative and not all zero.
+     */
+    explicit AliasTable(const std::vector<double>& weights) : outcomes(weights.size()) {
+        double sum = 0;
+        for (double w : weights) {
+            if (!(w >= 0) || !std::isfinite(w)) throw std::invalid_argument("AliasTable: weights must be finite and >= 0");
+            sum += w;
+        }
+        if (weights.empty() || !(sum > 0) || !std::isfinite(sum)) {
+            throw std::invalid_argument("AliasTable: weights must have a positive, finite sum");
+        }
+        if (weights.size() > (1u << 31)) throw std::invalid_argument("AliasTable: too many outcomes");
+
+        size_t size = 1;
+        shift = 32;
+        while (size < weights.size()) {
+            size <<= 1;
+            shift--;
+        }
+        threshold.assign(size, 0);
+        alias.resize(size);
+
+        // Vose: scale so the average bucket holds 1, then repeatedly fill a
+        // small bucket up with part of a large one
+        std::vector<double> scaled(size, 0.0);
+        std::vector<uint32_t> small, large;
+        for (size_t i = 0; i < size; i++) {
+            if (i < weights.size()) scaled[i] = weights[i] / sum * size;
+            (scaled[i] < 1.0 ? small : large).push_back(static_cast<uint32_t>(i));
+        }
+        while (!small.empty() && !large.empty()) {
+            uint32_t s = small.back(), l = large.back();
+            small.pop_back();
+            threshold[s] = static_cast<uint32_t>(std::ldexp(scaled[s], 32));
+            alias[s] = l;
+            scaled[l] -= 1.0 - scaled[s];
+            if (scaled[l] < 1.0) {
+                large.pop_back();
+                small.push_back(l);
+            }
+        }
+        // What is left holds 1 up to rounding: the bucket always keeps its
+        // outcome (threshold 2^32 - 1 and alias itself, so the coin does not
+        // matter). Rounding could in theory leave a zero-weight bucket here;
+        // that one must always give way to a real outcome instead.
+        uint32_t heaviest = static_cast<uint32_t>(std::max_element(weights.begin(), weights.end()) - weights.begin());
+        for (const std::vector<uint32_t>* rest : { &small, &large }) {
+            for (uint32_t i : *rest) {
+                bool empty = i >= weights.size() || weights[i] == 0;
+                threshold[i] = empty ? 0 : 0xFFFFFFFF;
+                alias[i] = empty ? heaviest : i;
+            }
+        }
+    }
+
+    /**
+     * @brief The outcome for 64 random bits: the top bits pick a bucket
+     *        and the low 32 bits decide between it and its alias.
+     */
+    uint32_t fromBits(uint64_t bits) const {
+        uint32_t bucket = shift == 32 ? 0 : static_cast<uint32_t>(bits >> 32) >> shift;
+        return static_cast<uint32_t>(bits) < threshold[bucket] ? bucket : alias[bucket];
+    }
+
+    template<typename Rng>
+    uint32_t operator()(Rng& rng) const {
+        return fromBits(rng());
+    }
+
+    /**
+     * @brief n samples into out, 8 at a time with AVX2.
+     */
+    template<typename Rng>
+    void sampleN(Rng& rng, uint32_t* out, size_t n, SimdLevel level = detectSimdLevel()) const {
+        uint64_t bits[distribution_detail::kChunk];
+        for (size_t done = 0; done < n;) {
+            size_t count = std::min(distribution_detail::kChunk, n - done);
+            distribution_detail::fillBits(rng, bits, count);
+#ifdef SIMD_X86
+            if (level == SimdLevel::AVX2) {
+                sampleAvx2(bits, out + done, count);
+            } else
+#endif
+            {
+                (void)level;
+                sampleScalar(bits, out + done, count);
+            }
+            done += count;
+        }
+    }
+
+    size_t size() const { return outcomes; }
+};
+
+/**
+ * @brief Normal values with the given mean and standard deviation.
+ */
+class ZigguratNormal {
+private:
+    double mean;
+    double stddev;
+
+    template<typename Rng>
+    void sampleScalar(const uint64_t* bits, double* out, size_t n, Rng& rng) const {
+        const distribution_detail::ZigguratTables& t = distribution_detail::zigguratTables<true>();
+        for (size_t k = 0; k < n; k++) {
+            int i = static_cast<int>(bits[k] & 255);
+            double x = distribution_detail::unitFrom52(bits[k]) * t.x[i];
+            if (!(x < t.x[i + 1])) x = distribution_detail::zigguratSlow<true>(bits[k], rng);
+            out[k] = mean + stddev * (bits[k] & 256 ? -x : x);
+        }
+    }
+
+#ifdef SIMD_X86
+    template<typename Rng>
+    void sampleAvx2(const uint64_t* bits, double* out, size_t n, Rng& rng) const;
+#endif
+
+public:
+    explicit ZigguratNormal(double mean = 0.0, double stddev = 1.0) : mean(mean), stddev(stddev) {
+        distribution_detail::zigguratTables<true>();
+    }
+
+    template<typename Rng>
+    double operator()(Rng& rng) const {
+        double out;
+        uint64_t bits = rng();
+        sampleScalar(&bits, &out, 1, rng);
+        return out;
+    }
+
+    /**
+     * @brief n samples into out, the fast path 4 at a time with AVX2.
+     */
+    template<typename Rng>
+    void sampleN(Rng& rng, double* out, size_t n, SimdLevel level = detectSimdLevel()) const {
+        uint64_t bits[distribution_detail::kChunk];
+        for (size_t done = 0; done < n;) {
+            size_t count = std::min(distribution_detail::kChunk, n - done);
+            distribution_detail::fillBits(rng, bits, count);
+#ifdef SIMD_X86
+            if (level == SimdLevel::AVX2) {
+                sampleAvx2(bits, out + done, count, rng);
+            } else
+#endif
+            {
+                (void)level;
+                sampleScalar(bits, out + done, count, rng);
+            }
+            done += count;
+        }
+    }
+};
+
+/**
+ * @brief Exponential values with rate lambda (mean 1 / lambda).
+ */
+class ZigguratExponential {
+private:
+    double scale;       // 1 / lambda
+
+    template<typename Rng>
+    void sampleScalar(const uint64_t* bits, double* out, size_t n, Rng& rng) const {
+        const distribution_detail::ZigguratTables& t = distribution_detail::zigguratTables<false>();
+        for (size_t k = 0; k < n; k++) {
+            int i = static_cast<int>(bits[k] & 255);
+            double x = distribution_detail::unitFrom52(bits[k]) * t.x[i];
+            if (!(x < t.x[i + 1])) x = distribution_detail::zigguratSlow<false>(bits[k], rng);
+            out[k] = scale * x;
+        }
+    }
+
+#ifdef SIMD_X86
+    template<typename Rng>
+    void sampleAvx2(const uint64_t* bits, double* out, size_t n, Rng& rng) const;
+#endif
+
+public:
+    /**
+     * @brief Throws std::invalid_argument unless lambda > 0.
+     */
+    explicit ZigguratExponential(double lambda = 1.0) {
+        if (!(lambda > 0)) throw std::invalid_argument("ZigguratExponential: lambda must be > 0");
+        scale = 1.0 / lambda;
+        distribution_detail::zigguratTables<false>();
+    }
+
+    template<typename Rng>
+    double operator()(Rng& rng) const {
+        double out;
+        uint64_t bits = rng();
+        sampleScalar(&bits, &out, 1, rng);
+        return out;
+    }
+
+    template<typename Rng>
+    void sampleN(Rng& rng, double* out, size_t n, SimdLevel level = detectSimdLevel()) const {
+        uint64_t bits[distribution_detail::kChunk];
+        for (size_t done = 0; done < n;) {
+            size_t count = std::min(distribution_detail::kChunk, n - done);
+            distribution_detail::fillBits(rng, bits, count);
+#ifdef SIMD_X86
+            if (level == SimdLevel::AVX2) {
+                sampleAvx2(bits, out + done, count, rng);
+            } else
+#endif
+            {
+                (void)level;
+                sampleScalar(bits, out + done, count, rng);
+            }
+            done += count;
+        }
+    }
+};
+
+#ifdef SIMD_X86
+SIMD_BEGIN_AVX2
+namespace distribution_avx2 {
+
+// Four ziggurat fast paths: |value| in x, and a 4-bit mask of the lanes
+// whose point fell outside the layer above and need zigguratSlow()
+inline int zigguratFast(const uint64_t* bits, const distribution_detail::ZigguratTables& t, __m256d& x) {
+    __m256i u = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bits));
+    __m256i layer = _mm256_and_si256(u, _mm256_set1_epi64x(255));
+    __m256d width = _mm256_i64gather_pd(t.x, layer, 8);
+    __m256d inner = _mm256_i64gather_pd(t.x + 1, layer, 8);
+    __m256d unit = _mm256_sub_pd(
+        _mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(u, 12), _mm256_set1_epi64x(0x3FF0000000000000ll))),
+        _mm256_set1_pd(1.0));
+    x = _mm256_mul_pd(unit, width);
+    return _mm256_movemask_pd(_mm256_cmp_pd(x, inner, _CMP_NLT_UQ));
+}
+
+} // namespace distribution_avx2
+
+inline void AliasTable::sampleAvx2(const uint64_t* bits, uint32_t* out, size_t n) const {
+    // Gathering from a 1-bucket table with shift 32 would need a shift the
+    // instruction set clamps differently, so use the scalar path there
+    if (shift == 32) {
+        sampleScalar(bits, out, n);
+        return;
+    }
+    const __m256i deinterleave = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+    const __m128i bucketShift = _mm_cvtsi32_si128(shift);
+    const __m256i signBit = _mm256_set1_epi32(static_cast<int>(0x80000000));
+    const int* thresholds = reinterpret_cast<const int*>(threshold.data());
+    const int* aliases = reinterpret_cast<const int*>(alias.data());
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        // Eight 64-bit words: low halves (the coins) and high halves (the buckets)
+        __m256i a = _mm256_permutevar8x32_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(bits + i)), deinterleave);
+        __m256i b = _mm256_permutevar8x32_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(bits + i + 4)), deinterleave);
+        __m256i coin = _mm256_permute2x128_si256(a, b, 0x20);
+        __m256i bucket = _mm256_srl_epi32(_mm256_permute2x128_si256(a, b, 0x31), bucketShift);
+        __m256i limit = _mm256_i32gather_epi32(thresholds, bucket, 4);
+        __m256i other = _mm256_i32gather_epi32(aliases, bucket, 4);
+        // Unsigned coin < limit, as a signed compare with both sign bits flipped
+        __m256i keep = _mm256_cmpgt_epi32(_mm256_xor_si256(limit, signBit), _mm256_xor_si256(coin, signBit));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_blendv_epi8(other, bucket, keep));
+    }
+    sampleScalar(bits + i, out + i, n - i);
+}
+
+template<typename Rng>
+void ZigguratNormal::sampleAvx2(const uint64_t* bits, double* out, size_t n, Rng& rng) const {
+    const distribution_detail::ZigguratTables& t = distribution_detail::zigguratTables<true>();
+    const __m256d meanV = _mm256_set1_pd(mean), stddevV = _mm256_set1_pd(stddev);
+    size_t k = 0;
+    for (; k + 4 <= n; k += 4) {
+        __m256d x;
+        int slow = distribution_avx2::zigguratFast(bits + k, t, x);
+        // Bit 8 of each word is the sign
+        __m256i u = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bits + k));
+        __m256d sign = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_and_si256(u, _mm256_set1_epi64x(256)), 55));
+        _mm256_storeu_pd(out + k, _mm256_add_pd(meanV, _mm256_mul_pd(stddevV, _mm256_xor_pd(x, sign))));
+        for (; slow != 0; slow &= slow - 1) {
+            int lane = 0;
+            while (!(slow & (1 << lane))) lane++;
+            double value = distribution_detail::zigguratSlow<true>(bits[k + lane], rng);
+            out[k + lane] = mean + stddev * (bits[k + lane] & 256 ? -value : value);
+        }
+    }
+    sampleScalar(bits + k, out + k, n - k, rng);
+}
+
+template<typename Rng>
+void ZigguratExponential::sampleAvx2(const uint64_t* bits, double* out, size_t n, Rng& rng) const {
+    const distribution_detail::ZigguratTables& t = distribution_detail::zigguratTables<false>();
+    const __m256d scaleV = _mm256_set1_pd(scale);
+    size_t k = 0;
+    for (; k + 4 <= n; k += 4) {
+        __m256d x;
+        int slow = distribution_avx2::zigguratFast(bits + k, t, x);
+        _mm256_storeu_pd(out + k, _mm256_mul_pd(scaleV, x));
+        for (; slow != 0; slow &= slow - 1) {
+            int lane = 0;
+            while (!(slow & (1 << lane))) lane++;
+            out[k + lane] = scale * distribution_detail::zigguratSlow<false>(bits[k + lane], rng);
+        }
+    }
+    sampleScalar(bits + k, out + k, n - k, rng);
+}
+SIMD_END_TARGET
+#endif
+
+#endif // FAST_DISTRIBUTIONS_H
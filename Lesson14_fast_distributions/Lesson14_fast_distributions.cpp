@@ -0,0 +1,289 @@
+// Lesson14_fast_distributions.cpp : This file contains the 'main' function. Program execution begins and ends there.
+//
+// Million samples per second from std::discrete_distribution,
+// std::normal_distribution and std::exponential_distribution (with
+// std::mt19937_64) against AliasTable, ZigguratNormal and
+// ZigguratExponential one at a time and with sampleN(), scalar and AVX2.
+// The discrete tables are the even/odd weights of Lesson14 exercise 5 and
+// random weights over 1000 and 1000000 outcomes.
+//
+// The sanity check is statistical: chi-square tests for the alias tables
+// and Kolmogorov-Smirnov tests for the ziggurats, with fixed seeds.
+//
+// Usage: Lesson14_fast_distributions [samples]
+//   Default: 20000000 samples per measurement.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FastDistributions.h"
+
+typedef std::chrono::steady_clock Clock;
+
+// Chi-square statistic above which a table fails: the Wilson-Hilferty
+// approximation of the quantile 4.5 standard deviations up (p ~ 3e-6)
+double chiSquareLimit(size_t degreesOfFreedom) {
+    double k = static_cast<double>(degreesOfFreedom), z = 4.5;
+    double c = 1 - 2 / (9 * k) + z * std::sqrt(2 / (9 * k));
+    return k * c * c * c;
+}
+
+// Draws samples from the table with sampleN() at the given level and
+// checks the counts against the weights
+void checkAliasTable(const std::vector<double>& weights, size_t samples, SimdLevel level, const std::string& name) {
+    AliasTable table(weights);
+    Xoshiro256ppX8 rng(17);
+    std::vector<uint32_t> drawn(samples);
+    table.sampleN(rng, drawn.data(), samples, level);
+    std::vector<size_t> counts(weights.size());
+    for (uint32_t outcome : drawn) {
+        if (outcome >= weights.size()) throw std::logic_error(name + ": outcome out of range");
+        counts[outcome]++;
+    }
+    double sum = 0;
+    for (double w : weights) sum += w;
+    double chiSquare = 0;
+    size_t degrees = 0;
+    for (size_t i = 0; i < weights.size(); i++) {
+        double expected = samples * weights[i] / sum;
+        if (weights[i] == 0) {
+            if (counts[i] != 0) throw std::logic_error(name + ": zero-weight outcome drawn");
+            continue;
+        }
+        chiSquare += (counts[i] - expected) * (counts[i] - expected) / expected;
+        degrees++;
+    }
+    if (degrees > 1 && chiSquare > chiSquareLimit(degrees - 1)) {
+        throw std::logic_error(name + ": chi-square " + std::to_string(chiSquare) + " too large");
+    }
+}
+
+// Kolmogorov-Smirnov: the largest gap between the empirical distribution
+// of the samples and cdf must stay below 1.95 / sqrt(n) (p = 0.001)
+void checkKolmogorovSmirnov(std::vector<double> samples, const std::function<double(double)>& cdf,
+                            const std::string& name) {
+    std::sort(samples.begin(), samples.end());
+    double n = static_cast<double>(samples.size()), d = 0;
+    for (size_t i = 0; i < samples.size(); i++) {
+        double f = cdf(samples[i]);
+        d = std::max(d, std::max(f - i / n, (i + 1) / n - f));
+    }
+    if (d > 1.95 / std::sqrt(n)) throw std::logic_error(name + ": KS distance " + std::to_string(d) + " too large");
+}
+
+void sanityCheck() {
+    std::vector<SimdLevel> levels = { SimdLevel::Scalar };
+    if (detectSimdLevel() == SimdLevel::AVX2) levels.push_back(SimdLevel::AVX2);
+
+    // Alias tables: exercise 5's even/odd weights, one outcome, zero
+    // weights (which must never come up) and sizes that need padding
+    std::mt19937_64 weightRng(5);
+    std::vector<double> random1000(1000), spiky(77);
+    for (double& w : random1000) w = std::uniform_real_distribution<double>(0, 1)(weightRng);
+    for (size_t i = 0; i < spiky.size(); i++) spiky[i] = i % 10 == 0 ? 1000.0 : i % 3 == 0 ? 0.0 : 1.0;
+    std::vector<std::pair<std::string, std::vector<double>>> tables = {
+        { "even/odd", { 2, 1, 2, 1, 2, 1, 2, 1, 2, 1 } },
+        { "single", { 3.5 } },
+        { "zeros", { 0, 1, 0, 0, 2, 0, 0 } },
+        { "random 1000", random1000 },
+        { "spiky 77", spiky },
+    };
+    for (SimdLevel level : levels) {
+        for (const auto& table : tables) {
+            checkAliasTable(table.second, 2000000 + 7, level, "AliasTable " + table.first + " " + simdLevelName(level));
+        }
+    }
+    for (const std::vector<double>& bad : { std::vector<double>(), std::vector<double>{ 0, 0 },
+                                            std::vector<double>{ 1, -1 }, std::vector<double>{ 1, NAN } }) {
+        bool threw = false;
+        try {
+            AliasTable table(bad);
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        if (!threw) throw std::logic_error("AliasTable accepted invalid weights");
+    }
+
+    // Ziggurats: KS against the exact CDF, for one-at-a-time and sampleN()
+    const size_t n = 1000000;
+    ZigguratNormal normal(100.0, 10.0);
+    ZigguratExponential exponential(2.0);
+    auto normalCdf = [](double x) { return 0.5 * std::erfc(-(x - 100.0) / 10.0 / std::sqrt(2.0)); };
+    auto exponentialCdf = [](double x) { return x < 0 ? 0.0 : 1.0 - std::exp(-2.0 * x); };
+    Xoshiro256pp rng(23);
+    std::vector<double> values(n);
+    for (double& v : values) v = normal(rng);
+    checkKolmogorovSmirnov(values, normalCdf, "ZigguratNormal");
+    for (double& v : values) v = exponential(rng);
+    checkKolmogorovSmirnov(values, exponentialCdf, "ZigguratExponential");
+
+    for (SimdLevel level : levels) {
+        std::string suffix = std::string(" sampleN ") + simdLevelName(level);
+        Xoshiro256ppX8 bulk(29);
+        normal.sampleN(bulk, values.data(), n, level);
+        checkKolmogorovSmirnov(values, normalCdf, "ZigguratNormal" + suffix);
+        exponential.sampleN(bulk, values.data(), n, level);
+        checkKolmogorovSmirnov(values, exponentialCdf, "ZigguratExponential" + suffix);
+    }
+
+    // KS hardly sees the tails, where the ziggurat switches to its slow path:
+    // count values beyond 3.5 and 4.5 standard deviations and beyond 8 means
+    ZigguratNormal standard;
+    ZigguratExponential unit;
+    Xoshiro256ppX8 bulk(31);
+    const size_t tailSamples = 20000000;
+    std::vector<double> tail(tailSamples);
+    struct { double limit; double probability; bool normal; } tails[] = {
+        { 3.5, std::erfc(3.5 / std::sqrt(2.0)), true },
+        { 4.5, std::erfc(4.5 / std::sqrt(2.0)), true },
+        { 8.0, std::exp(-8.0), false },
+    };
+    for (const auto& t : tails) {
+        if (t.normal) {
+            standard.sampleN(bulk, tail.data(), tailSamples);
+        } else {
+            unit.sampleN(bulk, tail.data(), tailSamples);
+        }
+        size_t beyond = 0;
+        for (double v : tail) beyond += std::abs(v) > t.limit;
+        double expected = t.probability * tailSamples;
+        if (std::abs(beyond - expected) > 5 * std::sqrt(expected)) {
+            throw std::logic_error("tail beyond " + std::to_string(t.limit) + ": " + std::to_string(beyond) +
+                                   " values, expected " + std::to_string(expected));
+        }
+    }
+
+    // AVX2 and scalar sampleN give exactly the same values
+    if (levels.size() > 1) {
+        std::vector<double> scalar(100003), avx2(100003);
+        std::vector<uint32_t> scalarOutcomes(100003), avx2Outcomes(100003);
+        AliasTable table(random1000);
+        Xoshiro256ppX8 a(37, SimdLevel::Scalar), b(37, SimdLevel::Scalar);
+        normal.sampleN(a, scalar.data(), scalar.size(), SimdLevel::Scalar);
+        normal.sampleN(b, avx2.data(), avx2.size(), SimdLevel::AVX2);
+        if (scalar != avx2) throw std::logic_error("ZigguratNormal AVX2 differs from scalar");
+        exponential.sampleN(a, scalar.data(), scalar.size(), SimdLevel::Scalar);
+        exponential.sampleN(b, avx2.data(), avx2.size(), SimdLevel::AVX2);
+        if (scalar != avx2) throw std::logic_error("ZigguratExponential AVX2 differs from scalar");
+        table.sampleN(a, scalarOutcomes.data(), scalarOutcomes.size(), SimdLevel::Scalar);
+        table.sampleN(b, avx2Outcomes.data(), avx2Outcomes.size(), SimdLevel::AVX2);
+        if (scalarOutcomes != avx2Outcomes) throw std::logic_error("AliasTable AVX2 differs from scalar");
+    }
+
+    bool threw = false;
+    try {
+        ZigguratExponential bad(0.0);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    if (!threw) throw std::logic_error("ZigguratExponential accepted lambda 0");
+
+    std::cout << "Sanity check passed\n\n";
+}
+
+uint64_t sink = 0;
+
+// Million samples per second for sample(buffer) producing kBuffer values a call
+const size_t kBuffer = 4096;
+
+template<typename T>
+double measure(size_t samples, const std::function<void(T*)>& sample) {
+    std::vector<T> buffer(kBuffer);
+    size_t rounds = std::max<size_t>(1, samples / kBuffer);
+    auto start = Clock::now();
+    for (size_t r = 0; r < rounds; r++) {
+        sample(buffer.data());
+        sink += static_cast<uint64_t>(buffer[r % kBuffer]);
+    }
+    return rounds * kBuffer / std::chrono::duration<double>(Clock::now() - start).count() / 1e6;
+}
+
+void printRow(const std::string& name, const std::vector<double>& results) {
+    std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(1);
+    for (double mps : results) std::cout << std::setw(14) << mps;
+    std::cout << "\n";
+}
+
+int main(int argc, char* argv[]) {
+    size_t samples = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20000000;
+
+    sanityCheck();
+
+    std::cout << "Hardware threads: " << std::thread::hardware_concurrency() << ", "
+              << simdLevelName(detectSimdLevel()) << "\n";
+    std::cout << "Million samples per second, " << samples << " per measurement\n\n";
+    std::cout << std::left << std::setw(24) << "distribution" << std::right << std::setw(14) << "std::"
+              << std::setw(14) << "one at a time" << std::setw(14) << "sampleN" << std::setw(14) << "sampleN AVX2"
+              << "\n";
+
+    std::mt19937_64 mt;
+    Xoshiro256pp xoshiro(1);
+    Xoshiro256ppX8 bulk(1);
+    SimdLevel best = detectSimdLevel();
+
+    std::mt19937_64 weightRng(5);
+    std::vector<double> evenOdd = { 2, 1, 2, 1, 2, 1, 2, 1, 2, 1 };
+    std::vector<double> random1000(1000), randomMillion(1000000);
+    for (double& w : random1000) w = std::uniform_real_distribution<double>(0, 1)(weightRng);
+    for (double& w : randomMillion) w = std::uniform_real_distribution<double>(0, 1)(weightRng);
+    std::pair<std::string, const std::vector<double>*> discrete[] = {
+        { "discrete even/odd", &evenOdd },
+        { "discrete 1000", &random1000 },
+        { "discrete 1000000", &randomMillion },
+    };
+    for (const auto& weights : discrete) {
+        std::discrete_distribution<uint32_t> standard(weights.second->begin(), weights.second->end());
+        AliasTable table(*weights.second);
+        printRow(weights.first, {
+            measure<uint32_t>(samples, [&](uint32_t* out) { for (size_t i = 0; i < kBuffer; i++) out[i] = standard(mt); }),
+            measure<uint32_t>(samples, [&](uint32_t* out) { for (size_t i = 0; i < kBuffer; i++) out[i] = table(xoshiro); }),
+            measure<uint32_t>(samples, [&](uint32_t* out) { table.sampleN(bulk, out, kBuffer, SimdLevel::Scalar); }),
+            measure<uint32_t>(samples, [&](uint32_t* out) { table.sampleN(bulk, out, kBuffer, best); }),
+        });
+    }
+
+    std::normal_distribution<double> standardNormal(0.0, 1.0);
+    ZigguratNormal normal;
+    printRow("normal", {
+        measure<double>(samples, [&](double* out) { for (size_t i = 0; i < kBuffer; i++) out[i] = standardNormal(mt); }),
+        measure<double>(samples, [&](double* out) { for (size_t i = 0; i < kBuffer; i++) out[i] = normal(xoshiro); }),
+        measure<double>(samples, [&](double* out) { normal.sampleN(bulk, out, kBuffer, SimdLevel::Scalar); }),
+        measure<double>(samples, [&](double* out) { normal.sampleN(bulk, out, kBuffer, best); }),
+    });
+
+    std::exponential_distribution<double> standardExponential(1.0);
+    ZigguratExponential exponential;
+    printRow("exponential", {
+        measure<double>(samples, [&](double* out) {
+            for (size_t i = 0; i < kBuffer; i++) out[i] = standardExponential(mt);
+        }),
+        measure<double>(samples, [&](double* out) { for (size_t i = 0; i < kBuffer; i++) out[i] = exponential(xoshiro); }),
+        measure<double>(samples, [&](double* out) { exponential.sampleN(bulk, out, kBuffer, SimdLevel::Scalar); }),
+        measure<double>(samples, [&](double* out) { exponential.sampleN(bulk, out, kBuffer, best); }),
+    });
+
+    std::cout << "\n(checksum " << sink % 1000 << ")\n";
+    return 0;
+}
+
+// Run program: Ctrl + F5 or Debug > Start Without Debugging menu
+// Debug program: F5 or Debug > Start Debugging menu
+
+// Tips for Getting Started:
+//   1. Use the Solution Explorer window to add/manage files
+//   2. Use the Team Explorer window to connect to source control
+//   3. Use the Output window to see build output and other messages
+//   4. Use the Error List window to view errors
+//   5. Go to Project > Add New Item to create new code files, or Project > Add Existing Item to add existing code files to the project
+//   6. In the future, to open this project again, go to File > Open > Project and select the .sln file
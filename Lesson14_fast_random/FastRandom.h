@@ -0,0 +1,595 @@
+// FastRandom.h
+//
+// Random number generators for simulations that need billions of draws.
+//
+// The generators in "Lesson14  - Random number Generation.md" return one
+// 32-bit value per call, nextInRange() reduces with %, which favours small
+// results whenever the range does not divide 2^32 (and a division is slow),
+// and there is no way to give each thread its own stream that does not
+// overlap the others. This header provides:
+//
+//   Xoshiro256pp     xoshiro256++ (Blackman & Vigna): 256 bits of state,
+//                    64-bit results, period 2^256 - 1. jump() skips 2^128
+//                    values and longJump() 2^192, so a thread (or task)
+//                    can be given a stream no other thread will reach
+//   Xoshiro256ppX8   eight xoshiro256++ generators, jump() apart, stepped
+//                    together: fill() keeps them in two AVX2 registers and
+//                    produces 8 values per step
+//   Philox4x32       Philox4x32-10 (Salmon et al.): counter-based. Value i
+//                    of stream s is a fixed function of (seed, s, i), so
+//                    streams need no jumping, discard(n) is O(1) and fill()
+//                    computes 8 blocks at a time with AVX2
+//
+// and, for any of them, the helpers
+//
+//   boundedRandom(rng, range)          unbiased value in [0, range)
+//   uniformInt(rng, min, max)          unbiased value in [min, max]
+//   uniformDouble(rng)                 double in [0, 1)
+//   fillBounded / fillUniform          the same in bulk on top of fill()
+//
+// boundedRandom() uses Lemire's method: multiply a 64-bit draw by the
+// range and keep the high half. The low half tells whether the draw fell in
+// the small over-represented slice, which needs a division to detect and
+// happens with probability range / 2^64 - for most ranges never.
+//
+// All three generators satisfy UniformRandomBitGenerator, so they also
+// work with <random>'s distributions and std::shuffle. Xoshiro256ppX8
+// and Philox4x32 take a SimdLevel (by default detectSimdLevel()) and fall
+// back to one lane or block at a time without AVX2; fill() returns the
+// same numbers either way, so a seeded simulation gives the same results
+// on every machine.
+
+#ifndef FAST_RANDOM_H
+#define FAST_RANDOM_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#include "../common/SimdDispatch.h"
+
+namespace fast_random_detail {
+
+inline uint64_t rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+// High and low halves of the 128-bit product a * b
+inline uint64_t mulHiLo(uint64_t a, uint64_t b, uint64_t& lo) {
+#if defined(_MSC_VER) && defined(_M_X64)
+    uint64_t hi;
+    lo = _umul128(a, b, &hi);
+    return hi;
+#elif defined(__SIZEOF_INT128__)
+    unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+    lo = static_cast<uint64_t>(product);
+    return static_cast<uint64_t>(product >> 64);
+#else
+    uint64_t aLo = a & 0xFFFFFFFF, aHi = a >> 32, bLo = b & 0xFFFFFFFF, bHi = b >> 32;
+    uint64_t ll = aLo * bLo, lh = aLo * bHi, hl = aHi * bLo, hh = aHi * bHi;
+    uint64_t middle = (ll >> 32) + (lh & 0xFFFFFFFF) + (hl & 0xFFFFFFFF);
+    lo = (middle << 32) | (ll & 0xFFFFFFFF);
+    return hh + (lh >> 32) + (hl >> 32) + (middle >> 32);
+#endif
+}
+
+// SplitMix64: turns one seed into well-mixed state words, as the xoshiro
+// authors recommend (a state that is mostly zero bits starts out poor)
+inline uint64_t splitMix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+const uint64_t kJump[4] = { 0x180EC6D33CFD0ABAull, 0xD5A61266F0C9392Cull,
+                            0xA9582618E03FC9AAull, 0x39ABDC4529B1661Cull };
+const uint64_t kLongJump[4] = { 0x76E15D3EFEFDCBBFull, 0xC5004E441C522FB3ull,
+                                0x77710069854EE241ull, 0x39109BB02ACBE635ull };
+
+// Philox4x32-10 constants: the two multipliers and the key increments
+const uint32_t kPhiloxM0 = 0xD2511F53, kPhiloxM1 = 0xCD9E8D57;
+const uint32_t kPhiloxW0 = 0x9E3779B9, kPhiloxW1 = 0xBB67AE85;
+
+} // namespace fast_random_detail
+
+/**
+ * @brief xoshiro256++: small, fast, 64-bit results, with jump-ahead.
+ */
+class Xoshiro256pp {
+private:
+    uint64_t s[4];
+
+    // Advance by the polynomial in table, i.e. by 2^128 or 2^192 steps
+    void jumpBy(const uint64_t (&table)[4]) {
+        uint64_t t[4] = { 0, 0, 0, 0 };
+        for (uint64_t word : table) {
+            for (int bit = 0; bit < 64; bit++) {
+                if (word & (1ull << bit)) {
+                    for (int i = 0; i < 4; i++) t[i] ^= s[i];
+                }
+                next();
+            }
+        }
+        std::memcpy(s, t, sizeof(s));
+    }
+
+public:
+    typedef uint64_t result_type;
+
+    explicit Xoshiro256pp(uint64_t seed = 1) {
+        for (uint64_t& word : s) word = fast_random_detail::splitMix64(seed);
+    }
+
+    /**
+     * @brief Start from an exact state, which must not be all zero.
+     */
+    explicit Xoshiro256pp(const std::array<uint64_t, 4>& state) {
+        std::memcpy(s, state.data(), sizeof(s));
+    }
+
+    static constexpr uint64_t min() { return 0; }
+    static constexpr uint64_t max() { return std::numeric_limits<uint64_t>::max(); }
+
+    uint64_t next() {
+        uint64_t result = fast_random_detail::rotl(s[0] + s[3], 23) + s[0];
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = fast_random_detail::rotl(s[3], 45);
+        return result;
+    }
+
+    uint64_t operator()() { return next(); }
+
+    /**
+     * @brief Skip 2^128 values: up to 2^128 non-overlapping streams.
+     */
+    void jump() { jumpBy(fast_random_detail::kJump); }
+
+    /**
+     * @brief Skip 2^192 values. Give each thread longJump() streams and
+     *        let the thread split its own with jump() (Xoshiro256ppX8 does).
+     */
+    void longJump() { jumpBy(fast_random_detail::kLongJump); }
+
+    /**
+     * @brief The next n values, exactly as n calls to next() would return.
+     */
+    void fill(uint64_t* out, size_t n) {
+        for (size_t i = 0; i < n; i++) out[i] = next();
+    }
+
+    std::array<uint64_t, 4> state() const { return { { s[0], s[1], s[2], s[3] } }; }
+};
+
+/**
+ * @brief Eight xoshiro256++ streams stepped in lock step for bulk output.
+ *
+ * Lane k starts where Xoshiro256pp(seed) would be after k jump()s. The
+ * output is lane 0's next value, lane 1's, ..., lane 7's, then lane 0's
+ * following value and so on, the same on every instruction set and however
+ * it is split between fill() and operator() calls: values of a step not
+ * yet handed out wait in a small buffer.
+ */
+class Xoshiro256ppX8 {
+public:
+    static constexpr int kLanes = 8;
+
+private:
+    // s[word][lane]: each state word of the 8 lanes is two AVX2 registers
+    alignas(32) uint64_t s[4][kLanes];
+    uint64_t buffered[kLanes];
+    int used = kLanes;          // values of buffered already handed out
+    SimdLevel level;
+
+    void init(Xoshiro256pp base) {
+        for (int lane = 0; lane < kLanes; lane++) {
+            std::array<uint64_t, 4> state = base.state();
+            for (int w = 0; w < 4; w++) s[w][lane] = state[w];
+            base.jump();
+        }
+    }
+
+    void fillScalar(uint64_t* out, size_t steps);
+#ifdef SIMD_X86
+    void fillAvx2(uint64_t* out, size_t steps);
+#endif
+
+public:
+    typedef uint64_t result_type;
+
+    explicit Xoshiro256ppX8(uint64_t seed = 1, SimdLevel level = detectSimdLevel()) : level(level) {
+        init(Xoshiro256pp(seed));
+    }
+
+    explicit Xoshiro256ppX8(const Xoshiro256pp& base, SimdLevel level = detectSimdLevel()) : level(level) {
+        init(base);
+    }
+
+    static constexpr uint64_t min() { return 0; }
+    static constexpr uint64_t max() { return std::numeric_limits<uint64_t>::max(); }
+
+    uint64_t operator()() {
+        if (used == kLanes) {
+            fillScalar(buffered, 1);
+            used = 0;
+        }
+        return buffered[used++];
+    }
+
+    void fill(uint64_t* out, size_t n) {
+        while (used < kLanes && n > 0) {
+            *out++ = buffered[used++];
+            n--;
+        }
+        size_t steps = n / kLanes;
+#ifdef SIMD_X86
+        if (level == SimdLevel::AVX2) {
+            fillAvx2(out, steps);
+        } else
+#endif
+        {
+            fillScalar(out, steps);
+        }
+        if (n % kLanes != 0) {
+            fillScalar(buffered, 1);
+            used = static_cast<int>(n % kLanes);
+            std::memcpy(out + steps * kLanes, buffered, used * sizeof(uint64_t));
+        }
+    }
+
+    /**
+     * @brief Move every lane on by 2^192 values (a new set of 8 streams),
+     *        dropping any buffered values.
+     */
+    void longJump() {
+        used = kLanes;
+        for (int lane = 0; lane < kLanes; lane++) {
+            Xoshiro256pp g(laneState(lane));
+            g.longJump();
+            std::array<uint64_t, 4> state = g.state();
+            for (int w = 0; w < 4; w++) s[w][lane] = state[w];
+        }
+    }
+
+    std::array<uint64_t, 4> laneState(int lane) const {
+        return { { s[0][lane], s[1][lane], s[2][lane], s[3][lane] } };
+    }
+
+    SimdLevel simdLevel() const { return level; }
+};
+
+inline void Xoshiro256ppX8::fillScalar(uint64_t* out, size_t steps) {
+    using fast_random_detail::rotl;
+    for (size_t i = 0; i < steps; i++, out += kLanes) {
+        for (int k = 0; k < kLanes; k++) {
+            out[k] = rotl(s[0][k] + s[3][k], 23) + s[0][k];
+            uint64_t t = s[1][k] << 17;
+            s[2][k] ^= s[0][k];
+            s[3][k] ^= s[1][k];
+            s[1][k] ^= s[2][k];
+            s[0][k] ^= s[3][k];
+            s[2][k] ^= t;
+            s[3][k] = rotl(s[3][k], 45);
+        }
+    }
+}
+
+#ifdef SIMD_X86
+SIMD_BEGIN_AVX2
+namespace fast_random_avx2 {
+
+template<int K>
+inline __m256i rotl(__m256i x) {
+    return _mm256_or_si256(_mm256_slli_epi64(x, K), _mm256_srli_epi64(x, 64 - K));
+}
+
+// One xoshiro256++ step of four lanes
+inline __m256i step(__m256i& s0, __m256i& s1, __m256i& s2, __m256i& s3) {
+    __m256i result = _mm256_add_epi64(rotl<23>(_mm256_add_epi64(s0, s3)), s0);
+    __m256i t = _mm256_slli_epi64(s1, 17);
+    s2 = _mm256_xor_si256(s2, s0);
+    s3 = _mm256_xor_si256(s3, s1);
+    s1 = _mm256_xor_si256(s1, s2);
+    s0 = _mm256_xor_si256(s0, s3);
+    s2 = _mm256_xor_si256(s2, t);
+    s3 = rotl<45>(s3);
+    return result;
+}
+
+} // namespace fast_random_avx2
+
+// Lanes 0-3 and 4-7 are independent, so the two halves of each step
+// overlap in the pipeline
+inline void Xoshiro256ppX8::fillAvx2(uint64_t* out, size_t steps) {
+    __m256i a[4], b[4];
+    for (int w = 0; w < 4; w++) {
+        a[w] = _mm256_load_si256(reinterpret_cast<const __m256i*>(&s[w][0]));
+        b[w] = _mm256_load_si256(reinterpret_cast<const __m256i*>(&s[w][4]));
+    }
+    for (size_t i = 0; i < steps; i++, out += kLanes) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), fast_random_avx2::step(a[0], a[1], a[2], a[3]));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 4), fast_random_avx2::step(b[0], b[1], b[2], b[3]));
+    }
+    for (int w = 0; w < 4; w++) {
+        _mm256_store_si256(reinterpret_cast<__m256i*>(&s[w][0]), a[w]);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(&s[w][4]), b[w]);
+    }
+}
+SIMD_END_TARGET
+#endif
+
+/**
+ * @brief Philox4x32-10: value i of stream s is a pure function of (seed, s, i).
+ *
+ * Each 128-bit counter (block index in the low 64 bits, stream in the high
+ * 64 bits) is encrypted with the 64-bit seed as key, giving two 64-bit
+ * values. Streams never overlap (each has 2^65 values) and any position is
+ * reached in O(1), which makes results reproducible however the work is
+ * split between threads: give each piece of work its own stream.
+ */
+class Philox4x32 {
+public:
+    typedef std::array<uint32_t, 4> Block;
+
+private:
+    uint64_t seed;
+    uint64_t stream;
+    uint64_t index = 0;                 // of the next value
+    uint64_t cachedBlock = ~0ull;       // block index whose values are in cache
+    uint64_t cache[2] = { 0, 0 };
+    SimdLevel level;
+
+    Block counter(uint64_t block) const {
+        return { { static_cast<uint32_t>(block), static_cast<uint32_t>(block >> 32),
+                   static_cast<uint32_t>(stream), static_cast<uint32_t>(stream >> 32) } };
+    }
+
+    void blocksScalar(uint64_t firstBlock, size_t blocks, uint64_t* out) const {
+        for (size_t b = 0; b < blocks; b++) {
+            Block x = encrypt(counter(firstBlock + b), seed);
+            out[2 * b] = x[0] | static_cast<uint64_t>(x[1]) << 32;
+            out[2 * b + 1] = x[2] | static_cast<uint64_t>(x[3]) << 32;
+        }
+    }
+
+#ifdef SIMD_X86
+    void blocksAvx2(uint64_t firstBlock, size_t blocks, uint64_t* out) const;
+#endif
+
+public:
+    typedef uint64_t result_type;
+
+    explicit Philox4x32(uint64_t seed = 0, uint64_t stream = 0, SimdLevel level = detectSimdLevel())
+        : seed(seed), stream(stream), level(level) {}
+
+    static constexpr uint64_t min() { return 0; }
+    static constexpr uint64_t max() { return std::numeric_limits<uint64_t>::max(); }
+
+    /**
+     * @brief The Philox4x32-10 bijection itself: 10 rounds on one counter.
+     */
+    static Block encrypt(Block x, uint64_t key) {
+        using namespace fast_random_detail;
+        uint32_t k0 = static_cast<uint32_t>(key), k1 = static_cast<uint32_t>(key >> 32);
+        for (int round = 0; round < 10; round++) {
+            uint64_t p0 = static_cast<uint64_t>(kPhiloxM0) * x[0];
+            uint64_t p1 = static_cast<uint64_t>(kPhiloxM1) * x[2];
+            x = { { static_cast<uint32_t>(p1 >> 32) ^ x[1] ^ k0, static_cast<uint32_t>(p1),
+                    static_cast<uint32_t>(p0 >> 32) ^ x[3] ^ k1, static_cast<uint32_t>(p0) } };
+            k0 += kPhiloxW0;
+            k1 += kPhiloxW1;
+        }
+        return x;
+    }
+
+    uint64_t next() {
+        uint64_t block = index >> 1;
+        if (block != cachedBlock) {
+            blocksScalar(block, 1, cache);
+            cachedBlock = block;
+        }
+        return cache[index++ & 1];
+    }
+
+    uint64_t operator()() { return next(); }
+
+    /**
+     * @brief Skip n values in O(1).
+     */
+    void discard(uint64_t n) { index += n; }
+
+    uint64_t position() const { return index; }
+
+    /**
+     * @brief The next n values, exactly as n calls to next() would return.
+     */
+    void fill(uint64_t* out, size_t n) {
+        if (n > 0 && (index & 1)) {
+            *out++ = next();
+            n--;
+        }
+        size_t blocks = n / 2;
+#ifdef SIMD_X86
+        if (level == SimdLevel::AVX2) {
+            blocksAvx2(index >> 1, blocks, out);
+        } else
+#endif
+        {
+            blocksScalar(index >> 1, blocks, out);
+        }
+        index += 2 * blocks;
+        if (n & 1) out[n - 1] = next();
+    }
+
+    SimdLevel simdLevel() const { return level; }
+};
+
+#ifdef SIMD_X86
+SIMD_BEGIN_AVX2
+namespace fast_random_avx2 {
+
+// 32 x 32 -> 64-bit products of all eight lanes of x with m, split into
+// the low and the high halves
+inline void mulHiLo(__m256i x, __m256i m, __m256i& lo, __m256i& hi) {
+    __m256i even = _mm256_mul_epu32(x, m);
+    __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(x, 32), m);
+    lo = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+    hi = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+}
+
+// The counters of blocks c .. c + 7: low words in x0, high words in x1
+inline void philoxCounters(uint64_t c, __m256i& x0, __m256i& x1) {
+    if (static_cast<uint32_t>(c) <= 0xFFFFFFFF - 7) {
+        x0 = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(c)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        x1 = _mm256_set1_epi32(static_cast<int>(c >> 32));
+        return;
+    }
+    alignas(32) uint32_t lo[8], hi[8];
+    for (int i = 0; i < 8; i++) {
+        lo[i] = static_cast<uint32_t>(c + i);
+        hi[i] = static_cast<uint32_t>((c + i) >> 32);
+    }
+    x0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(lo));
+    x1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(hi));
+}
+
+// G groups of eight blocks, one block per 32-bit lane: x[g][w] holds word w
+// of the eight blocks of group g. A round is a chain of multiplies, so
+// interleaving two groups keeps the multiplier busy.
+template<int G>
+inline void philoxBlocks(uint64_t firstBlock, uint64_t key, uint64_t stream, uint64_t* out) {
+    using namespace fast_random_detail;
+    const __m256i m0 = _mm256_set1_epi32(static_cast<int>(kPhiloxM0));
+    const __m256i m1 = _mm256_set1_epi32(static_cast<int>(kPhiloxM1));
+    __m256i x[G][4];
+    for (int g = 0; g < G; g++) {
+        philoxCounters(firstBlock + 8 * g, x[g][0], x[g][1]);
+        x[g][2] = _mm256_set1_epi32(static_cast<int>(static_cast<uint32_t>(stream)));
+        x[g][3] = _mm256_set1_epi32(static_cast<int>(static_cast<uint32_t>(stream >> 32)));
+    }
+    uint32_t k0 = static_cast<uint32_t>(key), k1 = static_cast<uint32_t>(key >> 32);
+    for (int round = 0; round < 10; round++) {
+        __m256i key0 = _mm256_set1_epi32(static_cast<int>(k0)), key1 = _mm256_set1_epi32(static_cast<int>(k1));
+        for (int g = 0; g < G; g++) {
+            __m256i lo0, hi0, lo1, hi1;
+            mulHiLo(x[g][0], m0, lo0, hi0);
+            mulHiLo(x[g][2], m1, lo1, hi1);
+            x[g][0] = _mm256_xor_si256(_mm256_xor_si256(hi1, x[g][1]), key0);
+            x[g][1] = lo1;
+            x[g][2] = _mm256_xor_si256(_mm256_xor_si256(hi0, x[g][3]), key1);
+            x[g][3] = lo0;
+        }
+        k0 += kPhiloxW0;
+        k1 += kPhiloxW1;
+    }
+    // Back to block order: (x0 | x1 << 32, x2 | x3 << 32) per block
+    for (int g = 0; g < G; g++) {
+        __m256i lo01 = _mm256_unpacklo_epi32(x[g][0], x[g][1]), hi01 = _mm256_unpackhi_epi32(x[g][0], x[g][1]);
+        __m256i lo23 = _mm256_unpacklo_epi32(x[g][2], x[g][3]), hi23 = _mm256_unpackhi_epi32(x[g][2], x[g][3]);
+        __m256i b04 = _mm256_unpacklo_epi64(lo01, lo23), b15 = _mm256_unpackhi_epi64(lo01, lo23);
+        __m256i b26 = _mm256_unpacklo_epi64(hi01, hi23), b37 = _mm256_unpackhi_epi64(hi01, hi23);
+        __m256i* o = reinterpret_cast<__m256i*>(out + 16 * g);
+        _mm256_storeu_si256(o, _mm256_permute2x128_si256(b04, b15, 0x20));
+        _mm256_storeu_si256(o + 1, _mm256_permute2x128_si256(b26, b37, 0x20));
+        _mm256_storeu_si256(o + 2, _mm256_permute2x128_si256(b04, b15, 0x31));
+        _mm256_storeu_si256(o + 3, _mm256_permute2x128_si256(b26, b37, 0x31));
+    }
+}
+
+} // namespace fast_random_avx2
+
+inline void Philox4x32::blocksAvx2(uint64_t firstBlock, size_t blocks, uint64_t* out) const {
+    size_t b = 0;
+    for (; b + 16 <= blocks; b += 16, out += 32) fast_random_avx2::philoxBlocks<2>(firstBlock + b, seed, stream, out);
+    for (; b + 8 <= blocks; b += 8, out += 16) fast_random_avx2::philoxBlocks<1>(firstBlock + b, seed, stream, out);
+    blocksScalar(firstBlock + b, blocks - b, out);
+}
+SIMD_END_TARGET
+#endif
+
+/**
+ * @brief Unbiased value in [0, range) from a 64-bit generator (Lemire).
+ *        range 0 means the full 64 bits.
+ */
+template<typename Rng>
+uint64_t boundedRandom(Rng& rng, uint64_t range) {
+    static_assert(Rng::min() == 0 && Rng::max() == std::numeric_limits<uint64_t>::max(),
+                  "boundedRandom needs a generator of full 64-bit values");
+    if (range == 0) return rng();
+    uint64_t lo;
+    uint64_t hi = fast_random_detail::mulHiLo(rng(), range, lo);
+    if (lo < range) {
+        // 2^64 mod range: the draws that would make some results more likely
+        uint64_t threshold = (0 - range) % range;
+        while (lo < threshold) hi = fast_random_detail::mulHiLo(rng(), range, lo);
+    }
+    return hi;
+}
+
+/**
+ * @brief Unbiased integer in [min, max].
+ */
+template<typename Int, typename Rng>
+Int uniformInt(Rng& rng, Int min, Int max) {
+    static_assert(std::is_integral<Int>::value && sizeof(Int) <= 8, "uniformInt needs an integer of up to 64 bits");
+    typedef typename std::make_unsigned<Int>::type U;
+    uint64_t range = static_cast<uint64_t>(static_cast<U>(max) - static_cast<U>(min)) + 1;
+    return static_cast<Int>(static_cast<U>(min) + static_cast<U>(boundedRandom(rng, range)));
+}
+
+/**
+ * @brief The top 53 bits of a draw as a double in [0, 1).
+ */
+inline double toUnitDouble(uint64_t bits) {
+    return static_cast<double>(bits >> 11) * (1.0 / 9007199254740992.0);
+}
+
+template<typename Rng>
+double uniformDouble(Rng& rng) {
+    return toUnitDouble(rng());
+}
+
+/**
+ * @brief n unbiased values in [0, range), drawing in bulk with rng.fill().
+ *
+ * A rejected draw (probability below range / 2^64 each) is replaced with
+ * the generator's next value.
+ */
+template<typename Rng>
+void fillBounded(Rng& rng, uint64_t* out, size_t n, uint64_t range) {
+    rng.fill(out, n);
+    if (range == 0) return;
+    uint64_t threshold = (0 - range) % range;
+    for (size_t i = 0; i < n; i++) {
+        uint64_t lo;
+        uint64_t hi = fast_random_detail::mulHiLo(out[i], range, lo);
+        while (lo < threshold) {
+            hi = fast_random_detail::mulHiLo(rng(), range, lo);
+        }
+        out[i] = hi;
+    }
+}
+
+/**
+ * @brief n doubles in [0, 1), drawing in bulk with rng.fill().
+ */
+template<typename Rng>
+void fillUniform(Rng& rng, double* out, size_t n) {
+    const size_t kChunk = 256;
+    uint64_t bits[kChunk];
+    for (size_t i = 0; i < n; i += kChunk) {
+        size_t count = n - i < kChunk ? n - i : kChunk;
+        rng.fill(bits, count);
+        for (size_t j = 0; j < count; j++) out[i + j] = toUnitDouble(bits[j]);
+    }
+}
+
+#endif // FAST_RANDOM_H
@@ -0,0 +1,442 @@
+// Lesson14_fast_random.cpp : This file contains the 'main' function. Program execution begins and ends there.
+//
+// Throughput in GB/s of the generators in "Lesson14  - Random number
+// Generation.md", std::mt19937 and the generators in FastRandom.h, one
+// value per call and with fill(); then bounded integers, modulo against
+// Lemire's method; then a Monte Carlo estimate of pi split into Philox
+// streams, which gives the same answer for any number of threads.
+//
+// Usage: Lesson14_fast_random [megabytes] [samples]
+//   Defaults: 512 MB per generator, 200000000 Monte Carlo samples.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FastRandom.h"
+
+// The three generators from the lesson, as written there
+
+class LinearCongruentialGenerator {
+private:
+    uint64_t state;
+    const uint64_t a = 1664525;
+    const uint64_t c = 1013904223;
+    const uint64_t m = 0xFFFFFFFF;  // 2^32
+
+public:
+    LinearCongruentialGenerator(uint64_t seed = 1) : state(seed) {}
+
+    uint32_t next() {
+        state = (a * state + c) % m;
+        return state;
+    }
+
+    // Generate a number in range [min, max]
+    int32_t nextInRange(int32_t min, int32_t max) {
+        return min + (next() % (max - min + 1));
+    }
+};
+
+class MersenneTwister {
+private:
+    static const int N = 624;
+    static const int M = 397;
+    uint32_t mt[N];
+    int index;
+
+    void twist() {
+        const uint32_t MATRIX_A = 0x9908b0df;
+        const uint32_t UPPER_MASK = 0x80000000;
+        const uint32_t LOWER_MASK = 0x7fffffff;
+
+        for (int i = 0; i < N; i++) {
+            uint32_t x = (mt[i] & UPPER_MASK) + (mt[(i + 1) % N] & LOWER_MASK);
+            uint32_t xA = x >> 1;
+            if (x % 2) xA ^= MATRIX_A;
+            mt[i] = mt[(i + M) % N] ^ xA;
+        }
+        index = 0;
+    }
+
+public:
+    MersenneTwister(uint32_t seed = 5489) {
+        mt[0] = seed;
+        for (int i = 1; i < N; i++) {
+            mt[i] = 1812433253UL * (mt[i-1] ^ (mt[i-1] >> 30)) + i;
+        }
+        index = N;
+    }
+
+    uint32_t next() {
+        if (index >= N) twist();
+
+        uint32_t y = mt[index++];
+        y ^= (y >> 11);
+        y ^= (y << 7) & 0x9d2c5680;
+        y ^= (y << 15) & 0xefc60000;
+        y ^= (y >> 18);
+
+        return y;
+    }
+};
+
+class SubtractWithCarryGenerator {
+private:
+    static const int LAG = 24;
+    uint32_t state[LAG];
+    int index;
+    int carry;
+
+public:
+    SubtractWithCarryGenerator(uint32_t seed = 12345) {
+        // Initialize state using LCG
+        uint32_t lcg = seed;
+        for (int i = 0; i < LAG; i++) {
+            lcg = 1664525 * lcg + 1013904223;
+            state[i] = lcg;
+        }
+        index = 0;
+        carry = 0;
+    }
+
+    uint32_t next() {
+        const int SHORT_LAG = 10;
+        uint32_t result = state[(index + LAG - SHORT_LAG) % LAG] -
+                         state[index] - carry;
+
+        carry = (result > state[(index + LAG - SHORT_LAG) % LAG]) ? 1 : 0;
+        state[index] = result;
+        index = (index + 1) % LAG;
+
+        return result;
+    }
+};
+
+typedef std::chrono::steady_clock Clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// The buffer is refilled over and over; 64 KB stays in the L2 cache, so
+// the generator rather than memory sets the speed
+const size_t kBufferWords = 8192;
+uint64_t sink = 0;
+
+// GB/s for fillBuffer(buffer) writing kBufferWords x 8 bytes each call
+double measure(size_t megabytes, const std::function<void(uint64_t*)>& fillBuffer) {
+    std::vector<uint64_t> buffer(kBufferWords);
+    size_t rounds = std::max<size_t>(1, megabytes * 1024 * 1024 / (kBufferWords * 8));
+    auto start = Clock::now();
+    for (size_t r = 0; r < rounds; r++) {
+        fillBuffer(buffer.data());
+        sink += buffer[r % kBufferWords];
+    }
+    return rounds * kBufferWords * 8 / secondsSince(start) / 1e9;
+}
+
+// A 32-bit generator filling the buffer one next() at a time
+template<typename Next>
+void fill32(uint64_t* out, Next next) {
+    for (size_t i = 0; i < kBufferWords; i++) {
+        uint64_t low = next();
+        out[i] = low | static_cast<uint64_t>(next()) << 32;
+    }
+}
+
+// Monte Carlo estimate of pi from samples points in the unit square.
+// Chunk c of kChunkSamples points uses Philox stream c, and the chunks'
+// hit counts are added as integers, so the split between threads cannot
+// change the result.
+const uint64_t kChunkSamples = 1 << 20;
+
+double estimatePi(uint64_t samples, int threads, uint64_t seed) {
+    uint64_t chunks = (samples + kChunkSamples - 1) / kChunkSamples;
+    std::atomic<uint64_t> nextChunk(0), hits(0);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&]() {
+            std::vector<double> xy(2048);
+            uint64_t myHits = 0;
+            for (uint64_t c; (c = nextChunk++) < chunks;) {
+                Philox4x32 rng(seed, c);
+                uint64_t points = std::min(kChunkSamples, samples - c * kChunkSamples);
+                for (uint64_t done = 0; done < points;) {
+                    size_t count = static_cast<size_t>(std::min<uint64_t>(xy.size() / 2, points - done));
+                    fillUniform(rng, xy.data(), 2 * count);
+                    for (size_t i = 0; i < count; i++) {
+                        double x = xy[2 * i], y = xy[2 * i + 1];
+                        myHits += x * x + y * y < 1.0;
+                    }
+                    done += count;
+                }
+            }
+            hits += myHits;
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    return 4.0 * hits / samples;
+}
+
+// Fraction of bounded(rng) draws below half of range. For an unbiased
+// method that is 1/2; modulo with range = 3/4 of 2^64 gives 5/8.
+template<typename Draw>
+double fractionBelowHalf(uint64_t range, size_t draws, Draw draw) {
+    size_t below = 0;
+    for (size_t i = 0; i < draws; i++) {
+        uint64_t v = draw();
+        if (v >= range) throw std::logic_error("bounded value out of range");
+        below += v < range / 2;
+    }
+    return static_cast<double>(below) / draws;
+}
+
+void sanityCheck() {
+    // Reference values: the xoshiro256++ formula on the state {1, 2, 3, 4},
+    // and the Philox4x32-10 known-answer tests from Random123
+    if (Xoshiro256pp(std::array<uint64_t, 4>{ { 1, 2, 3, 4 } }).next() != (5ull << 23) + 1) throw std::logic_error("xoshiro256++ wrong");
+    struct { Philox4x32::Block counter; uint64_t key; Philox4x32::Block expected; } kats[] = {
+        { { { 0, 0, 0, 0 } }, 0, { { 0x6627E8D5, 0xE169C58D, 0xBC57AC4C, 0x9B00DBD8 } } },
+        { { { 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF } }, 0xFFFFFFFFFFFFFFFFull,
+          { { 0x408F276D, 0x41C83B0E, 0xA20BC7C6, 0x6D5451FD } } },
+        { { { 0x243F6A88, 0x85A308D3, 0x13198A2E, 0x03707344 } }, 0x299F31D0A4093822ull,
+          { { 0xD16CFE09, 0x94FDCCEB, 0x5001E420, 0x24126EA1 } } },
+    };
+    for (const auto& kat : kats) {
+        if (Philox4x32::encrypt(kat.counter, kat.key) != kat.expected) throw std::logic_error("Philox4x32 wrong");
+    }
+
+    // Jumping is linear: jumping then stepping n times must land where
+    // stepping then jumping does, and the jumped stream must be different
+    for (int longJump = 0; longJump < 2; longJump++) {
+        Xoshiro256pp stepFirst(42), jumpFirst(42);
+        uint64_t before = Xoshiro256pp(42).next();
+        for (int i = 0; i < 1000; i++) stepFirst.next();
+        if (longJump) {
+            stepFirst.longJump();
+            jumpFirst.longJump();
+        } else {
+            stepFirst.jump();
+            jumpFirst.jump();
+        }
+        if (Xoshiro256pp(jumpFirst).next() == before) throw std::logic_error("jump did not move the stream");
+        for (int i = 0; i < 1000; i++) jumpFirst.next();
+        if (stepFirst.state() != jumpFirst.state()) throw std::logic_error("jump is not a fixed skip");
+    }
+
+    // Xoshiro256ppX8: lane k is Xoshiro256pp after k jumps, on every
+    // instruction set, across fill() calls of awkward lengths mixed with
+    // single values
+    std::vector<SimdLevel> levels = { SimdLevel::Scalar };
+    if (detectSimdLevel() == SimdLevel::AVX2) levels.push_back(SimdLevel::AVX2);
+    for (SimdLevel level : levels) {
+        Xoshiro256ppX8 bulk(9, level);
+        std::vector<Xoshiro256pp> lanes;
+        Xoshiro256pp lane(9);
+        for (int k = 0; k < Xoshiro256ppX8::kLanes; k++, lane.jump()) lanes.push_back(lane);
+        size_t position = 0;
+        for (size_t n : { 8, 64, 5, 1000, 0, 13, 1, 1, 3 }) {
+            std::vector<uint64_t> out(n);
+            if (n == 1) {
+                out[0] = bulk();
+            } else {
+                bulk.fill(out.data(), n);
+            }
+            for (size_t i = 0; i < n; i++, position++) {
+                if (out[i] != lanes[position % 8].next()) {
+                    throw std::logic_error(std::string("Xoshiro256ppX8 wrong with ") + simdLevelName(level));
+                }
+            }
+        }
+    }
+
+    // Philox4x32::fill() gives exactly the values of next(), from odd
+    // positions and across the 2^32 block boundary
+    for (SimdLevel level : levels) {
+        for (uint64_t start : { 0ull, 1ull, 2 * 0xFFFFFFF0ull + 1 }) {
+            Philox4x32 bulk(5, 3, level), single(5, 3, level);
+            bulk.discard(start);
+            single.discard(start);
+            for (size_t n : { 1, 2, 37, 40, 0, 301 }) {
+                std::vector<uint64_t> out(n);
+                bulk.fill(out.data(), n);
+                for (size_t i = 0; i < n; i++) {
+                    if (out[i] != single.next()) {
+                        throw std::logic_error(std::string("Philox4x32::fill wrong with ") + simdLevelName(level));
+                    }
+                }
+            }
+        }
+    }
+    Philox4x32 streamA(5, 0), streamB(5, 1), skipped(5, 0);
+    skipped.discard(1000);
+    for (int i = 0; i < 1000; i++) streamA.next();
+    if (streamA.next() != skipped.next() || Philox4x32(5, 0).next() == streamB.next()) {
+        throw std::logic_error("Philox4x32 streams or discard wrong");
+    }
+
+    // Bounded values: small ranges hit every value evenly, and for a range
+    // of 3/4 of 2^64 (where modulo would give 5/8) half the values fall
+    // below half the range
+    Xoshiro256pp rng(11);
+    for (uint64_t range : { 1, 6, 1000 }) {
+        std::vector<size_t> counts(range);
+        const size_t draws = 600000;
+        for (size_t i = 0; i < draws; i++) {
+            uint64_t v = boundedRandom(rng, range);
+            if (v >= range) throw std::logic_error("boundedRandom out of range");
+            counts[v]++;
+        }
+        double expected = static_cast<double>(draws) / range;
+        for (size_t c : counts) {
+            if (std::abs(c - expected) > 6 * std::sqrt(expected)) throw std::logic_error("boundedRandom uneven");
+        }
+    }
+    const uint64_t big = 3ull << 62;
+    const size_t draws = 200000;
+    double lemire = fractionBelowHalf(big, draws, [&]() { return boundedRandom(rng, big); });
+    std::vector<uint64_t> bulkBounded(draws);
+    Xoshiro256ppX8 bulk(12);
+    fillBounded(bulk, bulkBounded.data(), draws, big);
+    size_t i = 0;
+    double bulkFraction = fractionBelowHalf(big, draws, [&]() { return bulkBounded[i++]; });
+    double modulo = fractionBelowHalf(big, draws, [&]() { return rng() % big; });
+    if (std::abs(lemire - 0.5) > 0.01 || std::abs(bulkFraction - 0.5) > 0.01 || std::abs(modulo - 0.625) > 0.01) {
+        throw std::logic_error("bounded values biased");
+    }
+
+    bool seen[7] = {};
+    for (int n = 0; n < 1000; n++) {
+        int v = uniformInt(rng, -3, 3);
+        if (v < -3 || v > 3) throw std::logic_error("uniformInt out of range");
+        seen[v + 3] = true;
+    }
+    if (std::count(seen, seen + 7, true) != 7) throw std::logic_error("uniformInt missed a value");
+    uniformInt(rng, std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max());
+    uniformInt(rng, std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::max());
+    std::vector<double> unit(1000);
+    fillUniform(bulk, unit.data(), unit.size());
+    for (double u : unit) {
+        if (u < 0 || u >= 1) throw std::logic_error("fillUniform out of [0, 1)");
+    }
+    std::uniform_real_distribution<double> distribution(0, 1);
+    if (distribution(rng) >= 1) throw std::logic_error("not usable with <random>");
+
+    // The Monte Carlo result depends on the seed, not on the thread count
+    double pi = estimatePi(5000000, 1, 7);
+    if (estimatePi(5000000, 3, 7) != pi || estimatePi(5000000, 4, 7) != pi || std::abs(pi - 3.14159) > 0.01) {
+        throw std::logic_error("Monte Carlo estimate not reproducible");
+    }
+
+    std::cout << "Sanity check passed\n\n";
+}
+
+int main(int argc, char* argv[]) {
+    size_t megabytes = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 512;
+    uint64_t samples = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 200000000;
+
+    sanityCheck();
+
+    std::cout << "Hardware threads: " << std::thread::hardware_concurrency() << ", "
+              << simdLevelName(detectSimdLevel()) << "\n";
+    std::cout << "Random bytes per second, " << megabytes << " MB per generator\n\n";
+    std::cout << std::left << std::setw(40) << "generator" << std::right << std::setw(10) << "GB/s" << "\n";
+
+    LinearCongruentialGenerator lcg;
+    MersenneTwister twister;
+    SubtractWithCarryGenerator swc;
+    std::mt19937 mt32;
+    std::mt19937_64 mt64;
+    Xoshiro256pp xoshiro(1);
+    Xoshiro256ppX8 xoshiroScalar(1, SimdLevel::Scalar), xoshiroBest(1);
+    Philox4x32 philoxScalar(1, 0, SimdLevel::Scalar), philoxBest(1);
+
+    std::string best = std::string(simdLevelName(detectSimdLevel())) + ")";
+    struct { std::string name; std::function<void(uint64_t*)> fill; } generators[] = {
+        { "LinearCongruentialGenerator::next", [&](uint64_t* out) { fill32(out, [&]() { return lcg.next(); }); } },
+        { "MersenneTwister::next", [&](uint64_t* out) { fill32(out, [&]() { return twister.next(); }); } },
+        { "SubtractWithCarryGenerator::next", [&](uint64_t* out) { fill32(out, [&]() { return swc.next(); }); } },
+        { "std::mt19937", [&](uint64_t* out) { fill32(out, [&]() { return static_cast<uint32_t>(mt32()); }); } },
+        { "std::mt19937_64", [&](uint64_t* out) { for (size_t i = 0; i < kBufferWords; i++) out[i] = mt64(); } },
+        { "Xoshiro256pp::next", [&](uint64_t* out) { for (size_t i = 0; i < kBufferWords; i++) out[i] = xoshiro(); } },
+        { "Xoshiro256pp::fill", [&](uint64_t* out) { xoshiro.fill(out, kBufferWords); } },
+        { "Xoshiro256ppX8::fill (scalar)", [&](uint64_t* out) { xoshiroScalar.fill(out, kBufferWords); } },
+        { "Xoshiro256ppX8::fill (" + best, [&](uint64_t* out) { xoshiroBest.fill(out, kBufferWords); } },
+        { "Philox4x32::next", [&](uint64_t* out) { for (size_t i = 0; i < kBufferWords; i++) out[i] = philoxScalar(); } },
+        { "Philox4x32::fill (scalar)", [&](uint64_t* out) { philoxScalar.fill(out, kBufferWords); } },
+        { "Philox4x32::fill (" + best, [&](uint64_t* out) { philoxBest.fill(out, kBufferWords); } },
+    };
+    for (const auto& generator : generators) {
+        std::cout << std::left << std::setw(40) << generator.name << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(10) << measure(megabytes, generator.fill) << "\n";
+    }
+
+    // Bounded integers in [0, 1000): the lesson's modulo against Lemire
+    const int32_t range = 1000;
+    std::uniform_int_distribution<int32_t> distribution(0, range - 1);
+    std::vector<uint64_t> buffer(kBufferWords);
+    size_t values = megabytes * 1024 * 1024 / 8;
+    struct { std::string name; std::function<void()> fill; } bounded[] = {
+        { "LinearCongruentialGenerator::nextInRange", [&]() {
+              for (size_t i = 0; i < kBufferWords; i++) buffer[i] = lcg.nextInRange(0, range - 1);
+          } },
+        { "std::uniform_int_distribution, mt19937", [&]() {
+              for (size_t i = 0; i < kBufferWords; i++) buffer[i] = distribution(mt32);
+          } },
+        { "boundedRandom, Xoshiro256pp", [&]() {
+              for (size_t i = 0; i < kBufferWords; i++) buffer[i] = boundedRandom(xoshiro, range);
+          } },
+        { "fillBounded, Xoshiro256ppX8", [&]() { fillBounded(xoshiroBest, buffer.data(), kBufferWords, range); } },
+    };
+    std::cout << "\nValues in [0, " << range << ") per second\n\n";
+    std::cout << std::left << std::setw(40) << "method" << std::right << std::setw(10) << "M/s" << "\n";
+    for (const auto& method : bounded) {
+        size_t rounds = std::max<size_t>(1, values / kBufferWords);
+        auto start = Clock::now();
+        for (size_t r = 0; r < rounds; r++) {
+            method.fill();
+            sink += buffer[r % kBufferWords];
+        }
+        std::cout << std::left << std::setw(40) << method.name << std::right << std::setw(10)
+                  << rounds * kBufferWords / secondsSince(start) / 1e6 << "\n";
+    }
+
+    std::cout << "\nMonte Carlo pi, " << samples << " samples, one Philox stream per " << kChunkSamples
+              << " samples\n\n";
+    std::cout << std::left << std::setw(10) << "threads" << std::right << std::setw(14) << "estimate"
+              << std::setw(14) << "Msamples/s" << "\n";
+    int maxThreads = std::max(4, static_cast<int>(std::thread::hardware_concurrency()));
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        auto start = Clock::now();
+        double pi = estimatePi(samples, threads, 2024);
+        double seconds = secondsSince(start);
+        std::cout << std::left << std::setw(10) << threads << std::right << std::setprecision(8) << std::setw(14)
+                  << pi << std::setprecision(1) << std::setw(14) << samples / seconds / 1e6 << "\n";
+    }
+
+    std::cout << "\n(checksum " << sink % 1000 << ")\n";
+    return 0;
+}
+
+// Run program: Ctrl + F5 or Debug > Start Without Debugging menu
+// Debug program: F5 or Debug > Start Debugging menu
+
+// Tips for Getting Started:
+//   1. Use the Solution Explorer window to add/manage files
+//   2. Use the Team Explorer window to connect to source control
+//   3. Use the Output window to see build output and other messages
+//   4. Use the Error List window to view errors
+//   5. Go to Project > Add New Item to create new code files, or Project > Add Existing Item to add existing code files to the project
+//   6. In the future, to open this project again, go to File > Open > Project and select the .sln file
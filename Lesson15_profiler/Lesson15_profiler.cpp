@@ -0,0 +1,310 @@
+// Lesson15_profiler.cpp : This file contains the 'main' function. Program execution begins and ends there.
+//
+// Cost of a PROFILE_ZONE, then the instrumented sorts from
+// Lesson12_parallel_sort and FlatHashMap from Lesson10_flat_hash_map run
+// with recording off and on. The dictionary benchmark adds a zone around
+// every insert and find, so the difference in time divided by the number
+// of zones is the cost per zone in real code. Finishes with the per-zone
+// latency table and writes a Chrome trace of the sorts.
+//
+// Usage: Lesson15_profiler [elements] [trace.json]
+//   Defaults: 4000000 elements, trace written to profile_trace.json.
+
+// Zones are compiled in for this program only
+#define PROFILER_ENABLED 1
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Profiler.h"
+#include "../Lesson10_flat_hash_map/FlatHashMap.h"
+#include "../Lesson12_parallel_sort/ParallelSort.h"
+
+typedef std::chrono::steady_clock Clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+size_t countOf(const std::string& text, const std::string& pattern) {
+    size_t count = 0;
+    for (size_t at = text.find(pattern); at != std::string::npos; at = text.find(pattern, at + 1)) count++;
+    return count;
+}
+
+void sanityCheck() {
+    Profiler::collect();
+
+    // Nesting: depths, names and intervals inside their parent's
+    {
+        PROFILE_ZONE("outer");
+        for (int i = 0; i < 3; i++) {
+            PROFILE_ZONE("inner");
+            PROFILE_ZONE("innermost");
+        }
+    }
+    std::vector<ZoneEvent> events = Profiler::collect();
+    if (events.size() != 7) throw std::logic_error("expected 7 events, got " + std::to_string(events.size()));
+    const ZoneEvent& outer = events.back();
+    if (std::string(outer.name) != "outer" || outer.depth != 0) throw std::logic_error("outer zone wrong");
+    for (size_t i = 0; i < 6; i++) {
+        bool innermost = i % 2 == 0;
+        const ZoneEvent& e = events[i];
+        if (std::string(e.name) != (innermost ? "innermost" : "inner") || e.depth != (innermost ? 2u : 1u) ||
+            e.start > e.end || e.start < outer.start || e.end > outer.end || e.thread != outer.thread) {
+            throw std::logic_error("nested zone " + std::to_string(i) + " wrong");
+        }
+    }
+
+    // Switched off at run time: nothing is recorded
+    Profiler::setEnabled(false);
+    {
+        PROFILE_ZONE("invisible");
+    }
+    Profiler::setEnabled(true);
+    if (!Profiler::collect().empty()) throw std::logic_error("disabled zone recorded");
+
+    // Several threads, collected while they run
+    const int threads = 4, perThread = 20000;
+    std::vector<std::thread> workers;
+    std::atomic<int> finished(0);
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&]() {
+            for (int i = 0; i < perThread; i++) {
+                PROFILE_ZONE("worker");
+            }
+            finished++;
+        });
+    }
+    std::vector<ZoneEvent> all;
+    while (finished < threads) {
+        std::vector<ZoneEvent> some = Profiler::collect();
+        all.insert(all.end(), some.begin(), some.end());
+    }
+    for (auto& worker : workers) worker.join();
+    std::vector<ZoneEvent> rest = Profiler::collect();
+    all.insert(all.end(), rest.begin(), rest.end());
+    std::map<uint32_t, int> perThreadCount;
+    for (const ZoneEvent& e : all) perThreadCount[e.thread]++;
+    if (all.size() + Profiler::dropped() != static_cast<size_t>(threads * perThread) ||
+        perThreadCount.size() != static_cast<size_t>(threads) || perThreadCount.count(outer.thread) != 0) {
+        throw std::logic_error("events lost or attributed to the wrong thread");
+    }
+
+    // A full ring drops new events and counts them (a fresh thread gets a
+    // ring of the new capacity)
+    Profiler::setRingCapacity(1024);
+    uint64_t droppedBefore = Profiler::dropped();
+    std::thread([]() {
+        for (int i = 0; i < 1100; i++) {
+            PROFILE_ZONE("overflow");
+        }
+    }).join();
+    if (Profiler::collect().size() != 1024 || Profiler::dropped() - droppedBefore != 76) {
+        throw std::logic_error("full ring not handled");
+    }
+    Profiler::setRingCapacity(size_t(1) << 16);
+
+    // Calibrated durations: a 20 ms sleep takes at least 20 ms
+    {
+        PROFILE_ZONE("sleep \"20 ms\"");
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    events = Profiler::collect();
+    double sleptNs = Profiler::durationNanoseconds(events.at(0));
+    if (sleptNs < 19.5e6 || sleptNs > 1e9) throw std::logic_error("sleep measured as " + std::to_string(sleptNs) + " ns");
+
+    // Outputs: one JSON object per event, names escaped; one histogram per name
+    std::ostringstream json;
+    writeChromeTrace(json, all);
+    writeChromeTrace(json, events);
+    if (countOf(json.str(), "\"ph\":\"X\"") != all.size() + 1 || countOf(json.str(), "sleep \\\"20 ms\\\"") != 1) {
+        throw std::logic_error("Chrome trace wrong");
+    }
+    ZoneStatistics statistics;
+    statistics.add(all);
+    statistics.add(events);
+    if (statistics.zones().size() != 2 || statistics.zones().at("worker").totalCount() != all.size()) {
+        throw std::logic_error("zone statistics wrong");
+    }
+
+    std::cout << "Sanity check passed\n\n";
+}
+
+// ns per iteration of body, over batches of kBatch iterations with the
+// rings drained between batches (not timed) into statistics, if given.
+// Best of 5 runs.
+const size_t kBatch = 20000;
+
+template<typename Body>
+double nsPerIteration(size_t iterations, Body body, ZoneStatistics* statistics = nullptr) {
+    double best = 1e300;
+    for (int run = 0; run < 5; run++) {
+        double seconds = 0;
+        for (size_t done = 0; done < iterations; done += kBatch) {
+            auto start = Clock::now();
+            body(std::min(kBatch, iterations - done));
+            seconds += secondsSince(start);
+            std::vector<ZoneEvent> events = Profiler::collect();
+            if (statistics != nullptr) statistics->add(events);
+        }
+        best = std::min(best, seconds * 1e9 / iterations);
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    size_t elements = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 4000000;
+    std::string tracePath = argc > 2 ? argv[2] : "profile_trace.json";
+
+    sanityCheck();
+
+    std::cout << "Hardware threads: " << std::thread::hardware_concurrency() << ", clock: " << Profiler::clockName()
+              << ", " << std::setprecision(4) << 1.0 / profiler_detail::calibration().nsPerTick << " ticks per ns\n\n";
+
+    // An empty zone, best of several runs
+    volatile uint64_t counter = 0;
+    const size_t zones = 2000000;
+    double baseline = nsPerIteration(zones, [&](size_t n) {
+        for (size_t i = 0; i < n; i++) counter = counter + 1;
+    });
+    double clockRead = nsPerIteration(zones, [&](size_t n) {
+        for (size_t i = 0; i < n; i++) counter = counter + profiler_detail::now();
+    });
+    Profiler::setEnabled(false);
+    double disabled = nsPerIteration(zones, [&](size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            PROFILE_ZONE("empty");
+            counter = counter + 1;
+        }
+    });
+    Profiler::setEnabled(true);
+    double enabled = nsPerIteration(zones, [&](size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            PROFILE_ZONE("empty");
+            counter = counter + 1;
+        }
+    });
+    std::cout << "Cost of an empty zone (ns)\n";
+    std::cout << std::left << std::setw(36) << "  compiled out (no zone at all)" << std::right << std::fixed
+              << std::setprecision(2) << std::setw(8) << 0.0 << "\n";
+    std::cout << std::left << std::setw(36) << "  setEnabled(false)" << std::right << std::setw(8)
+              << disabled - baseline << "\n";
+    // The profiler's own work per zone: everything but the two clock reads,
+    // which cost what the CPU (or hypervisor) makes rdtsc cost
+    double clockReads = 2 * (clockRead - baseline);
+    double bookkeeping = enabled - baseline - clockReads;
+    std::cout << std::left << std::setw(36) << "  recording" << std::right << std::setw(8) << enabled - baseline
+              << (enabled - baseline < 20.0 ? "   (within the 20 ns budget)" : "   (over the 20 ns budget)") << "\n";
+    std::cout << std::left << std::setw(36) << "    two clock reads" << std::right << std::setw(8) << clockReads
+              << "\n";
+    std::cout << std::left << std::setw(36) << "    the rest of the zone" << std::right << std::setw(8)
+              << bookkeeping << (bookkeeping < 20.0 ? "   (within the 20 ns budget)" : "   (over the 20 ns budget)")
+              << "\n\n";
+    if (bookkeeping >= 20.0) {
+        throw std::runtime_error("a zone costs " + std::to_string(bookkeeping) + " ns on top of its clock reads");
+    }
+
+    // The instrumented sorts: few zones, so recording should not be visible
+    ThreadPool pool;
+    std::mt19937 rng(12345);
+    std::vector<int32_t> original(elements);
+    for (int32_t& v : original) v = static_cast<int32_t>(rng());
+    std::vector<ZoneEvent> sortEvents;
+    std::cout << std::left << std::setw(22) << "instrumented code" << std::right << std::setw(12) << "off ms"
+              << std::setw(12) << "on ms" << std::setw(12) << "zones" << std::setw(16) << "ns per zone" << "\n";
+    struct { std::string name; std::function<void(std::vector<int32_t>&)> sort; } sorts[] = {
+        { "parallelIntrosort", [&](std::vector<int32_t>& v) { parallelIntrosort(v.begin(), v.end(), pool); } },
+        { "parallelMergeSort", [&](std::vector<int32_t>& v) { parallelMergeSort(v.begin(), v.end(), pool); } },
+    };
+    for (const auto& sort : sorts) {
+        double seconds[2] = { 1e300, 1e300 };
+        size_t zoneCount = 0;
+        for (int run = 0; run < 6; run++) {
+            bool on = run % 2 == 1;
+            Profiler::setEnabled(on);
+            std::vector<int32_t> data = original;
+            auto start = Clock::now();
+            sort.sort(data);
+            seconds[on] = std::min(seconds[on], secondsSince(start));
+            if (!std::is_sorted(data.begin(), data.end())) throw std::logic_error(sort.name + " did not sort");
+            std::vector<ZoneEvent> events = Profiler::collect();
+            zoneCount = events.size();
+            if (run == 5) sortEvents.insert(sortEvents.end(), events.begin(), events.end());
+        }
+        std::cout << std::left << std::setw(22) << sort.name << std::right << std::setprecision(2) << std::setw(12)
+                  << seconds[0] * 1e3 << std::setw(12) << seconds[1] * 1e3 << std::setw(12) << zoneCount
+                  << std::setw(16);
+        // Too few zones to separate their cost from run-to-run noise
+        if (zoneCount < 1000) std::cout << "-" << "\n";
+        else std::cout << (seconds[1] - seconds[0]) * 1e9 / zoneCount << "\n";
+    }
+    Profiler::setEnabled(true);
+
+    // The dictionary with a zone around every operation
+    size_t keys = std::min<size_t>(elements, 1000000);
+    ZoneStatistics dictionaryStatistics;
+    double dictionary[2];
+    for (int on = 0; on < 2; on++) {
+        Profiler::setEnabled(on == 1);
+        FlatHashMap<uint64_t, uint64_t> map;
+        uint64_t next = 0;
+        dictionary[on] = nsPerIteration(keys, [&](size_t n) {
+            size_t found = 0;
+            for (size_t i = 0; i < n; i++, next++) {
+                {
+                    PROFILE_ZONE("FlatHashMap::insert");
+                    map.insert(next * 0x9E3779B97F4A7C15ull, next);
+                }
+                {
+                    PROFILE_ZONE("FlatHashMap::find");
+                    found += map.find(next / 2 * 0x9E3779B97F4A7C15ull) != nullptr;
+                }
+            }
+            if (found != n) throw std::logic_error("FlatHashMap lost a key");
+        }, on == 1 ? &dictionaryStatistics : nullptr);
+    }
+    Profiler::setEnabled(true);
+    std::cout << std::left << std::setw(22) << "FlatHashMap ops" << std::right << std::setw(12)
+              << dictionary[0] * keys / 1e6 << std::setw(12) << dictionary[1] * keys / 1e6 << std::setw(12)
+              << 2 * keys << std::setw(16) << (dictionary[1] - dictionary[0]) / 2 << "\n\n";
+
+    ZoneStatistics sortStatistics;
+    sortStatistics.add(sortEvents);
+    std::cout << "Zones of the last sorts\n";
+    sortStatistics.print(std::cout);
+    std::cout << "\nZones of the FlatHashMap runs\n";
+    dictionaryStatistics.print(std::cout);
+
+    std::ofstream trace(tracePath);
+    writeChromeTrace(trace, sortEvents);
+    std::cout << "\n" << sortEvents.size() << " events written to " << tracePath << ", "
+              << Profiler::dropped() << " dropped in total\n";
+
+    return 0;
+}
+
+// Run program: Ctrl + F5 or Debug > Start Without Debugging menu
+// Debug program: F5 or Debug > Start Debugging menu
+
+// Tips for Getting Started:
+//   1. Use the Solution Explorer window to add/manage files
+//   2. Use the Team Explorer window to connect to source control
+//   3. Use the Output window to see build output and other messages
+//   4. Use the Error List window to view errors
+//   5. Go to Project > Add New Item to create new code files, or Project > Add Existing Item to add existing code files to the project
+//   6. In the future, to open this project again, go to File > Open > Project and select the .sln file
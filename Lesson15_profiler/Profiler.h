@@ -0,0 +1,389 @@
+// Profiler.h
+//
+// Scoped timing zones cheap enough to leave in hot code.
+//
+// "Lesson15 - chrono.md" times code with a pair of steady_clock::now()
+// calls and prints the difference. That works for one measurement; for a
+// program with many threads and many timed regions you want the timings
+// recorded, not printed, and looked at afterwards. Here a zone is declared
+// with a macro and times the rest of its scope:
+//
+//   void rehash() {
+//       PROFILE_ZONE("FlatHashMap::rehash");
+//       ...
+//   }
+//
+// When the scope ends, the zone's name, thread, nesting depth and start and
+// end timestamps go into a ring buffer owned by the thread: no lock, no
+// allocation and no shared cache line is touched on the hot path. Some
+// other thread calls Profiler::collect() now and then to drain the rings,
+// and the events can be written as Chrome trace-event JSON (open it at
+// chrome://tracing or ui.perfetto.dev) or summarised per zone in latency
+// histograms (ZoneStatistics). A ring that fills up before it is drained
+// drops new events and counts them, rather than blocking the program.
+//
+// Timestamps come from the CPU's time-stamp counter (rdtsc, a few ns) on
+// x86, converted to nanoseconds with a factor calibrated once against
+// steady_clock; elsewhere, or with PROFILER_USE_STEADY_CLOCK defined, from
+// steady_clock itself.
+//
+// Zones compile to nothing unless PROFILER_ENABLED is defined as 1 before
+// this header is first included, so instrumented code pays nothing in
+// normal builds. Library headers include only ProfilerMacros.h, which
+// pulls this header in just when zones are enabled.
+// Profiler::setEnabled(false) also turns recording off at run time,
+// leaving one relaxed load and a branch per zone.
+//
+// A recorded zone costs two rdtsc reads plus a few stores: the nesting
+// depth lives in a thread_local next to the ring pointer, and the ring
+// itself is written once, when the zone ends. Lesson15_profiler measures
+// both parts and fails if the stores and checks alone reach 20 ns. The
+// whole zone is under 20 ns only where rdtsc runs at its native cost (a
+// few dozen cycles): on a VM that traps rdtsc, reads of about 16 ns each
+// put a zone at about 35 ns.
+//
+// Zone names must be string literals (or otherwise live as long as the
+// events): only the pointer is stored.
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Lesson16_sharded_stats/ShardedStats.h"
+#include "ProfilerMacros.h"
+
+#if !defined(PROFILER_USE_STEADY_CLOCK) && \
+    (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86))
+#define PROFILER_RDTSC 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+/**
+ * @brief One finished zone, with timestamps in clock ticks.
+ */
+struct ZoneEvent {
+    const char* name;
+    uint64_t start;
+    uint64_t end;
+    uint32_t thread;    // 1, 2, ... in the order threads first opened a zone
+    uint32_t depth;     // number of enclosing zones on the same thread
+};
+
+namespace profiler_detail {
+
+inline uint64_t now() {
+#ifdef PROFILER_RDTSC
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+// Single-producer ring: the owning thread pushes, collect() pops
+struct ThreadRing {
+    std::vector<ZoneEvent> slots;
+    size_t mask;
+    uint32_t thread = 0;
+    std::atomic<bool> owned{true};
+
+    alignas(64) std::atomic<uint64_t> head{0};      // written by the owner
+    uint64_t cachedTail = 0;
+    std::atomic<uint64_t> dropped{0};
+    alignas(64) std::atomic<uint64_t> tail{0};      // written by collect()
+
+    explicit ThreadRing(size_t capacity) : slots(capacity), mask(capacity - 1) {}
+
+    void push(const char* name, uint64_t start, uint64_t end, uint32_t zoneDepth) {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        if (h - cachedTail > mask) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (h - cachedTail > mask) {
+                dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return;
+            }
+        }
+        slots[h & mask] = ZoneEvent{ name, start, end, thread, zoneDepth };
+        head.store(h + 1, std::memory_order_release);
+    }
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadRing>> rings;
+    uint32_t threads = 0;
+    size_t capacity = size_t(1) << 16;
+    std::mutex collectMutex;
+};
+
+inline Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+inline std::atomic<bool> enabled{true};
+
+// The thread's ring and its number of open zones, in one thread_local so a
+// zone resolves a single TLS address
+struct ThreadState {
+    ThreadRing* ring = nullptr;
+    uint32_t depth = 0;
+};
+
+inline thread_local ThreadState state;
+
+// Hands the thread's ring back when the thread exits, so a program that
+// keeps starting threads reuses rings instead of growing without bound.
+// The events still in the ring stay there until collected.
+struct RingLease {
+    ThreadRing* ring = nullptr;
+    ~RingLease() {
+        if (ring != nullptr) {
+            state.ring = nullptr;
+            ring->owned.store(false, std::memory_order_release);
+        }
+    }
+};
+
+inline thread_local RingLease lease;
+
+inline ThreadRing* registerThread() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    ThreadRing* ring = nullptr;
+    for (auto& candidate : r.rings) {
+        bool expected = false;
+        if (candidate->slots.size() == r.capacity &&
+            candidate->owned.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            ring = candidate.get();
+            break;
+        }
+    }
+    if (ring == nullptr) {
+        r.rings.push_back(std::make_unique<ThreadRing>(r.capacity));
+        ring = r.rings.back().get();
+    }
+    ring->thread = ++r.threads;
+    lease.ring = ring;
+    state.ring = ring;
+    return ring;
+}
+
+// Ticks -> nanoseconds: ns = base + (ticks - baseTicks) * nsPerTick
+struct Calibration {
+    uint64_t baseTicks;
+    double baseNs;
+    double nsPerTick;
+};
+
+inline const Calibration& calibration() {
+    static const Calibration c = []() {
+        using namespace std::chrono;
+        auto steadyNs = []() {
+            return static_cast<double>(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+        };
+#ifdef PROFILER_RDTSC
+        // Count ticks across 20 ms of steady_clock
+        double startNs = steadyNs();
+        uint64_t startTicks = now();
+        double endNs;
+        do {
+            endNs = steadyNs();
+        } while (endNs - startNs < 20e6);
+        uint64_t endTicks = now();
+        return Calibration{ startTicks, startNs, (endNs - startNs) / static_cast<double>(endTicks - startTicks) };
+#else
+        return Calibration{ 0, 0.0, 1.0 };
+#endif
+    }();
+    return c;
+}
+
+} // namespace profiler_detail
+
+/**
+ * @brief Times its own lifetime as a zone; use PROFILE_ZONE(name).
+ */
+class ProfileZone {
+private:
+    const char* name;
+    profiler_detail::ThreadRing* ring;
+    uint64_t start;
+    uint32_t depth;
+
+public:
+    explicit ProfileZone(const char* name) : name(name), ring(nullptr), start(0), depth(0) {
+        if (!profiler_detail::enabled.load(std::memory_order_relaxed)) return;
+        profiler_detail::ThreadState& state = profiler_detail::state;
+        ring = state.ring != nullptr ? state.ring : profiler_detail::registerThread();
+        depth = state.depth++;
+        start = profiler_detail::now();
+    }
+
+    ~ProfileZone() {
+        if (ring == nullptr) return;
+        uint64_t end = profiler_detail::now();
+        profiler_detail::state.depth = depth;
+        ring->push(name, start, end, depth);
+    }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+};
+
+class Profiler {
+public:
+    static void setEnabled(bool on) { profiler_detail::enabled.store(on, std::memory_order_relaxed); }
+    static bool isEnabled() { return profiler_detail::enabled.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Events per thread ring (rounded up to a power of two), for
+     *        threads that open their first zone after the call.
+     */
+    static void setRingCapacity(size_t events) {
+        size_t capacity = 2;
+        while (capacity < events) capacity <<= 1;
+        profiler_detail::Registry& r = profiler_detail::registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.capacity = capacity;
+    }
+
+    /**
+     * @brief Drain every thread's ring. Safe while zones are being recorded;
+     *        events are in order of completion per thread.
+     */
+    static std::vector<ZoneEvent> collect() {
+        profiler_detail::Registry& r = profiler_detail::registry();
+        std::lock_guard<std::mutex> collecting(r.collectMutex);
+        std::vector<profiler_detail::ThreadRing*> rings;
+        {
+            std::lock_guard<std::mutex> lock(r.mutex);
+            for (auto& ring : r.rings) rings.push_back(ring.get());
+        }
+        std::vector<ZoneEvent> events;
+        for (profiler_detail::ThreadRing* ring : rings) {
+            uint64_t t = ring->tail.load(std::memory_order_relaxed);
+            uint64_t h = ring->head.load(std::memory_order_acquire);
+            for (; t != h; t++) events.push_back(ring->slots[t & ring->mask]);
+            ring->tail.store(t, std::memory_order_release);
+        }
+        return events;
+    }
+
+    /**
+     * @brief Events lost so far because a ring was full.
+     */
+    static uint64_t dropped() {
+        profiler_detail::Registry& r = profiler_detail::registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        uint64_t total = 0;
+        for (auto& ring : r.rings) total += ring->dropped.load(std::memory_order_relaxed);
+        return total;
+    }
+
+    static double toNanoseconds(uint64_t ticks) {
+        const profiler_detail::Calibration& c = profiler_detail::calibration();
+        return c.baseNs + (static_cast<double>(ticks) - static_cast<double>(c.baseTicks)) * c.nsPerTick;
+    }
+
+    static double durationNanoseconds(const ZoneEvent& event) {
+        return static_cast<double>(event.end - event.start) * profiler_detail::calibration().nsPerTick;
+    }
+
+    static const char* clockName() {
+#ifdef PROFILER_RDTSC
+        return "rdtsc";
+#else
+        return "steady_clock";
+#endif
+    }
+};
+
+/**
+ * @brief Write events as Chrome trace-event JSON ("X" complete events,
+ *        times in microseconds from the earliest event).
+ */
+inline void writeChromeTrace(std::ostream& out, const std::vector<ZoneEvent>& events) {
+    uint64_t first = events.empty() ? 0 : events[0].start;
+    for (const ZoneEvent& event : events) first = std::min(first, event.start);
+    double base = Profiler::toNanoseconds(first);
+
+    std::ios_base::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << "{\"traceEvents\":[\n" << std::fixed << std::setprecision(3);
+    for (size_t i = 0; i < events.size(); i++) {
+        const ZoneEvent& event = events[i];
+        out << "{\"name\":\"";
+        for (const char* c = event.name; *c != '\0'; c++) {
+            if (*c == '"' || *c == '\\') {
+                out << '\\' << *c;
+            } else if (static_cast<unsigned char>(*c) < 0x20) {
+                out << "\\u00" << "0123456789abcdef"[*c >> 4] << "0123456789abcdef"[*c & 15];
+            } else {
+                out << *c;
+            }
+        }
+        out << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+            << ",\"ts\":" << (Profiler::toNanoseconds(event.start) - base) / 1000.0
+            << ",\"dur\":" << Profiler::durationNanoseconds(event) / 1000.0 << "}"
+            << (i + 1 < events.size() ? ",\n" : "\n");
+    }
+    out << "],\"displayTimeUnit\":\"ns\"}\n";
+    out.flags(flags);
+    out.precision(precision);
+}
+
+/**
+ * @brief Latency histogram (in ns) of each zone name, built from
+ *        collected events.
+ */
+class ZoneStatistics {
+private:
+    std::map<std::string, HistogramSnapshot> histograms;
+
+public:
+    void add(const std::vector<ZoneEvent>& events) {
+        for (const ZoneEvent& event : events) {
+            histograms[event.name].record(static_cast<uint64_t>(Profiler::durationNanoseconds(event) + 0.5));
+        }
+    }
+
+    const std::map<std::string, HistogramSnapshot>& zones() const { return histograms; }
+
+    /**
+     * @brief One line per zone: count, total, mean and percentiles.
+     */
+    void print(std::ostream& out) const {
+        std::ios_base::fmtflags flags = out.flags();
+        out << std::left << std::setw(32) << "zone" << std::right << std::setw(10) << "count" << std::setw(12)
+            << "total ms" << std::setw(12) << "mean ns" << std::setw(12) << "p50 ns" << std::setw(12) << "p99 ns"
+            << std::setw(14) << "max ns" << "\n";
+        for (const auto& zone : histograms) {
+            const HistogramSnapshot& h = zone.second;
+            out << std::left << std::setw(32) << zone.first << std::right << std::setw(10) << h.totalCount()
+                << std::fixed << std::setprecision(2) << std::setw(12) << h.total() / 1e6 << std::setprecision(0)
+                << std::setw(12) << h.mean() << std::setw(12) << h.percentile(0.5) << std::setw(12)
+                << h.percentile(0.99) << std::setw(14) << h.max() << "\n";
+        }
+        out.flags(flags);
+    }
+};
+
+#endif // PROFILER_H
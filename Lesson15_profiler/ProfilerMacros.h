@@ -0,0 +1,25 @@
+// ProfilerMacros.h
+//
+// PROFILE_ZONE and PROFILE_FUNCTION without the rest of Profiler.h.
+//
+// Headers that mark their hot phases include this one. Unless the program
+// defines PROFILER_ENABLED as 1 the macros expand to nothing and no part of
+// the profiler (rings, registry, rdtsc) is compiled in; otherwise this
+// header includes Profiler.h itself.
+
+#ifndef PROFILER_MACROS_H
+#define PROFILER_MACROS_H
+
+#define PROFILER_CONCAT_INNER(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_INNER(a, b)
+
+#if defined(PROFILER_ENABLED) && PROFILER_ENABLED
+#define PROFILE_ZONE(name) ProfileZone PROFILER_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_ZONE(__func__)
+#include "Profiler.h"
+#else
+#define PROFILE_ZONE(name) static_cast<void>(0)
+#define PROFILE_FUNCTION() static_cast<void>(0)
+#endif
+
+#endif // PROFILER_MACROS_H
@@ -0,0 +1,294 @@
+// ConcurrentDictionary.h
+//
+// Thread-safe hash dictionary built from many independently locked shards.
+//
+// The ThreadSafeCounter in "Lesson16_4_threads_locks.md" guards its data with
+// one mutex, so every thread queues behind every other. This dictionary
+// splits the keys over N shards ("lock striping") so writers only contend
+// when they touch the same shard, and readers take no lock at all.
+//
+// Each shard is protected by a sequence lock (seqlock):
+//
+//   writer: lock mutex, seq++ (now odd), modify the table, seq++ (even), unlock
+//   reader: read seq, read the table, read seq again; if seq was odd or has
+//           changed, a writer interfered so throw the result away and retry
+//
+// Readers never write shared memory, so they never block writers and never
+// bounce cache lines between cores. Because a reader can observe a table
+// that is being modified, keys and values are stored in std::atomic and must
+// be trivially copyable; a torn read is simply discarded by the retry.
+//
+// A shard that grows cannot free its old slot array straight away, because
+// a reader may still be probing it. Retired arrays are kept until the
+// dictionary is destroyed; with doubling they never add up to more than the
+// live array.
+
+#ifndef CONCURRENT_DICTIONARY_H
+#define CONCURRENT_DICTIONARY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Sharded hash dictionary with mutex-per-shard writes and
+ *        seqlock optimistic (lock-free) reads.
+ *
+ * All member functions may be called concurrently from any thread.
+ */
+template<typename K, typename V, typename Hash = std::hash<K>>
+class ConcurrentDictionary {
+    static_assert(std::is_trivially_copyable<K>::value, "ConcurrentDictionary keys must be trivially copyable");
+    static_assert(std::is_trivially_copyable<V>::value, "ConcurrentDictionary values must be trivially copyable");
+
+public:
+    explicit ConcurrentDictionary(size_t shardCount = 64, size_t initialCapacityPerShard = 64)
+        : shardBits(0) {
+        while ((size_t(1) << shardBits) < shardCount) {
+            shardBits++;
+        }
+        size_t capacity = 16;
+        while (capacity < initialCapacityPerShard) {
+            capacity *= 2;
+        }
+        shards.reset(new Shard[size_t(1) << shardBits]);
+        for (size_t i = 0; i < (size_t(1) << shardBits); i++) {
+            shards[i].install(new Table(capacity));
+        }
+    }
+
+    ConcurrentDictionary(const ConcurrentDictionary&) = delete;
+    ConcurrentDictionary& operator=(const ConcurrentDictionary&) = delete;
+
+    // Insert a new key or update the value of an existing one
+    void insert(const K& key, const V& value) {
+        uint64_t hash = hashOf(key);
+        Shard& shard = shardFor(hash);
+        std::lock_guard<std::mutex> lock(shard.writeMutex);
+
+        // Growing needs no write section: the new table is complete before it
+        // is published, and readers still on the old one see unchanged data
+        if (shard.size + 1 > shard.current->growthLimit()) {
+            shard.grow();
+        }
+
+        WriteSection section(shard);
+        Table* table = shard.current;
+        size_t index = static_cast<size_t>(hash) & table->mask;
+        while (table->slots[index].full.load(std::memory_order_relaxed)) {
+            if (table->slots[index].key.load(std::memory_order_relaxed) == key) {
+                table->slots[index].value.store(value, std::memory_order_relaxed);
+                return;
+            }
+            index = (index + 1) & table->mask;
+        }
+        table->slots[index].key.store(key, std::memory_order_relaxed);
+        table->slots[index].value.store(value, std::memory_order_relaxed);
+        table->slots[index].full.store(true, std::memory_order_relaxed);
+        shard.size++;
+        shard.publishedSize.store(shard.size, std::memory_order_relaxed);
+    }
+
+    // Lock-free lookup. Returns true and copies the value out if key is present.
+    bool find(const K& key, V& valueOut) const {
+        uint64_t hash = hashOf(key);
+        const Shard& shard = shardFor(hash);
+        unsigned spins = 0;
+
+        while (true) {
+            uint64_t before = shard.seq.load(std::memory_order_acquire);
+            if (before & 1) {
+                // A writer is mid-update; back off and try again
+                if (++spins > 64) {
+                    std::this_thread::yield();
+                }
+                continue;
+            }
+
+            bool found = false;
+            V value{};
+            const Table* table = shard.published.load(std::memory_order_acquire);
+            size_t index = static_cast<size_t>(hash) & table->mask;
+            // Bounded by the table size in case a concurrent write leaves
+            // us looking at a run with no empty slot
+            for (size_t probes = 0; probes <= table->mask; probes++) {
+                const Slot& slot = table->slots[index];
+                if (!slot.full.load(std::memory_order_relaxed)) {
+                    break;
+                }
+                if (slot.key.load(std::memory_order_relaxed) == key) {
+                    value = slot.value.load(std::memory_order_relaxed);
+                    found = true;
+                    break;
+                }
+                index = (index + 1) & table->mask;
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (shard.seq.load(std::memory_order_relaxed) == before) {
+                if (found) {
+                    valueOut = value;
+                }
+                return found;
+            }
+        }
+    }
+
+    bool contains(const K& key) const {
+        V ignored;
+        return find(key, ignored);
+    }
+
+    bool remove(const K& key) {
+        uint64_t hash = hashOf(key);
+        Shard& shard = shardFor(hash);
+        std::lock_guard<std::mutex> lock(shard.writeMutex);
+
+        Table* table = shard.current;
+        const size_t mask = table->mask;
+        size_t hole = static_cast<size_t>(hash) & mask;
+        while (true) {
+            if (!table->slots[hole].full.load(std::memory_order_relaxed)) {
+                return false;    // a miss never disturbs readers
+            }
+            if (table->slots[hole].key.load(std::memory_order_relaxed) == key) {
+                break;
+            }
+            hole = (hole + 1) & mask;
+        }
+
+        WriteSection section(shard);
+
+        // Backward shift deletion, as in FlatHashMap: no tombstones
+        size_t next = hole;
+        while (true) {
+            next = (next + 1) & mask;
+            Slot& candidate = table->slots[next];
+            if (!candidate.full.load(std::memory_order_relaxed)) {
+                break;
+            }
+            K movedKey = candidate.key.load(std::memory_order_relaxed);
+            size_t home = static_cast<size_t>(hashOf(movedKey)) & mask;
+            if (((next - home) & mask) >= ((next - hole) & mask)) {
+                table->slots[hole].key.store(movedKey, std::memory_order_relaxed);
+                table->slots[hole].value.store(candidate.value.load(std::memory_order_relaxed),
+                                               std::memory_order_relaxed);
+                hole = next;
+            }
+        }
+        table->slots[hole].full.store(false, std::memory_order_relaxed);
+        shard.size--;
+        shard.publishedSize.store(shard.size, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Sum of the shard sizes; exact only when no writer is running
+    size_t size() const {
+        size_t total = 0;
+        for (size_t i = 0; i < shardCount(); i++) {
+            total += shards[i].publishedSize.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    size_t shardCount() const { return size_t(1) << shardBits; }
+
+private:
+    struct Slot {
+        std::atomic<K> key;
+        std::atomic<V> value;
+        std::atomic<bool> full;
+
+        Slot() : full(false) {}
+    };
+
+    struct Table {
+        size_t mask;
+        std::unique_ptr<Slot[]> slots;
+
+        explicit Table(size_t capacity) : mask(capacity - 1), slots(new Slot[capacity]) {}
+
+        // Linear probing stays fast up to about 70% full
+        size_t growthLimit() const { return (mask + 1) / 10 * 7; }
+    };
+
+    // alignas keeps each shard's mutex and sequence number on their own
+    // cache line so threads working on neighbouring shards do not interfere
+    struct alignas(64) Shard {
+        std::mutex writeMutex;
+        std::atomic<uint64_t> seq{0};
+        std::atomic<const Table*> published{nullptr};   // what readers probe
+        std::atomic<size_t> publishedSize{0};
+        Table* current = nullptr;                        // same table, writer's view
+        size_t size = 0;                                 // guarded by writeMutex
+        std::vector<std::unique_ptr<Table>> tables;      // live table plus retired ones
+
+        void install(Table* table) {
+            tables.emplace_back(table);
+            current = table;
+            published.store(table, std::memory_order_release);
+        }
+
+        // Rehash into a table twice the size and publish it; caller holds writeMutex
+        void grow() {
+            Table* bigger = new Table((current->mask + 1) * 2);
+            for (size_t i = 0; i <= current->mask; i++) {
+                const Slot& slot = current->slots[i];
+                if (!slot.full.load(std::memory_order_relaxed)) {
+                    continue;
+                }
+                K key = slot.key.load(std::memory_order_relaxed);
+                size_t index = static_cast<size_t>(ConcurrentDictionary::hashOf(key)) & bigger->mask;
+                while (bigger->slots[index].full.load(std::memory_order_relaxed)) {
+                    index = (index + 1) & bigger->mask;
+                }
+                bigger->slots[index].key.store(key, std::memory_order_relaxed);
+                bigger->slots[index].value.store(slot.value.load(std::memory_order_relaxed),
+                                                 std::memory_order_relaxed);
+                bigger->slots[index].full.store(true, std::memory_order_relaxed);
+            }
+            install(bigger);
+        }
+    };
+
+    // RAII seqlock write section: seq is odd while the object is alive
+    class WriteSection {
+    public:
+        explicit WriteSection(Shard& s) : shard(s) {
+            shard.seq.store(shard.seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+        ~WriteSection() {
+            shard.seq.store(shard.seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+    private:
+        Shard& shard;
+    };
+
+    std::unique_ptr<Shard[]> shards;
+    unsigned shardBits;
+
+    static uint64_t hashOf(const K& key) {
+        uint64_t h = static_cast<uint64_t>(Hash()(key));
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    // Shards use the top hash bits; slots within a shard use the bottom bits
+    size_t shardIndex(uint64_t hash) const {
+        return shardBits == 0 ? 0 : static_cast<size_t>(hash >> (64 - shardBits));
+    }
+
+    Shard& shardFor(uint64_t hash) { return shards[shardIndex(hash)]; }
+    const Shard& shardFor(uint64_t hash) const { return shards[shardIndex(hash)]; }
+};
+
+#endif // CONCURRENT_DICTIONARY_H
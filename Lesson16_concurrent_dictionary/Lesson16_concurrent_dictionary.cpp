@@ -0,0 +1,187 @@
+// Lesson16_concurrent_dictionary.cpp : This file contains the 'main' function. Program execution begins and ends there.
+//
+// Throughput of ConcurrentDictionary against a single-mutex dictionary written
+// in the style of ThreadSafeCounter (Lesson16_4), sweeping 1 - 64 threads and
+// read/write mixes of 100/0, 95/5 and 50/50.
+//
+// Usage: Lesson16_concurrent_dictionary [keys] [opsPerThread]
+//   Defaults: 1000000 keys, 200000 operations per thread.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "ConcurrentDictionary.h"
+
+// One mutex around std::unordered_map, exactly like ThreadSafeCounter
+class LockedDictionary {
+private:
+    std::unordered_map<uint64_t, uint64_t> map;
+    std::mutex mutex;
+
+public:
+    void insert(uint64_t key, uint64_t value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        map[key] = value;
+    }
+
+    bool find(uint64_t key, uint64_t& value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = map.find(key);
+        if (it == map.end()) return false;
+        value = it->second;
+        return true;
+    }
+
+    bool remove(uint64_t key) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return map.erase(key) == 1;
+    }
+};
+
+// Each thread runs opsPerThread random operations; writePercent of them
+// are writes, split evenly between insert and remove
+template<typename Dict>
+double runThroughput(Dict& dict, size_t keyCount, int threadCount, int writePercent, size_t opsPerThread) {
+    std::atomic<bool> go(false);
+    std::atomic<uint64_t> sink(0);
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < threadCount; t++) {
+        threads.emplace_back([&, t]() {
+            std::mt19937_64 rng(t + 1);
+            uint64_t found = 0;
+            while (!go.load()) {
+                std::this_thread::yield();
+            }
+            for (size_t i = 0; i < opsPerThread; i++) {
+                uint64_t r = rng();
+                uint64_t key = r % keyCount;
+                if (static_cast<int>((r >> 40) % 100) < writePercent) {
+                    if (r & (1ULL << 63)) {
+                        dict.insert(key, key * 2);
+                    } else {
+                        dict.remove(key);
+                    }
+                } else {
+                    uint64_t value;
+                    found += dict.find(key, value);
+                }
+            }
+            sink += found;
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    go = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return threadCount * opsPerThread / seconds / 1e6;
+}
+
+// Writers own disjoint key ranges while readers check that every value they
+// see is consistent (value == key * 2); a torn seqlock read would break that
+void sanityCheck() {
+    ConcurrentDictionary<uint64_t, uint64_t> dict(8, 16);
+    std::atomic<bool> done(false);
+    std::atomic<uint64_t> badReads(0);
+    const uint64_t perWriter = 50000;
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 2; r++) {
+        readers.emplace_back([&]() {
+            std::mt19937_64 rng(99);
+            while (!done.load()) {
+                uint64_t key = rng() % (4 * perWriter);
+                uint64_t value;
+                if (dict.find(key, value) && value != key * 2) {
+                    badReads++;
+                }
+            }
+        });
+    }
+
+    std::vector<std::thread> writers;
+    for (uint64_t w = 0; w < 4; w++) {
+        writers.emplace_back([&dict, w, perWriter]() {
+            for (uint64_t k = w * perWriter; k < (w + 1) * perWriter; k++) {
+                dict.insert(k, k * 2);
+            }
+            for (uint64_t k = w * perWriter; k < (w + 1) * perWriter; k += 2) {
+                dict.remove(k);
+            }
+        });
+    }
+    for (auto& thread : writers) thread.join();
+    done = true;
+    for (auto& thread : readers) thread.join();
+
+    for (uint64_t k = 0; k < 4 * perWriter; k++) {
+        uint64_t value = 0;
+        bool found = dict.find(k, value);
+        if (found != (k % 2 == 1) || (found && value != k * 2)) {
+            throw std::logic_error("ConcurrentDictionary lost or kept key " + std::to_string(k));
+        }
+    }
+    if (badReads != 0 || dict.size() != 2 * perWriter) {
+        throw std::logic_error("ConcurrentDictionary returned inconsistent data");
+    }
+    std::cout << "Sanity check passed: " << dict.size() << " keys across " << dict.shardCount() << " shards\n\n";
+}
+
+int main(int argc, char* argv[]) {
+    size_t keyCount = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    size_t opsPerThread = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 200000;
+
+    sanityCheck();
+
+    std::cout << "Hardware threads: " << std::thread::hardware_concurrency() << "\n";
+    std::cout << "Throughput in million operations per second, " << keyCount << " keys\n\n";
+    std::cout << std::left << std::setw(10) << "threads" << std::setw(10) << "read %" << std::right
+              << std::setw(18) << "single mutex" << std::setw(18) << "sharded+seqlock" << "\n";
+
+    const int mixes[] = { 0, 5, 50 };
+    for (int writePercent : mixes) {
+        for (int threads = 1; threads <= 64; threads *= 2) {
+            LockedDictionary locked;
+            ConcurrentDictionary<uint64_t, uint64_t> sharded(64, keyCount / 64 * 2);
+            for (uint64_t k = 0; k < keyCount; k += 2) {
+                locked.insert(k, k * 2);
+                sharded.insert(k, k * 2);
+            }
+
+            double lockedMops = runThroughput(locked, keyCount, threads, writePercent, opsPerThread);
+            double shardedMops = runThroughput(sharded, keyCount, threads, writePercent, opsPerThread);
+
+            std::cout << std::left << std::setw(10) << threads << std::setw(10) << (100 - writePercent) << std::right
+                      << std::fixed << std::setprecision(2)
+                      << std::setw(18) << lockedMops << std::setw(18) << shardedMops << "\n";
+        }
+        std::cout << "\n";
+    }
+
+    return 0;
+}
+
+// Run program: Ctrl + F5 or Debug > Start Without Debugging menu
+// Debug program: F5 or Debug > Start Debugging menu
+
+// Tips for Getting Started:
+//   1. Use the Solution Explorer window to add/manage files
+//   2. Use the Team Explorer window to connect to source control
+//   3. Use the Output window to see build output and other messages
+//   4. Use the Error List window to view errors
+//   5. Go to Project > Add New Item to create new code files, or Project > Add Existing Item to add existing code files to the project
+//   6. In the future, to open this project again, go to File > Open > Project and select the .sln file
@@ -0,0 +1,206 @@
+// ConcurrentPriorityQueue.h
+//
+// Priority queue for many producer and consumer threads.
+//
+// A single heap behind one mutex, the way ThreadSafeQueue in
+// "Lesson16_5_threads_conditionvariables.md" guards its std::queue, lets
+// only one thread in at a time: every push and pop also has to move the
+// mutex and the top of the heap between cores. This queue instead keeps
+// several independently locked heaps (a "multi-queue"):
+//
+//   push:  lock a randomly chosen heap (try another if it is busy) and push
+//   pop:   pick two heaps at random, and pop from whichever has the better
+//          top element
+//
+// With c heaps per thread, threads rarely want the same lock, so throughput
+// grows with the thread count. The price is that pop no longer returns
+// *the* best element, only one that is close to it: comparing two random
+// heaps keeps the expected rank error (how many better elements were left
+// behind) at about the number of heaps, independent of the queue's size.
+// Schedulers and best-first searches tolerate that easily.
+//
+// QueueOrder::Strict keeps one heap instead, for callers that need exact
+// priority order; it is the single-lock design, with its throughput.
+//
+// Each heap is a DaryHeap from Lesson 11.
+
+#ifndef CONCURRENT_PRIORITY_QUEUE_H
+#define CONCURRENT_PRIORITY_QUEUE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "../Lesson11_dary_heap/DaryHeap.h"
+
+enum class QueueOrder { Strict, Relaxed };
+
+namespace concurrent_pq_detail {
+
+// A per-thread xorshift generator; std::mt19937 would be slower than the push it picks a heap for
+inline size_t randomBelow(size_t n) {
+    static std::atomic<uint64_t> seeds(0x9E3779B97F4A7C15ull);
+    thread_local uint64_t state = seeds.fetch_add(0x9E3779B97F4A7C15ull) | 1;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return static_cast<size_t>((state >> 32) * n >> 32);
+}
+
+inline void noOp() {}
+
+} // namespace concurrent_pq_detail
+
+/**
+ * @brief Multi-queue priority queue. Pop returns the largest element under
+ *        Compare (exactly in Strict mode, approximately in Relaxed mode).
+ *
+ * All member functions may be called concurrently from any thread.
+ */
+template<typename T, typename Compare = std::less<T>>
+class ConcurrentPriorityQueue {
+public:
+    /**
+     * @param threads Threads expected to use the queue; Relaxed mode keeps
+     *        queuesPerThread heaps for each (at least two heaps in total).
+     */
+    explicit ConcurrentPriorityQueue(QueueOrder order = QueueOrder::Relaxed,
+                                     size_t threads = std::thread::hardware_concurrency(),
+                                     size_t queuesPerThread = 2)
+        : order(order) {
+        queueCount = order == QueueOrder::Strict ? 1 : std::max<size_t>(threads * queuesPerThread, 2);
+        queues.reset(new SubQueue[queueCount]);
+    }
+
+    ConcurrentPriorityQueue(const ConcurrentPriorityQueue&) = delete;
+    ConcurrentPriorityQueue& operator=(const ConcurrentPriorityQueue&) = delete;
+
+    void push(T value) {
+        push(std::move(value), concurrent_pq_detail::noOp);
+    }
+
+    /**
+     * @brief Push, calling whileLocked() while the receiving heap is still
+     *        locked - e.g. to take a timestamp that orders the operation
+     *        consistently with every other operation on that heap.
+     */
+    template<typename Fn>
+    void push(T value, Fn whileLocked) {
+        SubQueue* queue = nullptr;
+        std::unique_lock<std::mutex> lock;
+        if (order == QueueOrder::Relaxed) {
+            // A few tries for a free heap before waiting on one
+            for (int attempt = 0; attempt < 4 && !lock.owns_lock(); attempt++) {
+                queue = &queues[concurrent_pq_detail::randomBelow(queueCount)];
+                lock = std::unique_lock<std::mutex>(queue->mutex, std::try_to_lock);
+            }
+        }
+        if (!lock.owns_lock()) {
+            queue = &queues[concurrent_pq_detail::randomBelow(queueCount)];
+            lock = std::unique_lock<std::mutex>(queue->mutex);
+        }
+        queue->heap.push(std::move(value));
+        queue->size.store(queue->heap.size(), std::memory_order_relaxed);
+        whileLocked();
+    }
+
+    /**
+     * @brief Pop into out. Returns false if the queue was empty.
+     */
+    bool tryPop(T& out) {
+        return tryPop(out, concurrent_pq_detail::noOp);
+    }
+
+    template<typename Fn>
+    bool tryPop(T& out, Fn whileLocked) {
+        if (order == QueueOrder::Relaxed) {
+            for (size_t attempt = 0; attempt < queueCount; attempt++) {
+                if (popBetterOfTwo(out, whileLocked)) return true;
+            }
+        }
+        // Strict mode, or the random choices kept finding empty or busy
+        // heaps: check every heap before reporting empty
+        for (size_t i = 0; i < queueCount; i++) {
+            SubQueue& queue = queues[i];
+            if (queue.size.load(std::memory_order_relaxed) == 0 && order == QueueOrder::Relaxed) continue;
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.heap.empty()) {
+                popLocked(queue, out);
+                whileLocked();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Exact only while no other thread is pushing or popping
+    size_t size() const {
+        size_t total = 0;
+        for (size_t i = 0; i < queueCount; i++) total += queues[i].size.load(std::memory_order_relaxed);
+        return total;
+    }
+
+    bool empty() const { return size() == 0; }
+
+    size_t heapCount() const { return queueCount; }
+
+private:
+    // alignas keeps each heap's mutex and size on their own cache line
+    struct alignas(64) SubQueue {
+        std::mutex mutex;
+        std::atomic<size_t> size{0};    // the heap's size, readable without the lock
+        DaryHeap<T, 4, Compare> heap;
+    };
+
+    QueueOrder order;
+    size_t queueCount;
+    std::unique_ptr<SubQueue[]> queues;
+    Compare comp;
+
+    void popLocked(SubQueue& queue, T& out) {
+        out = queue.heap.extractTop();
+        queue.size.store(queue.heap.size(), std::memory_order_relaxed);
+    }
+
+    // Lock two random heaps without waiting and pop from the one with the
+    // better top. If either is busy, give up and let the caller draw two
+    // new heaps: popping from whichever one happened to be free would lose
+    // the comparison that keeps the rank error small. try_lock never
+    // blocks, so the lock order does not matter.
+    template<typename Fn>
+    bool popBetterOfTwo(T& out, Fn& whileLocked) {
+        size_t a = concurrent_pq_detail::randomBelow(queueCount);
+        size_t b = concurrent_pq_detail::randomBelow(queueCount - 1);
+        if (b >= a) b++;
+        SubQueue* first = &queues[a];
+        SubQueue* second = &queues[b];
+        if (first->size.load(std::memory_order_relaxed) == 0) std::swap(first, second);
+        if (first->size.load(std::memory_order_relaxed) == 0) return false;
+
+        std::unique_lock<std::mutex> lockFirst(first->mutex, std::try_to_lock);
+        if (!lockFirst.owns_lock()) return false;
+        std::unique_lock<std::mutex> lockSecond;
+        if (second->size.load(std::memory_order_relaxed) != 0) {
+            lockSecond = std::unique_lock<std::mutex>(second->mutex, std::try_to_lock);
+            if (!lockSecond.owns_lock()) return false;
+        }
+        bool useFirst = !first->heap.empty();
+        bool useSecond = lockSecond.owns_lock() && !second->heap.empty();
+        if (useFirst && useSecond) {
+            if (comp(first->heap.top(), second->heap.top())) useFirst = false;
+            else useSecond = false;
+        }
+        if (!useFirst && !useSecond) return false;
+        popLocked(useFirst ? *first : *second, out);
+        whileLocked();
+        return true;
+    }
+};
+
+#endif // CONCURRENT_PRIORITY_QUEUE_H
@@ -0,0 +1,276 @@
+// Lesson16_concurrent_priority_queue.cpp : This file contains the 'main' function. Program execution begins and ends there.
+//
+// Throughput and ordering quality of ConcurrentPriorityQueue. Strict mode is
+// one mutex around one heap, the ThreadSafeQueue design with a heap inside;
+// Relaxed mode is the multi-queue with 2 and 4 heaps per thread.
+//
+// Quality is the rank error of each pop: how many elements in the queue at
+// that moment were better than the one returned (0 for an exact priority
+// queue). Every operation takes a ticket while its heap is locked, and the
+// tickets are replayed in order against a sequential count of the keys.
+//
+// Usage: Lesson16_concurrent_priority_queue [prefill] [opsPerThread]
+//   Defaults: 1000000 elements in the queue, 200000 operations per thread.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ConcurrentPriorityQueue.h"
+
+struct Result {
+    double mops;
+    double meanRankError;
+    uint64_t maxRankError;
+};
+
+// One push or pop, numbered in the order the heaps saw them
+struct Event {
+    uint64_t ticket;
+    uint64_t key;
+    bool pop;
+};
+
+// Counts of the keys present, indexed by key rank, for replaying the events
+class FenwickTree {
+private:
+    std::vector<int64_t> tree;
+
+public:
+    explicit FenwickTree(size_t n) : tree(n + 1, 0) {}
+
+    void add(size_t i, int64_t delta) {
+        for (i++; i < tree.size(); i += i & (0 - i)) tree[i] += delta;
+    }
+
+    // Sum of counts [0, i]
+    int64_t prefix(size_t i) const {
+        int64_t sum = 0;
+        for (i++; i > 0; i -= i & (0 - i)) sum += tree[i];
+        return sum;
+    }
+};
+
+// Replays the events in ticket order. The queue pops the largest key, so the
+// rank error of a pop is the number of larger keys present at that moment.
+void rankErrors(std::vector<Event>& events, Result& result) {
+    std::sort(events.begin(), events.end(), [](const Event& a, const Event& b) { return a.ticket < b.ticket; });
+    std::vector<uint64_t> keys;
+    keys.reserve(events.size());
+    for (const Event& e : events) keys.push_back(e.key);
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    FenwickTree present(keys.size());
+    int64_t total = 0;
+    uint64_t pops = 0, errorSum = 0, errorMax = 0;
+    for (const Event& e : events) {
+        size_t rank = std::lower_bound(keys.begin(), keys.end(), e.key) - keys.begin();
+        if (e.pop) {
+            uint64_t error = static_cast<uint64_t>(total - present.prefix(rank));
+            errorSum += error;
+            errorMax = std::max(errorMax, error);
+            pops++;
+            present.add(rank, -1);
+            total--;
+        } else {
+            present.add(rank, 1);
+            total++;
+        }
+    }
+    result.meanRankError = pops == 0 ? 0.0 : static_cast<double>(errorSum) / pops;
+    result.maxRankError = errorMax;
+}
+
+// Each thread alternates randomly between push and tryPop, half each, on a
+// queue prefilled with random keys. With measureQuality every operation
+// also takes a ticket and is logged, which costs throughput.
+Result runWorkload(QueueOrder order, size_t queuesPerThread, int threadCount, size_t prefill,
+                   size_t opsPerThread, bool measureQuality) {
+    ConcurrentPriorityQueue<uint64_t> queue(order, threadCount, queuesPerThread);
+    std::atomic<uint64_t> tickets(0);
+    std::vector<std::vector<Event>> logs(threadCount + 1);
+
+    std::mt19937_64 fillRng(12345);
+    if (measureQuality) logs[threadCount].reserve(prefill);
+    for (size_t i = 0; i < prefill; i++) {
+        uint64_t key = fillRng();
+        if (measureQuality) {
+            queue.push(key, [&]() { logs[threadCount].push_back(Event{ tickets++, key, false }); });
+        } else {
+            queue.push(key);
+        }
+    }
+
+    std::atomic<bool> go(false);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; t++) {
+        threads.emplace_back([&, t]() {
+            std::mt19937_64 rng(t + 1);
+            std::vector<Event>& log = logs[t];
+            if (measureQuality) log.reserve(opsPerThread);
+            while (!go.load()) {
+                std::this_thread::yield();
+            }
+            for (size_t i = 0; i < opsPerThread; i++) {
+                uint64_t key = rng();
+                if (key & 1) {
+                    if (measureQuality) {
+                        queue.push(key, [&]() { log.push_back(Event{ tickets++, key, false }); });
+                    } else {
+                        queue.push(key);
+                    }
+                } else {
+                    uint64_t top;
+                    if (measureQuality) {
+                        queue.tryPop(top, [&]() { log.push_back(Event{ tickets++, top, true }); });
+                    } else {
+                        queue.tryPop(top);
+                    }
+                }
+            }
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    go = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    Result result{ threadCount * opsPerThread / seconds / 1e6, 0.0, 0 };
+    if (measureQuality) {
+        std::vector<Event> events;
+        for (const auto& log : logs) events.insert(events.end(), log.begin(), log.end());
+        rankErrors(events, result);
+    }
+    return result;
+}
+
+// Concurrent producers and consumers must hand over exactly the keys that
+// were pushed, a strict queue must pop in exact order, and the rank error
+// replay must report 0 for the strict queue
+void sanityCheck() {
+    for (QueueOrder order : { QueueOrder::Strict, QueueOrder::Relaxed }) {
+        ConcurrentPriorityQueue<uint64_t> queue(order, 4);
+        uint64_t value;
+        if (queue.tryPop(value) || !queue.empty()) throw std::logic_error("empty queue popped an element");
+
+        const uint64_t perProducer = 50000;
+        std::atomic<uint64_t> popped(0);
+        std::vector<std::vector<uint64_t>> received(4);
+        std::vector<std::thread> threads;
+        for (uint64_t p = 0; p < 4; p++) {
+            threads.emplace_back([&queue, p, perProducer]() {
+                for (uint64_t k = p; k < 4 * perProducer; k += 4) queue.push(k);
+            });
+        }
+        for (int c = 0; c < 4; c++) {
+            threads.emplace_back([&, c]() {
+                uint64_t key;
+                while (popped.load() < 4 * perProducer) {
+                    if (queue.tryPop(key)) {
+                        received[c].push_back(key);
+                        popped++;
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) thread.join();
+
+        std::vector<uint64_t> all;
+        for (const auto& keys : received) all.insert(all.end(), keys.begin(), keys.end());
+        std::sort(all.begin(), all.end());
+        for (uint64_t k = 0; k < all.size(); k++) {
+            if (all[k] != k) throw std::logic_error("concurrent push/pop lost or duplicated key " + std::to_string(k));
+        }
+        if (all.size() != 4 * perProducer || !queue.empty()) throw std::logic_error("concurrent push/pop lost keys");
+    }
+
+    ConcurrentPriorityQueue<uint64_t> strict(QueueOrder::Strict);
+    std::mt19937_64 rng(7);
+    std::vector<uint64_t> keys(10000);
+    for (uint64_t& k : keys) {
+        k = rng() % 1000;
+        strict.push(k);
+    }
+    std::sort(keys.begin(), keys.end(), std::greater<uint64_t>());
+    for (uint64_t expected : keys) {
+        uint64_t key;
+        if (!strict.tryPop(key) || key != expected) throw std::logic_error("strict queue popped out of order");
+    }
+
+    Result quality = runWorkload(QueueOrder::Strict, 1, 4, 10000, 20000, true);
+    if (quality.maxRankError != 0) throw std::logic_error("strict queue reported a rank error");
+    std::cout << "Sanity check passed\n\n";
+}
+
+int main(int argc, char* argv[]) {
+    size_t prefill = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    size_t opsPerThread = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 200000;
+
+    sanityCheck();
+
+    std::cout << "Hardware threads: " << std::thread::hardware_concurrency() << "\n";
+    std::cout << "50% push / 50% pop on " << prefill << " elements, " << opsPerThread << " operations per thread\n\n";
+
+    struct Variant {
+        const char* name;
+        QueueOrder order;
+        size_t queuesPerThread;
+    };
+    const Variant variants[] = {
+        { "strict", QueueOrder::Strict, 1 },
+        { "relaxed c=2", QueueOrder::Relaxed, 2 },
+        { "relaxed c=4", QueueOrder::Relaxed, 4 },
+    };
+
+    std::cout << "Throughput in million operations per second\n";
+    std::cout << std::left << std::setw(10) << "threads" << std::right;
+    for (const Variant& v : variants) std::cout << std::setw(14) << v.name;
+    std::cout << "\n";
+    for (int threads = 1; threads <= 64; threads *= 2) {
+        std::cout << std::left << std::setw(10) << threads << std::right << std::fixed << std::setprecision(2);
+        for (const Variant& v : variants) {
+            std::cout << std::setw(14) << runWorkload(v.order, v.queuesPerThread, threads, prefill, opsPerThread, false).mops;
+        }
+        std::cout << "\n";
+    }
+
+    std::cout << "\nRank error of each pop (mean / max), operations logged\n";
+    std::cout << std::left << std::setw(10) << "threads" << std::right;
+    for (const Variant& v : variants) std::cout << std::setw(20) << v.name;
+    std::cout << "\n";
+    for (int threads = 1; threads <= 64; threads *= 2) {
+        std::cout << std::left << std::setw(10) << threads << std::right;
+        for (const Variant& v : variants) {
+            Result r = runWorkload(v.order, v.queuesPerThread, threads, prefill, opsPerThread, true);
+            std::cout << std::setw(11) << std::fixed << std::setprecision(1) << r.meanRankError
+                      << " / " << std::left << std::setw(6) << r.maxRankError << std::right;
+        }
+        std::cout << "\n";
+    }
+
+    return 0;
+}
+
+// Run program: Ctrl + F5 or Debug > Start Without Debugging menu
+// Debug program: F5 or Debug > Start Debugging menu
+
+// Tips for Getting Started:
+//   1. Use the Solution Explorer window to add/manage files
+//   2. Use the Team Explorer window to connect to source control
+//   3. Use the Output window to see build output and other messages
+//   4. Use the Error List window to view errors
+//   5. Go to Project > Add New Item to create new code files, or Project > Add Existing Item to add existing code files to the project
+//   6. In the future, to open this project again, go to File > Open > Project and select the .sln file
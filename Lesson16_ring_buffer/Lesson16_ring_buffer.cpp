@@ -0,0 +1,292 @@
+// Lesson16_ring_buffer.cpp : This file contains the 'main' function. Program execution begins and ends there.
+//
+// Items per second through ThreadSafeQueue (Lesson16_5) and the lock-free
+// rings in RingBuffer.h, for several producer/consumer counts. The rings
+// are measured with blocking push/pop, with batches of 32 and, where the
+// thread counts allow it, as the specialised SPSC/MPSC ring.
+//
+// ThreadSafeQueue is copied from the lesson without its std::cout lines,
+// which would otherwise be all that gets measured.
+//
+// Usage: Lesson16_ring_buffer [itemsPerProducer]
+//   Default: 1000000 items per producer.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "RingBuffer.h"
+
+class ThreadSafeQueue {
+private:
+    std::queue<uint64_t> queue;
+    std::mutex mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    const unsigned int capacity;
+
+public:
+    ThreadSafeQueue(unsigned int max_size) : capacity(max_size) {}
+
+    void produce(uint64_t value) {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_full.wait(lock, [this]() {
+            return queue.size() < capacity;
+        });
+        queue.push(value);
+        not_empty.notify_one();
+    }
+
+    uint64_t consume() {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_empty.wait(lock, [this]() {
+            return !queue.empty();
+        });
+        uint64_t value = queue.front();
+        queue.pop();
+        not_full.notify_one();
+        return value;
+    }
+};
+
+const size_t kCapacity = 1024;
+const size_t kBatch = 32;
+
+// Item i of producer p
+inline uint64_t item(uint64_t p, uint64_t i) {
+    return (p << 32) | i;
+}
+
+// Producer p calls produce(p) and consumer c calls consume(c, count),
+// consumers sharing the items evenly. Returns million items per second.
+template<typename Produce, typename Consume>
+double runPipeline(int producers, int consumers, size_t itemsPerProducer, Produce produce, Consume consume) {
+    size_t total = producers * itemsPerProducer;
+    std::atomic<bool> go(false);
+    std::atomic<uint64_t> sink(0);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&, p]() {
+            while (!go.load()) std::this_thread::yield();
+            produce(p);
+        });
+    }
+    for (int c = 0; c < consumers; c++) {
+        size_t count = total / consumers + (static_cast<size_t>(c) < total % consumers ? 1 : 0);
+        threads.emplace_back([&, c, count]() {
+            while (!go.load()) std::this_thread::yield();
+            sink += consume(c, count);
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    go = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return total / seconds / 1e6;
+}
+
+// push/pop one item at a time, waiting when full/empty
+template<typename Ring>
+double runSingle(Ring& ring, int producers, int consumers, size_t itemsPerProducer,
+                 std::vector<std::vector<uint64_t>>* received = nullptr) {
+    return runPipeline(producers, consumers, itemsPerProducer,
+        [&](int p) {
+            for (size_t i = 0; i < itemsPerProducer; i++) ring.push(item(p, i));
+        },
+        [&](int c, size_t count) {
+            uint64_t sum = 0;
+            for (size_t i = 0; i < count; i++) {
+                uint64_t value = ring.pop();
+                sum += value;
+                if (received) (*received)[c].push_back(value);
+            }
+            return sum;
+        });
+}
+
+// tryPushN/tryPopN in batches of kBatch, yielding when nothing moved
+template<typename Ring>
+double runBatched(Ring& ring, int producers, int consumers, size_t itemsPerProducer,
+                  std::vector<std::vector<uint64_t>>* received = nullptr) {
+    return runPipeline(producers, consumers, itemsPerProducer,
+        [&](int p) {
+            uint64_t batch[kBatch];
+            for (size_t i = 0; i < itemsPerProducer;) {
+                size_t n = std::min(kBatch, itemsPerProducer - i);
+                for (size_t j = 0; j < n; j++) batch[j] = item(p, i + j);
+                size_t pushed = 0;
+                while (pushed < n) {
+                    size_t moved = ring.tryPushN(batch + pushed, n - pushed);
+                    if (moved == 0) std::this_thread::yield();
+                    pushed += moved;
+                }
+                i += n;
+            }
+        },
+        [&](int c, size_t count) {
+            uint64_t batch[kBatch];
+            uint64_t sum = 0;
+            for (size_t i = 0; i < count;) {
+                size_t moved = ring.tryPopN(batch, std::min(kBatch, count - i));
+                if (moved == 0) std::this_thread::yield();
+                for (size_t j = 0; j < moved; j++) {
+                    sum += batch[j];
+                    if (received) (*received)[c].push_back(batch[j]);
+                }
+                i += moved;
+            }
+            return sum;
+        });
+}
+
+// Every item must arrive exactly once, and each consumer must see any one
+// producer's items in the order they were pushed
+void checkReceived(const std::vector<std::vector<uint64_t>>& received, int producers, size_t itemsPerProducer,
+                   const std::string& name) {
+    std::vector<uint64_t> all;
+    for (const auto& values : received) {
+        std::vector<int64_t> last(producers, -1);
+        for (uint64_t value : values) {
+            uint64_t p = value >> 32, i = value & 0xFFFFFFFF;
+            if (p >= static_cast<uint64_t>(producers) || static_cast<int64_t>(i) <= last[p]) {
+                throw std::logic_error(name + ": item out of order or unknown");
+            }
+            last[p] = i;
+        }
+        all.insert(all.end(), values.begin(), values.end());
+    }
+    std::sort(all.begin(), all.end());
+    size_t k = 0;
+    for (int p = 0; p < producers; p++) {
+        for (size_t i = 0; i < itemsPerProducer; i++, k++) {
+            if (k >= all.size() || all[k] != item(p, i)) throw std::logic_error(name + ": item lost or duplicated");
+        }
+    }
+    if (k != all.size()) throw std::logic_error(name + ": item duplicated");
+}
+
+template<typename Ring>
+void checkRing(const std::string& name, int producers, int consumers) {
+    const size_t itemsPerProducer = 20000;
+    for (bool batched : { false, true }) {
+        Ring ring(64);
+        std::vector<std::vector<uint64_t>> received(consumers);
+        if (batched) {
+            runBatched(ring, producers, consumers, itemsPerProducer, &received);
+        } else {
+            runSingle(ring, producers, consumers, itemsPerProducer, &received);
+        }
+        checkReceived(received, producers, itemsPerProducer, name + (batched ? " batched" : ""));
+        if (ring.size() != 0) throw std::logic_error(name + ": not empty at the end");
+    }
+}
+
+template<typename Ring>
+void checkSingleThreaded(const std::string& name) {
+    Ring ring(5);
+    if (ring.capacity() != 8) throw std::logic_error(name + ": capacity not rounded up");
+    uint64_t value;
+    if (ring.tryPop(value)) throw std::logic_error(name + ": popped from an empty ring");
+    for (uint64_t i = 0; i < 8; i++) {
+        if (!ring.tryPush(i)) throw std::logic_error(name + ": push failed below capacity");
+    }
+    if (ring.tryPush(8)) throw std::logic_error(name + ": pushed into a full ring");
+    uint64_t batch[16];
+    if (ring.tryPopN(batch, 16) != 8 || batch[0] != 0 || batch[7] != 7) {
+        throw std::logic_error(name + ": tryPopN returned the wrong items");
+    }
+    for (uint64_t i = 0; i < 16; i++) batch[i] = 100 + i;
+    if (ring.tryPushN(batch, 16) != 8 || ring.pop() != 100) throw std::logic_error(name + ": tryPushN overfilled");
+
+    // Move-only items, and items still in the ring when it is destroyed
+    MpmcRing<std::unique_ptr<std::string>> owners(4);
+    owners.push(std::make_unique<std::string>("moved in"));
+    owners.push(std::make_unique<std::string>("left behind, freed by the destructor"));
+    if (*owners.pop() != "moved in") throw std::logic_error("move-only item lost");
+}
+
+void sanityCheck() {
+    checkSingleThreaded<SpscRing<uint64_t>>("SpscRing");
+    checkSingleThreaded<MpscRing<uint64_t>>("MpscRing");
+    checkSingleThreaded<MpmcRing<uint64_t>>("MpmcRing");
+    checkRing<SpscRing<uint64_t>>("SpscRing", 1, 1);
+    checkRing<MpscRing<uint64_t>>("MpscRing", 4, 1);
+    checkRing<MpmcRing<uint64_t>>("MpmcRing", 4, 4);
+    checkRing<MpmcRing<uint64_t>>("MpmcRing", 1, 3);
+    std::cout << "Sanity check passed\n\n";
+}
+
+int main(int argc, char* argv[]) {
+    size_t itemsPerProducer = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+
+    sanityCheck();
+
+    std::cout << "Hardware threads: " << std::thread::hardware_concurrency() << "\n";
+    std::cout << "Million items per second, capacity " << kCapacity << ", " << itemsPerProducer
+              << " items per producer\n\n";
+    std::cout << std::left << std::setw(12) << "prod x cons" << std::right << std::setw(18) << "ThreadSafeQueue"
+              << std::setw(14) << "MpmcRing" << std::setw(16) << "MpmcRing x32" << std::setw(20) << "SPSC / MPSC"
+              << std::setw(20) << "SPSC / MPSC x32" << "\n";
+
+    const int configs[][2] = { { 1, 1 }, { 1, 4 }, { 4, 1 }, { 2, 2 }, { 4, 4 }, { 8, 8 } };
+    for (const auto& config : configs) {
+        int producers = config[0], consumers = config[1];
+        ThreadSafeQueue locked(kCapacity);
+        double lockedMops = runPipeline(producers, consumers, itemsPerProducer,
+            [&](int p) {
+                for (size_t i = 0; i < itemsPerProducer; i++) locked.produce(item(p, i));
+            },
+            [&](int, size_t count) {
+                uint64_t sum = 0;
+                for (size_t i = 0; i < count; i++) sum += locked.consume();
+                return sum;
+            });
+        MpmcRing<uint64_t> ring(kCapacity);
+        double ringMops = runSingle(ring, producers, consumers, itemsPerProducer);
+        double batchMops = runBatched(ring, producers, consumers, itemsPerProducer);
+
+        std::cout << std::left << std::setw(12) << (std::to_string(producers) + " x " + std::to_string(consumers))
+                  << std::right << std::fixed << std::setprecision(2) << std::setw(18) << lockedMops
+                  << std::setw(14) << ringMops << std::setw(16) << batchMops;
+        if (producers == 1 && consumers == 1) {
+            SpscRing<uint64_t> spsc(kCapacity);
+            std::cout << std::setw(20) << runSingle(spsc, 1, 1, itemsPerProducer)
+                      << std::setw(20) << runBatched(spsc, 1, 1, itemsPerProducer);
+        } else if (consumers == 1) {
+            MpscRing<uint64_t> mpsc(kCapacity);
+            std::cout << std::setw(20) << runSingle(mpsc, producers, 1, itemsPerProducer)
+                      << std::setw(20) << runBatched(mpsc, producers, 1, itemsPerProducer);
+        } else {
+            std::cout << std::setw(20) << "-" << std::setw(20) << "-";
+        }
+        std::cout << "\n";
+    }
+
+    return 0;
+}
+
+// Run program: Ctrl + F5 or Debug > Start Without Debugging menu
+// Debug program: F5 or Debug > Start Debugging menu
+
+// Tips for Getting Started:
+//   1. Use the Solution Explorer window to add/manage files
+//   2. Use the Team Explorer window to connect to source control
+//   3. Use the Output window to see build output and other messages
+//   4. Use the Error List window to view errors
+//   5. Go to Project > Add New Item to create new code files, or Project > Add Existing Item to add existing code files to the project
+//   6. In the future, to open this project again, go to File > Open > Project and select the .sln file
@@ -0,0 +1,415 @@
+// RingBuffer.h
+//
+// Bounded lock-free queues for passing items between threads.
+//
+// ThreadSafeQueue in "Lesson16_5_threads_conditionvariables.md" locks a
+// mutex for every produce and consume, so producers and consumers take
+// turns, and the std::queue behind it allocates as it grows. These queues
+// are a fixed array of slots used as a ring (the capacity is rounded up to
+// a power of two so the slot of position i is i & mask), and threads
+// coordinate with atomic counters instead of a lock:
+//
+//   SpscRing<T>    one producer, one consumer: each side owns one counter
+//                  and only reads the other's (Lamport's queue)
+//   MpscRing<T>    many producers, one consumer
+//   MpmcRing<T>    many producers, many consumers: each slot carries a
+//                  sequence number saying whose turn it is (Vyukov's queue)
+//
+// tryPush/tryPop never wait and return false when the ring is full/empty.
+// tryPushN/tryPopN move up to n items with one claim of the counters.
+// push/pop wait: first spinning, then yielding, and finally sleeping on a
+// condition variable, which a thread only touches when somebody is asleep.
+//
+// The producer and consumer counters sit on separate cache lines so the
+// two sides do not invalidate each other's line on every operation.
+
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#define RING_BUFFER_PAUSE() _mm_pause()
+#else
+#define RING_BUFFER_PAUSE() ((void)0)
+#endif
+
+namespace ring_detail {
+
+constexpr size_t kCacheLine = 64;
+
+inline size_t roundUpPow2(size_t n) {
+    if (n < 2) return 2;
+    if (n > (size_t(1) << (sizeof(size_t) * 8 - 2))) throw std::invalid_argument("Ring capacity too large");
+    size_t capacity = 1;
+    while (capacity < n) capacity <<= 1;
+    return capacity;
+}
+
+// Uninitialised storage for one T; the rings construct and destroy in place
+template<typename T>
+struct Storage {
+    alignas(T) unsigned char bytes[sizeof(T)];
+
+    T* get() { return std::launder(reinterpret_cast<T*>(bytes)); }
+};
+
+/**
+ * @brief Where threads sleep when spinning on a full or empty ring took
+ *        too long. One for "not empty" and one for "not full".
+ *
+ * wake() is called after every successful push or pop; it costs a fence
+ * and a load unless a thread is actually asleep.
+ */
+class alignas(kCacheLine) Parker {
+private:
+    static constexpr int kSpins = 128;
+    static constexpr int kYields = 16;
+
+    std::atomic<int> sleepers{0};
+    std::atomic<uint64_t> epoch{0};    // changed (under the mutex) by every wake-up
+    std::mutex mutex;
+    std::condition_variable cv;
+
+public:
+    void wake() {
+        // Pairs with the increment of sleepers in waitUntil: either the
+        // waiter's attempt sees our item, or we see the waiter
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers.load(std::memory_order_relaxed) != 0) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                epoch.fetch_add(1, std::memory_order_relaxed);
+            }
+            cv.notify_all();
+        }
+    }
+
+    // Repeat attempt() until it returns true. attempt() runs without the
+    // mutex held, because it wakes the other Parker.
+    template<typename Attempt>
+    void waitUntil(Attempt attempt) {
+        for (int i = 0; i < kSpins; i++) {
+            if (attempt()) return;
+            RING_BUFFER_PAUSE();
+        }
+        for (int i = 0; i < kYields; i++) {
+            if (attempt()) return;
+            std::this_thread::yield();
+        }
+        sleepers.fetch_add(1, std::memory_order_seq_cst);
+        for (;;) {
+            uint64_t seen = epoch.load(std::memory_order_relaxed);
+            if (attempt()) break;
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&]() { return epoch.load(std::memory_order_relaxed) != seen; });
+        }
+        sleepers.fetch_sub(1, std::memory_order_relaxed);
+    }
+};
+
+} // namespace ring_detail
+
+/**
+ * @brief Single-producer, single-consumer ring. Exactly one thread may
+ *        push and exactly one (other) thread may pop.
+ */
+template<typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity)
+        : mask(ring_detail::roundUpPow2(capacity) - 1),
+          slots(new ring_detail::Storage<T>[mask + 1]) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    ~SpscRing() {
+        size_t tail = producer.tail.load(std::memory_order_relaxed);
+        for (size_t pos = consumer.head.load(std::memory_order_relaxed); pos != tail; pos++) {
+            slots[pos & mask].get()->~T();
+        }
+    }
+
+    template<typename... Args>
+    bool tryEmplace(Args&&... args) {
+        size_t pos = producer.tail.load(std::memory_order_relaxed);
+        if (pos - producer.cachedHead > mask) {
+            producer.cachedHead = consumer.head.load(std::memory_order_acquire);
+            if (pos - producer.cachedHead > mask) return false;
+        }
+        ::new (slots[pos & mask].get()) T(std::forward<Args>(args)...);
+        producer.tail.store(pos + 1, std::memory_order_release);
+        notEmpty.wake();
+        return true;
+    }
+
+    bool tryPush(const T& value) { return tryEmplace(value); }
+    bool tryPush(T&& value) { return tryEmplace(std::move(value)); }
+
+    bool tryPop(T& out) {
+        size_t pos = consumer.head.load(std::memory_order_relaxed);
+        if (pos == consumer.cachedTail) {
+            consumer.cachedTail = producer.tail.load(std::memory_order_acquire);
+            if (pos == consumer.cachedTail) return false;
+        }
+        T* item = slots[pos & mask].get();
+        out = std::move(*item);
+        item->~T();
+        consumer.head.store(pos + 1, std::memory_order_release);
+        notFull.wake();
+        return true;
+    }
+
+    /**
+     * @brief Copy up to n items in. Returns how many fitted.
+     */
+    size_t tryPushN(const T* items, size_t n) {
+        size_t pos = producer.tail.load(std::memory_order_relaxed);
+        size_t space = mask + 1 - (pos - producer.cachedHead);
+        if (space < n) {
+            producer.cachedHead = consumer.head.load(std::memory_order_acquire);
+            space = mask + 1 - (pos - producer.cachedHead);
+        }
+        size_t count = n < space ? n : space;
+        if (count == 0) return 0;
+        for (size_t i = 0; i < count; i++) ::new (slots[(pos + i) & mask].get()) T(items[i]);
+        producer.tail.store(pos + count, std::memory_order_release);
+        notEmpty.wake();
+        return count;
+    }
+
+    /**
+     * @brief Move up to n items out. Returns how many there were.
+     */
+    size_t tryPopN(T* out, size_t n) {
+        size_t pos = consumer.head.load(std::memory_order_relaxed);
+        size_t available = consumer.cachedTail - pos;
+        if (available < n) {
+            consumer.cachedTail = producer.tail.load(std::memory_order_acquire);
+            available = consumer.cachedTail - pos;
+        }
+        size_t count = n < available ? n : available;
+        if (count == 0) return 0;
+        for (size_t i = 0; i < count; i++) {
+            T* item = slots[(pos + i) & mask].get();
+            out[i] = std::move(*item);
+            item->~T();
+        }
+        consumer.head.store(pos + count, std::memory_order_release);
+        notFull.wake();
+        return count;
+    }
+
+    // Wait for space, then push
+    void push(T value) {
+        notFull.waitUntil([&]() { return tryPush(std::move(value)); });
+    }
+
+    // Wait for an item, then pop it
+    T pop() {
+        T out;
+        notEmpty.waitUntil([&]() { return tryPop(out); });
+        return out;
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+    // Exact only while neither side is running
+    size_t size() const {
+        size_t head = consumer.head.load(std::memory_order_acquire);
+        return producer.tail.load(std::memory_order_acquire) - head;
+    }
+
+private:
+    // Written by the producer only; the copy of head avoids reading the
+    // consumer's cache line until the ring looks full
+    struct alignas(ring_detail::kCacheLine) ProducerSide {
+        std::atomic<size_t> tail{0};
+        size_t cachedHead = 0;
+    };
+
+    struct alignas(ring_detail::kCacheLine) ConsumerSide {
+        std::atomic<size_t> head{0};
+        size_t cachedTail = 0;
+    };
+
+    const size_t mask;
+    std::unique_ptr<ring_detail::Storage<T>[]> slots;
+    ProducerSide producer;
+    ConsumerSide consumer;
+    ring_detail::Parker notEmpty;
+    ring_detail::Parker notFull;
+};
+
+/**
+ * @brief Ring for many producers and one or many consumers.
+ *
+ * Slot i of lap k holds the sequence number k*capacity + i while it is free
+ * for the producer of that position and one more once the item is in; the
+ * consumer sets it to the next lap's position when it has taken the item.
+ * Threads claim positions with a CAS on tail (producers) or head
+ * (consumers) and then own the slot without any further synchronisation.
+ * With a single consumer the head needs no CAS.
+ */
+template<typename T, bool MultiConsumer = true>
+class MpmcRing {
+public:
+    explicit MpmcRing(size_t capacity)
+        : mask(ring_detail::roundUpPow2(capacity) - 1),
+          slots(new Slot[mask + 1]) {
+        for (size_t i = 0; i <= mask; i++) slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    MpmcRing(const MpmcRing&) = delete;
+    MpmcRing& operator=(const MpmcRing&) = delete;
+
+    ~MpmcRing() {
+        size_t tail = tailIndex.value.load(std::memory_order_relaxed);
+        for (size_t pos = headIndex.value.load(std::memory_order_relaxed); pos != tail; pos++) {
+            slots[pos & mask].storage.get()->~T();
+        }
+    }
+
+    template<typename... Args>
+    bool tryEmplace(Args&&... args) {
+        size_t pos;
+        if (claim(tailIndex.value, 0, 1, pos) == 0) return false;
+        Slot& slot = slots[pos & mask];
+        ::new (slot.storage.get()) T(std::forward<Args>(args)...);
+        slot.sequence.store(pos + 1, std::memory_order_release);
+        notEmpty.wake();
+        return true;
+    }
+
+    bool tryPush(const T& value) { return tryEmplace(value); }
+    bool tryPush(T&& value) { return tryEmplace(std::move(value)); }
+
+    bool tryPop(T& out) {
+        size_t pos;
+        if (claim(headIndex.value, 1, 1, pos) == 0) return false;
+        Slot& slot = slots[pos & mask];
+        T* item = slot.storage.get();
+        out = std::move(*item);
+        item->~T();
+        slot.sequence.store(pos + mask + 1, std::memory_order_release);
+        notFull.wake();
+        return true;
+    }
+
+    /**
+     * @brief Copy up to n items in, into consecutive positions claimed with
+     *        one CAS. Returns how many fitted.
+     */
+    size_t tryPushN(const T* items, size_t n) {
+        size_t pos;
+        size_t count = claim(tailIndex.value, 0, n, pos);
+        if (count == 0) return 0;
+        for (size_t i = 0; i < count; i++) {
+            Slot& slot = slots[(pos + i) & mask];
+            ::new (slot.storage.get()) T(items[i]);
+            slot.sequence.store(pos + i + 1, std::memory_order_release);
+        }
+        notEmpty.wake();
+        return count;
+    }
+
+    /**
+     * @brief Move up to n items out of consecutive positions claimed with
+     *        one CAS. Returns how many there were.
+     */
+    size_t tryPopN(T* out, size_t n) {
+        size_t pos;
+        size_t count = claim(headIndex.value, 1, n, pos);
+        if (count == 0) return 0;
+        for (size_t i = 0; i < count; i++) {
+            Slot& slot = slots[(pos + i) & mask];
+            T* item = slot.storage.get();
+            out[i] = std::move(*item);
+            item->~T();
+            slot.sequence.store(pos + i + mask + 1, std::memory_order_release);
+        }
+        notFull.wake();
+        return count;
+    }
+
+    // Wait for space, then push
+    void push(T value) {
+        notFull.waitUntil([&]() { return tryPush(std::move(value)); });
+    }
+
+    // Wait for an item, then pop it
+    T pop() {
+        T out;
+        notEmpty.waitUntil([&]() { return tryPop(out); });
+        return out;
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+    // Exact only while no thread is pushing or popping
+    size_t size() const {
+        size_t head = headIndex.value.load(std::memory_order_acquire);
+        return tailIndex.value.load(std::memory_order_acquire) - head;
+    }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        ring_detail::Storage<T> storage;
+    };
+
+    struct alignas(ring_detail::kCacheLine) PaddedIndex {
+        std::atomic<size_t> value{0};
+    };
+
+    const size_t mask;
+    std::unique_ptr<Slot[]> slots;
+    PaddedIndex tailIndex;
+    PaddedIndex headIndex;
+    ring_detail::Parker notEmpty;
+    ring_detail::Parker notFull;
+
+    // Claim up to n consecutive positions from index, whose slots must be
+    // ready: sequence == position + offset (0 for producers, 1 for
+    // consumers). Returns the number claimed and the first in pos.
+    size_t claim(std::atomic<size_t>& index, size_t offset, size_t n, size_t& pos) {
+        pos = index.load(std::memory_order_relaxed);
+        for (;;) {
+            size_t ready = 0;
+            while (ready < n) {
+                size_t sequence = slots[(pos + ready) & mask].sequence.load(std::memory_order_acquire);
+                if (sequence != pos + ready + offset) break;
+                ready++;
+            }
+            if (ready == 0) {
+                // Either full/empty, or another thread claimed pos already
+                size_t sequence = slots[pos & mask].sequence.load(std::memory_order_acquire);
+                if (static_cast<std::ptrdiff_t>(sequence - (pos + offset)) < 0) return 0;
+                pos = index.load(std::memory_order_relaxed);
+                continue;
+            }
+            // A single consumer has nobody to race with for head
+            if (offset == 1 && !MultiConsumer) {
+                index.store(pos + ready, std::memory_order_relaxed);
+                return ready;
+            }
+            if (index.compare_exchange_weak(pos, pos + ready, std::memory_order_relaxed)) return ready;
+        }
+    }
+};
+
+template<typename T>
+using MpscRing = MpmcRing<T, false>;
+
+#endif // RING_BUFFER_H
@@ -0,0 +1,210 @@
+// Lesson16_sharded_stats.cpp : This file contains the 'main' function. Program execution begins and ends there.
+//
+// Increments per second against the number of threads for ThreadSafeCounter
+// (Lesson16_4), a single std::atomic and ShardedCounter, followed by the
+// other sharded statistics: gauge, min/max and histogram.
+//
+// Usage: Lesson16_sharded_stats [opsPerThread] [maxThreads]
+//   Defaults: 2000000 operations per thread, up to 64 threads.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ShardedStats.h"
+
+// As in Lesson16_4, with a 64-bit count
+class ThreadSafeCounter {
+private:
+    uint64_t count = 0;
+    std::mutex mutex;
+
+public:
+    void increment() {
+        std::lock_guard<std::mutex> lock(mutex);
+        count++;
+    }
+
+    uint64_t getValue() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return count;
+    }
+};
+
+class AtomicCounter {
+private:
+    std::atomic<uint64_t> count{0};
+
+public:
+    void increment() { count.fetch_add(1, std::memory_order_relaxed); }
+    uint64_t getValue() const { return count.load(); }
+};
+
+// Each thread calls op(thread, i) opsPerThread times. Returns million
+// operations per second.
+template<typename Op>
+double runThreads(int threadCount, size_t opsPerThread, Op op) {
+    std::atomic<bool> go(false);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; t++) {
+        threads.emplace_back([&, t]() {
+            while (!go.load()) std::this_thread::yield();
+            for (size_t i = 0; i < opsPerThread; i++) op(t, i);
+        });
+    }
+    auto start = std::chrono::steady_clock::now();
+    go = true;
+    for (auto& thread : threads) thread.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return threadCount * opsPerThread / seconds / 1e6;
+}
+
+void sanityCheck() {
+    const int threads = 8;
+    const size_t perThread = 100000;
+
+    // Fewer shards than threads, so shards are shared and flushes race
+    ShardedCounter counter(4, 100);
+    ShardedGauge gauge(4, 100);
+    ShardedMinMax<int64_t> minMax(4, 100);
+    ShardedHistogram histogram(4, 100);
+    if (!minMax.snapshot().empty() || histogram.snapshot().totalCount() != 0) {
+        throw std::logic_error("new statistics not empty");
+    }
+    runThreads(threads, perThread, [&](int t, size_t i) {
+        counter.increment();
+        gauge.add(i % 2 == 0 ? 3 : -1);
+        minMax.record(static_cast<int64_t>(i) * (t % 2 == 0 ? 1 : -1));
+        histogram.record(i % 1000);
+    });
+
+    if (counter.snapshot() != threads * perThread) throw std::logic_error("ShardedCounter lost increments");
+    if (counter.read() > counter.snapshot() || counter.read() + counter.shardCount() * 100 < counter.snapshot()) {
+        throw std::logic_error("ShardedCounter::read() lags more than flushEvery per shard");
+    }
+    if (gauge.snapshot() != static_cast<int64_t>(threads * perThread)) throw std::logic_error("ShardedGauge wrong");
+    MinMax<int64_t> extremes = minMax.snapshot();
+    if (extremes.min != -static_cast<int64_t>(perThread - 1) || extremes.max != static_cast<int64_t>(perThread - 1)) {
+        throw std::logic_error("ShardedMinMax wrong");
+    }
+    HistogramSnapshot h = histogram.snapshot();
+    if (h.totalCount() != threads * perThread || h.total() != threads * (perThread / 1000) * 499500 ||
+        h.min() != 0 || h.max() != 999) {
+        throw std::logic_error("ShardedHistogram count, sum or range wrong");
+    }
+    // 0..999 uniformly: percentiles within the 1/16 bucket error
+    for (double p : { 0.1, 0.5, 0.9, 0.99 }) {
+        double expected = p * 999, got = static_cast<double>(h.percentile(p));
+        if (got > expected || got < expected * 15 / 16 - 1) {
+            throw std::logic_error("percentile " + std::to_string(p) + " off: " + std::to_string(got));
+        }
+    }
+
+    // Bucket boundaries: every value lands in the bucket that starts at or below it
+    std::mt19937_64 rng(3);
+    for (int i = 0; i < 100000; i++) {
+        uint64_t v = rng() >> (rng() % 64);
+        size_t b = HistogramSnapshot::bucketOf(v);
+        if (HistogramSnapshot::bucketStart(b) > v ||
+            (b + 1 < HistogramSnapshot::kBuckets && HistogramSnapshot::bucketStart(b + 1) <= v)) {
+            throw std::logic_error("value " + std::to_string(v) + " in the wrong bucket");
+        }
+    }
+
+    // Merging two snapshots is the same as recording into one histogram
+    ShardedHistogram a(2), b(2), both(2);
+    for (uint64_t v = 0; v < 5000; v++) {
+        (v % 3 == 0 ? a : b).record(v * 37);
+        both.record(v * 37);
+    }
+    HistogramSnapshot merged = a.snapshot();
+    merged.merge(b.snapshot());
+    HistogramSnapshot direct = both.snapshot();
+    for (size_t i = 0; i < HistogramSnapshot::kBuckets; i++) {
+        if (merged.bucketCount(i) != direct.bucketCount(i)) throw std::logic_error("merged histogram differs");
+    }
+    if (merged.total() != direct.total() || merged.percentile(0.5) != direct.percentile(0.5)) {
+        throw std::logic_error("merged histogram differs");
+    }
+
+    // A snapshot taken during updates never sees half an update: every
+    // value recorded is 7, so the sum must always be 7 x the count
+    ShardedHistogram sevens(2);
+    std::atomic<bool> done(false), torn(false);
+    std::thread reader([&]() {
+        while (!done.load()) {
+            HistogramSnapshot s = sevens.snapshot();
+            if (s.total() != 7 * s.totalCount() || s.bucketCount(7) != s.totalCount()) torn = true;
+        }
+    });
+    runThreads(4, 50000, [&](int, size_t) { sevens.record(7); });
+    done = true;
+    reader.join();
+    if (torn) throw std::logic_error("torn histogram snapshot");
+
+    std::cout << "Sanity check passed\n\n";
+}
+
+int main(int argc, char* argv[]) {
+    size_t opsPerThread = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+    int maxThreads = argc > 2 ? std::atoi(argv[2]) : 64;
+
+    sanityCheck();
+
+    std::cout << "Hardware threads: " << std::thread::hardware_concurrency() << ", "
+              << sharded_stats_detail::defaultShards() << " shards by default\n";
+    std::cout << "Million operations per second, " << opsPerThread << " per thread\n\n";
+    std::cout << std::left << std::setw(10) << "threads" << std::right << std::setw(14) << "mutex"
+              << std::setw(14) << "std::atomic" << std::setw(14) << "sharded" << std::setw(14) << "gauge"
+              << std::setw(14) << "min/max" << std::setw(14) << "histogram" << "\n";
+
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        // Enough shards for every thread, as defaultShards() gives on a machine with that many cores
+        size_t shards = std::max<size_t>(threads, sharded_stats_detail::defaultShards());
+        ThreadSafeCounter locked;
+        AtomicCounter atomic;
+        ShardedCounter sharded(shards);
+        ShardedGauge gauge(shards);
+        ShardedMinMax<uint64_t> minMax(shards);
+        ShardedHistogram histogram(shards);
+
+        double results[] = {
+            runThreads(threads, opsPerThread, [&](int, size_t) { locked.increment(); }),
+            runThreads(threads, opsPerThread, [&](int, size_t) { atomic.increment(); }),
+            runThreads(threads, opsPerThread, [&](int, size_t) { sharded.increment(); }),
+            runThreads(threads, opsPerThread, [&](int, size_t i) { gauge.add(i & 1 ? 1 : -1); }),
+            runThreads(threads, opsPerThread, [&](int t, size_t i) { minMax.record(i * 2654435761u + t); }),
+            runThreads(threads, opsPerThread, [&](int, size_t i) { histogram.record(i & 0xFFFF); }),
+        };
+        if (locked.getValue() != atomic.getValue() || sharded.snapshot() != atomic.getValue()) {
+            throw std::logic_error("counters disagree");
+        }
+
+        std::cout << std::left << std::setw(10) << threads << std::right << std::fixed << std::setprecision(1);
+        for (double mops : results) std::cout << std::setw(14) << mops;
+        std::cout << "\n";
+    }
+
+    return 0;
+}
+
+// Run program: Ctrl + F5 or Debug > Start Without Debugging menu
+// Debug program: F5 or Debug > Start Debugging menu
+
+// Tips for Getting Started:
+//   1. Use the Solution Explorer window to add/manage files
+//   2. Use the Team Explorer window to connect to source control
+//   3. Use the Output window to see build output and other messages
+//   4. Use the Error List window to view errors
+//   5. Go to Project > Add New Item to create new code files, or Project > Add Existing Item to add existing code files to the project
+//   6. In the future, to open this project again, go to File > Open > Project and select the .sln file
@@ -0,0 +1,448 @@
+// ShardedStats.h
+//
+// Counters and statistics that many threads can update at full speed.
+//
+// ThreadSafeCounter in "Lesson16_4_threads_locks.md" locks a mutex for
+// every increment. Even a lone std::atomic counter does not scale: each
+// increment needs the cache line that holds it, so with many threads the
+// line moves from core to core on every operation. These classes split
+// the value into shards, one cache line each. A thread always updates
+// "its" shard (threads are dealt shards round robin), so as long as there
+// are at least as many shards as threads nobody shares a line.
+//
+// Reading has to combine the shards, so there are two ways to read:
+//
+//   snapshot()  visits every shard: exact - it includes every update that
+//               finished before the call - and costs O(shards)
+//   read()      O(1): a shared total that each shard tops up after every
+//               flushEvery of its updates. It lags behind by at most
+//               flushEvery updates per shard; ideal for progress displays
+//
+//   ShardedCounter      add(n), increment()
+//   ShardedGauge        add(delta), increment(), decrement() - may go down
+//   ShardedMinMax<T>    record(value) - smallest and largest value seen
+//   ShardedHistogram    record(value) - count, sum, min, max and
+//                       percentiles of uint64_t values; snapshots merge
+//
+// A histogram update touches several fields, so each histogram shard is a
+// sequence lock (as in ConcurrentDictionary): updates of one shard take
+// turns, and snapshot() retries a shard it saw being updated, so it never
+// sees half of an update.
+
+#ifndef SHARDED_STATS_H
+#define SHARDED_STATS_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace sharded_stats_detail {
+
+// At least one shard per hardware thread, rounded up to a power of two
+inline size_t defaultShards() {
+    size_t shards = 1;
+    while (shards < std::thread::hardware_concurrency()) shards <<= 1;
+    return shards;
+}
+
+inline size_t roundUpPow2(size_t n) {
+    size_t shards = 1;
+    while (shards < n) shards <<= 1;
+    return shards;
+}
+
+// The calling thread's shard number before masking; dealt round robin
+inline size_t threadSlot() {
+    static std::atomic<size_t> next(0);
+    thread_local size_t slot = next.fetch_add(1, std::memory_order_relaxed);
+    return slot;
+}
+
+inline unsigned floorLog2(uint64_t v) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, v);
+    return index;
+#else
+    return 63 - __builtin_clzll(v);
+#endif
+}
+
+// Add the part of total not yet in global once it reaches flushEvery.
+// flushed is how much of this shard's total global already holds; the CAS
+// makes sure only one of the threads sharing a shard moves each amount.
+template<typename V>
+void flushIfDue(V total, std::atomic<V>& flushed, std::atomic<V>& global, V flushEvery) {
+    V done = flushed.load(std::memory_order_relaxed);
+    V pending = total - done;
+    if (pending >= flushEvery || pending <= -flushEvery) {
+        if (flushed.compare_exchange_strong(done, total, std::memory_order_relaxed)) {
+            global.fetch_add(total - done, std::memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * @brief A running total split over cache-line sized shards. Shared by
+ *        ShardedCounter and ShardedGauge.
+ */
+template<typename V>
+class ShardedSum {
+public:
+    ShardedSum(size_t shardCount, V flushEvery)
+        : mask(roundUpPow2(shardCount) - 1), shards(new Shard[mask + 1]), flushEvery(flushEvery) {
+        if (flushEvery <= 0) throw std::invalid_argument("flushEvery must be positive");
+    }
+
+    void add(V delta) {
+        Shard& shard = shards[threadSlot() & mask];
+        V total = shard.total.fetch_add(delta, std::memory_order_relaxed) + delta;
+        flushIfDue(total, shard.flushed, published, flushEvery);
+    }
+
+    V read() const { return published.load(std::memory_order_relaxed); }
+
+    V snapshot() const {
+        V sum = 0;
+        for (size_t i = 0; i <= mask; i++) sum += shards[i].total.load(std::memory_order_acquire);
+        return sum;
+    }
+
+    size_t shardCount() const { return mask + 1; }
+
+private:
+    // alignas gives every shard a cache line of its own
+    struct alignas(64) Shard {
+        std::atomic<V> total{0};      // everything added to this shard, ever
+        std::atomic<V> flushed{0};    // the part of total already in published
+    };
+
+    size_t mask;
+    std::unique_ptr<Shard[]> shards;
+    V flushEvery;
+    alignas(64) std::atomic<V> published{0};
+};
+
+} // namespace sharded_stats_detail
+
+/**
+ * @brief Event counter: only goes up.
+ */
+class ShardedCounter {
+public:
+    explicit ShardedCounter(size_t shardCount = sharded_stats_detail::defaultShards(), uint64_t flushEvery = 1024)
+        : sum(shardCount, static_cast<int64_t>(flushEvery)) {}
+
+    void add(uint64_t n) { sum.add(static_cast<int64_t>(n)); }
+    void increment() { sum.add(1); }
+
+    // O(1); may lag by up to flushEvery per shard
+    uint64_t read() const { return static_cast<uint64_t>(sum.read()); }
+
+    // Exact; visits every shard
+    uint64_t snapshot() const { return static_cast<uint64_t>(sum.snapshot()); }
+
+    size_t shardCount() const { return sum.shardCount(); }
+
+private:
+    sharded_stats_detail::ShardedSum<int64_t> sum;
+};
+
+/**
+ * @brief A level that goes up and down, e.g. requests in flight.
+ *
+ * There is no set(): with the value spread over shards, "set to 5" has no
+ * cheap meaning. Each shard on its own may be negative; the total is right.
+ */
+class ShardedGauge {
+public:
+    explicit ShardedGauge(size_t shardCount = sharded_stats_detail::defaultShards(), int64_t flushEvery = 1024)
+        : sum(shardCount, flushEvery) {}
+
+    void add(int64_t delta) { sum.add(delta); }
+    void increment() { sum.add(1); }
+    void decrement() { sum.add(-1); }
+
+    int64_t read() const { return sum.read(); }
+    int64_t snapshot() const { return sum.snapshot(); }
+
+    size_t shardCount() const { return sum.shardCount(); }
+
+private:
+    sharded_stats_detail::ShardedSum<int64_t> sum;
+};
+
+template<typename T>
+struct MinMax {
+    T min;
+    T max;
+
+    // True until a value has been recorded
+    bool empty() const { return max < min; }
+};
+
+/**
+ * @brief Smallest and largest value recorded.
+ *
+ * A shard's min and max are only written when a value beats them, which
+ * soon becomes rare, so record() is mostly two loads plus the count that
+ * decides when to flush, all on the thread's own cache line.
+ */
+template<typename T>
+class ShardedMinMax {
+public:
+    explicit ShardedMinMax(size_t shardCount = sharded_stats_detail::defaultShards(), uint64_t flushEvery = 1024)
+        : mask(sharded_stats_detail::roundUpPow2(shardCount) - 1), shards(new Shard[mask + 1]),
+          flushMask(sharded_stats_detail::roundUpPow2(flushEvery) - 1) {}
+
+    void record(T value) {
+        Shard& shard = shards[sharded_stats_detail::threadSlot() & mask];
+        lower(shard.min, value);
+        raise(shard.max, value);
+        if ((shard.records.fetch_add(1, std::memory_order_relaxed) & flushMask) == flushMask) {
+            lower(global.min, shard.min.load(std::memory_order_relaxed));
+            raise(global.max, shard.max.load(std::memory_order_relaxed));
+        }
+    }
+
+    // O(1); may miss extremes recorded since a shard's last flush
+    MinMax<T> read() const {
+        return MinMax<T>{ global.min.load(std::memory_order_relaxed), global.max.load(std::memory_order_relaxed) };
+    }
+
+    // Exact; visits every shard
+    MinMax<T> snapshot() const {
+        MinMax<T> result = read();
+        for (size_t i = 0; i <= mask; i++) {
+            result.min = std::min(result.min, shards[i].min.load(std::memory_order_acquire));
+            result.max = std::max(result.max, shards[i].max.load(std::memory_order_acquire));
+        }
+        return result;
+    }
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<T> min{ std::numeric_limits<T>::max() };
+        std::atomic<T> max{ std::numeric_limits<T>::lowest() };
+        std::atomic<uint64_t> records{0};
+    };
+
+    size_t mask;
+    std::unique_ptr<Shard[]> shards;
+    uint64_t flushMask;    // flushEvery rounded up to a power of two, minus 1
+    Shard global;
+
+    static void lower(std::atomic<T>& current, T value) {
+        T seen = current.load(std::memory_order_relaxed);
+        while (value < seen && !current.compare_exchange_weak(seen, value, std::memory_order_release)) {
+        }
+    }
+
+    static void raise(std::atomic<T>& current, T value) {
+        T seen = current.load(std::memory_order_relaxed);
+        while (seen < value && !current.compare_exchange_weak(seen, value, std::memory_order_release)) {
+        }
+    }
+};
+
+/**
+ * @brief The contents of a ShardedHistogram at one point, which can be
+ *        queried and merged with snapshots of other histograms.
+ *
+ * Values below 16 have a bucket each; above that every power of two is
+ * split into 16 buckets, so a percentile is within 1/16 (6.25%) of the
+ * true value, with 976 buckets covering all of uint64_t.
+ */
+class HistogramSnapshot {
+public:
+    static constexpr unsigned kSubBits = 4;
+    static constexpr size_t kSub = size_t(1) << kSubBits;
+    static constexpr size_t kBuckets = (64 - kSubBits + 1) * kSub;
+
+    HistogramSnapshot() : buckets(kBuckets, 0), count(0), sum(0),
+                          minimum(std::numeric_limits<uint64_t>::max()), maximum(0) {}
+
+    static size_t bucketOf(uint64_t value) {
+        if (value < kSub) return static_cast<size_t>(value);
+        unsigned log = sharded_stats_detail::floorLog2(value);
+        unsigned shift = log - kSubBits;
+        return (log - kSubBits + 1) * kSub + static_cast<size_t>((value >> shift) & (kSub - 1));
+    }
+
+    // Smallest value that falls into bucket
+    static uint64_t bucketStart(size_t bucket) {
+        if (bucket < kSub) return bucket;
+        unsigned shift = static_cast<unsigned>(bucket / kSub - 1);
+        return static_cast<uint64_t>(kSub + bucket % kSub) << shift;
+    }
+
+    /**
+     * @brief Add one value directly. Not thread-safe: for building a
+     *        histogram on one thread, e.g. from events recorded earlier.
+     */
+    void record(uint64_t value) {
+        buckets[bucketOf(value)]++;
+        count++;
+        sum += value;
+        minimum = std::min(minimum, value);
+        maximum = std::max(maximum, value);
+    }
+
+    void merge(const HistogramSnapshot& other) {
+        for (size_t i = 0; i < kBuckets; i++) buckets[i] += other.buckets[i];
+        count += other.count;
+        sum += other.sum;
+        minimum = std::min(minimum, other.minimum);
+        maximum = std::max(maximum, other.maximum);
+    }
+
+    uint64_t totalCount() const { return count; }
+    uint64_t total() const { return sum; }
+    uint64_t min() const { return minimum; }
+    uint64_t max() const { return maximum; }
+    double mean() const { return count == 0 ? 0.0 : static_cast<double>(sum) / count; }
+
+    /**
+     * @brief The value below which fraction p (0..1) of the values fall,
+     *        as the start of its bucket, clamped to [min, max].
+     */
+    uint64_t percentile(double p) const {
+        if (count == 0) throw std::logic_error("Percentile of an empty histogram");
+        uint64_t rank = static_cast<uint64_t>(p * (count - 1));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBuckets; i++) {
+            seen += buckets[i];
+            if (seen > rank) return std::min(std::max(bucketStart(i), minimum), maximum);
+        }
+        return maximum;
+    }
+
+    uint64_t bucketCount(size_t bucket) const { return buckets[bucket]; }
+
+private:
+    std::vector<uint64_t> buckets;
+    uint64_t count;
+    uint64_t sum;
+    uint64_t minimum;
+    uint64_t maximum;
+
+    friend class ShardedHistogram;
+};
+
+/**
+ * @brief Histogram of uint64_t values (latencies in ns, sizes in bytes...).
+ *
+ * read() gives the count alone in O(1); snapshot() the full distribution.
+ */
+class ShardedHistogram {
+public:
+    explicit ShardedHistogram(size_t shardCount = sharded_stats_detail::defaultShards(), uint64_t flushEvery = 1024)
+        : mask(sharded_stats_detail::roundUpPow2(shardCount) - 1), shards(new Shard[mask + 1]),
+          flushEvery(flushEvery) {}
+
+    void record(uint64_t value) {
+        Shard& shard = shards[sharded_stats_detail::threadSlot() & mask];
+        size_t bucket = HistogramSnapshot::bucketOf(value);
+        WriteSection section(shard);
+        // Only the lock holder writes, so plain load + store, no atomic add
+        bump(shard.buckets[bucket], 1);
+        bump(shard.sum, value);
+        uint64_t count = shard.count.load(std::memory_order_relaxed) + 1;
+        shard.count.store(count, std::memory_order_relaxed);
+        if (value < shard.min.load(std::memory_order_relaxed)) shard.min.store(value, std::memory_order_relaxed);
+        if (value > shard.max.load(std::memory_order_relaxed)) shard.max.store(value, std::memory_order_relaxed);
+        if (count - shard.flushedCount >= flushEvery) {
+            published.fetch_add(count - shard.flushedCount, std::memory_order_relaxed);
+            shard.flushedCount = count;
+        }
+    }
+
+    // O(1) approximate number of values recorded
+    uint64_t read() const { return published.load(std::memory_order_relaxed); }
+
+    // Every shard copied between two updates of it, and merged
+    HistogramSnapshot snapshot() const {
+        HistogramSnapshot result;
+        HistogramSnapshot copy;
+        for (size_t i = 0; i <= mask; i++) {
+            readShard(shards[i], copy);
+            result.merge(copy);
+        }
+        return result;
+    }
+
+    size_t shardCount() const { return mask + 1; }
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> seq{0};    // odd while the shard is being updated
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> sum{0};
+        std::atomic<uint64_t> min{ std::numeric_limits<uint64_t>::max() };
+        std::atomic<uint64_t> max{0};
+        uint64_t flushedCount = 0;       // guarded by seq
+        std::atomic<uint64_t> buckets[HistogramSnapshot::kBuckets] = {};
+    };
+
+    // Takes the shard's sequence lock: waits for an even seq and makes it odd
+    class WriteSection {
+    public:
+        explicit WriteSection(Shard& s) : shard(s) {
+            uint64_t seq = shard.seq.load(std::memory_order_relaxed);
+            for (;;) {
+                if ((seq & 1) == 0 &&
+                    shard.seq.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+                    break;
+                }
+                std::this_thread::yield();
+                seq = shard.seq.load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+        ~WriteSection() {
+            shard.seq.store(shard.seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+    private:
+        Shard& shard;
+    };
+
+    size_t mask;
+    std::unique_ptr<Shard[]> shards;
+    uint64_t flushEvery;
+    alignas(64) std::atomic<uint64_t> published{0};
+
+    static void bump(std::atomic<uint64_t>& field, uint64_t by) {
+        field.store(field.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+
+    static void readShard(const Shard& shard, HistogramSnapshot& out) {
+        for (;;) {
+            uint64_t before = shard.seq.load(std::memory_order_acquire);
+            if (before & 1) {
+                std::this_thread::yield();
+                continue;
+            }
+            for (size_t i = 0; i < HistogramSnapshot::kBuckets; i++) {
+                out.buckets[i] = shard.buckets[i].load(std::memory_order_relaxed);
+            }
+            out.count = shard.count.load(std::memory_order_relaxed);
+            out.sum = shard.sum.load(std::memory_order_relaxed);
+            out.minimum = shard.min.load(std::memory_order_relaxed);
+            out.maximum = shard.max.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (shard.seq.load(std::memory_order_relaxed) == before) return;
+        }
+    }
+};
+
+#endif // SHARDED_STATS_H
@@ -0,0 +1,277 @@
+// Lesson16_work_stealing_pool.cpp : This file contains the 'main' function. Program execution begins and ends there.
+//
+// Runs many small (1 microsecond) and a few coarse (1 millisecond) tasks
+// four ways, for 1, 2, 4, ... worker threads:
+//
+//   thread per task     a new std::thread per task, joined, as in Lesson16_1
+//   shared queue        ThreadPool + TaskGroup from Lesson12_parallel_sort
+//   submit + future     WorkStealingPool::submit, one future per task
+//   parallelFor         WorkStealingPool parallelFor, one index per task
+//
+// Efficiency is the time the tasks themselves take divided by workers x
+// elapsed time: 100% means no overhead at all.
+//
+// Usage: Lesson16_work_stealing_pool [maxWorkers]
+//   Default: the number of hardware threads (at least 4).
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Lesson12_parallel_sort/ThreadPool.h"
+#include "WorkStealingPool.h"
+
+typedef std::chrono::steady_clock Clock;
+
+// Spin for the given time, standing in for a task's real work
+void busyWork(std::chrono::nanoseconds duration) {
+    auto end = Clock::now() + duration;
+    while (Clock::now() < end) {
+    }
+}
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+double threadPerTask(size_t tasks, size_t workers, std::chrono::nanoseconds work) {
+    auto start = Clock::now();
+    for (size_t done = 0; done < tasks;) {
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < workers && done < tasks; i++, done++) {
+            threads.emplace_back(busyWork, work);
+        }
+        for (std::thread& thread : threads) thread.join();
+    }
+    return secondsSince(start);
+}
+
+double sharedQueue(size_t tasks, size_t workers, std::chrono::nanoseconds work) {
+    ThreadPool pool(workers - 1);    // the waiting caller runs tasks too
+    auto start = Clock::now();
+    TaskGroup group(pool);
+    for (size_t i = 0; i < tasks; i++) {
+        group.run([work]() { busyWork(work); });
+    }
+    group.wait();
+    return secondsSince(start);
+}
+
+double submitFutures(size_t tasks, size_t workers, std::chrono::nanoseconds work) {
+    WorkStealingPool pool(workers);
+    auto start = Clock::now();
+    std::vector<std::future<void>> futures;
+    futures.reserve(tasks);
+    for (size_t i = 0; i < tasks; i++) {
+        futures.push_back(pool.submit([work]() { busyWork(work); }));
+    }
+    for (auto& future : futures) future.get();
+    return secondsSince(start);
+}
+
+double stealingFor(size_t tasks, size_t workers, std::chrono::nanoseconds work) {
+    WorkStealingPool pool(workers);
+    auto start = Clock::now();
+    // Started from inside the pool, so the caller does not add a thread
+    pool.submit([&]() {
+        parallelFor(0, tasks, pool, [work](size_t) { busyWork(work); }, 1);
+    }).get();
+    return secondsSince(start);
+}
+
+void sanityCheck() {
+    WorkStealingPool pool(4);
+
+    if (pool.submit([]() { return 6 * 7; }).get() != 42) throw std::logic_error("submit returned the wrong value");
+    auto owned = std::make_unique<int>(5);
+    if (pool.submit([p = std::move(owned)]() { return *p; }).get() != 5) {
+        throw std::logic_error("move-only task failed");
+    }
+    bool threw = false;
+    try {
+        pool.submit([]() { throw std::runtime_error("task failed"); }).get();
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    if (!threw) throw std::logic_error("submit lost an exception");
+
+    // Every index exactly once, for awkward sizes and grains, and nested
+    for (size_t n : { 0, 1, 1000, 100003 }) {
+        for (size_t grain : { 0, 1, 7 }) {
+            std::vector<std::atomic<int>> hits(n);
+            parallelFor(0, n, pool, [&](size_t i) { hits[i]++; }, grain);
+            for (size_t i = 0; i < n; i++) {
+                if (hits[i] != 1) throw std::logic_error("parallelFor ran index " + std::to_string(i) + " wrongly");
+            }
+        }
+    }
+    std::atomic<size_t> nested(0);
+    parallelFor(0, 50, pool, [&](size_t) {
+        parallelFor(0, 100, pool, [&](size_t) { nested++; }, 3);
+    }, 1);
+    if (nested != 5000) throw std::logic_error("nested parallelFor lost iterations");
+    threw = false;
+    try {
+        parallelFor(0, 1000, pool, [](size_t i) {
+            if (i == 500) throw std::runtime_error("index failed");
+        }, 10);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    if (!threw) throw std::logic_error("parallelFor lost an exception");
+
+    // combine is applied left to right: concatenation must keep the order
+    std::vector<int> sequence = parallelReduce(0, 1000, pool, std::vector<int>(),
+        [](size_t lo, size_t hi) {
+            std::vector<int> piece;
+            for (size_t i = lo; i < hi; i++) piece.push_back(static_cast<int>(i));
+            return piece;
+        },
+        [](std::vector<int> a, const std::vector<int>& b) {
+            a.insert(a.end(), b.begin(), b.end());
+            return a;
+        }, 9);
+    for (int i = 0; i < 1000; i++) {
+        if (sequence.size() != 1000 || sequence[i] != i) throw std::logic_error("parallelReduce out of order");
+    }
+    uint64_t sum = parallelReduce(0, 1000000, pool, uint64_t(0),
+        [](size_t lo, size_t hi) {
+            uint64_t s = 0;
+            for (size_t i = lo; i < hi; i++) s += i;
+            return s;
+        },
+        [](uint64_t a, uint64_t b) { return a + b; });
+    if (sum != 999999ull * 1000000ull / 2) throw std::logic_error("parallelReduce sum wrong");
+
+    // A task waiting for its own sub-tasks must not deadlock a 1-worker pool
+    WorkStealingPool single(1);
+    std::function<uint64_t(int)> fib = [&](int n) -> uint64_t {
+        if (n < 2) return n;
+        std::future<uint64_t> left = single.submit([&fib, n]() { return fib(n - 1); });
+        uint64_t right = fib(n - 2);
+        return single.get(left) + right;
+    };
+    if (single.submit([&]() { return fib(15); }).get() != 610) throw std::logic_error("recursive submit failed");
+
+    // Cancellation: before start, while running, and inside a parallelFor
+    CancellationToken early;
+    early.cancel();
+    std::atomic<bool> ran(false);
+    std::future<void> skipped = pool.submit(early, [&]() { ran = true; });
+    threw = false;
+    try {
+        skipped.get();
+    } catch (const TaskCancelled&) {
+        threw = true;
+    }
+    if (!threw || ran) throw std::logic_error("task cancelled before start still ran");
+
+    CancellationToken token;
+    std::atomic<bool> started(false);
+    std::future<int> loop = pool.submit(token, [&]() {
+        started = true;
+        for (;;) {
+            this_task::interruptionPoint();
+            std::this_thread::yield();
+        }
+        return 0;
+    });
+    while (!started) std::this_thread::yield();
+    token.cancel();
+    threw = false;
+    try {
+        loop.get();
+    } catch (const TaskCancelled&) {
+        threw = true;
+    }
+    if (!threw) throw std::logic_error("running task not interrupted");
+
+    CancellationToken forToken;
+    std::atomic<size_t> iterations(0);
+    std::future<void> cancelledFor = pool.submit(forToken, [&]() {
+        parallelFor(0, 1000000, pool, [&](size_t) {
+            if (++iterations == 1000) forToken.cancel();
+        }, 100);
+    });
+    threw = false;
+    try {
+        cancelledFor.get();
+    } catch (const TaskCancelled&) {
+        threw = true;
+    }
+    if (!threw || iterations >= 1000000) throw std::logic_error("parallelFor not cancelled");
+
+    // Tasks still queued when the pool is destroyed are run, not dropped
+    std::atomic<int> counter(0);
+    {
+        WorkStealingPool shortLived(2);
+        for (int i = 0; i < 1000; i++) shortLived.submit([&]() { counter++; });
+    }
+    if (counter != 1000) throw std::logic_error("pool dropped queued tasks");
+
+    std::cout << "Sanity check passed\n\n";
+}
+
+void benchmark(const std::string& title, size_t tasks, size_t threadTasks, std::chrono::nanoseconds work,
+               size_t maxWorkers) {
+    std::cout << title << ": " << tasks << " tasks of " << work.count() / 1000.0 << " us\n";
+    std::cout << std::left << std::setw(10) << "workers" << std::right << std::setw(22) << "thread per task"
+              << std::setw(22) << "shared queue" << std::setw(22) << "submit + future" << std::setw(22)
+              << "parallelFor" << "\n";
+    std::cout << std::left << std::setw(10) << "" << std::right;
+    for (int i = 0; i < 4; i++) std::cout << std::setw(13) << "ktasks/s" << std::setw(9) << "eff %";
+    std::cout << "\n";
+
+    for (size_t workers = 1; workers <= maxWorkers; workers *= 2) {
+        // Thread creation is too slow to start every task on a new thread
+        double seconds[4] = {
+            threadPerTask(threadTasks, workers, work) * tasks / threadTasks,
+            sharedQueue(tasks, workers, work),
+            submitFutures(tasks, workers, work),
+            stealingFor(tasks, workers, work),
+        };
+        double ideal = tasks * std::chrono::duration<double>(work).count();
+        std::cout << std::left << std::setw(10) << workers << std::right << std::fixed;
+        for (double s : seconds) {
+            std::cout << std::setprecision(1) << std::setw(13) << tasks / s / 1e3 << std::setprecision(0)
+                      << std::setw(9) << 100.0 * ideal / (workers * s);
+        }
+        std::cout << "\n";
+    }
+    std::cout << "\n";
+}
+
+int main(int argc, char* argv[]) {
+    size_t maxWorkers = argc > 1 ? std::strtoull(argv[1], nullptr, 10)
+                                 : std::max<size_t>(4, std::thread::hardware_concurrency());
+
+    sanityCheck();
+
+    std::cout << "Hardware threads: " << std::thread::hardware_concurrency() << "\n\n";
+    benchmark("Fine-grained", 200000, 5000, std::chrono::microseconds(1), maxWorkers);
+    benchmark("Coarse", 256, 256, std::chrono::milliseconds(1), maxWorkers);
+
+    return 0;
+}
+
+// Run program: Ctrl + F5 or Debug > Start Without Debugging menu
+// Debug program: F5 or Debug > Start Debugging menu
+
+// Tips for Getting Started:
+//   1. Use the Solution Explorer window to add/manage files
+//   2. Use the Team Explorer window to connect to source control
+//   3. Use the Output window to see build output and other messages
+//   4. Use the Error List window to view errors
+//   5. Go to Project > Add New Item to create new code files, or Project > Add Existing Item to add existing code files to the project
+//   6. In the future, to open this project again, go to File > Open > Project and select the .sln file
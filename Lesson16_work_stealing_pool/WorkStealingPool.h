@@ -0,0 +1,570 @@
+// WorkStealingPool.h
+//
+// A fixed set of worker threads that run tasks, with futures, parallel
+// loops and cooperative cancellation.
+//
+// The Lesson 16 examples start a thread per piece of work and join it.
+// Creating a thread costs tens of microseconds, far more than many tasks
+// take to run. A pool starts its threads once and hands them tasks.
+//
+// ThreadPool in Lesson12_parallel_sort keeps all tasks in one mutex-guarded
+// queue, which every thread locks for every task. Here each worker has its
+// own deque (a Chase-Lev deque):
+//
+//   - a worker pushes the tasks it creates onto the bottom of its own deque
+//     and pops from the bottom too - newest first, while their data is
+//     still in its cache - without any lock
+//   - a worker that runs out of tasks steals from the top of another
+//     worker's deque - the oldest task, usually the biggest piece of work
+//   - tasks submitted from outside the pool go into a shared queue
+//
+// so threads only touch each other's data when the load is unbalanced.
+//
+// Threads waiting for parallelFor/parallelReduce run other tasks in the
+// meantime, so nested parallel loops cannot deadlock the pool. A task must
+// not block on a future from the same pool, though, unless enough workers
+// are free to run it; use helpWhile() to wait instead.
+//
+// Cancellation is cooperative, like boost::this_thread::interruption_point()
+// in Lesson16_2: a task submitted with a CancellationToken calls
+// this_task::interruptionPoint() at convenient places, which throws
+// TaskCancelled once the token is cancelled. Tasks that have not started
+// yet when the token is cancelled do not run at all. Tasks spawned by a
+// task (e.g. by parallelFor inside it) share its token.
+
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Thrown by this_task::interruptionPoint() in a cancelled task, and
+ *        from the future of a task cancelled before it started.
+ */
+class TaskCancelled : public std::runtime_error {
+public:
+    TaskCancelled() : std::runtime_error("Task cancelled") {}
+};
+
+/**
+ * @brief Shared cancellation flag. Copies refer to the same flag.
+ */
+class CancellationToken {
+public:
+    CancellationToken() : flag(std::make_shared<std::atomic<bool>>(false)) {}
+
+    void cancel() { flag->store(true, std::memory_order_release); }
+
+    bool isCancelled() const { return flag->load(std::memory_order_acquire); }
+
+private:
+    std::shared_ptr<std::atomic<bool>> flag;
+
+    friend class WorkStealingPool;
+};
+
+namespace work_stealing_detail {
+
+typedef std::shared_ptr<std::atomic<bool>> CancelFlag;
+
+struct Task {
+    CancelFlag cancelled;    // null if the task cannot be cancelled
+
+    explicit Task(CancelFlag cancelled) : cancelled(std::move(cancelled)) {}
+    virtual ~Task() {}
+    // Must not throw
+    virtual void run() = 0;
+};
+
+template<typename Fn>
+struct FnTask : Task {
+    Fn fn;
+
+    FnTask(CancelFlag cancelled, Fn fn) : Task(std::move(cancelled)), fn(std::move(fn)) {}
+    void run() override { fn(); }
+};
+
+// The flag of the task running on this thread, if any
+inline const CancelFlag*& currentCancelFlag() {
+    thread_local const CancelFlag* flag = nullptr;
+    return flag;
+}
+
+/**
+ * @brief Chase-Lev work-stealing deque of pointers (Lê et al., "Correct and
+ *        Efficient Work-Stealing for Weak Memory Models", 2013).
+ *
+ * One owner thread calls push and pop at the bottom; any thread may call
+ * steal at the top. pop and steal return nullptr when the deque is empty
+ * or they lost the race for its last element. The array doubles when full;
+ * old arrays are kept until the deque is destroyed, because a thief may
+ * still be reading one.
+ */
+template<typename T>
+class ChaseLevDeque {
+public:
+    explicit ChaseLevDeque(size_t capacity = 256) : top(0), bottom(0) {
+        arrays.emplace_back(new Array(capacity));
+        array.store(arrays.back().get(), std::memory_order_relaxed);
+    }
+
+    ChaseLevDeque(const ChaseLevDeque&) = delete;
+    ChaseLevDeque& operator=(const ChaseLevDeque&) = delete;
+
+    void push(T* item) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        Array* a = array.load(std::memory_order_relaxed);
+        if (b - t > static_cast<int64_t>(a->mask)) a = grow(a, t, b);
+        a->put(b, item);
+        bottom.store(b + 1, std::memory_order_release);
+    }
+
+    T* pop() {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        Array* a = array.load(std::memory_order_relaxed);
+        // seq_cst store then load: a thief either sees the smaller bottom
+        // or we see its larger top, so the last element goes to only one
+        bottom.store(b, std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_seq_cst);
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        T* item = a->get(b);
+        if (t == b) {
+            // The last element: race the thieves for it
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                item = nullptr;
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    T* steal() {
+        int64_t t = top.load(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_seq_cst);
+        if (t >= b) return nullptr;
+        Array* a = array.load(std::memory_order_acquire);
+        T* item = a->get(t);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return item;
+    }
+
+    // Approximate unless called by the owner with no thieves around
+    bool empty() const {
+        return top.load(std::memory_order_relaxed) >= bottom.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Array {
+        size_t mask;
+        std::unique_ptr<std::atomic<T*>[]> slots;
+
+        explicit Array(size_t capacity) : mask(capacity - 1), slots(new std::atomic<T*>[capacity]) {}
+
+        T* get(int64_t i) const { return slots[i & mask].load(std::memory_order_relaxed); }
+        void put(int64_t i, T* item) { slots[i & mask].store(item, std::memory_order_relaxed); }
+    };
+
+    // top and bottom on separate cache lines: thieves write top, the owner bottom
+    alignas(64) std::atomic<int64_t> top;
+    alignas(64) std::atomic<int64_t> bottom;
+    std::atomic<Array*> array;
+    std::vector<std::unique_ptr<Array>> arrays;    // owner only
+
+    Array* grow(Array* old, int64_t t, int64_t b) {
+        Array* bigger = new Array((old->mask + 1) * 2);
+        arrays.emplace_back(bigger);
+        for (int64_t i = t; i < b; i++) bigger->put(i, old->get(i));
+        array.store(bigger, std::memory_order_release);
+        return bigger;
+    }
+};
+
+// Counts outstanding tasks of a parallel loop and keeps the first exception
+struct Join {
+    std::atomic<size_t> pending{0};
+    std::mutex errorMutex;
+    std::exception_ptr error;
+
+    template<typename Fn>
+    void run(Fn&& fn) {
+        try {
+            fn();
+        } catch (...) {
+            fail(std::current_exception());
+        }
+        pending.fetch_sub(1, std::memory_order_release);
+    }
+
+    void fail(std::exception_ptr e) {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        if (!error) error = e;
+    }
+
+    bool busy() const { return pending.load(std::memory_order_acquire) != 0; }
+
+    void rethrow() {
+        if (error) std::rethrow_exception(error);
+    }
+};
+
+} // namespace work_stealing_detail
+
+namespace this_task {
+
+/**
+ * @brief True if the running task's CancellationToken has been cancelled.
+ */
+inline bool cancellationRequested() {
+    const work_stealing_detail::CancelFlag* flag = work_stealing_detail::currentCancelFlag();
+    return flag && *flag && (*flag)->load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Throw TaskCancelled if the running task has been cancelled.
+ */
+inline void interruptionPoint() {
+    if (cancellationRequested()) throw TaskCancelled();
+}
+
+} // namespace this_task
+
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(size_t workers = defaultWorkers()) : stopping(false) {
+        if (workers == 0) throw std::invalid_argument("WorkStealingPool needs at least one worker");
+        for (size_t i = 0; i < workers; i++) queues.emplace_back(new WorkerQueue());
+        for (size_t i = 0; i < workers; i++) {
+            threads.emplace_back([this, i]() { workerLoop(i); });
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // Runs every task already queued, then stops the workers
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+            epoch.fetch_add(1, std::memory_order_relaxed);
+        }
+        sleepCv.notify_all();
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+    /**
+     * @brief Run fn() on the pool. The future returns its result or
+     *        rethrows its exception.
+     */
+    template<typename Fn>
+    auto submit(Fn fn) -> std::future<std::invoke_result_t<Fn&>> {
+        return submitTask(nullptr, std::move(fn));
+    }
+
+    /**
+     * @brief As submit(fn), cancellable through token. If the token is
+     *        cancelled before fn starts, fn never runs and the future
+     *        throws TaskCancelled.
+     */
+    template<typename Fn>
+    auto submit(const CancellationToken& token, Fn fn) -> std::future<std::invoke_result_t<Fn&>> {
+        return submitTask(token.flag, std::move(fn));
+    }
+
+    /**
+     * @brief Queue fn() with no future; it inherits the running task's
+     *        cancellation token. fn must not throw.
+     */
+    template<typename Fn>
+    void spawn(Fn fn) {
+        const work_stealing_detail::CancelFlag* flag = work_stealing_detail::currentCancelFlag();
+        schedule(new work_stealing_detail::FnTask<Fn>(flag ? *flag : nullptr, std::move(fn)));
+    }
+
+    /**
+     * @brief Run queued tasks on the calling thread while busy() is true,
+     *        instead of blocking it.
+     */
+    template<typename Busy>
+    void helpWhile(Busy busy) {
+        size_t self = currentWorker();
+        while (busy()) {
+            work_stealing_detail::Task* task = findTask(self);
+            if (task) {
+                execute(task);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    // Wait for a future from this pool, running other tasks meanwhile
+    template<typename R>
+    R get(std::future<R>& future) {
+        helpWhile([&]() { return future.wait_for(std::chrono::seconds(0)) != std::future_status::ready; });
+        return future.get();
+    }
+
+    size_t workerCount() const { return threads.size(); }
+
+    static size_t defaultWorkers() {
+        unsigned int hw = std::thread::hardware_concurrency();
+        return hw > 0 ? hw : 1;
+    }
+
+private:
+    typedef work_stealing_detail::Task Task;
+
+    static constexpr size_t kNotWorker = static_cast<size_t>(-1);
+    static constexpr int kIdleRounds = 64;
+
+    struct alignas(64) WorkerQueue {
+        work_stealing_detail::ChaseLevDeque<Task> deque;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> threads;
+
+    // Tasks submitted from threads outside the pool
+    std::mutex injectMutex;
+    std::deque<Task*> injected;
+    std::atomic<size_t> injectedCount{0};
+
+    // Idle workers sleep here; epoch changes with every wake-up
+    std::mutex sleepMutex;
+    std::condition_variable sleepCv;
+    std::atomic<int> sleepers{0};
+    std::atomic<uint64_t> epoch{0};
+    bool stopping;
+
+    struct WorkerContext {
+        const WorkStealingPool* pool = nullptr;
+        size_t index = 0;
+    };
+
+    static WorkerContext& context() {
+        thread_local WorkerContext current;
+        return current;
+    }
+
+    size_t currentWorker() const {
+        return context().pool == this ? context().index : kNotWorker;
+    }
+
+    template<typename Fn>
+    auto submitTask(work_stealing_detail::CancelFlag flag, Fn fn) -> std::future<std::invoke_result_t<Fn&>> {
+        typedef std::invoke_result_t<Fn&> R;
+        auto promise = std::make_shared<std::promise<R>>();
+        std::future<R> future = promise->get_future();
+        auto body = [promise, fn = std::move(fn)]() mutable {
+            try {
+                this_task::interruptionPoint();
+                if constexpr (std::is_void<R>::value) {
+                    fn();
+                    promise->set_value();
+                } else {
+                    promise->set_value(fn());
+                }
+            } catch (...) {
+                promise->set_exception(std::current_exception());
+            }
+        };
+        schedule(new work_stealing_detail::FnTask<decltype(body)>(std::move(flag), std::move(body)));
+        return future;
+    }
+
+    void schedule(Task* task) {
+        size_t self = currentWorker();
+        if (self != kNotWorker) {
+            queues[self]->deque.push(task);
+        } else {
+            std::lock_guard<std::mutex> lock(injectMutex);
+            injected.push_back(task);
+            injectedCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        // Pairs with the increment of sleepers in workerLoop: either the
+        // sleeper's last look finds this task, or we see the sleeper
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers.load(std::memory_order_relaxed) != 0) {
+            {
+                std::lock_guard<std::mutex> lock(sleepMutex);
+                epoch.fetch_add(1, std::memory_order_relaxed);
+            }
+            sleepCv.notify_one();
+        }
+    }
+
+    // Own deque first, then the shared queue, then the other workers
+    // starting at a random one
+    Task* findTask(size_t self) {
+        if (self != kNotWorker) {
+            if (Task* task = queues[self]->deque.pop()) return task;
+        }
+        if (injectedCount.load(std::memory_order_relaxed) != 0) {
+            std::lock_guard<std::mutex> lock(injectMutex);
+            if (!injected.empty()) {
+                Task* task = injected.front();
+                injected.pop_front();
+                injectedCount.fetch_sub(1, std::memory_order_relaxed);
+                return task;
+            }
+        }
+        thread_local uint64_t seed = reinterpret_cast<uintptr_t>(&seed) | 1;
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        size_t count = queues.size();
+        size_t start = static_cast<size_t>(seed % count);
+        for (size_t i = 0; i < count; i++) {
+            size_t victim = (start + i) % count;
+            if (victim == self) continue;
+            if (Task* task = queues[victim]->deque.steal()) return task;
+        }
+        return nullptr;
+    }
+
+    void execute(Task* task) {
+        std::unique_ptr<Task> owned(task);
+        const work_stealing_detail::CancelFlag*& current = work_stealing_detail::currentCancelFlag();
+        const work_stealing_detail::CancelFlag* saved = current;
+        current = &task->cancelled;
+        task->run();
+        current = saved;
+    }
+
+    void workerLoop(size_t index) {
+        context().pool = this;
+        context().index = index;
+        for (;;) {
+            Task* task = findTask(index);
+            for (int round = 0; !task && round < kIdleRounds; round++) {
+                std::this_thread::yield();
+                task = findTask(index);
+            }
+            if (!task) {
+                sleepers.fetch_add(1, std::memory_order_seq_cst);
+                // Pairs with the fence in schedule(): either that call sees
+                // this sleeper, or the findTask below sees its task
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                for (;;) {
+                    uint64_t seen = epoch.load(std::memory_order_relaxed);
+                    task = findTask(index);
+                    if (task) break;
+                    std::unique_lock<std::mutex> lock(sleepMutex);
+                    if (stopping) break;
+                    sleepCv.wait(lock, [&]() { return stopping || epoch.load(std::memory_order_relaxed) != seen; });
+                }
+                sleepers.fetch_sub(1, std::memory_order_relaxed);
+                if (!task) return;    // stopping, nothing left to run
+            }
+            execute(task);
+        }
+    }
+};
+
+namespace work_stealing_detail {
+
+template<typename Fn>
+void forRange(size_t lo, size_t hi, size_t grain, WorkStealingPool& pool, const Fn& fn, Join& join) {
+    // Hand the upper halves to the pool; a thief takes the biggest first
+    while (hi - lo > grain) {
+        size_t mid = lo + (hi - lo) / 2;
+        join.pending.fetch_add(1, std::memory_order_relaxed);
+        pool.spawn([mid, hi, grain, &pool, &fn, &join]() {
+            join.run([&]() { forRange(mid, hi, grain, pool, fn, join); });
+        });
+        hi = mid;
+    }
+    this_task::interruptionPoint();
+    for (size_t i = lo; i < hi; i++) fn(i);
+}
+
+template<typename T, typename Body, typename Combine>
+T reduceRange(size_t lo, size_t hi, size_t grain, WorkStealingPool& pool, const T& identity,
+              const Body& body, const Combine& combine) {
+    this_task::interruptionPoint();
+    if (hi - lo <= grain) return body(lo, hi);
+    size_t mid = lo + (hi - lo) / 2;
+    Join join;
+    join.pending.store(1, std::memory_order_relaxed);
+    T right = identity;
+    pool.spawn([&]() {
+        join.run([&]() { right = reduceRange(mid, hi, grain, pool, identity, body, combine); });
+    });
+    T left = identity;
+    try {
+        left = reduceRange(lo, mid, grain, pool, identity, body, combine);
+    } catch (...) {
+        join.fail(std::current_exception());
+    }
+    // Usually the right half is still at the bottom of our own deque
+    pool.helpWhile([&]() { return join.busy(); });
+    join.rethrow();
+    return combine(left, right);
+}
+
+inline size_t defaultGrain(size_t n, const WorkStealingPool& pool) {
+    // About 8 pieces per worker: enough to balance, few enough to be cheap
+    return std::max<size_t>(1, n / (pool.workerCount() * 8));
+}
+
+} // namespace work_stealing_detail
+
+/**
+ * @brief Call fn(i) for every i in [first, last) on the pool and wait.
+ *
+ * The range is split in halves down to grain indices per task (by default
+ * about 8 tasks per worker). The first exception thrown by fn is rethrown
+ * once all started tasks have finished.
+ */
+template<typename Fn>
+void parallelFor(size_t first, size_t last, WorkStealingPool& pool, Fn fn, size_t grain = 0) {
+    if (first >= last) return;
+    if (grain == 0) grain = work_stealing_detail::defaultGrain(last - first, pool);
+    work_stealing_detail::Join join;
+    try {
+        work_stealing_detail::forRange(first, last, grain, pool, fn, join);
+    } catch (...) {
+        join.fail(std::current_exception());
+    }
+    pool.helpWhile([&]() { return join.busy(); });
+    join.rethrow();
+}
+
+/**
+ * @brief Reduce [first, last): body(lo, hi) returns the value of a piece
+ *        and combine(a, b) merges the values of adjacent pieces, left to
+ *        right, so combine need only be associative.
+ */
+template<typename T, typename Body, typename Combine>
+T parallelReduce(size_t first, size_t last, WorkStealingPool& pool, T identity, Body body, Combine combine,
+                 size_t grain = 0) {
+    if (first >= last) return identity;
+    if (grain == 0) grain = work_stealing_detail::defaultGrain(last - first, pool);
+    return work_stealing_detail::reduceRange(first, last, grain, pool, identity, body, combine);
+}
+
+#endif // WORK_STEALING_POOL_H
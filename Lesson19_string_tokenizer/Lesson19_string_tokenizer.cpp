@@ -0,0 +1,296 @@
+// Lesson19_string_tokenizer.cpp : This file contains the 'main' function. Program execution begins and ends there.
+//
+// GB/s for splitting a log of comma-separated lines into fields with the
+// getline-based splits of dynArray ("Lesson5 Task.cpp") and
+// StringParser::split ("Lesson19 - Testing.md") against Tokenizer and
+// splitInto() from StringTokenizer.h (scalar, SSE4.1 and AVX2), then for
+// parsing the numeric fields with StringParser::toInt / toDouble against
+// parseInt / parseDouble.
+//
+// The getline versions split the log into lines and each line into
+// fields; the tokenizer does it in one pass with the delimiter set ",\n".
+// All produce the same fields.
+//
+// Usage: Lesson19_string_tokenizer [megabytes]
+//   Default: 64 MB of log.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "StringTokenizer.h"
+
+typedef std::chrono::steady_clock Clock;
+
+// The splitting of the dynArray(str, separator) constructor
+class dynArray {
+private:
+    std::vector<std::string> data;
+
+public:
+    dynArray(const std::string& str, char separator) {
+        std::istringstream ss(str);
+        std::string token;
+        while (std::getline(ss, token, separator)) {
+            data.push_back(token);
+        }
+    }
+
+    size_t size() const { return data.size(); }
+
+    const std::string& operator[](size_t index) const { return data.at(index); }
+};
+
+// From "Lesson19 - Testing.md"
+class StringParser {
+public:
+    static std::vector<std::string> split(const std::string& input, char delimiter) {
+        std::vector<std::string> result;
+        std::istringstream stream(input);
+        std::string token;
+        while (std::getline(stream, token, delimiter)) {
+            result.push_back(token);
+        }
+        return result;
+    }
+
+    static int toInt(const std::string& input) {
+        try {
+            return std::stoi(input);
+        } catch (const std::exception& e) {
+            throw std::invalid_argument("Cannot convert to integer: " + input);
+        }
+    }
+
+    static double toDouble(const std::string& input) {
+        try {
+            return std::stod(input);
+        } catch (const std::exception& e) {
+            throw std::invalid_argument("Cannot convert to double: " + input);
+        }
+    }
+};
+
+// Lines of "timestamp,level,latency ms,bytes,path"; field 0 and 3 are
+// ints, field 2 a double. No newline after the last line.
+const size_t kFields = 5;
+
+std::string makeLog(size_t bytes, unsigned seed) {
+    std::mt19937 rng(seed);
+    const char* levels[] = { "INFO", "WARN", "ERROR", "DEBUG" };
+    const char* paths[] = { "/", "/index.html", "/api/v1/orders", "/static/app.js", "/login" };
+    std::string log;
+    log.reserve(bytes + 100);
+    int timestamp = 1700000000;
+    while (log.size() < bytes) {
+        if (!log.empty()) log += '\n';
+        log += std::to_string(timestamp += rng() % 3);
+        log += ',';
+        log += levels[rng() % 4];
+        log += ',';
+        log += std::to_string(rng() % 1000) + "." + std::to_string(rng() % 1000);
+        log += ',';
+        log += std::to_string(rng() % 100000);
+        log += ',';
+        log += paths[rng() % 5];
+    }
+    return log;
+}
+
+std::vector<std::string> getlineFields(const std::string& log) {
+    std::vector<std::string> fields;
+    for (const std::string& line : StringParser::split(log, '\n')) {
+        std::vector<std::string> lineFields = StringParser::split(line, ',');
+        fields.insert(fields.end(), lineFields.begin(), lineFields.end());
+    }
+    return fields;
+}
+
+std::vector<std::string> tokens(std::string_view text, const DelimiterSet& delimiters,
+                                EmptyTokens empty = EmptyTokens::Keep) {
+    std::vector<std::string> result;
+    for (std::string_view token : Tokenizer(text, delimiters, empty)) result.emplace_back(token);
+    return result;
+}
+
+void sanityCheck() {
+    SimdLevel levels[] = { SimdLevel::Scalar, SimdLevel::SSE41, SimdLevel::AVX2 };
+    for (SimdLevel level : levels) {
+        if (level > detectSimdLevel()) continue;
+        DelimiterSet comma(',', level);
+        auto expect = [&](std::vector<std::string> got, std::vector<std::string> expected, const char* what) {
+            if (got != expected) throw std::logic_error(std::string(what) + " wrong at " + simdLevelName(level));
+        };
+        expect(tokens("apple,banana,cherry", comma), { "apple", "banana", "cherry" }, "basic split");
+        expect(tokens("apple,,cherry", comma), { "apple", "", "cherry" }, "consecutive delimiters");
+        expect(tokens("", comma), { "" }, "empty input");
+        expect(tokens("abcdef", comma), { "abcdef" }, "no delimiter");
+        expect(tokens(",a,", comma), { "", "a", "" }, "delimiters at both ends");
+        expect(tokens(",,a,,b,,", comma, EmptyTokens::Skip), { "a", "b" }, "skipping empty tokens");
+        expect(tokens(",,,", comma, EmptyTokens::Skip), {}, "only delimiters");
+        expect(tokens("key1=value1;key2 = value2\tx", DelimiterSet(";= \t", level), EmptyTokens::Skip),
+               { "key1", "value1", "key2", "value2", "x" }, "delimiter set");
+
+        // Random texts, delimiters across 64-byte blocks and at their
+        // edges, against a one-character-at-a-time split. The sets include
+        // one with more than 8 different high halves (classified without
+        // the nibble tables) and non-ASCII bytes.
+        std::mt19937 rng(11);
+        std::string sets[] = { ",", ",\n", "\x01 0@P`p\x80\x90\xA0\xFF", ";= \t\r\n|" };
+        for (const std::string& set : sets) {
+            DelimiterSet delimiters(set, level);
+            for (int round = 0; round < 200; round++) {
+                std::string text(rng() % 300, 'x');
+                for (char& c : text) {
+                    c = rng() % 5 == 0 ? set[rng() % set.size()] : static_cast<char>(rng() % 256);
+                }
+                std::vector<std::string> expected(1);
+                for (char c : text) {
+                    if (set.find(c) != std::string::npos) expected.emplace_back();
+                    else expected.back() += c;
+                }
+                expect(tokens(text, delimiters), expected, "random split");
+                size_t first = 0;
+                while (first < text.size() && set.find(text[first]) == std::string::npos) first++;
+                if (delimiters.find(text.data(), text.size(), 0) != first) {
+                    throw std::logic_error(std::string("DelimiterSet::find wrong at ") + simdLevelName(level));
+                }
+            }
+        }
+
+        // The fields of a log, as the getline version sees them
+        std::string log = makeLog(100000, 3);
+        std::vector<std::string_view> views;
+        splitInto(log, DelimiterSet(",\n", level), views);
+        std::vector<std::string> expected = getlineFields(log);
+        if (views.size() != expected.size() || !std::equal(views.begin(), views.end(), expected.begin())) {
+            throw std::logic_error(std::string("log split wrong at ") + simdLevelName(level));
+        }
+    }
+
+    // Numbers: the whole token, no exceptions
+    int i = 7;
+    double d = 7;
+    if (parseInt("123", i) != std::errc() || i != 123 || parseInt("-456", i) != std::errc() || i != -456 ||
+        parseInt("abc", i) != std::errc::invalid_argument || parseInt("12.34", i) != std::errc::invalid_argument ||
+        parseInt("", i) != std::errc::invalid_argument || parseInt(" 1", i) != std::errc::invalid_argument ||
+        parseInt("99999999999", i) != std::errc::result_out_of_range || i != -456) {
+        throw std::logic_error("parseInt wrong");
+    }
+    if (parseDouble("123.45", d) != std::errc() || d != 123.45 || parseDouble("-4.5e3", d) != std::errc() ||
+        d != -4500 || parseDouble("abc", d) != std::errc::invalid_argument ||
+        parseDouble("12,34", d) != std::errc::invalid_argument || parseDouble("", d) != std::errc::invalid_argument ||
+        parseDouble("1e999", d) != std::errc::result_out_of_range || d != -4500) {
+        throw std::logic_error("parseDouble wrong");
+    }
+
+    std::cout << "Sanity check passed\n\n";
+}
+
+// Best of 3 runs, in GB/s of log; the checksum keeps the results alive
+double gbPerSecond(size_t bytes, const std::function<size_t()>& run, size_t& checksum) {
+    double best = 0;
+    for (int repeat = 0; repeat < 3; repeat++) {
+        auto start = Clock::now();
+        checksum += run();
+        best = std::max(best, bytes / std::chrono::duration<double>(Clock::now() - start).count() / 1e9);
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    size_t megabytes = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 64;
+
+    sanityCheck();
+
+    std::string log = makeLog(megabytes << 20, 1);
+    std::cout << "Hardware threads: " << std::thread::hardware_concurrency() << ", "
+              << simdLevelName(detectSimdLevel()) << "\n";
+    std::cout << "GB/s over " << log.size() / 1e6 << " MB of log, " << kFields << " fields per line\n\n";
+
+    size_t checksum = 0;
+    auto row = [&](const std::string& name, const std::function<size_t()>& run) {
+        std::cout << std::left << std::setw(40) << name << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(10) << gbPerSecond(log.size(), run, checksum) << std::endl;
+    };
+
+    std::cout << "Splitting into fields\n";
+    row("dynArray (lines, then fields)", [&]() {
+        size_t fields = 0;
+        dynArray lines(log, '\n');
+        for (size_t i = 0; i < lines.size(); i++) fields += dynArray(lines[i], ',').size();
+        return fields;
+    });
+    row("StringParser::split (lines, then fields)", [&]() { return getlineFields(log).size(); });
+    std::vector<std::string_view> views;
+    SimdLevel levels[] = { SimdLevel::Scalar, SimdLevel::SSE41, SimdLevel::AVX2 };
+    for (SimdLevel level : levels) {
+        if (level > detectSimdLevel()) continue;
+        DelimiterSet delimiters(",\n", level);
+        row(std::string("Tokenizer ") + simdLevelName(level), [&]() {
+            size_t length = 0;
+            for (std::string_view field : Tokenizer(log, delimiters)) length += field.size();
+            return length;
+        });
+        row(std::string("splitInto ") + simdLevelName(level), [&]() { return splitInto(log, delimiters, views); });
+    }
+
+    std::cout << "\nSplitting and parsing the numeric fields\n";
+    row("StringParser split, toInt, toDouble", [&]() {
+        std::vector<std::string> fields = getlineFields(log);
+        double sum = 0;
+        for (size_t i = 0; i + kFields <= fields.size(); i += kFields) {
+            sum += StringParser::toInt(fields[i]) + StringParser::toDouble(fields[i + 2]) +
+                   StringParser::toInt(fields[i + 3]);
+        }
+        return static_cast<size_t>(sum);
+    });
+    DelimiterSet delimiters(",\n");
+    row("Tokenizer, parseInt, parseDouble", [&]() {
+        double sum = 0;
+        size_t field = 0;
+        int number = 0;
+        double real = 0;
+        for (std::string_view token : Tokenizer(log, delimiters)) {
+            switch (field) {
+            case 0:
+            case 3:
+                if (parseInt(token, number) != std::errc()) throw std::logic_error("bad int in log");
+                sum += number;
+                break;
+            case 2:
+                if (parseDouble(token, real) != std::errc()) throw std::logic_error("bad double in log");
+                sum += real;
+                break;
+            }
+            field = field + 1 == kFields ? 0 : field + 1;
+        }
+        return static_cast<size_t>(sum);
+    });
+
+    std::cout << "\n(checksum " << checksum << ")\n";
+
+    return 0;
+}
+
+// Run program: Ctrl + F5 or Debug > Start Without Debugging menu
+// Debug program: F5 or Debug > Start Debugging menu
+
+// Tips for Getting Started:
+//   1. Use the Solution Explorer window to add/manage files
+//   2. Use the Team Explorer window to connect to source control
+//   3. Use the Output window to see build output and other messages
+//   4. Use the Error List window to view errors
+//   5. Go to Project > Add New Item to create new code files, or Project > Add Existing Item to add existing code files to the project
+//   6. In the future, to open this project again, go to File > Open > Project and select the .sln file
@@ -0,0 +1,336 @@
+// StringTokenizer.h
+//
+// Splitting and number parsing that neither copies nor throws.
+//
+// dynArray in "Lesson5 Task.cpp" and StringParser::split in "Lesson19 -
+// Testing.md" split with std::istringstream and std::getline. Every token
+// is copied into a new std::string (a heap allocation once it is longer
+// than the small string buffer), the stream examines the input one
+// character at a time, and StringParser::toInt / toDouble add std::stoi /
+// std::stod, which skip white space, depend on the locale and report
+// failure by throwing. For text that is parsed at hundreds of MB per
+// second, those costs are most of the work.
+//
+//   DelimiterSet        the characters that separate tokens, e.g. ",;\n".
+//                       With AVX2 (or SSE4.1) 32 (16) bytes are classified
+//                       at once: each byte's low and high 4 bits index
+//                       two 16-entry tables (pshufb) whose bitwise AND is
+//                       non-zero exactly for the delimiters. This works
+//                       for any set whose characters have at most 8
+//                       different high halves; other sets are classified
+//                       one byte at a time
+//   Tokenizer           walks the tokens of a std::string_view and returns
+//                       each as a std::string_view into the same buffer:
+//                       no allocation, no copy. It classifies 64 bytes at
+//                       a time into a bit mask, then takes the delimiter
+//                       positions from the mask one by one
+//   splitInto()         all tokens into a std::vector<std::string_view>;
+//                       reusing the vector allocates nothing once it is
+//                       large enough
+//   parseInt()          std::from_chars: no locale, no exceptions. The
+//   parseDouble()       result is a std::errc - std::errc() on success,
+//                       invalid_argument unless the whole token is a
+//                       number, result_out_of_range if it does not fit
+//
+// Tokens follow the usual split rules: n delimiters make n + 1 tokens, so
+// "a,,b" gives "a", "" and "b", and "" gives one empty token (getline
+// gives none, and drops the empty token after a final delimiter).
+// EmptyTokens::Skip leaves out every empty token.
+//
+// The views point into the text that was split, which must outlive them.
+// A DelimiterSet fixes its SimdLevel when it is built: it classifies 64
+// bytes at a time with AVX2 or SSE4.1 nibble lookups, or a byte at a time
+// with a 256-entry table, and all three find the same delimiters.
+
+#ifndef STRING_TOKENIZER_H
+#define STRING_TOKENIZER_H
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "../common/SimdDispatch.h"
+
+namespace tokenizer_detail {
+
+inline unsigned trailingZeros(uint64_t v) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, v);
+    return index;
+#else
+    return static_cast<unsigned>(__builtin_ctzll(v));
+#endif
+}
+
+} // namespace tokenizer_detail
+
+enum class EmptyTokens { Keep, Skip };
+
+/**
+ * @brief A set of delimiter characters, classified 16 or 32 bytes at a
+ * time where the CPU allows.
+ */
+class DelimiterSet {
+private:
+    bool member[256] = {};
+    // Byte c is a delimiter iff low[c & 15] & high[c >> 4] is non-zero
+    alignas(16) uint8_t low[16] = {};
+    alignas(16) uint8_t high[16] = {};
+    bool nibbleTables = true;
+    SimdLevel level;
+
+    void build(std::string_view chars) {
+        int groups = 0;
+        int groupOf[16];
+        for (int& g : groupOf) g = -1;
+        for (char c : chars) {
+            unsigned char u = static_cast<unsigned char>(c);
+            member[u] = true;
+            unsigned h = u >> 4;
+            if (groupOf[h] < 0) {
+                if (groups == 8) {
+                    nibbleTables = false;
+                    continue;
+                }
+                groupOf[h] = groups++;
+                high[h] = static_cast<uint8_t>(1u << groupOf[h]);
+            }
+            low[u & 15] |= high[h];
+        }
+    }
+
+    uint64_t classifyScalar(const char* p, size_t n) const {
+        uint64_t mask = 0;
+        for (size_t i = 0; i < n; i++) {
+            mask |= static_cast<uint64_t>(member[static_cast<unsigned char>(p[i])]) << i;
+        }
+        return mask;
+    }
+
+    uint64_t classifyAvx2(const char* p) const;
+    uint64_t classifySse41(const char* p) const;
+
+public:
+    /**
+     * @param chars every character of which is a delimiter.
+     */
+    explicit DelimiterSet(std::string_view chars, SimdLevel level = detectSimdLevel()) : level(level) {
+        build(chars);
+    }
+
+    explicit DelimiterSet(char delimiter, SimdLevel level = detectSimdLevel()) : level(level) {
+        build(std::string_view(&delimiter, 1));
+    }
+
+    bool contains(char c) const { return member[static_cast<unsigned char>(c)]; }
+
+    /**
+     * @brief Bit i is set iff p[i] is a delimiter, for i < n <= 64.
+     */
+    uint64_t classify(const char* p, size_t n) const {
+        if (n == 64 && nibbleTables) {
+#ifdef SIMD_X86
+            if (level == SimdLevel::AVX2) return classifyAvx2(p);
+            if (level == SimdLevel::SSE41) return classifySse41(p);
+#endif
+        }
+        return classifyScalar(p, n);
+    }
+
+    /**
+     * @brief Index of the first delimiter at or after from, or size.
+     */
+    size_t find(const char* data, size_t size, size_t from) const {
+        while (from < size) {
+            size_t n = size - from < 64 ? size - from : 64;
+            uint64_t mask = classify(data + from, n);
+            if (mask != 0) return from + tokenizer_detail::trailingZeros(mask);
+            from += n;
+        }
+        return size;
+    }
+};
+
+/**
+ * @brief The tokens of a string_view, as string_views into it.
+ */
+class Tokenizer {
+private:
+    std::string_view text;
+    const DelimiterSet* delimiters;
+    EmptyTokens empty;
+    size_t block = 0;           // start of the classified 64-byte block
+    uint64_t mask = 0;          // delimiters in it not yet used
+    size_t tokenStart = 0;
+    bool finished = false;
+
+    void classifyBlock() {
+        size_t n = text.size() - block < 64 ? text.size() - block : 64;
+        mask = delimiters->classify(text.data() + block, n);
+    }
+
+    bool nextToken(std::string_view& token) {
+        if (finished) return false;
+        while (mask == 0) {
+            block += 64;
+            if (block >= text.size()) {
+                token = text.substr(tokenStart);
+                finished = true;
+                return true;
+            }
+            classifyBlock();
+        }
+        size_t end = block + tokenizer_detail::trailingZeros(mask);
+        mask &= mask - 1;
+        token = text.substr(tokenStart, end - tokenStart);
+        tokenStart = end + 1;
+        return true;
+    }
+
+public:
+    /**
+     * @param delimiters must outlive the Tokenizer.
+     */
+    Tokenizer(std::string_view text, const DelimiterSet& delimiters, EmptyTokens empty = EmptyTokens::Keep)
+        : text(text), delimiters(&delimiters), empty(empty) {
+        if (!text.empty()) classifyBlock();
+    }
+
+    // A temporary DelimiterSet would be gone before the first token
+    Tokenizer(std::string_view text, const DelimiterSet&& delimiters, EmptyTokens empty = EmptyTokens::Keep) = delete;
+
+    /**
+     * @brief The next token, if there is one.
+     */
+    bool next(std::string_view& token) {
+        while (nextToken(token)) {
+            if (!token.empty() || empty == EmptyTokens::Keep) return true;
+        }
+        return false;
+    }
+
+    class iterator {
+    private:
+        Tokenizer* tokenizer;
+        std::string_view token;
+
+    public:
+        typedef std::input_iterator_tag iterator_category;
+        typedef std::string_view value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const std::string_view* pointer;
+        typedef const std::string_view& reference;
+
+        explicit iterator(Tokenizer* tokenizer) : tokenizer(tokenizer) {
+            if (tokenizer != nullptr && !tokenizer->next(token)) this->tokenizer = nullptr;
+        }
+
+        reference operator*() const { return token; }
+        pointer operator->() const { return &token; }
+
+        iterator& operator++() {
+            if (!tokenizer->next(token)) tokenizer = nullptr;
+            return *this;
+        }
+
+        bool operator==(const iterator& other) const { return tokenizer == other.tokenizer; }
+        bool operator!=(const iterator& other) const { return tokenizer != other.tokenizer; }
+    };
+
+    /**
+     * @brief For range-for; the tokens can be walked only once.
+     */
+    iterator begin() { return iterator(this); }
+    iterator end() { return iterator(nullptr); }
+};
+
+/**
+ * @brief Replaces the contents of tokens with the tokens of text.
+ * @return The number of tokens.
+ */
+inline size_t splitInto(std::string_view text, const DelimiterSet& delimiters, std::vector<std::string_view>& tokens,
+                        EmptyTokens empty = EmptyTokens::Keep) {
+    tokens.clear();
+    Tokenizer tokenizer(text, delimiters, empty);
+    std::string_view token;
+    while (tokenizer.next(token)) tokens.push_back(token);
+    return tokens.size();
+}
+
+/**
+ * @brief Parses the whole of text as a decimal int; value is unchanged
+ * unless the result is std::errc().
+ */
+inline std::errc parseInt(std::string_view text, int& value) {
+    int parsed;
+    std::from_chars_result result = std::from_chars(text.data(), text.data() + text.size(), parsed);
+    if (result.ec != std::errc()) return result.ec;
+    if (result.ptr != text.data() + text.size()) return std::errc::invalid_argument;
+    value = parsed;
+    return std::errc();
+}
+
+/**
+ * @brief Parses the whole of text as a double (fixed or scientific); value
+ * is unchanged unless the result is std::errc().
+ */
+inline std::errc parseDouble(std::string_view text, double& value) {
+    double parsed;
+    std::from_chars_result result = std::from_chars(text.data(), text.data() + text.size(), parsed);
+    if (result.ec != std::errc()) return result.ec;
+    if (result.ptr != text.data() + text.size()) return std::errc::invalid_argument;
+    value = parsed;
+    return std::errc();
+}
+
+#ifdef SIMD_X86
+SIMD_BEGIN_AVX2
+inline uint64_t DelimiterSet::classifyAvx2(const char* p) const {
+    const __m256i lowTable = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(low)));
+    const __m256i highTable = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(high)));
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    uint64_t mask = 0;
+    for (int half = 0; half < 2; half++) {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32 * half));
+        __m256i lows = _mm256_shuffle_epi8(lowTable, _mm256_and_si256(bytes, nibble));
+        __m256i highs = _mm256_shuffle_epi8(highTable, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibble));
+        __m256i none = _mm256_cmpeq_epi8(_mm256_and_si256(lows, highs), _mm256_setzero_si256());
+        mask |= static_cast<uint64_t>(~static_cast<uint32_t>(_mm256_movemask_epi8(none))) << (32 * half);
+    }
+    return mask;
+}
+SIMD_END_TARGET
+
+SIMD_BEGIN_SSE41
+inline uint64_t DelimiterSet::classifySse41(const char* p) const {
+    const __m128i lowTable = _mm_load_si128(reinterpret_cast<const __m128i*>(low));
+    const __m128i highTable = _mm_load_si128(reinterpret_cast<const __m128i*>(high));
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    uint64_t mask = 0;
+    for (int quarter = 0; quarter < 4; quarter++) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * quarter));
+        __m128i lows = _mm_shuffle_epi8(lowTable, _mm_and_si128(bytes, nibble));
+        __m128i highs = _mm_shuffle_epi8(highTable, _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble));
+        __m128i none = _mm_cmpeq_epi8(_mm_and_si128(lows, highs), _mm_setzero_si128());
+        mask |= static_cast<uint64_t>(~static_cast<uint32_t>(_mm_movemask_epi8(none)) & 0xFFFF) << (16 * quarter);
+    }
+    return mask;
+}
+SIMD_END_TARGET
+#else
+inline uint64_t DelimiterSet::classifyAvx2(const char* p) const {
+    return classifyScalar(p, 64);
+}
+
+inline uint64_t DelimiterSet::classifySse41(const char* p) const {
+    return classifyScalar(p, 64);
+}
+#endif
+
+#endif // STRING_TOKENIZER_H
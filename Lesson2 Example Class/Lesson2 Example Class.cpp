@@ -14,7 +14,6 @@ public:
 
     // Method to calculate the area of the circle
     double calculateArea() const {
-        return radius * radius;
         return mypi * radius * radius;
     }
 
@@ -0,0 +1,393 @@
+// GeometryBatch.h
+//
+// Structure-of-arrays containers for the shapes of the lessons:
+//
+//   CircleBatch          Circle (Lesson2 Example Class): calculateAreas()
+//   SphereBatch          Sphere (Lesson2 Example BaseClass), derived from
+//                        CircleBatch as Sphere is from Circle:
+//                        calculateSurfaceAreas()
+//   RectangleBatch<T>    Rectangle<T> (Lesson7_worked_example_2): getAreas()
+//   PointBatch           Point (Lesson13_operator_overload.md):
+//                        distancesFromOrigin()
+//
+// A std::vector<Circle> stores each radius next to a copy of mypi, and
+// calculateArea() is called once per object. A CircleBatch stores only the
+// radii, contiguously, so a batch method streams through them: the loads
+// use every byte of each cache line, and one AVX2 (SSE) instruction
+// handles 4 (2) doubles, 8 (4) floats or ints. Each batch method writes
+// one result per shape to an output array of size() elements; with a
+// ThreadPool the batch is split into slices that run in parallel, each
+// starting at a multiple of 8 elements.
+//
+// The results are bit for bit those of the scalar classes: the kernels
+// perform the same IEEE operations in the same order - (pi * r) * r,
+// ((4 * pi) * r) * r, l * w and sqrt(x * x + y * y) - and SIMD multiplies,
+// adds and square roots round exactly as the scalar ones do. That holds as
+// long as the scalar code is not compiled with fused multiply-adds (e.g.
+// GCC or Clang with -mfma and -ffp-contract=fast / on). Integer products
+// wrap on overflow at every SimdLevel, including the scalar one.
+//
+// Every batch method takes a SimdLevel, defaulting to detectSimdLevel(),
+// so a benchmark can run the AVX2, SSE4.1 and scalar kernels side by side
+// on the same shapes.
+
+#ifndef GEOMETRY_BATCH_H
+#define GEOMETRY_BATCH_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../common/SimdDispatch.h"
+#include "../Lesson12_parallel_sort/ThreadPool.h"
+
+/**
+ * @brief The value of mypi in the Lesson2 Circle class; using it keeps
+ * the batch results identical to the class's.
+ */
+constexpr double kCirclePi = 3.141592;
+
+/**
+ * @brief out[i] = (scale * r[i]) * r[i] for i < n.
+ */
+inline void scaledSquares(const double* r, size_t n, double scale, double* out, SimdLevel level = detectSimdLevel());
+
+/**
+ * @brief out[i] = a[i] * b[i] for i < n. SIMD for double, float and
+ * int32_t; other types are multiplied one at a time.
+ */
+template<typename T>
+void products(const T* a, const T* b, size_t n, T* out, SimdLevel level = detectSimdLevel());
+
+/**
+ * @brief out[i] = sqrt(x[i] * x[i] + y[i] * y[i]) for i < n.
+ */
+inline void distancesFromOrigin(const double* x, const double* y, size_t n, double* out,
+                                SimdLevel level = detectSimdLevel());
+
+/**
+ * @brief Radii of circles, stored contiguously.
+ */
+class CircleBatch {
+protected:
+    std::vector<double> radii;
+
+public:
+    CircleBatch() {}
+
+    explicit CircleBatch(std::vector<double> radii) : radii(std::move(radii)) {}
+
+    void add(double radius) { radii.push_back(radius); }
+    void reserve(size_t n) { radii.reserve(n); }
+    void clear() { radii.clear(); }
+    size_t size() const { return radii.size(); }
+
+    double getRadius(size_t index) const { return radii[index]; }
+    const double* data() const { return radii.data(); }
+
+    /**
+     * @brief out[i] = Circle(getRadius(i)).calculateArea().
+     */
+    void calculateAreas(double* out, SimdLevel level = detectSimdLevel()) const {
+        scaledSquares(radii.data(), radii.size(), kCirclePi, out, level);
+    }
+
+    void calculateAreas(double* out, ThreadPool& pool, SimdLevel level = detectSimdLevel()) const {
+        const double* r = radii.data();
+        thread_pool_detail::forSlices(radii.size(), pool, [=](size_t begin, size_t end) {
+            scaledSquares(r + begin, end - begin, kCirclePi, out + begin, level);
+        }, 8);
+    }
+};
+
+/**
+ * @brief Radii of spheres; calculateAreas() gives the area of the
+ * circle through the centre, as Sphere inherits it from Circle.
+ */
+class SphereBatch : public CircleBatch {
+public:
+    SphereBatch() {}
+
+    explicit SphereBatch(std::vector<double> radii) : CircleBatch(std::move(radii)) {}
+
+    /**
+     * @brief out[i] = Sphere(getRadius(i)).calculateSurfaceArea().
+     */
+    void calculateSurfaceAreas(double* out, SimdLevel level = detectSimdLevel()) const {
+        scaledSquares(radii.data(), radii.size(), 4 * kCirclePi, out, level);
+    }
+
+    void calculateSurfaceAreas(double* out, ThreadPool& pool, SimdLevel level = detectSimdLevel()) const {
+        const double* r = radii.data();
+        thread_pool_detail::forSlices(radii.size(), pool, [=](size_t begin, size_t end) {
+            scaledSquares(r + begin, end - begin, 4 * kCirclePi, out + begin, level);
+        }, 8);
+    }
+};
+
+/**
+ * @brief Lengths and widths of rectangles, in two contiguous arrays.
+ */
+template<typename T>
+class RectangleBatch {
+private:
+    std::vector<T> lengths;
+    std::vector<T> widths;
+
+public:
+    void add(T length, T width) {
+        lengths.push_back(length);
+        widths.push_back(width);
+    }
+
+    void reserve(size_t n) {
+        lengths.reserve(n);
+        widths.reserve(n);
+    }
+
+    void clear() {
+        lengths.clear();
+        widths.clear();
+    }
+
+    size_t size() const { return lengths.size(); }
+    T getLength(size_t index) const { return lengths[index]; }
+    T getWidth(size_t index) const { return widths[index]; }
+
+    /**
+     * @brief out[i] = Rectangle<T>(getLength(i), getWidth(i)).getArea().
+     */
+    void getAreas(T* out, SimdLevel level = detectSimdLevel()) const {
+        products(lengths.data(), widths.data(), lengths.size(), out, level);
+    }
+
+    void getAreas(T* out, ThreadPool& pool, SimdLevel level = detectSimdLevel()) const {
+        const T* l = lengths.data();
+        const T* w = widths.data();
+        thread_pool_detail::forSlices(lengths.size(), pool, [=](size_t begin, size_t end) {
+            products(l + begin, w + begin, end - begin, out + begin, level);
+        }, 8);
+    }
+};
+
+/**
+ * @brief x and y coordinates of points, in two contiguous arrays.
+ */
+class PointBatch {
+private:
+    std::vector<double> xs;
+    std::vector<double> ys;
+
+public:
+    void add(double x, double y) {
+        xs.push_back(x);
+        ys.push_back(y);
+    }
+
+    void reserve(size_t n) {
+        xs.reserve(n);
+        ys.reserve(n);
+    }
+
+    void clear() {
+        xs.clear();
+        ys.clear();
+    }
+
+    size_t size() const { return xs.size(); }
+    double getX(size_t index) const { return xs[index]; }
+    double getY(size_t index) const { return ys[index]; }
+
+    /**
+     * @brief out[i] = Point(getX(i), getY(i)).distanceFromOrigin().
+     */
+    void distancesFromOrigin(double* out, SimdLevel level = detectSimdLevel()) const {
+        ::distancesFromOrigin(xs.data(), ys.data(), xs.size(), out, level);
+    }
+
+    void distancesFromOrigin(double* out, ThreadPool& pool, SimdLevel level = detectSimdLevel()) const {
+        const double* x = xs.data();
+        const double* y = ys.data();
+        thread_pool_detail::forSlices(xs.size(), pool, [=](size_t begin, size_t end) {
+            ::distancesFromOrigin(x + begin, y + begin, end - begin, out + begin, level);
+        }, 8);
+    }
+};
+
+namespace geometry_detail {
+
+inline void scaledSquaresScalar(const double* r, size_t n, double scale, double* out) {
+    for (size_t i = 0; i < n; i++) out[i] = scale * r[i] * r[i];
+}
+
+template<typename T>
+void productsScalar(const T* a, const T* b, size_t n, T* out) {
+    for (size_t i = 0; i < n; i++) out[i] = a[i] * b[i];
+}
+
+// Unsigned, so that overflow wraps like the SIMD lanes
+inline void productsScalar(const int32_t* a, const int32_t* b, size_t n, int32_t* out) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = static_cast<int32_t>(static_cast<uint32_t>(a[i]) * static_cast<uint32_t>(b[i]));
+    }
+}
+
+inline void distancesScalar(const double* x, const double* y, size_t n, double* out) {
+    for (size_t i = 0; i < n; i++) out[i] = std::sqrt(x[i] * x[i] + y[i] * y[i]);
+}
+
+} // namespace geometry_detail
+
+#ifdef SIMD_X86
+SIMD_BEGIN_AVX2
+namespace geometry_avx2 {
+
+inline void scaledSquares(const double* r, size_t n, double scale, double* out) {
+    const __m256d s = _mm256_set1_pd(scale);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d v = _mm256_loadu_pd(r + i);
+        _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_mul_pd(s, v), v));
+    }
+    geometry_detail::scaledSquaresScalar(r + i, n - i, scale, out + i);
+}
+
+inline void products(const double* a, const double* b, size_t n, double* out) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    }
+    geometry_detail::productsScalar(a + i, b + i, n - i, out + i);
+}
+
+inline void products(const float* a, const float* b, size_t n, float* out) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    }
+    geometry_detail::productsScalar(a + i, b + i, n - i, out + i);
+}
+
+inline void products(const int32_t* a, const int32_t* b, size_t n, int32_t* out) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_mullo_epi32(x, y));
+    }
+    geometry_detail::productsScalar(a + i, b + i, n - i, out + i);
+}
+
+inline void distancesFromOrigin(const double* x, const double* y, size_t n, double* out) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d vx = _mm256_loadu_pd(x + i);
+        __m256d vy = _mm256_loadu_pd(y + i);
+        __m256d squares = _mm256_add_pd(_mm256_mul_pd(vx, vx), _mm256_mul_pd(vy, vy));
+        _mm256_storeu_pd(out + i, _mm256_sqrt_pd(squares));
+    }
+    geometry_detail::distancesScalar(x + i, y + i, n - i, out + i);
+}
+
+} // namespace geometry_avx2
+SIMD_END_TARGET
+
+SIMD_BEGIN_SSE41
+namespace geometry_sse41 {
+
+inline void scaledSquares(const double* r, size_t n, double scale, double* out) {
+    const __m128d s = _mm_set1_pd(scale);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d v = _mm_loadu_pd(r + i);
+        _mm_storeu_pd(out + i, _mm_mul_pd(_mm_mul_pd(s, v), v));
+    }
+    geometry_detail::scaledSquaresScalar(r + i, n - i, scale, out + i);
+}
+
+inline void products(const double* a, const double* b, size_t n, double* out) {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(out + i, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    }
+    geometry_detail::productsScalar(a + i, b + i, n - i, out + i);
+}
+
+inline void products(const float* a, const float* b, size_t n, float* out) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+    geometry_detail::productsScalar(a + i, b + i, n - i, out + i);
+}
+
+inline void products(const int32_t* a, const int32_t* b, size_t n, int32_t* out) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_mullo_epi32(x, y));
+    }
+    geometry_detail::productsScalar(a + i, b + i, n - i, out + i);
+}
+
+inline void distancesFromOrigin(const double* x, const double* y, size_t n, double* out) {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d vx = _mm_loadu_pd(x + i);
+        __m128d vy = _mm_loadu_pd(y + i);
+        __m128d squares = _mm_add_pd(_mm_mul_pd(vx, vx), _mm_mul_pd(vy, vy));
+        _mm_storeu_pd(out + i, _mm_sqrt_pd(squares));
+    }
+    geometry_detail::distancesScalar(x + i, y + i, n - i, out + i);
+}
+
+} // namespace geometry_sse41
+SIMD_END_TARGET
+#endif
+
+namespace geometry_detail {
+
+template<typename T>
+struct HasSimdProducts {
+    static constexpr bool value =
+        std::is_same<T, double>::value || std::is_same<T, float>::value || std::is_same<T, int32_t>::value;
+};
+
+} // namespace geometry_detail
+
+inline void scaledSquares(const double* r, size_t n, double scale, double* out, SimdLevel level) {
+#ifdef SIMD_X86
+    if (level == SimdLevel::AVX2) return geometry_avx2::scaledSquares(r, n, scale, out);
+    if (level == SimdLevel::SSE41) return geometry_sse41::scaledSquares(r, n, scale, out);
+#endif
+    (void)level;
+    geometry_detail::scaledSquaresScalar(r, n, scale, out);
+}
+
+template<typename T>
+void products(const T* a, const T* b, size_t n, T* out, SimdLevel level) {
+#ifdef SIMD_X86
+    if constexpr (geometry_detail::HasSimdProducts<T>::value) {
+        if (level == SimdLevel::AVX2) return geometry_avx2::products(a, b, n, out);
+        if (level == SimdLevel::SSE41) return geometry_sse41::products(a, b, n, out);
+    }
+#endif
+    (void)level;
+    geometry_detail::productsScalar(a, b, n, out);
+}
+
+inline void distancesFromOrigin(const double* x, const double* y, size_t n, double* out, SimdLevel level) {
+#ifdef SIMD_X86
+    if (level == SimdLevel::AVX2) return geometry_avx2::distancesFromOrigin(x, y, n, out);
+    if (level == SimdLevel::SSE41) return geometry_sse41::distancesFromOrigin(x, y, n, out);
+#endif
+    (void)level;
+    geometry_detail::distancesScalar(x, y, n, out);
+}
+
+#endif // GEOMETRY_BATCH_H
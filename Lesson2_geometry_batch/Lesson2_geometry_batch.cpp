@@ -0,0 +1,300 @@
+// Lesson2_geometry_batch.cpp : This file contains the 'main' function. Program execution begins and ends there.
+//
+// Million shapes per second for the lesson classes - Circle, Sphere,
+// Rectangle<double>, Rectangle<int> and Point - held in a std::vector and
+// asked one object at a time, against the structure-of-arrays batches of
+// GeometryBatch.h with the scalar, SSE4.1 and AVX2 kernels, single-threaded
+// and on a ThreadPool. The sanity check compares every batch result bit for
+// bit with the lesson classes.
+//
+// Usage: Lesson2_geometry_batch [shapes]
+//   Default: 10000000 shapes of each kind.
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "GeometryBatch.h"
+
+typedef std::chrono::steady_clock Clock;
+
+// From "Lesson2 Example BaseClass.cpp" (without the output methods);
+// Circle::calculateArea() no longer returns radius * radius as in
+// "Lesson2 Example Class.cpp"
+class Circle {
+protected:
+    double radius;
+
+private:
+    double mypi = 3.141592;
+
+public:
+    Circle(double r) : radius(r) {}
+
+    double calculateArea() const {
+        return mypi * radius * radius;
+    }
+
+    double my_pi() const {
+        return mypi;
+    }
+
+    double getRadius() const {
+        return radius;
+    }
+};
+
+class Sphere : public Circle {
+public:
+    Sphere(double r) : Circle(r) {}
+
+    double calculateSurfaceArea() const {
+        return 4 * my_pi() * radius * radius;
+    }
+};
+
+// From Lesson7_worked_example_2.cpp
+template <typename T>
+class Rectangle {
+private:
+    T length;
+    T width;
+
+public:
+    Rectangle(T l, T w) : length(l), width(w) {}
+
+    T getArea() const {
+        return length * width;
+    }
+};
+
+// From Lesson13_operator_overload.md, with distanceFromOrigin() public
+class Point {
+private:
+    double x;
+    double y;
+
+public:
+    Point(double x_coord = 0.0, double y_coord = 0.0) : x(x_coord), y(y_coord) {}
+
+    double distanceFromOrigin() const {
+        return std::sqrt(x * x + y * y);
+    }
+
+    double getX() const { return x; }
+    double getY() const { return y; }
+};
+
+// The same shapes as objects and as batches
+struct Shapes {
+    std::vector<Circle> circles;
+    std::vector<Sphere> spheres;
+    std::vector<Rectangle<double>> rectangles;
+    std::vector<Rectangle<int>> intRectangles;
+    std::vector<Point> points;
+    CircleBatch circleBatch;
+    SphereBatch sphereBatch;
+    RectangleBatch<double> rectangleBatch;
+    RectangleBatch<int> intRectangleBatch;
+    PointBatch pointBatch;
+
+    Shapes(size_t n, unsigned seed) {
+        std::mt19937_64 rng(seed);
+        std::uniform_real_distribution<double> real(-1000, 1000);
+        std::uniform_int_distribution<int> side(0, 40000);
+        circleBatch.reserve(n);
+        sphereBatch.reserve(n);
+        rectangleBatch.reserve(n);
+        intRectangleBatch.reserve(n);
+        pointBatch.reserve(n);
+        for (size_t i = 0; i < n; i++) {
+            double r = real(rng), l = real(rng), w = real(rng), x = real(rng), y = real(rng);
+            int il = side(rng), iw = side(rng);
+            circles.emplace_back(r);
+            spheres.emplace_back(r);
+            rectangles.emplace_back(l, w);
+            intRectangles.emplace_back(il, iw);
+            points.emplace_back(x, y);
+            circleBatch.add(r);
+            sphereBatch.add(r);
+            rectangleBatch.add(l, w);
+            intRectangleBatch.add(il, iw);
+            pointBatch.add(x, y);
+        }
+    }
+};
+
+template<typename T>
+void checkSame(const std::vector<T>& expected, const std::vector<T>& got, const std::string& what) {
+    bool same = expected.size() == got.size() &&
+                (expected.empty() || std::memcmp(expected.data(), got.data(), expected.size() * sizeof(T)) == 0);
+    if (!same) {
+        throw std::logic_error(what + " differs from the lesson class");
+    }
+}
+
+void sanityCheck() {
+    if (Circle(2).calculateArea() != 3.141592 * 2 * 2) throw std::logic_error("Circle::calculateArea wrong");
+
+    ThreadPool pool(3);
+    SimdLevel levels[] = { SimdLevel::Scalar, SimdLevel::SSE41, SimdLevel::AVX2 };
+    // Sizes around the vector widths, and one that is split into slices
+    std::vector<size_t> sizes;
+    for (size_t n = 0; n <= 19; n++) sizes.push_back(n);
+    sizes.push_back(4 * thread_pool_detail::kMinSlice + 13);
+    for (size_t n : sizes) {
+        Shapes shapes(n, static_cast<unsigned>(n));
+        std::vector<double> circleAreas, sphereAreas, surfaceAreas, rectangleAreas, distances;
+        std::vector<int> intAreas;
+        for (size_t i = 0; i < n; i++) {
+            circleAreas.push_back(shapes.circles[i].calculateArea());
+            sphereAreas.push_back(shapes.spheres[i].calculateArea());
+            surfaceAreas.push_back(shapes.spheres[i].calculateSurfaceArea());
+            rectangleAreas.push_back(shapes.rectangles[i].getArea());
+            intAreas.push_back(shapes.intRectangles[i].getArea());
+            distances.push_back(shapes.points[i].distanceFromOrigin());
+        }
+        for (SimdLevel level : levels) {
+            if (level > detectSimdLevel()) continue;
+            for (int threaded = 0; threaded < 2; threaded++) {
+                std::string what = std::string(simdLevelName(level)) + (threaded ? " threaded" : "") + " ";
+                std::vector<double> out(n);
+                std::vector<int> intOut(n);
+                threaded ? shapes.circleBatch.calculateAreas(out.data(), pool, level)
+                         : shapes.circleBatch.calculateAreas(out.data(), level);
+                checkSame(circleAreas, out, what + "CircleBatch::calculateAreas");
+                threaded ? shapes.sphereBatch.calculateAreas(out.data(), pool, level)
+                         : shapes.sphereBatch.calculateAreas(out.data(), level);
+                checkSame(sphereAreas, out, what + "SphereBatch::calculateAreas");
+                threaded ? shapes.sphereBatch.calculateSurfaceAreas(out.data(), pool, level)
+                         : shapes.sphereBatch.calculateSurfaceAreas(out.data(), level);
+                checkSame(surfaceAreas, out, what + "SphereBatch::calculateSurfaceAreas");
+                threaded ? shapes.rectangleBatch.getAreas(out.data(), pool, level)
+                         : shapes.rectangleBatch.getAreas(out.data(), level);
+                checkSame(rectangleAreas, out, what + "RectangleBatch<double>::getAreas");
+                threaded ? shapes.intRectangleBatch.getAreas(intOut.data(), pool, level)
+                         : shapes.intRectangleBatch.getAreas(intOut.data(), level);
+                checkSame(intAreas, intOut, what + "RectangleBatch<int>::getAreas");
+                threaded ? shapes.pointBatch.distancesFromOrigin(out.data(), pool, level)
+                         : shapes.pointBatch.distancesFromOrigin(out.data(), level);
+                checkSame(distances, out, what + "PointBatch::distancesFromOrigin");
+            }
+        }
+    }
+
+    // Types without SIMD kernels fall back to the scalar loop
+    RectangleBatch<long long> big;
+    big.add(3000000000LL, 3);
+    long long area = 0;
+    big.getAreas(&area);
+    if (area != 9000000000LL) throw std::logic_error("RectangleBatch<long long> wrong");
+
+    // int products wrap the same way at every level, tails included
+    RectangleBatch<int> overflowing;
+    for (int i = 0; i < 11; i++) overflowing.add(65536 + i, 65536);
+    for (SimdLevel level : levels) {
+        if (level > detectSimdLevel()) continue;
+        std::vector<int> wrapped(overflowing.size());
+        overflowing.getAreas(wrapped.data(), level);
+        for (int i = 0; i < 11; i++) {
+            if (wrapped[i] != i * 65536) {
+                throw std::logic_error(std::string(simdLevelName(level)) + " RectangleBatch<int> does not wrap");
+            }
+        }
+    }
+
+    std::cout << "Sanity check passed\n\n";
+}
+
+// Best of 3 runs, in million shapes per second
+double millionPerSecond(size_t n, const std::function<void()>& run) {
+    double best = 0;
+    for (int repeat = 0; repeat < 3; repeat++) {
+        auto start = Clock::now();
+        run();
+        best = std::max(best, n / std::chrono::duration<double>(Clock::now() - start).count() / 1e6);
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+
+    sanityCheck();
+
+    Shapes shapes(n, 1);
+    ThreadPool pool;
+    std::vector<double> out(n);
+    std::vector<int> intOut(n);
+    double* o = out.data();
+    int* io = intOut.data();
+
+    std::cout << "Hardware threads: " << std::thread::hardware_concurrency() << ", "
+              << simdLevelName(detectSimdLevel()) << "\n";
+    std::cout << "Million shapes per second, " << n << " of each\n\n";
+    const char* columns[] = { "circle area", "sphere surf.", "rect<double>", "rect<int>", "point dist." };
+    std::cout << std::left << std::setw(22) << "" << std::right;
+    for (const char* column : columns) std::cout << std::setw(14) << column;
+    std::cout << "\n";
+
+    auto row = [&](const std::string& name, std::function<void()> runs[5]) {
+        std::cout << std::left << std::setw(22) << name << std::right << std::fixed << std::setprecision(0);
+        for (int i = 0; i < 5; i++) std::cout << std::setw(14) << millionPerSecond(n, runs[i]) << std::flush;
+        std::cout << "\n";
+    };
+
+    std::function<void()> objects[] = {
+        [&]() { for (size_t i = 0; i < n; i++) o[i] = shapes.circles[i].calculateArea(); },
+        [&]() { for (size_t i = 0; i < n; i++) o[i] = shapes.spheres[i].calculateSurfaceArea(); },
+        [&]() { for (size_t i = 0; i < n; i++) o[i] = shapes.rectangles[i].getArea(); },
+        [&]() { for (size_t i = 0; i < n; i++) io[i] = shapes.intRectangles[i].getArea(); },
+        [&]() { for (size_t i = 0; i < n; i++) o[i] = shapes.points[i].distanceFromOrigin(); },
+    };
+    row("objects, one by one", objects);
+
+    SimdLevel levels[] = { SimdLevel::Scalar, SimdLevel::SSE41, SimdLevel::AVX2 };
+    for (SimdLevel level : levels) {
+        if (level > detectSimdLevel()) continue;
+        std::function<void()> batches[] = {
+            [&]() { shapes.circleBatch.calculateAreas(o, level); },
+            [&]() { shapes.sphereBatch.calculateSurfaceAreas(o, level); },
+            [&]() { shapes.rectangleBatch.getAreas(o, level); },
+            [&]() { shapes.intRectangleBatch.getAreas(io, level); },
+            [&]() { shapes.pointBatch.distancesFromOrigin(o, level); },
+        };
+        row(std::string("batch ") + simdLevelName(level), batches);
+    }
+    SimdLevel best = detectSimdLevel();
+    std::function<void()> threaded[] = {
+        [&]() { shapes.circleBatch.calculateAreas(o, pool, best); },
+        [&]() { shapes.sphereBatch.calculateSurfaceAreas(o, pool, best); },
+        [&]() { shapes.rectangleBatch.getAreas(o, pool, best); },
+        [&]() { shapes.intRectangleBatch.getAreas(io, pool, best); },
+        [&]() { shapes.pointBatch.distancesFromOrigin(o, pool, best); },
+    };
+    row(std::string("batch ") + simdLevelName(best) + ", " + std::to_string(pool.workerCount() + 1) + " thr.", threaded);
+
+    std::cout << "\n(checksum " << out[n / 2] + intOut[n / 2] << ")\n";
+
+    return 0;
+}
+
+// Run program: Ctrl + F5 or Debug > Start Without Debugging menu
+// Debug program: F5 or Debug > Start Debugging menu
+
+// Tips for Getting Started:
+//   1. Use the Solution Explorer window to add/manage files
+//   2. Use the Team Explorer window to connect to source control
+//   3. Use the Output window to see build output and other messages
+//   4. Use the Error List window to view errors
+//   5. Go to Project > Add New Item to create new code files, or Project > Add Existing Item to add existing code files to the project
+//   6. In the future, to open this project again, go to File > Open > Project and select the .sln file
@@ -13,8 +13,9 @@
 #include <algorithm> // For std::min
 
 void resizeArray(int** arr, int oldSize, int newSize) {
-    // Allocate a new array with the new size
-    int* newArr = new int[newSize];
+    // Allocate a new array with the new size; () zeroes the elements
+    // that are not copied below, which would otherwise be garbage
+    int* newArr = new int[newSize]();
 
     // Copy elements from the old array to the new array
     int elementsToCopy = std::min(oldSize, newSize);
@@ -50,7 +51,6 @@ int main() {
 
     // Free the allocated memory
     delete[] array;
-    ++
     return 0;
 }
 
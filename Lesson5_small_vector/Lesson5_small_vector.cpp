@@ -0,0 +1,377 @@
+// Lesson5_small_vector.cpp : This file contains the 'main' function. Program execution begins and ends there.
+//
+// Appends ints one at a time to resizeArray() from Lesson5.cpp (grown by
+// one element per append, as the lesson uses it, and by doubling), to
+// std::vector and to SmallVector, and reports million appends per second,
+// the number of reallocations and how many of those moved the data to a
+// new address (realloc can often grow a block where it is). Then:
+//   - a million short arrays of 1 to 16 elements: std::vector against
+//     SmallVector<int, 16>, which never allocates for them
+//   - creating a large array that is then filled: zeroed by std::vector
+//     and SmallVector(n), left unset by SmallVector(n, defaultInit)
+//
+// Usage: Lesson5_small_vector [elements]
+//   Default: 20000000 elements (resizeArray by one: at most 100000).
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SmallVector.h"
+
+typedef std::chrono::steady_clock Clock;
+
+// From Lesson5.cpp
+void resizeArray(int** arr, int oldSize, int newSize) {
+    int* newArr = new int[newSize]();
+    int elementsToCopy = std::min(oldSize, newSize);
+    for (int i = 0; i < elementsToCopy; ++i) {
+        newArr[i] = (*arr)[i];
+    }
+    delete[] * arr;
+    *arr = newArr;
+}
+
+// std::unique_ptr only holds a pointer, so it can be moved with memcpy
+template<typename T>
+struct IsTriviallyRelocatable<std::unique_ptr<T>> : std::true_type {};
+
+// Counts live instances, to check that every element is destroyed once
+struct Tracked {
+    static int live;
+    int value;
+    Tracked(int value = 0) : value(value) { live++; }
+    Tracked(const Tracked& other) : value(other.value) { live++; }
+    Tracked(Tracked&& other) noexcept : value(other.value) { live++; }
+    Tracked& operator=(const Tracked&) = default;
+    ~Tracked() { live--; }
+    explicit operator int() const { return value; }
+};
+int Tracked::live = 0;
+
+// Counts live instances like Tracked; the copy after copiesLeft more
+// throws. No move constructor, so growing has to copy
+struct ThrowingCopy {
+    static int live;
+    static int copiesLeft;
+    int value;
+    ThrowingCopy(int value = 0) : value(value) { live++; }
+    ThrowingCopy(const ThrowingCopy& other) : value(other.value) {
+        if (copiesLeft-- == 0) throw std::runtime_error("copy failed");
+        live++;
+    }
+    ThrowingCopy& operator=(const ThrowingCopy&) = default;
+    ~ThrowingCopy() { live--; }
+    explicit operator int() const { return value; }
+};
+int ThrowingCopy::live = 0;
+int ThrowingCopy::copiesLeft = -1;
+
+// Runs fn, which must throw std::runtime_error
+template<typename Fn>
+void expectThrow(Fn fn, const char* what) {
+    bool threw = false;
+    try {
+        fn();
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    if (!threw) throw std::logic_error(std::string(what) + " did not throw");
+}
+
+template<typename Vector>
+void checkContents(const Vector& v, size_t n, int offset, const char* what) {
+    if (v.size() != n) throw std::logic_error(std::string(what) + ": wrong size");
+    for (size_t i = 0; i < n; i++) {
+        if (static_cast<int>(v[i]) != static_cast<int>(i) + offset) throw std::logic_error(std::string(what) + ": wrong element");
+    }
+}
+
+void sanityCheck() {
+    // Inline until the small buffer is full, then geometric growth
+    SmallVector<int, 4> small;
+    for (int i = 0; i < 4; i++) small.push_back(i);
+    if (!small.isInline() || small.capacity() != 4) throw std::logic_error("small buffer not used");
+    small.push_back(4);
+    if (small.isInline() || small.capacity() != 6) throw std::logic_error("growth by 1.5 wrong");
+    for (int i = 5; i < 1000; i++) small.push_back(small[i - 1] + 1);
+    checkContents(small, 1000, 0, "push_back");
+    small.resize(3);
+    small.shrink_to_fit();
+    if (!small.isInline() || small.capacity() != 4) throw std::logic_error("shrink_to_fit into the small buffer");
+    checkContents(small, 3, 0, "shrink_to_fit");
+    small.reserve(100);
+    if (small.capacity() != 100 || small.isInline()) throw std::logic_error("reserve wrong");
+    small.resize(50);
+    small.shrink_to_fit();
+    if (small.capacity() != 50 || small[49] != 0 || small[2] != 2) throw std::logic_error("shrink_to_fit on the heap");
+
+    SmallVector<int, 2, DoublingGrowth> doubling;
+    for (int i = 0; i < 9; i++) doubling.push_back(i);
+    if (doubling.capacity() != 16) throw std::logic_error("doubling growth wrong");
+
+    // Value-initialization zeroes, and the value overload fills
+    SmallVector<int> zeroed(1000);
+    SmallVector<int> filled(1000, 7);
+    if (std::count(zeroed.begin(), zeroed.end(), 0) != 1000 || std::count(filled.begin(), filled.end(), 7) != 1000) {
+        throw std::logic_error("resize initialization wrong");
+    }
+    SmallVector<int> unset(1000, defaultInit);
+    for (size_t i = 0; i < unset.size(); i++) unset[i] = static_cast<int>(i);
+    checkContents(unset, 1000, 0, "defaultInit");
+
+    // Copies, moves of inline and heap arrays, non-trivial elements
+    {
+        SmallVector<Tracked, 4> a;
+        for (int i = 0; i < 3; i++) a.emplace_back(i);
+        SmallVector<Tracked, 4> b = a;
+        SmallVector<Tracked, 4> c = std::move(a);
+        if (!a.empty() || !c.isInline()) throw std::logic_error("inline move wrong");
+        for (int i = 3; i < 100; i++) c.emplace_back(i);
+        const Tracked* heap = c.data();
+        SmallVector<Tracked, 4> d = std::move(c);
+        if (d.data() != heap || !c.empty() || !c.isInline()) throw std::logic_error("heap move did not steal");
+        checkContents(d, 100, 0, "moved");
+        b = d;
+        d = std::move(b);
+        c.push_back(d[5]);
+        c = d;
+        checkContents(c, 100, 0, "assigned");
+        c.resize(200, c[10]);
+        if (c[150].value != 10) throw std::logic_error("resize with an aliased value");
+        c.pop_back();
+        c.shrink_to_fit();
+        if (Tracked::live != 199 + 100) throw std::logic_error("Tracked live count wrong");
+    }
+    if (Tracked::live != 0) throw std::logic_error("elements leaked or destroyed twice");
+
+    // Appending an element of the array itself while it is full
+    {
+        SmallVector<Tracked, 4> a;
+        for (int i = 0; i < 4; i++) a.emplace_back(i);
+        a.push_back(a.back());
+        while (a.size() < a.capacity()) a.emplace_back(0);
+        a.emplace_back(a[0]);
+        if (a[4].value != 3 || a.back().value != 0) throw std::logic_error("append of an aliased Tracked");
+        SmallVector<std::string, 2> s;
+        s.push_back(std::string(100, 'a'));
+        s.push_back(std::string(100, 'b'));
+        s.push_back(s.back());
+        while (s.size() < s.capacity()) s.emplace_back();
+        s.emplace_back(s[0]);
+        if (s[2] != std::string(100, 'b') || s.back() != std::string(100, 'a')) {
+            throw std::logic_error("append of an aliased string");
+        }
+    }
+    if (Tracked::live != 0) throw std::logic_error("aliased appends leaked");
+
+    // A copy that throws while growing or resizing leaves the array as it was
+    {
+        SmallVector<ThrowingCopy, 2> a;
+        for (int i = 0; i < 6; i++) a.emplace_back(i);
+        ThrowingCopy::copiesLeft = 3;
+        expectThrow([&]() { a.reserve(100); }, "growing copy");
+        ThrowingCopy::copiesLeft = -1;
+        checkContents(a, 6, 0, "failed growth");
+        if (ThrowingCopy::live != 6) throw std::logic_error("failed growth leaked");
+        a.reserve(20);
+        ThrowingCopy::copiesLeft = 5;
+        expectThrow([&]() { a.resize(20, ThrowingCopy(6)); }, "resizing copy");
+        ThrowingCopy::copiesLeft = -1;
+        if (a.size() != 11 || a[10].value != 6 || ThrowingCopy::live != 11) {
+            throw std::logic_error("failed resize lost elements");
+        }
+    }
+    if (ThrowingCopy::live != 0) throw std::logic_error("ThrowingCopy leaked or destroyed twice");
+
+    // Relocation with realloc for a specialized type
+    SmallVector<std::unique_ptr<int>, 2> pointers;
+    for (int i = 0; i < 1000; i++) pointers.push_back(std::make_unique<int>(i));
+    for (int i = 0; i < 1000; i++) {
+        if (*pointers[i] != i) throw std::logic_error("unique_ptr relocation wrong");
+    }
+    SmallVector<std::string, 2> strings;
+    for (int i = 0; i < 100; i++) strings.push_back(std::string(i, 'x'));
+    for (int i = 0; i < 100; i++) {
+        if (strings[i].size() != static_cast<size_t>(i)) throw std::logic_error("string relocation wrong");
+    }
+
+    bool threw = false;
+    try {
+        strings.at(100);
+    } catch (const std::out_of_range&) {
+        threw = true;
+    }
+    if (!threw) throw std::logic_error("at() did not check the index");
+
+    // resizeArray now zeroes the new elements
+    int* array = new int[2]{ 1, 2 };
+    resizeArray(&array, 2, 5);
+    bool ok = array[0] == 1 && array[1] == 2 && array[2] == 0 && array[4] == 0;
+    delete[] array;
+    if (!ok) throw std::logic_error("resizeArray wrong");
+
+    std::cout << "Sanity check passed\n\n";
+}
+
+struct AppendResult {
+    double seconds;
+    size_t reallocations;
+    size_t moves;
+};
+
+// Appends 0 ... n-1; counts capacity changes and data address changes
+template<typename Vector>
+AppendResult appendAll(Vector& v, size_t n) {
+    AppendResult result{ 0, 0, 0 };
+    auto start = Clock::now();
+    size_t capacity = v.capacity();
+    const int* data = v.data();
+    for (size_t i = 0; i < n; i++) {
+        v.push_back(static_cast<int>(i));
+        if (v.capacity() != capacity) {
+            result.reallocations++;
+            result.moves += v.data() != data;
+            capacity = v.capacity();
+            data = v.data();
+        }
+    }
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    checkContents(v, n, 0, "append");
+    return result;
+}
+
+void printAppend(const std::string& name, size_t n, const AppendResult& result) {
+    std::cout << std::left << std::setw(34) << name << std::right << std::setw(12) << n << std::fixed
+              << std::setprecision(3) << std::setw(12) << n / result.seconds / 1e6 << std::setw(10)
+              << result.reallocations << std::setw(10) << result.moves << "\n";
+}
+
+int main(int argc, char* argv[]) {
+    size_t elements = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20000000;
+
+    sanityCheck();
+
+    std::cout << "Hardware threads: " << std::thread::hardware_concurrency() << "\n\n";
+    std::cout << std::left << std::setw(34) << "append one at a time" << std::right << std::setw(12) << "elements"
+              << std::setw(12) << "M/s" << std::setw(10) << "reallocs" << std::setw(10) << "moved" << "\n";
+
+    // resizeArray, one element more per append
+    {
+        int n = static_cast<int>(std::min<size_t>(elements, 100000));
+        int* array = nullptr;
+        auto start = Clock::now();
+        for (int i = 0; i < n; i++) {
+            resizeArray(&array, i, i + 1);
+            array[i] = i;
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        if (array[n - 1] != n - 1) throw std::logic_error("resizeArray append wrong");
+        delete[] array;
+        printAppend("resizeArray (+1 each time)", n, AppendResult{ seconds, static_cast<size_t>(n), static_cast<size_t>(n) });
+    }
+    // resizeArray, doubling when full
+    {
+        int n = static_cast<int>(elements), capacity = 0, reallocations = 0;
+        int* array = nullptr;
+        auto start = Clock::now();
+        for (int i = 0; i < n; i++) {
+            if (i == capacity) {
+                int grown = std::max(4, 2 * capacity);
+                resizeArray(&array, capacity, grown);
+                capacity = grown;
+                reallocations++;
+            }
+            array[i] = i;
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        if (array[n - 1] != n - 1) throw std::logic_error("resizeArray append wrong");
+        delete[] array;
+        printAppend("resizeArray (doubling)", n, AppendResult{ seconds, static_cast<size_t>(reallocations),
+                                                                 static_cast<size_t>(reallocations) });
+    }
+    {
+        std::vector<int> v;
+        printAppend("std::vector", elements, appendAll(v, elements));
+    }
+    {
+        std::vector<int> v;
+        v.reserve(elements);
+        printAppend("std::vector after reserve", elements, appendAll(v, elements));
+    }
+    {
+        SmallVector<int, 16> v;
+        printAppend("SmallVector<int, 16>", elements, appendAll(v, elements));
+    }
+    {
+        SmallVector<int, 16, DoublingGrowth> v;
+        printAppend("SmallVector<int, 16, Doubling>", elements, appendAll(v, elements));
+    }
+    {
+        SmallVector<int, 16> v;
+        v.reserve(elements);
+        printAppend("SmallVector after reserve", elements, appendAll(v, elements));
+    }
+
+    // Many short arrays
+    const size_t arrays = 1000000;
+    auto shortArrays = [&](auto make) {
+        auto start = Clock::now();
+        long long sum = 0;
+        for (size_t a = 0; a < arrays; a++) {
+            auto v = make();
+            size_t length = 1 + a % 16;
+            for (size_t i = 0; i < length; i++) v.push_back(static_cast<int>(i));
+            sum += v[length - 1];
+        }
+        if (sum != static_cast<long long>(arrays / 16) * 120) throw std::logic_error("short arrays wrong");
+        return arrays / std::chrono::duration<double>(Clock::now() - start).count() / 1e6;
+    };
+    std::cout << "\n" << arrays << " arrays of 1 to 16 elements, M arrays/s\n";
+    std::cout << std::left << std::setw(34) << "  std::vector" << std::right << std::setw(12)
+              << shortArrays([]() { return std::vector<int>(); }) << "\n";
+    std::cout << std::left << std::setw(34) << "  SmallVector<int, 16>" << std::right << std::setw(12)
+              << shortArrays([]() { return SmallVector<int, 16>(); }) << "\n";
+
+    // Create, then overwrite every element
+    auto createAndFill = [&](auto create) {
+        double best = 1e300;
+        for (int repeat = 0; repeat < 3; repeat++) {
+            auto start = Clock::now();
+            auto v = create();
+            for (size_t i = 0; i < elements; i++) v[i] = static_cast<int>(i);
+            best = std::min(best, std::chrono::duration<double>(Clock::now() - start).count());
+            checkContents(v, elements, 0, "create and fill");
+        }
+        return best * 1e3;
+    };
+    std::cout << "\nCreate " << elements << " ints, then fill them, ms\n";
+    std::cout << std::left << std::setw(34) << "  std::vector<int>(n)" << std::right << std::setw(12)
+              << createAndFill([&]() { return std::vector<int>(elements); }) << "\n";
+    std::cout << std::left << std::setw(34) << "  SmallVector<int>(n)" << std::right << std::setw(12)
+              << createAndFill([&]() { return SmallVector<int>(elements); }) << "\n";
+    std::cout << std::left << std::setw(34) << "  SmallVector<int>(n, defaultInit)" << std::right << std::setw(12)
+              << createAndFill([&]() { return SmallVector<int>(elements, defaultInit); }) << "\n";
+
+    return 0;
+}
+
+// Run program: Ctrl + F5 or Debug > Start Without Debugging menu
+// Debug program: F5 or Debug > Start Debugging menu
+
+// Tips for Getting Started:
+//   1. Use the Solution Explorer window to add/manage files
+//   2. Use the Team Explorer window to connect to source control
+//   3. Use the Output window to see build output and other messages
+//   4. Use the Error List window to view errors
+//   5. Go to Project > Add New Item to create new code files, or Project > Add Existing Item to add existing code files to the project
+//   6. In the future, to open this project again, go to File > Open > Project and select the .sln file
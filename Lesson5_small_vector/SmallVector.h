@@ -0,0 +1,366 @@
+// SmallVector.h
+//
+// A dynamic array to replace resizeArray() from Lesson5.cpp.
+//
+// resizeArray(&arr, oldSize, newSize) allocates exactly newSize elements
+// and copies the old ones across one by one. Growing an array one element
+// at a time therefore copies 1 + 2 + ... + n elements: O(n^2). The new
+// elements are left uninitialized, so printing them reads garbage.
+//
+// SmallVector<T, N, Growth> keeps size and capacity apart, like
+// std::vector, and adds:
+//
+//   geometric growth   a full array grows by a factor (Growth; 1.5 by
+//                      default, DoublingGrowth for 2), so n appends copy
+//                      fewer than 3n elements in total: amortized O(1)
+//   a small buffer     the first N elements live inside the object itself.
+//                      Arrays that stay small never touch the heap, and
+//                      one cache line holds the header and the data
+//   realloc            elements that can be moved by copying their bytes
+//                      (IsTriviallyRelocatable: every trivially copyable
+//                      type, plus any type for which it is specialized)
+//                      grow with std::realloc. It often extends the
+//                      block in place, and otherwise moves it with memcpy
+//                      instead of a loop of constructor calls
+//   defaultInit        SmallVector(n, defaultInit) and resize(n,
+//                      defaultInit) leave new ints, doubles, ... unset
+//                      instead of zeroing them, for arrays that are about
+//                      to be overwritten anyway
+//   reserve / shrink_to_fit as in std::vector; shrink_to_fit moves the
+//                      elements back into the small buffer if they fit
+//
+// Heap memory comes from std::malloc so that it can be passed to
+// std::realloc; types aligned beyond std::max_align_t are not supported.
+// As with std::vector, growing invalidates pointers to the elements.
+
+#ifndef SMALL_VECTOR_H
+#define SMALL_VECTOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @brief True if a T can be moved to another address by copying its
+ * bytes (and the original then forgotten). Specialize it for types such as
+ * std::unique_ptr that are relocatable without being trivially copyable.
+ */
+template<typename T>
+struct IsTriviallyRelocatable : std::is_trivially_copyable<T> {};
+
+/**
+ * @brief Grows capacity to at least Numerator / Denominator times the old
+ * capacity (and at least what is needed).
+ */
+template<size_t Numerator, size_t Denominator>
+struct GeometricGrowth {
+    static_assert(Numerator > Denominator && Denominator > 0, "GeometricGrowth must grow");
+
+    static size_t next(size_t capacity, size_t needed) {
+        size_t grown = capacity + (capacity * (Numerator - Denominator) + Denominator - 1) / Denominator;
+        return std::max({ grown, needed, size_t(4) });
+    }
+};
+
+typedef GeometricGrowth<3, 2> GoldenGrowth;
+typedef GeometricGrowth<2, 1> DoublingGrowth;
+
+struct DefaultInit {};
+
+/**
+ * @brief Pass to leave new elements default-initialized (unset for ints,
+ * doubles, pointers and other trivial types).
+ */
+constexpr DefaultInit defaultInit{};
+
+/**
+ * @brief Vector with an inline buffer for N elements and geometric growth.
+ */
+template<typename T, size_t N = 8, typename Growth = GoldenGrowth>
+class SmallVector {
+    static_assert(alignof(T) <= alignof(std::max_align_t), "SmallVector: over-aligned types are not supported");
+
+private:
+    T* first;
+    size_t count;
+    size_t capacity_;
+    alignas(T) unsigned char buffer[(N > 0 ? N : 1) * sizeof(T)];
+
+    static constexpr bool kRelocatable = IsTriviallyRelocatable<T>::value;
+
+    T* inlineData() { return reinterpret_cast<T*>(buffer); }
+
+    static T* allocate(size_t n) {
+        void* p = std::malloc(n * sizeof(T));
+        if (p == nullptr) throw std::bad_alloc();
+        return static_cast<T*>(p);
+    }
+
+    // Moves the n elements at from into uninitialized to; from is left
+    // without live elements. If a copy throws, the elements built in to are
+    // destroyed and from is left as it was
+    static void relocate(T* from, size_t n, T* to) {
+        if (kRelocatable) {
+            if (n != 0) std::memcpy(static_cast<void*>(to), static_cast<const void*>(from), n * sizeof(T));
+        } else {
+            size_t built = 0;
+            try {
+                for (; built < n; built++) ::new (static_cast<void*>(to + built)) T(std::move_if_noexcept(from[built]));
+            } catch (...) {
+                destroy(to, to + built);
+                throw;
+            }
+            destroy(from, from + n);
+        }
+    }
+
+    static void destroy(T* from, T* to) {
+        if (!std::is_trivially_destructible<T>::value) {
+            for (; from != to; ++from) from->~T();
+        }
+    }
+
+    // Exactly newCapacity >= count elements, on the heap
+    void reallocate(size_t newCapacity) {
+        if (kRelocatable && !isInline()) {
+            void* p = std::realloc(static_cast<void*>(first), newCapacity * sizeof(T));
+            if (p == nullptr) throw std::bad_alloc();
+            first = static_cast<T*>(p);
+        } else {
+            T* fresh = allocate(newCapacity);
+            try {
+                relocate(first, count, fresh);
+            } catch (...) {
+                std::free(fresh);
+                throw;
+            }
+            if (!isInline()) std::free(first);
+            first = fresh;
+        }
+        capacity_ = newCapacity;
+    }
+
+    void grow(size_t needed) {
+        reallocate(Growth::next(capacity_, needed));
+    }
+
+    // Moves other's elements into this empty, inline array
+    void takeFrom(SmallVector& other) {
+        if (!other.isInline()) {
+            first = other.first;
+            capacity_ = other.capacity_;
+            count = other.count;
+            other.first = other.inlineData();
+            other.capacity_ = N;
+            other.count = 0;
+        } else {
+            for (T& value : other) {
+                ::new (static_cast<void*>(first + count)) T(std::move(value));
+                count++;
+            }
+            other.clear();
+        }
+    }
+
+    template<typename Init>
+    void resizeWith(size_t n, Init init) {
+        if (n > capacity_) reallocate(std::max(n, Growth::next(capacity_, n)));
+        if (n < count) {
+            destroy(first + n, first + count);
+            count = n;
+        } else {
+            // count covers every element built so far if init throws
+            for (; count < n; count++) init(first + count);
+        }
+    }
+
+public:
+    typedef T value_type;
+    typedef T* iterator;
+    typedef const T* const_iterator;
+
+    SmallVector() : first(inlineData()), count(0), capacity_(N) {}
+
+    /**
+     * @brief n value-initialized elements (zero for arithmetic types).
+     */
+    explicit SmallVector(size_t n) : SmallVector() { resize(n); }
+
+    SmallVector(size_t n, const T& value) : SmallVector() { resize(n, value); }
+
+    /**
+     * @brief n default-initialized elements (unset for trivial types).
+     */
+    SmallVector(size_t n, DefaultInit) : SmallVector() { resize(n, defaultInit); }
+
+    SmallVector(std::initializer_list<T> values) : SmallVector() {
+        reserve(values.size());
+        for (const T& value : values) {
+            ::new (static_cast<void*>(first + count)) T(value);
+            count++;
+        }
+    }
+
+    SmallVector(const SmallVector& other) : SmallVector() {
+        reserve(other.count);
+        for (const T& value : other) {
+            ::new (static_cast<void*>(first + count)) T(value);
+            count++;
+        }
+    }
+
+    /**
+     * @brief Takes other's heap buffer; elements in other's small buffer are
+     * moved one by one. other is left empty.
+     */
+    SmallVector(SmallVector&& other) noexcept(std::is_nothrow_move_constructible<T>::value) : SmallVector() {
+        takeFrom(other);
+    }
+
+    SmallVector& operator=(const SmallVector& other) {
+        if (this != &other) {
+            clear();
+            reserve(other.count);
+            for (const T& value : other) {
+                ::new (static_cast<void*>(first + count)) T(value);
+                count++;
+            }
+        }
+        return *this;
+    }
+
+    SmallVector& operator=(SmallVector&& other) noexcept(std::is_nothrow_move_constructible<T>::value) {
+        if (this != &other) {
+            clear();
+            if (!isInline()) {
+                std::free(first);
+                first = inlineData();
+                capacity_ = N;
+            }
+            takeFrom(other);
+        }
+        return *this;
+    }
+
+    ~SmallVector() {
+        destroy(first, first + count);
+        if (!isInline()) std::free(first);
+    }
+
+    size_t size() const { return count; }
+    size_t capacity() const { return capacity_; }
+    bool empty() const { return count == 0; }
+
+    /**
+     * @brief True while the elements are in the small buffer.
+     */
+    bool isInline() const { return first == reinterpret_cast<const T*>(buffer); }
+
+    T* data() { return first; }
+    const T* data() const { return first; }
+    iterator begin() { return first; }
+    iterator end() { return first + count; }
+    const_iterator begin() const { return first; }
+    const_iterator end() const { return first + count; }
+
+    T& operator[](size_t index) { return first[index]; }
+    const T& operator[](size_t index) const { return first[index]; }
+
+    /**
+     * @throws std::out_of_range if index >= size().
+     */
+    T& at(size_t index) {
+        if (index >= count) throw std::out_of_range("SmallVector::at");
+        return first[index];
+    }
+
+    const T& at(size_t index) const {
+        if (index >= count) throw std::out_of_range("SmallVector::at");
+        return first[index];
+    }
+
+    T& front() { return first[0]; }
+    T& back() { return first[count - 1]; }
+    const T& front() const { return first[0]; }
+    const T& back() const { return first[count - 1]; }
+
+    template<typename... Args>
+    T& emplace_back(Args&&... args) {
+        if (count == capacity_) {
+            // args may refer to an element that the growth moves or frees
+            T value(std::forward<Args>(args)...);
+            grow(count + 1);
+            ::new (static_cast<void*>(first + count)) T(std::move(value));
+        } else {
+            ::new (static_cast<void*>(first + count)) T(std::forward<Args>(args)...);
+        }
+        return first[count++];
+    }
+
+    void push_back(const T& value) { emplace_back(value); }
+    void push_back(T&& value) { emplace_back(std::move(value)); }
+
+    void pop_back() {
+        first[--count].~T();
+    }
+
+    void clear() {
+        destroy(first, first + count);
+        count = 0;
+    }
+
+    /**
+     * @brief Makes room for n elements without growing again.
+     */
+    void reserve(size_t n) {
+        if (n > capacity_) reallocate(n);
+    }
+
+    /**
+     * @brief Gives back unused capacity: into the small buffer if the
+     * elements fit, otherwise to exactly size() elements.
+     */
+    void shrink_to_fit() {
+        if (isInline() || count == capacity_) return;
+        if (count <= N) {
+            T* heap = first;
+            relocate(heap, count, inlineData());
+            std::free(heap);
+            first = inlineData();
+            capacity_ = N;
+        } else {
+            reallocate(count);
+        }
+    }
+
+    /**
+     * @brief New elements are value-initialized (zero for arithmetic types).
+     */
+    void resize(size_t n) {
+        resizeWith(n, [](T* p) { ::new (static_cast<void*>(p)) T(); });
+    }
+
+    void resize(size_t n, const T& value) {
+        if (n > capacity_ && count != 0 && &value >= first && &value < first + count) {
+            T copy(value);
+            resize(n, copy);
+            return;
+        }
+        resizeWith(n, [&value](T* p) { ::new (static_cast<void*>(p)) T(value); });
+    }
+
+    /**
+     * @brief New elements are default-initialized (unset for trivial types).
+     */
+    void resize(size_t n, DefaultInit) {
+        resizeWith(n, [](T* p) { ::new (static_cast<void*>(p)) T; });
+    }
+};
+
+#endif // SMALL_VECTOR_H
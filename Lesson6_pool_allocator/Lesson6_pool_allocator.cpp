@@ -0,0 +1,275 @@
+// Lesson6_pool_allocator.cpp : This file contains the 'main' function. Program execution begins and ends there.
+//
+// Builds a LinkedList, a HashTableChaining and a BSTDictionary three ways -
+// with std::allocator (one `new` per node), with a PoolAllocator and with an
+// ArenaAllocator - and reports for each:
+//   - insert time per element
+//   - calls to the global operator new per insert
+//   - growth of the process resident set size (RSS)
+//   - time to destroy the whole container
+// A last run builds lists on several threads at once, each from its own
+// thread-local PoolResource.
+//
+// Usage: Lesson6_pool_allocator [elements] [row]
+//   Default is 2000000 elements. Memory freed by one row stays in the C
+//   runtime's heap and is reused by the next, so for clean RSS figures run
+//   one row per process, e.g. "Lesson6_pool_allocator 2000000 BSTDictionary / Pool".
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <unistd.h>
+#endif
+
+#include "NodeContainers.h"
+
+// Count every call to the global operator new made by this program.
+// GCC cannot see that these replacements pair malloc with free.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+static std::atomic<size_t> newCalls(0);
+
+void* operator new(size_t bytes) {
+    newCalls.fetch_add(1, std::memory_order_relaxed);
+    void* p = std::malloc(bytes == 0 ? 1 : bytes);
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+size_t residentBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return counters.WorkingSetSize;
+#else
+    size_t pages = 0, resident = 0;
+    FILE* statm = std::fopen("/proc/self/statm", "r");
+    if (statm != nullptr) {
+        if (std::fscanf(statm, "%zu %zu", &pages, &resident) != 2) resident = 0;
+        std::fclose(statm);
+    }
+    return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+typedef std::chrono::steady_clock Clock;
+
+double msSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+struct Result {
+    double insertNs;
+    double newsPerInsert;
+    double rssMB;
+    double destroyMs;
+};
+
+// Fill a freshly constructed container through `insert`, then destroy it.
+// The container lives on the heap so its destruction can be timed.
+template<typename Container, typename Make, typename Insert>
+Result measure(size_t n, Make make, Insert insert) {
+    Result result;
+    size_t rssBefore = residentBytes();
+    size_t newsBefore = newCalls.load();
+
+    Container* container = make();
+    auto start = Clock::now();
+    for (size_t i = 0; i < n; i++) {
+        insert(*container, i);
+    }
+    result.insertNs = msSince(start) * 1e6 / n;
+    result.newsPerInsert = static_cast<double>(newCalls.load() - newsBefore) / n;
+    result.rssMB = (static_cast<double>(residentBytes()) - rssBefore) / (1 << 20);
+
+    start = Clock::now();
+    delete container;
+    result.destroyMs = msSince(start);
+    return result;
+}
+
+void printRow(const std::string& name, const Result& r) {
+    std::cout << std::left << std::setw(34) << name << std::right << std::fixed
+              << std::setprecision(1) << std::setw(11) << r.insertNs
+              << std::setprecision(4) << std::setw(13) << r.newsPerInsert
+              << std::setprecision(1) << std::setw(10) << r.rssMB << std::setw(13) << r.destroyMs << "\n";
+}
+
+// The pooled containers must hold exactly what the std::allocator ones do,
+// including after removals (free-list reuse) and after clear()
+void sanityCheck() {
+    std::mt19937 rng(9);
+    HashTableChaining<int, int> plain(101);
+    HashTableChaining<int, int, PoolAllocator<int>> pooled(101);
+    BSTDictionary<int, int> plainTree;
+    BSTDictionary<int, int, ArenaAllocator<int>> arenaTree;
+
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 50000; i++) {
+            int key = static_cast<int>(rng() % 5000);
+            if (rng() % 4 == 0) {
+                if (plain.remove(key) != pooled.remove(key)) throw std::logic_error("remove mismatch");
+            } else {
+                plain.insert(key, i);
+                pooled.insert(key, i);
+                plainTree.insert(key, i);
+                arenaTree.insert(key, i);
+            }
+        }
+        for (int key = 0; key < 5000; key++) {
+            int* a = plain.find(key);
+            int* b = pooled.find(key);
+            int* c = plainTree.find(key);
+            int* d = arenaTree.find(key);
+            if ((a == nullptr) != (b == nullptr) || (a != nullptr && *a != *b) ||
+                (c == nullptr) != (d == nullptr) || (c != nullptr && *c != *d)) {
+                throw std::logic_error("lookup mismatch at " + std::to_string(key));
+            }
+        }
+        if (plain.getSize() != pooled.getSize() || plainTree.size() != arenaTree.size()) {
+            throw std::logic_error("size mismatch");
+        }
+        // Clearing releases the pooled memory in one step; the containers
+        // must keep working afterwards
+        pooled.clear();
+        plain.clear();
+        arenaTree.clear();
+        plainTree.clear();
+    }
+
+    // A shared resource is never released behind another container's back
+    PoolResource shared;
+    LinkedList<int, PoolAllocator<int>> first{ PoolAllocator<int>(shared) };
+    {
+        LinkedList<int, PoolAllocator<int>> second{ PoolAllocator<int>(shared) };
+        for (int i = 0; i < 1000; i++) {
+            first.push_back(i);
+            second.push_front(i);
+        }
+    }
+    long long sum = 0;
+    first.forEach([&sum](int v) { sum += v; });
+    while (first.pop_front()) {}
+    if (sum != 999 * 1000 / 2 || !first.empty()) {
+        throw std::logic_error("shared resource corrupted");
+    }
+    std::cout << "Sanity check passed\n\n";
+}
+
+// Each thread builds and tears down lists from its own pool, so no two
+// threads ever touch the same free list
+template<typename Alloc, typename MakeAlloc>
+double threadedListsMs(size_t threads, size_t perThread, MakeAlloc makeAlloc) {
+    auto start = Clock::now();
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; t++) {
+        workers.emplace_back([perThread, makeAlloc]() {
+            for (int round = 0; round < 4; round++) {
+                LinkedList<uint64_t, Alloc> list(makeAlloc());
+                for (size_t i = 0; i < perThread; i++) list.push_back(i);
+                while (list.pop_front()) {}
+            }
+        });
+    }
+    for (std::thread& worker : workers) worker.join();
+    return msSince(start);
+}
+
+int main(int argc, char* argv[]) {
+    size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+    std::string only = argc > 2 ? argv[2] : "";
+    auto selected = [&only](const std::string& name) { return name.find(only) != std::string::npos; };
+
+    sanityCheck();
+
+    std::mt19937_64 rng(17);
+    std::vector<uint64_t> keys(n);
+    for (size_t i = 0; i < n; i++) keys[i] = i;
+    std::shuffle(keys.begin(), keys.end(), rng);
+
+    std::cout << n << " elements\n";
+    std::cout << std::left << std::setw(34) << "container / allocator" << std::right
+              << std::setw(11) << "insert ns" << std::setw(13) << "news/insert"
+              << std::setw(10) << "RSS MB" << std::setw(13) << "destroy ms" << "\n";
+
+    auto listPush = [](auto& list, size_t i) { list.push_back(i); };
+    if (selected("LinkedList / std::allocator")) printRow("LinkedList / std::allocator", measure<LinkedList<uint64_t>>(n,
+        []() { return new LinkedList<uint64_t>(); }, listPush));
+    if (selected("LinkedList / PoolAllocator")) printRow("LinkedList / PoolAllocator", measure<LinkedList<uint64_t, PoolAllocator<uint64_t>>>(n,
+        []() { return new LinkedList<uint64_t, PoolAllocator<uint64_t>>(); }, listPush));
+    if (selected("LinkedList / ArenaAllocator")) printRow("LinkedList / ArenaAllocator", measure<LinkedList<uint64_t, ArenaAllocator<uint64_t>>>(n,
+        []() { return new LinkedList<uint64_t, ArenaAllocator<uint64_t>>(); }, listPush));
+
+    // Buckets are allocated up front so only node allocations are counted
+    size_t buckets = n + 1;
+    auto hashInsert = [&keys](auto& table, size_t i) { table.insert(keys[i], i); };
+    if (selected("HashTableChaining / std::allocator")) printRow("HashTableChaining / std::allocator", measure<HashTableChaining<uint64_t, uint64_t>>(n,
+        [buckets]() { return new HashTableChaining<uint64_t, uint64_t>(buckets); }, hashInsert));
+    if (selected("HashTableChaining / PoolAllocator")) printRow("HashTableChaining / PoolAllocator", measure<HashTableChaining<uint64_t, uint64_t, PoolAllocator<uint64_t>>>(n,
+        [buckets]() { return new HashTableChaining<uint64_t, uint64_t, PoolAllocator<uint64_t>>(buckets); }, hashInsert));
+    if (selected("HashTableChaining / ArenaAllocator")) printRow("HashTableChaining / ArenaAllocator", measure<HashTableChaining<uint64_t, uint64_t, ArenaAllocator<uint64_t>>>(n,
+        [buckets]() { return new HashTableChaining<uint64_t, uint64_t, ArenaAllocator<uint64_t>>(buckets); }, hashInsert));
+
+    auto treeInsert = [&keys](auto& tree, size_t i) { tree.insert(keys[i], i); };
+    if (selected("BSTDictionary / std::allocator")) printRow("BSTDictionary / std::allocator", measure<BSTDictionary<uint64_t, uint64_t>>(n,
+        []() { return new BSTDictionary<uint64_t, uint64_t>(); }, treeInsert));
+    if (selected("BSTDictionary / PoolAllocator")) printRow("BSTDictionary / PoolAllocator", measure<BSTDictionary<uint64_t, uint64_t, PoolAllocator<uint64_t>>>(n,
+        []() { return new BSTDictionary<uint64_t, uint64_t, PoolAllocator<uint64_t>>(); }, treeInsert));
+    if (selected("BSTDictionary / ArenaAllocator")) printRow("BSTDictionary / ArenaAllocator", measure<BSTDictionary<uint64_t, uint64_t, ArenaAllocator<uint64_t>>>(n,
+        []() { return new BSTDictionary<uint64_t, uint64_t, ArenaAllocator<uint64_t>>(); }, treeInsert));
+
+    // Many threads allocating at once: the global heap is shared, the
+    // thread-local pools are not
+    if (!only.empty()) return 0;
+    size_t threads = std::max<size_t>(2, std::thread::hardware_concurrency());
+    size_t perThread = std::max<size_t>(1, n / threads);
+    double heapMs = threadedListsMs<std::allocator<uint64_t>>(threads, perThread,
+        []() { return std::allocator<uint64_t>(); });
+    double poolMs = threadedListsMs<PoolAllocator<uint64_t>>(threads, perThread,
+        []() { return PoolAllocator<uint64_t>(PoolResource::forThisThread()); });
+    std::cout << "\n" << threads << " threads each building 4 lists of " << perThread << " elements (ms)\n";
+    std::cout << std::left << std::setw(34) << "std::allocator" << std::right << std::fixed
+              << std::setprecision(1) << std::setw(11) << heapMs << "\n";
+    std::cout << std::left << std::setw(34) << "thread-local PoolResource" << std::right
+              << std::setw(11) << poolMs << "\n";
+
+    return 0;
+}
+
+// Run program: Ctrl + F5 or Debug > Start Without Debugging menu
+// Debug program: F5 or Debug > Start Debugging menu
+
+// Tips for Getting Started:
+//   1. Use the Solution Explorer window to add/manage files
+//   2. Use the Team Explorer window to connect to source control
+//   3. Use the Output window to see build output and other messages
+//   4. Use the Error List window to view errors
+//   5. Go to Project > Add New Item to create new code files, or Project > Add Existing Item to add existing code files to the project
+//   6. In the future, to open this project again, go to File > Open > Project and select the .sln file
@@ -0,0 +1,315 @@
+// NodeContainers.h
+//
+// The node-based containers from the lessons - a singly linked list
+// (Lesson 6) and HashTableChaining / BSTDictionary ("Lesson10  dictionary
+// types.md") - with an allocator parameter added.
+//
+// With the default std::allocator they behave exactly like the lesson
+// versions: one `new` per node. Pass a PoolAllocator or ArenaAllocator from
+// NodePool.h and the nodes come from that resource instead. If the container
+// is the only user of an owning resource and its nodes need no destructor,
+// clear() and the destructor drop the whole resource in one step instead of
+// visiting every node.
+
+#ifndef NODE_CONTAINERS_H
+#define NODE_CONTAINERS_H
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "NodePool.h"
+
+// Allocation helpers shared by the containers below
+template<typename Node, typename Alloc>
+struct NodeStorage {
+    typedef typename std::allocator_traits<Alloc>::template rebind_alloc<Node> NodeAlloc;
+    typedef std::allocator_traits<NodeAlloc> Traits;
+
+    NodeAlloc alloc;
+
+    explicit NodeStorage(const Alloc& a) : alloc(a) {}
+
+    template<typename... Args>
+    Node* create(Args&&... args) {
+        Node* node = Traits::allocate(alloc, 1);
+        try {
+            Traits::construct(alloc, node, std::forward<Args>(args)...);
+        } catch (...) {
+            Traits::deallocate(alloc, node, 1);
+            throw;
+        }
+        return node;
+    }
+
+    void destroy(Node* node) {
+        Traits::destroy(alloc, node);
+        Traits::deallocate(alloc, node, 1);
+    }
+
+    // True if every node was freed at once and the caller can skip its walk
+    bool releaseAll() {
+        return std::is_trivially_destructible<Node>::value && releaseAllNodes(alloc);
+    }
+};
+
+/**
+ * @brief Singly linked list with head and tail pointers.
+ */
+template<typename T, typename Alloc = std::allocator<T>>
+class LinkedList {
+private:
+    struct Node {
+        T data;
+        Node* next;
+        explicit Node(const T& value) : data(value), next(nullptr) {}
+    };
+
+    NodeStorage<Node, Alloc> nodes;
+    Node* head;
+    Node* tail;
+    size_t count;
+
+public:
+    explicit LinkedList(const Alloc& alloc = Alloc()) : nodes(alloc), head(nullptr), tail(nullptr), count(0) {}
+
+    LinkedList(const LinkedList&) = delete;
+    LinkedList& operator=(const LinkedList&) = delete;
+
+    ~LinkedList() {
+        clear();
+    }
+
+    void push_front(const T& value) {
+        Node* node = nodes.create(value);
+        node->next = head;
+        head = node;
+        if (tail == nullptr) tail = node;
+        count++;
+    }
+
+    void push_back(const T& value) {
+        Node* node = nodes.create(value);
+        if (tail == nullptr) {
+            head = tail = node;
+        } else {
+            tail->next = node;
+            tail = node;
+        }
+        count++;
+    }
+
+    bool pop_front() {
+        if (head == nullptr) return false;
+        Node* node = head;
+        head = head->next;
+        if (head == nullptr) tail = nullptr;
+        nodes.destroy(node);
+        count--;
+        return true;
+    }
+
+    T* front() { return head == nullptr ? nullptr : &head->data; }
+
+    template<typename Fn>
+    void forEach(Fn fn) const {
+        for (Node* node = head; node != nullptr; node = node->next) {
+            fn(node->data);
+        }
+    }
+
+    void clear() {
+        if (!nodes.releaseAll()) {
+            while (head != nullptr) {
+                Node* next = head->next;
+                nodes.destroy(head);
+                head = next;
+            }
+        }
+        head = tail = nullptr;
+        count = 0;
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+};
+
+/**
+ * @brief Separate-chaining hash table (fixed bucket count, as in the lesson).
+ */
+template<typename K, typename V, typename Alloc = std::allocator<std::pair<const K, V>>>
+class HashTableChaining {
+private:
+    struct Node {
+        K key;
+        V value;
+        Node* next;
+        Node(const K& k, const V& v) : key(k), value(v), next(nullptr) {}
+    };
+
+    NodeStorage<Node, Alloc> nodes;
+    std::vector<Node*> table;
+    size_t size;
+
+    size_t hash(const K& key) const {
+        return std::hash<K>{}(key) % table.size();
+    }
+
+public:
+    explicit HashTableChaining(size_t capacity = 997, const Alloc& alloc = Alloc())
+        : nodes(alloc), table(capacity, nullptr), size(0) {}
+
+    HashTableChaining(const HashTableChaining&) = delete;
+    HashTableChaining& operator=(const HashTableChaining&) = delete;
+
+    ~HashTableChaining() {
+        clear();
+    }
+
+    void insert(const K& key, const V& value) {
+        size_t index = hash(key);
+        Node* current = table[index];
+
+        // Check if key exists
+        while (current != nullptr) {
+            if (current->key == key) {
+                current->value = value;  // Update existing
+                return;
+            }
+            current = current->next;
+        }
+
+        // Insert new node at beginning of chain
+        Node* newNode = nodes.create(key, value);
+        newNode->next = table[index];
+        table[index] = newNode;
+        size++;
+    }
+
+    V* find(const K& key) {
+        for (Node* current = table[hash(key)]; current != nullptr; current = current->next) {
+            if (current->key == key) return &current->value;
+        }
+        return nullptr;
+    }
+
+    bool remove(const K& key) {
+        Node** link = &table[hash(key)];
+        while (*link != nullptr) {
+            if ((*link)->key == key) {
+                Node* node = *link;
+                *link = node->next;
+                nodes.destroy(node);
+                size--;
+                return true;
+            }
+            link = &(*link)->next;
+        }
+        return false;
+    }
+
+    void clear() {
+        bool released = nodes.releaseAll();
+        for (Node*& head : table) {
+            while (!released && head != nullptr) {
+                Node* next = head->next;
+                nodes.destroy(head);
+                head = next;
+            }
+            head = nullptr;
+        }
+        size = 0;
+    }
+
+    size_t getSize() const { return size; }
+};
+
+/**
+ * @brief Unbalanced binary search tree dictionary.
+ */
+template<typename K, typename V, typename Alloc = std::allocator<std::pair<const K, V>>>
+class BSTDictionary {
+private:
+    struct Node {
+        K key;
+        V value;
+        Node* left;
+        Node* right;
+
+        Node(const K& k, const V& v)
+            : key(k), value(v), left(nullptr), right(nullptr) {}
+    };
+
+    NodeStorage<Node, Alloc> nodes;
+    Node* root;
+    size_t count;
+
+    // Iterative so sorted input (a degenerate tree) cannot overflow the stack
+    void destroyAll() {
+        Node* node = root;
+        while (node != nullptr) {
+            if (node->left != nullptr) {
+                // Rotate the left child up so the walk only ever goes right
+                Node* left = node->left;
+                node->left = left->right;
+                left->right = node;
+                node = left;
+            } else {
+                Node* right = node->right;
+                nodes.destroy(node);
+                node = right;
+            }
+        }
+    }
+
+public:
+    explicit BSTDictionary(const Alloc& alloc = Alloc()) : nodes(alloc), root(nullptr), count(0) {}
+
+    BSTDictionary(const BSTDictionary&) = delete;
+    BSTDictionary& operator=(const BSTDictionary&) = delete;
+
+    ~BSTDictionary() {
+        clear();
+    }
+
+    void insert(const K& key, const V& value) {
+        Node** link = &root;
+        while (*link != nullptr) {
+            if (key < (*link)->key) {
+                link = &(*link)->left;
+            } else if ((*link)->key < key) {
+                link = &(*link)->right;
+            } else {
+                (*link)->value = value;  // Update existing
+                return;
+            }
+        }
+        *link = nodes.create(key, value);
+        count++;
+    }
+
+    V* find(const K& key) {
+        Node* node = root;
+        while (node != nullptr) {
+            if (key < node->key) node = node->left;
+            else if (node->key < key) node = node->right;
+            else return &node->value;
+        }
+        return nullptr;
+    }
+
+    void clear() {
+        if (!nodes.releaseAll()) {
+            destroyAll();
+        }
+        root = nullptr;
+        count = 0;
+    }
+
+    size_t size() const { return count; }
+};
+
+#endif // NODE_CONTAINERS_H
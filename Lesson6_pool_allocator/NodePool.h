@@ -0,0 +1,319 @@
+// NodePool.h
+//
+// Memory resources for node-based containers (linked lists, chained hash
+// tables, binary search trees).
+//
+// Those containers call `new Node` once per element. Each call goes through
+// the general-purpose heap, which has to handle every size and every thread,
+// and the nodes end up scattered across memory. Freeing the container then
+// walks every node just to delete it.
+//
+// The classes here hand out memory from large chunks instead:
+//
+//   BlockPool      one block size; freed blocks go onto a free list and are
+//                  reused by the next allocation
+//   PoolResource   a BlockPool per 16-byte size class (up to 256 bytes)
+//   ArenaResource  "monotonic" bump allocation; individual frees do nothing
+//                  and everything is returned at once by release()
+//   PoolAllocator  a standard allocator over either resource, so it can be
+//                  passed to our containers and to std::list, std::map, ...
+//
+// None of the resources lock. Give each thread its own resource (for example
+// PoolResource::forThisThread()) and the free lists are thread-local for free.
+
+#ifndef NODE_POOL_H
+#define NODE_POOL_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+/**
+ * @brief Pool of equally sized blocks carved out of geometrically growing chunks.
+ */
+class BlockPool {
+public:
+    explicit BlockPool(size_t blockSize = 16)
+        : blockSize_(roundUp(blockSize < sizeof(FreeBlock) ? sizeof(FreeBlock) : blockSize)),
+          freeList(nullptr), cursor(nullptr), chunkEnd(nullptr), nextChunkBytes(4096), reserved(0) {}
+
+    BlockPool(const BlockPool&) = delete;
+    BlockPool& operator=(const BlockPool&) = delete;
+
+    ~BlockPool() {
+        release();
+    }
+
+    void* allocate() {
+        if (freeList != nullptr) {
+            FreeBlock* block = freeList;
+            freeList = block->next;
+            return block;
+        }
+        if (cursor == chunkEnd) {
+            addChunk();
+        }
+        void* block = cursor;
+        cursor += blockSize_;
+        return block;
+    }
+
+    void deallocate(void* p) {
+        FreeBlock* block = static_cast<FreeBlock*>(p);
+        block->next = freeList;
+        freeList = block;
+    }
+
+    // Return every chunk to the heap at once, without visiting the blocks.
+    // Every pointer handed out by this pool becomes invalid.
+    void release() {
+        for (void* chunk : chunks) {
+            ::operator delete(chunk);
+        }
+        chunks.clear();
+        freeList = nullptr;
+        cursor = chunkEnd = nullptr;
+        nextChunkBytes = 4096;
+        reserved = 0;
+    }
+
+    size_t blockSize() const { return blockSize_; }
+    size_t chunkCount() const { return chunks.size(); }
+    size_t bytesReserved() const { return reserved; }
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    static const size_t kAlignment = alignof(std::max_align_t);
+    static const size_t kMaxChunkBytes = 1 << 20;
+
+    size_t blockSize_;
+    FreeBlock* freeList;
+    char* cursor;                   // next never-used block in the newest chunk
+    char* chunkEnd;
+    size_t nextChunkBytes;
+    size_t reserved;
+    std::vector<void*> chunks;
+
+    static size_t roundUp(size_t n) {
+        return (n + kAlignment - 1) / kAlignment * kAlignment;
+    }
+
+    // Chunks double in size (4 KB up to 1 MB) so a pool holding n blocks
+    // owns only O(log n) small chunks plus n / 1 MB large ones
+    void addChunk() {
+        size_t bytes = nextChunkBytes < blockSize_ ? blockSize_ : nextChunkBytes;
+        bytes = bytes / blockSize_ * blockSize_;
+        char* chunk = static_cast<char*>(::operator new(bytes));
+        chunks.push_back(chunk);
+        cursor = chunk;
+        chunkEnd = chunk + bytes;
+        reserved += bytes;
+        if (nextChunkBytes < kMaxChunkBytes) {
+            nextChunkBytes *= 2;
+        }
+    }
+};
+
+/**
+ * @brief General resource that serves small requests from per-size BlockPools.
+ *
+ * Requests above 256 bytes or with unusual alignment go straight to
+ * ::operator new.
+ */
+class PoolResource {
+public:
+    PoolResource() {
+        for (size_t i = 0; i < kClasses; i++) {
+            pools[i].reset(new BlockPool((i + 1) * kClassBytes));
+        }
+    }
+
+    void* allocate(size_t bytes, size_t alignment) {
+        if (bytes > kClasses * kClassBytes || alignment > alignof(std::max_align_t)) {
+            return ::operator new(bytes);
+        }
+        return pools[classOf(bytes)]->allocate();
+    }
+
+    void deallocate(void* p, size_t bytes, size_t alignment) {
+        if (bytes > kClasses * kClassBytes || alignment > alignof(std::max_align_t)) {
+            ::operator delete(p);
+            return;
+        }
+        pools[classOf(bytes)]->deallocate(p);
+    }
+
+    // Free every pooled block at once. Oversized requests are not tracked
+    // and must have been deallocated individually.
+    void release() {
+        for (size_t i = 0; i < kClasses; i++) {
+            pools[i]->release();
+        }
+    }
+
+    size_t bytesReserved() const {
+        size_t total = 0;
+        for (size_t i = 0; i < kClasses; i++) {
+            total += pools[i]->bytesReserved();
+        }
+        return total;
+    }
+
+    // A resource private to the calling thread, destroyed when it exits.
+    // Memory from it must be freed on the same thread.
+    static PoolResource& forThisThread() {
+        thread_local PoolResource resource;
+        return resource;
+    }
+
+private:
+    static const size_t kClassBytes = 16;
+    static const size_t kClasses = 16;
+
+    std::unique_ptr<BlockPool> pools[kClasses];
+
+    static size_t classOf(size_t bytes) {
+        return bytes == 0 ? 0 : (bytes - 1) / kClassBytes;
+    }
+};
+
+/**
+ * @brief Monotonic (bump pointer) arena. deallocate() is a no-op; memory is
+ *        only returned by release() or the destructor.
+ */
+class ArenaResource {
+public:
+    ArenaResource() : cursor(nullptr), chunkEnd(nullptr), nextChunkBytes(4096), reserved(0) {}
+
+    ArenaResource(const ArenaResource&) = delete;
+    ArenaResource& operator=(const ArenaResource&) = delete;
+
+    ~ArenaResource() {
+        release();
+    }
+
+    void* allocate(size_t bytes, size_t alignment) {
+        size_t pad = (alignment - reinterpret_cast<size_t>(cursor) % alignment) % alignment;
+        if (cursor == nullptr || pad + bytes > static_cast<size_t>(chunkEnd - cursor)) {
+            addChunk(bytes + alignment);
+            pad = (alignment - reinterpret_cast<size_t>(cursor) % alignment) % alignment;
+        }
+        char* p = cursor + pad;
+        cursor = p + bytes;
+        return p;
+    }
+
+    void deallocate(void*, size_t, size_t) {}
+
+    void release() {
+        for (void* chunk : chunks) {
+            ::operator delete(chunk);
+        }
+        chunks.clear();
+        cursor = chunkEnd = nullptr;
+        nextChunkBytes = 4096;
+        reserved = 0;
+    }
+
+    size_t bytesReserved() const { return reserved; }
+
+private:
+    static const size_t kMaxChunkBytes = 1 << 20;
+
+    char* cursor;
+    char* chunkEnd;
+    size_t nextChunkBytes;
+    size_t reserved;
+    std::vector<void*> chunks;
+
+    void addChunk(size_t atLeast) {
+        size_t bytes = nextChunkBytes < atLeast ? atLeast : nextChunkBytes;
+        char* chunk = static_cast<char*>(::operator new(bytes));
+        chunks.push_back(chunk);
+        cursor = chunk;
+        chunkEnd = chunk + bytes;
+        reserved += bytes;
+        if (nextChunkBytes < kMaxChunkBytes) {
+            nextChunkBytes *= 2;
+        }
+    }
+};
+
+/**
+ * @brief Standard-conforming allocator backed by a PoolResource or ArenaResource.
+ *
+ * A default-constructed allocator owns a fresh resource of its own; copies
+ * (including rebound copies made inside a container) share it. Constructing
+ * from a Resource& shares a resource owned by the caller instead.
+ */
+template<typename T, typename Resource = PoolResource>
+class PoolAllocator {
+public:
+    typedef T value_type;
+
+    PoolAllocator() : resource(std::make_shared<Resource>()), owning(true) {}
+
+    explicit PoolAllocator(Resource& shared)
+        : resource(std::shared_ptr<Resource>(), &shared), owning(false) {}
+
+    template<typename U>
+    PoolAllocator(const PoolAllocator<U, Resource>& other) : resource(other.resource), owning(other.owning) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(resource->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, size_t n) {
+        resource->deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    /**
+     * @brief Free everything in the resource at once, if that is safe.
+     *
+     * Only succeeds when this allocator owns its resource and no other
+     * allocator shares it, i.e. the calling container is the only user.
+     * @return true if the memory was released.
+     */
+    bool release_all() {
+        if (owning && resource.use_count() == 1) {
+            resource->release();
+            return true;
+        }
+        return false;
+    }
+
+    Resource& getResource() const { return *resource; }
+
+    template<typename U>
+    bool operator==(const PoolAllocator<U, Resource>& other) const { return resource == other.resource; }
+    template<typename U>
+    bool operator!=(const PoolAllocator<U, Resource>& other) const { return resource != other.resource; }
+
+private:
+    template<typename U, typename R> friend class PoolAllocator;
+
+    std::shared_ptr<Resource> resource;
+    bool owning;
+};
+
+template<typename T>
+using ArenaAllocator = PoolAllocator<T, ArenaResource>;
+
+// Containers call this before freeing their nodes one by one. It returns
+// true, meaning "all nodes are already gone", only for an allocator that can
+// drop its whole resource; for std::allocator and others it does nothing.
+template<typename Alloc>
+bool releaseAllNodes(Alloc&) {
+    return false;
+}
+
+template<typename T, typename Resource>
+bool releaseAllNodes(PoolAllocator<T, Resource>& alloc) {
+    return alloc.release_all();
+}
+
+#endif // NODE_POOL_H
@@ -0,0 +1,261 @@
+// Lesson7_range_kernels.cpp : This file contains the 'main' function. Program execution begins and ends there.
+//
+// The max and area templates of Lesson7 applied to whole arrays: the loops
+// of the lesson, one call per element, against the range overloads of
+// RangeKernels.h, for int8_t, int16_t, int32_t, int64_t, float and double.
+// Reports billion elements per second for the largest element, the areas
+// of rectangles and their total. The sanity check compares the kernels of
+// every SIMD level with the lesson loops, and evaluates the overloads at
+// compile time.
+//
+// Usage: Lesson7_range_kernels [elements]
+//   Default: 65536 elements (in the L2 cache), processed repeatedly.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "RangeKernels.h"
+
+typedef std::chrono::steady_clock Clock;
+
+// From Lesson7_tempate_functions_2.cpp
+template <typename T>
+T max(T a, T b) {
+    return (a > b) ? a : b;
+}
+
+// From Lesson7_worked_example_1.cpp
+template <typename T>
+T area(T a, T b) {
+    return a * b;
+}
+
+// The loops of the lesson
+template<typename T>
+T naiveMax(const std::vector<T>& data) {
+    T m = data[0];
+    for (size_t i = 1; i < data.size(); i++) m = max(m, data[i]);
+    return m;
+}
+
+template<typename T>
+void naiveArea(const std::vector<T>& lengths, const std::vector<T>& widths, std::vector<T>& out) {
+    for (size_t i = 0; i < lengths.size(); i++) out[i] = area(lengths[i], widths[i]);
+}
+
+template<typename T>
+T naiveTotalArea(const std::vector<T>& lengths, const std::vector<T>& widths) {
+    T total = T();
+    for (size_t i = 0; i < lengths.size(); i++) total += area(lengths[i], widths[i]);
+    return total;
+}
+
+// Values in [low, high]; integers when T is floating point, so that the
+// sums are exact whatever their order
+template<typename T>
+std::vector<T> randomValues(size_t n, long long low, long long high, std::mt19937_64& rng) {
+    std::uniform_int_distribution<long long> value(low, high);
+    std::vector<T> values(n);
+    for (T& v : values) v = static_cast<T>(value(rng));
+    return values;
+}
+
+template<typename T>
+void checkType(const std::string& name) {
+    std::mt19937_64 rng(sizeof(T));
+    long long low = std::is_signed<T>::value ? -11 : 0;
+    SimdLevel levels[] = { SimdLevel::Scalar, SimdLevel::SSE41, SimdLevel::AVX2 };
+    for (size_t n = 0; n <= 300; n += n < 140 ? 1 : 37) {
+        // Full range for max: the lowest and highest values of the type
+        std::vector<T> data = randomValues<T>(n, static_cast<long long>(std::numeric_limits<T>::lowest() / 2),
+                                              static_cast<long long>(std::numeric_limits<T>::max() / 2), rng);
+        if (n > 0) data[rng() % n] = std::numeric_limits<T>::lowest();
+        std::vector<T> lengths = randomValues<T>(n, low, 11, rng), widths = randomValues<T>(n, low, 11, rng);
+        std::vector<T> areas(n);
+        naiveArea(lengths, widths, areas);
+        T total = naiveTotalArea(lengths, widths);
+
+        for (SimdLevel level : levels) {
+            if (level > detectSimdLevel()) continue;
+            std::string what = name + " " + simdLevelName(level) + " n=" + std::to_string(n) + ": ";
+            if (n > 0 && max(data.data(), n, level) != naiveMax(data)) throw std::logic_error(what + "max wrong");
+            std::vector<T> out(n);
+            area(lengths.data(), widths.data(), out.data(), n, level);
+            if (out != areas) throw std::logic_error(what + "area wrong");
+            if (totalArea(lengths.data(), widths.data(), n, level) != total) {
+                throw std::logic_error(what + "totalArea wrong");
+            }
+        }
+        if (n > 0 && max(data) != naiveMax(data)) throw std::logic_error(name + " max of a vector wrong");
+        if (totalArea(lengths, widths) != total) throw std::logic_error(name + " totalArea of vectors wrong");
+    }
+}
+
+// The lowest and highest values of a 16-bit type, whose products overflow
+// an int: compared with the products and sums of their 32-bit unsigned
+// counterparts, cut down to 16 bits
+template<typename T>
+void checkExtremes(const std::string& name) {
+    const T extremes[] = { std::numeric_limits<T>::lowest(), std::numeric_limits<T>::max(),
+                           static_cast<T>(std::numeric_limits<T>::lowest() + 1), static_cast<T>(std::numeric_limits<T>::max() - 1) };
+    std::vector<T> lengths, widths;
+    for (size_t copy = 0; copy < 20; copy++) {
+        for (T a : extremes) {
+            for (T b : extremes) {
+                lengths.push_back(a);
+                widths.push_back(b);
+            }
+        }
+    }
+    std::vector<T> areas(lengths.size());
+    uint32_t total = 0;
+    for (size_t i = 0; i < lengths.size(); i++) {
+        uint32_t product = static_cast<uint32_t>(lengths[i]) * static_cast<uint32_t>(widths[i]);
+        areas[i] = static_cast<T>(static_cast<uint16_t>(product));
+        total += product;
+    }
+    T expected = static_cast<T>(static_cast<uint16_t>(total));
+
+    for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE41, SimdLevel::AVX2 }) {
+        if (level > detectSimdLevel()) continue;
+        std::string what = name + " " + simdLevelName(level) + " extremes: ";
+        std::vector<T> out(lengths.size());
+        area(lengths.data(), widths.data(), out.data(), out.size(), level);
+        if (out != areas) throw std::logic_error(what + "area wrong");
+        if (totalArea(lengths.data(), widths.data(), lengths.size(), level) != expected) {
+            throw std::logic_error(what + "totalArea wrong");
+        }
+    }
+}
+
+void sanityCheck() {
+    checkType<int8_t>("int8_t");
+    checkType<uint8_t>("uint8_t");
+    checkType<int16_t>("int16_t");
+    checkType<uint16_t>("uint16_t");
+    checkType<int32_t>("int32_t");
+    checkType<uint32_t>("uint32_t");
+    checkType<int64_t>("int64_t");
+    checkType<uint64_t>("uint64_t");
+    checkType<float>("float");
+    checkType<double>("double");
+    checkType<char>("char");
+    checkType<long>("long");
+    checkType<long long>("long long");
+    checkType<long double>("long double");
+
+    // Evaluated by the compiler
+    constexpr int values[] = { 3, 9, -2, 7 };
+    static_assert(max(values) == 9, "constexpr max wrong");
+    static_assert(max(values + 2, 1) == -2, "constexpr max wrong");
+    constexpr double lengths[] = { 1.5, 2.0, 4.0 };
+    constexpr double widths[] = { 2.0, 3.0, 0.25 };
+    static_assert(totalArea(lengths, widths) == 10.0, "constexpr totalArea wrong");
+    constexpr uint16_t longest[] = { 65535, 65535 };
+    static_assert(totalArea(longest, longest) == 2, "constexpr 16-bit totalArea does not wrap around");
+
+    // Integer sums wrap around, on every path
+    std::vector<int32_t> big(1000, 100000);
+    int32_t expected = static_cast<int32_t>(static_cast<uint32_t>(100000u * 100000u) * 1000u);
+    for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::AVX2 }) {
+        if (level > detectSimdLevel()) continue;
+        if (totalArea(big.data(), big.data(), big.size(), level) != expected) {
+            throw std::logic_error("totalArea does not wrap around");
+        }
+    }
+    checkExtremes<int16_t>("int16_t");
+    checkExtremes<uint16_t>("uint16_t");
+
+    bool threw = false;
+    try {
+        max(std::vector<int>());
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    if (!threw) throw std::logic_error("max of an empty range did not throw");
+
+    std::cout << "Sanity check passed\n\n";
+}
+
+// Best of 3 runs of repeats calls, in billion elements per second
+double billionPerSecond(size_t elements, const std::function<void()>& run) {
+    double best = 0;
+    for (int repeat = 0; repeat < 3; repeat++) {
+        auto start = Clock::now();
+        run();
+        best = std::max(best, elements / std::chrono::duration<double>(Clock::now() - start).count() / 1e9);
+    }
+    return best;
+}
+
+// Keeps the compiler from dropping results nobody reads
+volatile double sink;
+
+template<typename T>
+void benchmarkType(const std::string& name, size_t n, size_t repeats) {
+    std::mt19937_64 rng(1);
+    std::vector<T> data = randomValues<T>(n, -100, 100, rng);
+    std::vector<T> lengths = randomValues<T>(n, 0, 100, rng), widths = randomValues<T>(n, 0, 100, rng);
+    std::vector<T> out(n);
+    size_t elements = n * repeats;
+
+    std::function<void()> runs[] = {
+        [&]() { for (size_t r = 0; r < repeats; r++) sink = static_cast<double>(naiveMax(data)); },
+        [&]() { for (size_t r = 0; r < repeats; r++) sink = static_cast<double>(max(data)); },
+        [&]() { for (size_t r = 0; r < repeats; r++) { naiveArea(lengths, widths, out); sink = static_cast<double>(out[r % n]); } },
+        [&]() { for (size_t r = 0; r < repeats; r++) { area(lengths, widths, out); sink = static_cast<double>(out[r % n]); } },
+        [&]() { for (size_t r = 0; r < repeats; r++) sink = static_cast<double>(naiveTotalArea(lengths, widths)); },
+        [&]() { for (size_t r = 0; r < repeats; r++) sink = static_cast<double>(totalArea(lengths, widths)); },
+    };
+    std::cout << std::left << std::setw(10) << name << std::right << std::fixed << std::setprecision(2);
+    for (const std::function<void()>& run : runs) std::cout << std::setw(11) << billionPerSecond(elements, run) << std::flush;
+    std::cout << "\n";
+}
+
+int main(int argc, char* argv[]) {
+    size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 65536;
+    if (n == 0) n = 1;
+
+    sanityCheck();
+
+    size_t repeats = std::max<size_t>(1, (size_t(1) << 27) / n);
+    std::cout << "Hardware threads: " << std::thread::hardware_concurrency() << ", "
+              << simdLevelName(detectSimdLevel()) << "\n";
+    std::cout << "Billion elements per second, " << n << " elements " << repeats << " times\n\n";
+    const char* columns[] = { "max loop", "max", "area loop", "area", "total loop", "totalArea" };
+    std::cout << std::left << std::setw(10) << "" << std::right;
+    for (const char* column : columns) std::cout << std::setw(11) << column;
+    std::cout << "\n";
+
+    benchmarkType<int8_t>("int8_t", n, repeats);
+    benchmarkType<int16_t>("int16_t", n, repeats);
+    benchmarkType<int32_t>("int32_t", n, repeats);
+    benchmarkType<int64_t>("int64_t", n, repeats);
+    benchmarkType<float>("float", n, repeats);
+    benchmarkType<double>("double", n, repeats);
+
+    return 0;
+}
+
+// Run program: Ctrl + F5 or Debug > Start Without Debugging menu
+// Debug program: F5 or Debug > Start Debugging menu
+
+// Tips for Getting Started:
+//   1. Use the Solution Explorer window to add/manage files
+//   2. Use the Team Explorer window to connect to source control
+//   3. Use the Output window to see build output and other messages
+//   4. Use the Error List window to view errors
+//   5. Go to Project > Add New Item to create new code files, or Project > Add Existing Item to add existing code files to the project
+//   6. In the future, to open this project again, go to File > Open > Project and select the .sln file
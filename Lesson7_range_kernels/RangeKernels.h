@@ -0,0 +1,462 @@
+// RangeKernels.h
+//
+// The Lesson7 function templates over whole arrays.
+//
+// max<T>(a, b) (Lesson7_tempate_functions_2) and area<T>(a, b)
+// (Lesson7_worked_example_1) take one or two values. Applied to arrays in
+// a loop - m = max(m, data[i]), total += area(l[i], w[i]) - the compiler
+// keeps one running value, so each step waits for the one before it, and
+// for float and double it may not reorder the additions, so the loop is
+// not vectorized. The overloads here take the arrays themselves:
+//
+//   max(data, n)                  the largest element, with 4 running
+//   max(range)                    maxima of a whole AVX2 register each
+//                                 (32 int8_t, ..., 4 double)
+//   area(lengths, widths, out, n) out[i] = area(lengths[i], widths[i])
+//   area(lengths, widths, out)
+//   totalArea(lengths, widths, n) the sum of the areas, with 4 running
+//   totalArea(lengths, widths)    sums of a register each
+//
+// A range is anything std::data and std::size accept: a std::vector,
+// std::array, C array, ... For every arithmetic type the choice of kernel
+// is made at compile time (if constexpr on the element type): 8, 16, 32
+// and 64-bit integers, signed or not, float and double get AVX2 kernels,
+// used when detectSimdLevel() finds AVX2 and replaced by the loop of the
+// lesson on older CPUs; every other type - long double, a class with
+// operator> / operator* - always gets that loop. The program is C++17, so
+// if constexpr and type traits take the place of C++20 concepts, and the
+// ranges are taken through std::data / std::size instead of std::span.
+//
+// The functions are constexpr: evaluated at compile time (a constexpr
+// variable, a static_assert), they run the scalar loop, since SIMD
+// intrinsics are not constexpr. This uses __builtin_is_constant_evaluated,
+// which GCC 9, Clang 9 and MSVC 19.25 provide in C++17 mode - the C++20
+// std::is_constant_evaluated() without the header.
+//
+// Results: max is exact; integer areas and sums wrap around on overflow,
+// exactly as in unsigned arithmetic, for the SIMD and the scalar paths.
+// Floating-point sums are added in a different order than the loop adds
+// them, so they can differ from it in the last bits. As in the lesson's
+// max, NaNs are not supported, and for floating point which of -0.0 and
+// +0.0 is returned by max when both are the largest is unspecified.
+
+#ifndef RANGE_KERNELS_H
+#define RANGE_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+
+#include "../common/SimdDispatch.h"
+
+namespace range_kernels_detail {
+
+constexpr bool isConstantEvaluated() noexcept {
+    return __builtin_is_constant_evaluated();
+}
+
+// The fixed-width type with T's representation, for the types with SIMD
+// kernels (char, long, ... map to the intN_t / uintN_t of their size);
+// void for every other type. It picks the kernel only: the data is always
+// read and written as T, since long and int64_t (or long long) can be
+// distinct types of the same size
+template<typename T, typename Enable = void>
+struct Canonical {
+    typedef void type;
+};
+
+template<typename T>
+struct Canonical<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type> {
+    template<size_t Size, bool Signed> struct Of;
+    template<bool Signed> struct Of<1, Signed> { typedef typename std::conditional<Signed, int8_t, uint8_t>::type type; };
+    template<bool Signed> struct Of<2, Signed> { typedef typename std::conditional<Signed, int16_t, uint16_t>::type type; };
+    template<bool Signed> struct Of<4, Signed> { typedef typename std::conditional<Signed, int32_t, uint32_t>::type type; };
+    template<bool Signed> struct Of<8, Signed> { typedef typename std::conditional<Signed, int64_t, uint64_t>::type type; };
+    typedef typename Of<sizeof(T), std::is_signed<T>::value>::type type;
+};
+
+template<>
+struct Canonical<float> {
+    typedef float type;
+};
+
+template<>
+struct Canonical<double> {
+    typedef double type;
+};
+
+template<typename T>
+struct HasKernels {
+    static constexpr bool value = !std::is_void<typename Canonical<T>::type>::value;
+};
+
+// Integers are multiplied and added as their unsigned counterparts, which
+// wrap around instead of overflowing. At least unsigned int: uint8_t and
+// uint16_t would be promoted to int, and 65535 * 65535 overflows an int
+template<typename T, typename Enable = void>
+struct Wrapping {
+    typedef T type;
+};
+
+template<typename T>
+struct Wrapping<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type> {
+    typedef typename std::common_type<typename std::make_unsigned<T>::type, unsigned>::type type;
+};
+
+template<typename T>
+constexpr T product(const T& a, const T& b) {
+    typedef typename Wrapping<T>::type W;
+    return static_cast<T>(static_cast<W>(static_cast<W>(a) * static_cast<W>(b)));
+}
+
+template<typename T>
+constexpr T sum(const T& a, const T& b) {
+    typedef typename Wrapping<T>::type W;
+    return static_cast<T>(static_cast<W>(static_cast<W>(a) + static_cast<W>(b)));
+}
+
+// The loops of the lesson
+
+template<typename T>
+constexpr T maxScalar(const T* data, size_t n) {
+    T result = data[0];
+    for (size_t i = 1; i < n; i++) result = (data[i] > result) ? data[i] : result;
+    return result;
+}
+
+template<typename T>
+constexpr void areaScalar(const T* lengths, const T* widths, T* out, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = product(lengths[i], widths[i]);
+}
+
+template<typename T>
+constexpr T totalAreaScalar(const T* lengths, const T* widths, size_t n) {
+    T total = T();
+    for (size_t i = 0; i < n; i++) total = sum(total, product(lengths[i], widths[i]));
+    return total;
+}
+
+template<typename Range>
+constexpr size_t sizeOf(const Range& range) {
+    return static_cast<size_t>(std::size(range));
+}
+
+} // namespace range_kernels_detail
+
+/**
+ * @brief The largest of data[0, n), with the kernels of level.
+ * @throws std::invalid_argument if n == 0.
+ */
+template<typename T>
+T max(const T* data, size_t n, SimdLevel level);
+
+/**
+ * @brief out[i] = lengths[i] * widths[i] for i < n, with the kernels of level.
+ */
+template<typename T>
+void area(const T* lengths, const T* widths, T* out, size_t n, SimdLevel level);
+
+/**
+ * @brief The sum of lengths[i] * widths[i] for i < n, with the kernels of level.
+ */
+template<typename T>
+T totalArea(const T* lengths, const T* widths, size_t n, SimdLevel level);
+
+/**
+ * @brief The largest of data[0, n): the AVX2 kernel where the CPU has it,
+ * the scalar loop at compile time.
+ * @throws std::invalid_argument if n == 0.
+ */
+template<typename T>
+constexpr T max(const T* data, size_t n) {
+    if (n == 0) throw std::invalid_argument("max of an empty range");
+    if (range_kernels_detail::isConstantEvaluated()) return range_kernels_detail::maxScalar(data, n);
+    return max(data, n, detectSimdLevel());
+}
+
+/**
+ * @brief The largest element of a std::vector, std::array, C array, ...
+ */
+template<typename Range, typename = decltype(std::data(std::declval<const Range&>()))>
+constexpr auto max(const Range& range) {
+    return max(std::data(range), range_kernels_detail::sizeOf(range));
+}
+
+template<typename T>
+constexpr void area(const T* lengths, const T* widths, T* out, size_t n) {
+    if (range_kernels_detail::isConstantEvaluated()) return range_kernels_detail::areaScalar(lengths, widths, out, n);
+    area(lengths, widths, out, n, detectSimdLevel());
+}
+
+/**
+ * @throws std::invalid_argument unless the three ranges have the same size.
+ */
+template<typename Range, typename OutRange, typename = decltype(std::data(std::declval<const Range&>()))>
+constexpr void area(const Range& lengths, const Range& widths, OutRange& out) {
+    size_t n = range_kernels_detail::sizeOf(lengths);
+    if (range_kernels_detail::sizeOf(widths) != n || range_kernels_detail::sizeOf(out) != n) {
+        throw std::invalid_argument("area of ranges of different sizes");
+    }
+    area(std::data(lengths), std::data(widths), std::data(out), n);
+}
+
+template<typename T>
+constexpr T totalArea(const T* lengths, const T* widths, size_t n) {
+    if (range_kernels_detail::isConstantEvaluated()) return range_kernels_detail::totalAreaScalar(lengths, widths, n);
+    return totalArea(lengths, widths, n, detectSimdLevel());
+}
+
+/**
+ * @throws std::invalid_argument unless the ranges have the same size.
+ */
+template<typename Range, typename = decltype(std::data(std::declval<const Range&>()))>
+constexpr auto totalArea(const Range& lengths, const Range& widths) {
+    size_t n = range_kernels_detail::sizeOf(lengths);
+    if (range_kernels_detail::sizeOf(widths) != n) throw std::invalid_argument("totalArea of ranges of different sizes");
+    return totalArea(std::data(lengths), std::data(widths), n);
+}
+
+#ifdef SIMD_X86
+SIMD_BEGIN_AVX2
+namespace range_kernels_avx2 {
+
+// Maxima: W lanes of T per register. The integer loads and stores take the
+// caller's own element pointer (int, long, char, ...) as void*, so that
+// only the vector access reinterprets its bytes
+template<typename T> struct MaxLanes;
+
+#define RANGE_KERNELS_INTEGER_MAX(Type, Op)                                                                  \
+    template<> struct MaxLanes<Type> {                                                                       \
+        static constexpr size_t W = 32 / sizeof(Type);                                                       \
+        static __m256i load(const void* p) { return _mm256_loadu_si256(static_cast<const __m256i*>(p)); }  \
+        static void store(void* p, __m256i v) { _mm256_storeu_si256(static_cast<__m256i*>(p), v); }        \
+        static __m256i max(__m256i a, __m256i b) { return Op(a, b); }                                        \
+    };
+
+RANGE_KERNELS_INTEGER_MAX(int8_t, _mm256_max_epi8)
+RANGE_KERNELS_INTEGER_MAX(uint8_t, _mm256_max_epu8)
+RANGE_KERNELS_INTEGER_MAX(int16_t, _mm256_max_epi16)
+RANGE_KERNELS_INTEGER_MAX(uint16_t, _mm256_max_epu16)
+RANGE_KERNELS_INTEGER_MAX(int32_t, _mm256_max_epi32)
+RANGE_KERNELS_INTEGER_MAX(uint32_t, _mm256_max_epu32)
+#undef RANGE_KERNELS_INTEGER_MAX
+
+// AVX2 has no 64-bit max: compare, then blend
+inline __m256i maxEpi64(__m256i a, __m256i b) {
+    return _mm256_blendv_epi8(b, a, _mm256_cmpgt_epi64(a, b));
+}
+
+template<> struct MaxLanes<int64_t> {
+    static constexpr size_t W = 4;
+    static __m256i load(const void* p) { return _mm256_loadu_si256(static_cast<const __m256i*>(p)); }
+    static void store(void* p, __m256i v) { _mm256_storeu_si256(static_cast<__m256i*>(p), v); }
+    static __m256i max(__m256i a, __m256i b) { return maxEpi64(a, b); }
+};
+
+// Unsigned: flipping the sign bit maps the unsigned order onto the signed one
+template<> struct MaxLanes<uint64_t> {
+    static constexpr size_t W = 4;
+    static __m256i load(const void* p) { return _mm256_loadu_si256(static_cast<const __m256i*>(p)); }
+    static void store(void* p, __m256i v) { _mm256_storeu_si256(static_cast<__m256i*>(p), v); }
+    static __m256i max(__m256i a, __m256i b) {
+        const __m256i sign = _mm256_set1_epi64x(static_cast<long long>(0x8000000000000000ull));
+        __m256i greater = _mm256_cmpgt_epi64(_mm256_xor_si256(a, sign), _mm256_xor_si256(b, sign));
+        return _mm256_blendv_epi8(b, a, greater);
+    }
+};
+
+// maxps(a, b) is a > b ? a : b, as the lesson's max
+template<> struct MaxLanes<float> {
+    static constexpr size_t W = 8;
+    static __m256 load(const float* p) { return _mm256_loadu_ps(p); }
+    static void store(float* p, __m256 v) { _mm256_storeu_ps(p, v); }
+    static __m256 max(__m256 a, __m256 b) { return _mm256_max_ps(a, b); }
+};
+
+template<> struct MaxLanes<double> {
+    static constexpr size_t W = 4;
+    static __m256d load(const double* p) { return _mm256_loadu_pd(p); }
+    static void store(double* p, __m256d v) { _mm256_storeu_pd(p, v); }
+    static __m256d max(__m256d a, __m256d b) { return _mm256_max_pd(a, b); }
+};
+
+template<typename T>
+T max(const T* data, size_t n) {
+    typedef MaxLanes<typename range_kernels_detail::Canonical<T>::type> L;
+    if (n < 4 * L::W) return range_kernels_detail::maxScalar(data, n);
+    // Four independent running maxima; the last block may overlap the
+    // previous one, which max does not mind
+    auto m0 = L::load(data), m1 = L::load(data + L::W), m2 = L::load(data + 2 * L::W), m3 = L::load(data + 3 * L::W);
+    size_t i = 4 * L::W;
+    for (; i + 4 * L::W <= n; i += 4 * L::W) {
+        m0 = L::max(m0, L::load(data + i));
+        m1 = L::max(m1, L::load(data + i + L::W));
+        m2 = L::max(m2, L::load(data + i + 2 * L::W));
+        m3 = L::max(m3, L::load(data + i + 3 * L::W));
+    }
+    if (i < n) {
+        const T* last = data + n - 4 * L::W;
+        m0 = L::max(m0, L::load(last));
+        m1 = L::max(m1, L::load(last + L::W));
+        m2 = L::max(m2, L::load(last + 2 * L::W));
+        m3 = L::max(m3, L::load(last + 3 * L::W));
+    }
+    T lanes[L::W];
+    L::store(lanes, L::max(L::max(m0, m1), L::max(m2, m3)));
+    return range_kernels_detail::maxScalar(lanes, L::W);
+}
+
+// Products and sums: W elements per register. 8-bit values are widened to
+// 16-bit lanes (AVX2 has no 8-bit multiply); the low 8 bits of a 16-bit
+// product or sum are those of the 8-bit one. Lane is the type of a lane.
+template<typename T> struct ProductLanes;
+
+struct BytesToWords {
+    static constexpr size_t W = 16;
+    typedef uint16_t Lane;
+    static __m256i load(const void* p) {
+        return _mm256_cvtepu8_epi16(_mm_loadu_si128(static_cast<const __m128i*>(p)));
+    }
+    static void store(void* p, __m256i v) {
+        __m256i low = _mm256_and_si256(v, _mm256_set1_epi16(0xFF));
+        __m128i packed = _mm_packus_epi16(_mm256_castsi256_si128(low), _mm256_extracti128_si256(low, 1));
+        _mm_storeu_si128(static_cast<__m128i*>(p), packed);
+    }
+    static __m256i zero() { return _mm256_setzero_si256(); }
+    static __m256i mul(__m256i a, __m256i b) { return _mm256_mullo_epi16(a, b); }
+    static __m256i add(__m256i a, __m256i b) { return _mm256_add_epi16(a, b); }
+};
+
+template<> struct ProductLanes<int8_t> : BytesToWords {};
+template<> struct ProductLanes<uint8_t> : BytesToWords {};
+
+#define RANGE_KERNELS_INTEGER_PRODUCT(Type, LaneType, Mul, Add)                                                \
+    template<> struct ProductLanes<Type> {                                                                     \
+        static constexpr size_t W = 32 / sizeof(Type);                                                         \
+        typedef LaneType Lane;                                                                                 \
+        static __m256i load(const void* p) { return _mm256_loadu_si256(static_cast<const __m256i*>(p)); }    \
+        static void store(void* p, __m256i v) { _mm256_storeu_si256(static_cast<__m256i*>(p), v); }          \
+        static __m256i zero() { return _mm256_setzero_si256(); }                                               \
+        static __m256i mul(__m256i a, __m256i b) { return Mul(a, b); }                                         \
+        static __m256i add(__m256i a, __m256i b) { return Add(a, b); }                                         \
+    };
+
+// AVX2 has no 64-bit multiply: the low 64 bits of a * b are
+// lo(a) lo(b) + (hi(a) lo(b) + lo(a) hi(b)) << 32
+inline __m256i mulloEpi64(__m256i a, __m256i b) {
+    __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), b),
+                                     _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)));
+    return _mm256_add_epi64(_mm256_mul_epu32(a, b), _mm256_slli_epi64(cross, 32));
+}
+
+RANGE_KERNELS_INTEGER_PRODUCT(int16_t, uint16_t, _mm256_mullo_epi16, _mm256_add_epi16)
+RANGE_KERNELS_INTEGER_PRODUCT(uint16_t, uint16_t, _mm256_mullo_epi16, _mm256_add_epi16)
+RANGE_KERNELS_INTEGER_PRODUCT(int32_t, uint32_t, _mm256_mullo_epi32, _mm256_add_epi32)
+RANGE_KERNELS_INTEGER_PRODUCT(uint32_t, uint32_t, _mm256_mullo_epi32, _mm256_add_epi32)
+RANGE_KERNELS_INTEGER_PRODUCT(int64_t, uint64_t, mulloEpi64, _mm256_add_epi64)
+RANGE_KERNELS_INTEGER_PRODUCT(uint64_t, uint64_t, mulloEpi64, _mm256_add_epi64)
+#undef RANGE_KERNELS_INTEGER_PRODUCT
+
+template<> struct ProductLanes<float> {
+    static constexpr size_t W = 8;
+    typedef float Lane;
+    static __m256 load(const float* p) { return _mm256_loadu_ps(p); }
+    static void store(float* p, __m256 v) { _mm256_storeu_ps(p, v); }
+    static __m256 zero() { return _mm256_setzero_ps(); }
+    static __m256 mul(__m256 a, __m256 b) { return _mm256_mul_ps(a, b); }
+    static __m256 add(__m256 a, __m256 b) { return _mm256_add_ps(a, b); }
+};
+
+template<> struct ProductLanes<double> {
+    static constexpr size_t W = 4;
+    typedef double Lane;
+    static __m256d load(const double* p) { return _mm256_loadu_pd(p); }
+    static void store(double* p, __m256d v) { _mm256_storeu_pd(p, v); }
+    static __m256d zero() { return _mm256_setzero_pd(); }
+    static __m256d mul(__m256d a, __m256d b) { return _mm256_mul_pd(a, b); }
+    static __m256d add(__m256d a, __m256d b) { return _mm256_add_pd(a, b); }
+};
+
+template<typename T>
+void area(const T* lengths, const T* widths, T* out, size_t n) {
+    typedef ProductLanes<typename range_kernels_detail::Canonical<T>::type> L;
+    size_t i = 0;
+    for (; i + 2 * L::W <= n; i += 2 * L::W) {
+        L::store(out + i, L::mul(L::load(lengths + i), L::load(widths + i)));
+        L::store(out + i + L::W, L::mul(L::load(lengths + i + L::W), L::load(widths + i + L::W)));
+    }
+    range_kernels_detail::areaScalar(lengths + i, widths + i, out + i, n - i);
+}
+
+template<typename T>
+T totalArea(const T* lengths, const T* widths, size_t n) {
+    typedef ProductLanes<typename range_kernels_detail::Canonical<T>::type> L;
+    typedef typename L::Lane Lane;
+    auto s0 = L::zero(), s1 = L::zero(), s2 = L::zero(), s3 = L::zero();
+    size_t i = 0;
+    for (; i + 4 * L::W <= n; i += 4 * L::W) {
+        s0 = L::add(s0, L::mul(L::load(lengths + i), L::load(widths + i)));
+        s1 = L::add(s1, L::mul(L::load(lengths + i + L::W), L::load(widths + i + L::W)));
+        s2 = L::add(s2, L::mul(L::load(lengths + i + 2 * L::W), L::load(widths + i + 2 * L::W)));
+        s3 = L::add(s3, L::mul(L::load(lengths + i + 3 * L::W), L::load(widths + i + 3 * L::W)));
+    }
+    alignas(32) Lane lanes[L::W];
+    // Lane-wise sums of the four registers, then of the lanes
+    auto total = L::add(L::add(s0, s1), L::add(s2, s3));
+    if constexpr (std::is_same<Lane, float>::value) {
+        _mm256_store_ps(lanes, total);
+    } else if constexpr (std::is_same<Lane, double>::value) {
+        _mm256_store_pd(lanes, total);
+    } else {
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), total);
+    }
+    Lane sum = Lane();
+    for (size_t lane = 0; lane < L::W; lane++) sum = range_kernels_detail::sum(sum, lanes[lane]);
+    T result = static_cast<T>(sum);
+    return range_kernels_detail::sum(result, range_kernels_detail::totalAreaScalar(lengths + i, widths + i, n - i));
+}
+
+} // namespace range_kernels_avx2
+SIMD_END_TARGET
+#endif
+
+template<typename T>
+T max(const T* data, size_t n, SimdLevel level) {
+    if (n == 0) throw std::invalid_argument("max of an empty range");
+#ifdef SIMD_X86
+    if constexpr (range_kernels_detail::HasKernels<T>::value) {
+        if (level == SimdLevel::AVX2) return range_kernels_avx2::max(data, n);
+    }
+#endif
+    static_cast<void>(level);
+    return range_kernels_detail::maxScalar(data, n);
+}
+
+template<typename T>
+void area(const T* lengths, const T* widths, T* out, size_t n, SimdLevel level) {
+#ifdef SIMD_X86
+    if constexpr (range_kernels_detail::HasKernels<T>::value) {
+        if (level == SimdLevel::AVX2) {
+            range_kernels_avx2::area(lengths, widths, out, n);
+            return;
+        }
+    }
+#endif
+    static_cast<void>(level);
+    range_kernels_detail::areaScalar(lengths, widths, out, n);
+}
+
+template<typename T>
+T totalArea(const T* lengths, const T* widths, size_t n, SimdLevel level) {
+#ifdef SIMD_X86
+    if constexpr (range_kernels_detail::HasKernels<T>::value) {
+        if (level == SimdLevel::AVX2) return range_kernels_avx2::totalArea(lengths, widths, n);
+    }
+#endif
+    static_cast<void>(level);
+    return range_kernels_detail::totalAreaScalar(lengths, widths, n);
+}
+
+#endif // RANGE_KERNELS_H
@@ -0,0 +1,246 @@
+// Lesson9_search_kernels.cpp : This file contains the 'main' function. Program execution begins and ends there.
+//
+// Nanoseconds per lookup for the searches of "Lesson9 algorithms.md"
+// against the kernels in SearchKernels.h, on sorted arrays from 4 KB (in
+// the L1 cache) up to far beyond the last level cache. Half of the keys
+// are in the array. A second table compares linearSearch() with
+// linearSearchSimd() on small arrays, where a scan can beat a binary
+// search.
+//
+// Usage: Lesson9_search_kernels [largest array in elements] [lookups]
+//   Defaults: 67108864 elements (256 MB), 2000000 lookups per measurement.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SearchKernels.h"
+
+typedef std::chrono::steady_clock Clock;
+
+// The searches from "Lesson9 algorithms.md"
+
+int linearSearch(int arr[], int n, int target) {
+    for (int i = 0; i < n; i++) {
+        if (arr[i] == target)
+            return i; // Found at position i
+    }
+    return -1; // Not found
+}
+
+int binarySearchRecursive(int arr[], int left, int right, int target) {
+    if (right >= left) {
+        int mid = left + (right - left) / 2;
+        if (arr[mid] == target)
+            return mid;
+        if (arr[mid] > target)
+            return binarySearchRecursive(arr, left, mid - 1, target);
+        return binarySearchRecursive(arr, mid + 1, right, target);
+    }
+    return -1;
+}
+
+int binarySearchIterative(int arr[], int n, int target) {
+    int left = 0;
+    int right = n - 1;
+    while (left <= right) {
+        int mid = left + (right - left) / 2;
+        if (arr[mid] == target)
+            return mid;
+        if (arr[mid] < target)
+            left = mid + 1;
+        else
+            right = mid - 1;
+    }
+    return -1; // Not found
+}
+
+// n sorted values 2, 4, 6, ... with some runs of equal values; the odd
+// numbers are never present
+std::vector<int> sortedArray(int n, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::vector<int> arr(n);
+    int value = 0;
+    for (int& v : arr) {
+        if (rng() % 8 != 0) value += 2;
+        v = value;
+    }
+    return arr;
+}
+
+// Half present, half absent, in random order
+std::vector<int> lookupKeys(const std::vector<int>& arr, size_t count, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::vector<int> keys(count);
+    int top = arr.empty() ? 0 : arr.back();
+    for (size_t i = 0; i < count; i++) {
+        keys[i] = i % 2 == 0 && !arr.empty() ? arr[rng() % arr.size()] : static_cast<int>(rng() % (top + 3)) - 1;
+    }
+    return keys;
+}
+
+void sanityCheck() {
+    SimdLevel levels[] = { SimdLevel::Scalar, detectSimdLevel() };
+    for (int n : { 0, 1, 2, 3, 7, 8, 15, 16, 17, 31, 32, 33, 100, 1000, 4097, 100000 }) {
+        std::vector<int> arr = sortedArray(n, static_cast<unsigned>(n));
+        std::vector<int> keys = lookupKeys(arr, 3000, 7);
+        keys.push_back(-100);
+        keys.push_back(arr.empty() ? 100 : arr.back() + 100);
+        EytzingerIndex index(arr.data(), n);
+        EytzingerIndex copy = index;
+        std::vector<int> lower(keys.size()), found(keys.size());
+        index.lowerBoundMany(keys.data(), lower.data(), keys.size());
+        index.searchMany(keys.data(), found.data(), keys.size());
+        for (size_t i = 0; i < keys.size(); i++) {
+            int key = keys[i];
+            int expectedLower = static_cast<int>(std::lower_bound(arr.begin(), arr.end(), key) - arr.begin());
+            int expectedFound = expectedLower < n && arr[expectedLower] == key ? expectedLower : -1;
+            if (branchlessLowerBound(arr.data(), n, key) != expectedLower ||
+                branchlessBinarySearch(arr.data(), n, key) != expectedFound ||
+                index.lowerBound(key) != expectedLower || copy.find(key) != expectedFound ||
+                lower[i] != expectedLower || found[i] != expectedFound) {
+                throw std::logic_error("search of " + std::to_string(key) + " in " + std::to_string(n) + " values wrong");
+            }
+            // The lesson's searches may find any of several equal values
+            int iterative = binarySearchIterative(arr.data(), n, key);
+            int recursive = binarySearchRecursive(arr.data(), 0, n - 1, key);
+            if ((iterative < 0) != (expectedFound < 0) || (iterative >= 0 && arr[iterative] != key) ||
+                (recursive < 0) != (expectedFound < 0) || (recursive >= 0 && arr[recursive] != key)) {
+                throw std::logic_error("lesson binary search wrong");
+            }
+        }
+        for (SimdLevel level : levels) {
+            std::vector<int> many(keys.size()), manyFound(keys.size());
+            lowerBoundMany(arr.data(), n, keys.data(), many.data(), keys.size(), level);
+            searchMany(arr.data(), n, keys.data(), manyFound.data(), keys.size(), level);
+            for (size_t i = 0; i < keys.size(); i++) {
+                if (many[i] != lower[i] || manyFound[i] != found[i]) {
+                    throw std::logic_error(std::string("lowerBoundMany wrong at ") + simdLevelName(level));
+                }
+            }
+            // Linear search on unsorted data: the first match
+            if (n <= 4097) {
+                std::vector<int> shuffled = arr;
+                std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(3));
+                for (size_t i = 0; i < keys.size(); i += 7) {
+                    if (linearSearchSimd(shuffled.data(), n, keys[i], level) != linearSearch(shuffled.data(), n, keys[i])) {
+                        throw std::logic_error(std::string("linearSearchSimd wrong at ") + simdLevelName(level));
+                    }
+                }
+            }
+        }
+    }
+
+    bool threw = false;
+    try {
+        int unsorted[] = { 1, 3, 2 };
+        EytzingerIndex index(unsorted, 3);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    if (!threw) throw std::logic_error("unsorted input accepted");
+
+    std::cout << "Sanity check passed\n\n";
+}
+
+// Best of 3 runs, ns per lookup; the checksum keeps the results alive
+double nsPerLookup(size_t lookups, const std::function<long long()>& run, long long& checksum) {
+    double best = 1e300;
+    for (int repeat = 0; repeat < 3; repeat++) {
+        auto start = Clock::now();
+        checksum += run();
+        best = std::min(best, std::chrono::duration<double, std::nano>(Clock::now() - start).count() / lookups);
+    }
+    return best;
+}
+
+std::string sizeName(size_t bytes) {
+    if (bytes >= (size_t(1) << 20)) return std::to_string(bytes >> 20) + " MB";
+    return std::to_string(bytes >> 10) + " KB";
+}
+
+int main(int argc, char* argv[]) {
+    int largest = argc > 1 ? std::atoi(argv[1]) : 1 << 26;
+    size_t lookups = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2000000;
+
+    sanityCheck();
+
+    std::cout << "Hardware threads: " << std::thread::hardware_concurrency() << ", "
+              << simdLevelName(detectSimdLevel()) << "\n";
+    std::cout << "ns per lookup, " << lookups << " lookups of which half are present\n\n";
+
+    const char* columns[] = { "iterative", "recursive", "branchless", "Eytzinger", "many", "many AVX2",
+                              "Eytz. many" };
+    std::cout << std::left << std::setw(10) << "array" << std::right;
+    for (const char* column : columns) std::cout << std::setw(12) << column;
+    std::cout << "\n";
+
+    long long checksum = 0;
+    std::vector<int> results(lookups);
+    for (long long size = 1 << 10; size <= largest; size *= 4) {
+        int n = static_cast<int>(size);
+        std::vector<int> arr = sortedArray(n, 1);
+        std::vector<int> keys = lookupKeys(arr, lookups, 2);
+        EytzingerIndex index(arr.data(), n);
+        int* a = arr.data();
+        const int* k = keys.data();
+
+        std::function<long long()> runs[] = {
+            [&]() { long long s = 0; for (size_t i = 0; i < lookups; i++) s += binarySearchIterative(a, n, k[i]); return s; },
+            [&]() { long long s = 0; for (size_t i = 0; i < lookups; i++) s += binarySearchRecursive(a, 0, n - 1, k[i]); return s; },
+            [&]() { long long s = 0; for (size_t i = 0; i < lookups; i++) s += branchlessBinarySearch(a, n, k[i]); return s; },
+            [&]() { long long s = 0; for (size_t i = 0; i < lookups; i++) s += index.find(k[i]); return s; },
+            [&]() { searchMany(a, n, k, results.data(), lookups, SimdLevel::Scalar); return static_cast<long long>(results[lookups / 2]); },
+            [&]() { searchMany(a, n, k, results.data(), lookups, detectSimdLevel()); return static_cast<long long>(results[lookups / 2]); },
+            [&]() { index.searchMany(k, results.data(), lookups); return static_cast<long long>(results[lookups / 2]); },
+        };
+        std::cout << std::left << std::setw(10) << sizeName(n * sizeof(int)) << std::right << std::fixed
+                  << std::setprecision(1);
+        for (auto& run : runs) std::cout << std::setw(12) << nsPerLookup(lookups, run, checksum) << std::flush;
+        std::cout << "\n";
+    }
+
+    std::cout << "\nSmall arrays (the linear searches scan an unsorted copy)\n";
+    std::cout << std::left << std::setw(10) << "elements" << std::right << std::setw(12) << "linear" << std::setw(12)
+              << "linear SIMD" << std::setw(12) << "branchless" << "\n";
+    for (int n = 8; n <= 1024; n *= 2) {
+        std::vector<int> arr = sortedArray(n, 1);
+        std::vector<int> keys = lookupKeys(arr, lookups, 2);
+        std::vector<int> shuffled = arr;
+        std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(3));
+        int* a = arr.data();
+        int* u = shuffled.data();
+        const int* k = keys.data();
+        std::function<long long()> runs[] = {
+            [&]() { long long s = 0; for (size_t i = 0; i < lookups; i++) s += linearSearch(u, n, k[i]); return s; },
+            [&]() { long long s = 0; for (size_t i = 0; i < lookups; i++) s += linearSearchSimd(u, n, k[i]); return s; },
+            [&]() { long long s = 0; for (size_t i = 0; i < lookups; i++) s += branchlessBinarySearch(a, n, k[i]); return s; },
+        };
+        std::cout << std::left << std::setw(10) << n << std::right;
+        for (auto& run : runs) std::cout << std::setw(12) << nsPerLookup(lookups, run, checksum);
+        std::cout << "\n";
+    }
+    std::cout << "\n(checksum " << checksum << ")\n";
+
+    return 0;
+}
+
+// Run program: Ctrl + F5 or Debug > Start Without Debugging menu
+// Debug program: F5 or Debug > Start Debugging menu
+
+// Tips for Getting Started:
+//   1. Use the Solution Explorer window to add/manage files
+//   2. Use the Team Explorer window to connect to source control
+//   3. Use the Output window to see build output and other messages
+//   4. Use the Error List window to view errors
+//   5. Go to Project > Add New Item to create new code files, or Project > Add Existing Item to add existing code files to the project
+//   6. In the future, to open this project again, go to File > Open > Project and select the .sln file
@@ -0,0 +1,381 @@
+// SearchKernels.h
+//
+// Faster versions of the searches in "Lesson9 algorithms.md", for sorted
+// int arrays that are searched very many times.
+//
+// binarySearchIterative() does about log2(n) steps and every step waits
+// for the load of arr[mid], and then for the branch on it. The branch
+// goes either way with equal probability, so the CPU guesses it wrong
+// half the time and throws away the work it started on the guess. Once the
+// array no longer fits in the caches each load is a trip to memory, and
+// nothing else happens while it is on its way. This header attacks both:
+//
+//   branchlessLowerBound()    halves the range with a conditional move
+//                             instead of a branch: nothing to guess wrong,
+//                             and the loop runs the same number of times
+//                             for every target
+//   EytzingerIndex            the same values stored in breadth-first
+//                             (Eytzinger) order: the root first, then its
+//                             two children, then the four grandchildren...
+//                             The top levels of every search share a few
+//                             cache lines, and the 16 possible nodes four
+//                             levels further down are one cache line, so
+//                             it can be prefetched four steps ahead
+//   lowerBoundMany()          many searches at once. The searches do not
+//   EytzingerIndex::          depend on each other, so their loads can be
+//     searchMany()            in flight together: instead of one memory
+//                             trip per step, one trip per step for a whole
+//                             group of keys. With AVX2 the sorted-array
+//                             version advances 8 keys per instruction
+//                             using gathers
+//   linearSearchSimd()        linearSearch() comparing 32 elements per step
+//                             with AVX2; on small arrays this beats any
+//                             binary search
+//
+// The lower bound of target is the index of the first element that is not
+// less than target (n if there is none); the searches return the index of
+// the first element equal to target, or -1 as in the lesson. Only the
+// batched and linear searches have AVX2 versions, taken when the SimdLevel
+// argument (by default detectSimdLevel()) is AVX2; below that they run the
+// scalar loops, which return the same indices.
+
+#ifndef SEARCH_KERNELS_H
+#define SEARCH_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "../common/SimdDispatch.h"
+
+namespace search_detail {
+
+inline unsigned trailingZeros(uint64_t v) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, v);
+    return index;
+#else
+    return static_cast<unsigned>(__builtin_ctzll(v));
+#endif
+}
+
+inline void prefetch(const void* address) {
+#if defined(SIMD_X86)
+    _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#elif defined(__GNUC__)
+    __builtin_prefetch(address);
+#endif
+}
+
+// Keys searched together by the scalar batched searches
+const size_t kGroup = 16;
+
+} // namespace search_detail
+
+/**
+ * @brief Index of the first element of the sorted arr that is not less
+ * than target, or n; without branches on the data.
+ */
+inline int branchlessLowerBound(const int* arr, int n, int target) {
+    if (n <= 0) return 0;
+    const int* base = arr;
+    int length = n;
+    while (length > 1) {
+        int half = length / 2;
+        base = base[half] < target ? base + half : base;
+        length -= half;
+    }
+    return static_cast<int>(base - arr) + (*base < target);
+}
+
+/**
+ * @brief Index of the first element equal to target in the sorted arr, or
+ * -1.
+ */
+inline int branchlessBinarySearch(const int* arr, int n, int target) {
+    int i = branchlessLowerBound(arr, n, target);
+    return i < n && arr[i] == target ? i : -1;
+}
+
+/**
+ * @brief results[i] = branchlessLowerBound(arr, n, keys[i]) for i < count,
+ * searching a group of keys together.
+ */
+inline void lowerBoundMany(const int* arr, int n, const int* keys, int* results, size_t count,
+                           SimdLevel level = detectSimdLevel());
+
+/**
+ * @brief results[i] = branchlessBinarySearch(arr, n, keys[i]) for
+ * i < count, searching a group of keys together.
+ */
+inline void searchMany(const int* arr, int n, const int* keys, int* results, size_t count,
+                       SimdLevel level = detectSimdLevel()) {
+    lowerBoundMany(arr, n, keys, results, count, level);
+    for (size_t i = 0; i < count; i++) {
+        results[i] = results[i] < n && arr[results[i]] == keys[i] ? results[i] : -1;
+    }
+}
+
+/**
+ * @brief Index of the first element equal to target, or -1; arr need not
+ * be sorted.
+ */
+inline int linearSearchSimd(const int* arr, int n, int target, SimdLevel level = detectSimdLevel());
+
+/**
+ * @brief A sorted array in Eytzinger (breadth-first) order for fast
+ * searches; results are indices into the original sorted array.
+ */
+class EytzingerIndex {
+private:
+    // Node k (1-based) is tree()[k]; its children are 2k and 2k + 1. The
+    // storage is padded so that nodes 16j ... 16j + 15 share a cache line.
+    std::vector<int> storage;
+    size_t offset = 0;
+    std::vector<int> position;      // node -> index in the sorted array
+    int n = 0;
+
+    const int* tree() const { return storage.data() + offset; }
+
+    void build(const int* sorted, int& next, size_t k) {
+        if (k > static_cast<size_t>(n)) return;
+        build(sorted, next, 2 * k);
+        storage[offset + k] = sorted[next];
+        position[k] = next++;
+        build(sorted, next, 2 * k + 1);
+    }
+
+    // Node of the lower bound after the descent ended at node k (> n): the
+    // last node where the search went left. 0 if it never did.
+    static size_t lastLeft(size_t k) {
+        return k >> (search_detail::trailingZeros(~static_cast<uint64_t>(k)) + 1);
+    }
+
+    int resultOf(size_t k) const {
+        return k == 0 ? n : position[k];
+    }
+
+public:
+    /**
+     * @param sorted n values in ascending order.
+     * @throws std::invalid_argument if sorted is not in ascending order.
+     */
+    EytzingerIndex(const int* sorted, int n) : n(n < 0 ? 0 : n) {
+        for (int i = 1; i < this->n; i++) {
+            if (sorted[i] < sorted[i - 1]) throw std::invalid_argument("EytzingerIndex: values not sorted");
+        }
+        storage.resize(this->n + 1 + 16);
+        offset = (64 - reinterpret_cast<uintptr_t>(storage.data()) % 64) % 64 / sizeof(int);
+        position.resize(this->n + 1);
+        int next = 0;
+        build(sorted, next, 1);
+    }
+
+    EytzingerIndex(const EytzingerIndex& other) : n(0) { *this = other; }
+    EytzingerIndex(EytzingerIndex&&) = default;
+    EytzingerIndex& operator=(EytzingerIndex&&) = default;
+
+    EytzingerIndex& operator=(const EytzingerIndex& other) {
+        if (this != &other) {
+            // The copy's storage has its own alignment
+            n = other.n;
+            position = other.position;
+            storage.assign(n + 1 + 16, 0);
+            offset = (64 - reinterpret_cast<uintptr_t>(storage.data()) % 64) % 64 / sizeof(int);
+            for (int k = 1; k <= n; k++) storage[offset + k] = other.tree()[k];
+        }
+        return *this;
+    }
+
+    int size() const { return n; }
+
+    /**
+     * @brief Index in the sorted array of the first element not less than
+     * target, or size().
+     */
+    int lowerBound(int target) const {
+        return resultOf(lowerBoundNode(target));
+    }
+
+    /**
+     * @brief Index in the sorted array of the first element equal to
+     * target, or -1.
+     */
+    int find(int target) const {
+        size_t k = lowerBoundNode(target);
+        return k != 0 && tree()[k] == target ? position[k] : -1;
+    }
+
+    /**
+     * @brief results[i] = lowerBound(keys[i]) for i < count, searching a
+     * group of keys together.
+     */
+    void lowerBoundMany(const int* keys, int* results, size_t count) const {
+        lowerBoundNodes(keys, count, [&](size_t i, size_t k) { results[i] = resultOf(k); });
+    }
+
+    /**
+     * @brief results[i] = find(keys[i]) for i < count, searching a group of
+     * keys together.
+     */
+    void searchMany(const int* keys, int* results, size_t count) const {
+        const int* t = tree();
+        lowerBoundNodes(keys, count, [&](size_t i, size_t k) {
+            results[i] = k != 0 && t[k] == keys[i] ? position[k] : -1;
+        });
+    }
+
+private:
+    size_t lowerBoundNode(int target) const {
+        const int* t = tree();
+        size_t k = 1;
+        while (k <= static_cast<size_t>(n)) {
+            // The node four levels down: its 16 candidates are one line
+            search_detail::prefetch(reinterpret_cast<const void*>(reinterpret_cast<uintptr_t>(t) + 16 * k * sizeof(int)));
+            k = 2 * k + (t[k] < target);
+        }
+        return lastLeft(k);
+    }
+
+    // finish(i, node of the lower bound of keys[i]) for i < count
+    template<typename Finish>
+    void lowerBoundNodes(const int* keys, size_t count, Finish finish) const {
+        const int* t = tree();
+        // Every search takes `levels` or `levels - 1` steps; a search that
+        // has left the tree stays where it is
+        unsigned levels = 0;
+        while ((size_t(1) << levels) <= static_cast<size_t>(n)) levels++;
+        for (size_t first = 0; first < count; first += search_detail::kGroup) {
+            size_t group = count - first < search_detail::kGroup ? count - first : search_detail::kGroup;
+            size_t k[search_detail::kGroup];
+            for (size_t j = 0; j < group; j++) k[j] = 1;
+            for (unsigned level = 0; level < levels; level++) {
+                for (size_t j = 0; j < group; j++) {
+                    bool inside = k[j] <= static_cast<size_t>(n);
+                    int value = t[inside ? k[j] : 0];
+                    k[j] = inside ? 2 * k[j] + (value < keys[first + j]) : k[j];
+                    search_detail::prefetch(reinterpret_cast<const void*>(reinterpret_cast<uintptr_t>(t) + 16 * k[j] * sizeof(int)));
+                }
+            }
+            for (size_t j = 0; j < group; j++) finish(first + j, lastLeft(k[j]));
+        }
+    }
+};
+
+namespace search_detail {
+
+inline void lowerBoundManyScalar(const int* arr, int n, const int* keys, int* results, size_t count) {
+    if (n <= 0) {
+        for (size_t i = 0; i < count; i++) results[i] = 0;
+        return;
+    }
+    for (size_t first = 0; first < count; first += kGroup) {
+        size_t group = count - first < kGroup ? count - first : kGroup;
+        const int* base[kGroup];
+        for (size_t j = 0; j < group; j++) base[j] = arr;
+        // All searches of the group halve the same lengths
+        for (int length = n; length > 1; ) {
+            int half = length / 2;
+            for (size_t j = 0; j < group; j++) base[j] = base[j][half] < keys[first + j] ? base[j] + half : base[j];
+            length -= half;
+        }
+        for (size_t j = 0; j < group; j++) {
+            results[first + j] = static_cast<int>(base[j] - arr) + (*base[j] < keys[first + j]);
+        }
+    }
+}
+
+inline int linearSearchScalar(const int* arr, int n, int target) {
+    for (int i = 0; i < n; i++) {
+        if (arr[i] == target) return i;
+    }
+    return -1;
+}
+
+} // namespace search_detail
+
+#ifdef SIMD_X86
+SIMD_BEGIN_AVX2
+namespace search_avx2 {
+
+// Two groups of 8 searches stepped together: 16 gathers in flight
+inline void lowerBoundMany(const int* arr, int n, const int* keys, int* results, size_t count) {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i keyA = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+        __m256i keyB = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i + 8));
+        __m256i baseA = _mm256_setzero_si256(), baseB = _mm256_setzero_si256();
+        for (int length = n; length > 1; ) {
+            int half = length / 2;
+            __m256i halfV = _mm256_set1_epi32(half);
+            __m256i probeA = _mm256_i32gather_epi32(arr, _mm256_add_epi32(baseA, halfV), 4);
+            __m256i probeB = _mm256_i32gather_epi32(arr, _mm256_add_epi32(baseB, halfV), 4);
+            // probe < key: add half
+            baseA = _mm256_add_epi32(baseA, _mm256_and_si256(_mm256_cmpgt_epi32(keyA, probeA), halfV));
+            baseB = _mm256_add_epi32(baseB, _mm256_and_si256(_mm256_cmpgt_epi32(keyB, probeB), halfV));
+            length -= half;
+        }
+        __m256i lastA = _mm256_i32gather_epi32(arr, baseA, 4);
+        __m256i lastB = _mm256_i32gather_epi32(arr, baseB, 4);
+        // + (last < key), as subtracting the all-ones compare mask
+        baseA = _mm256_sub_epi32(baseA, _mm256_cmpgt_epi32(keyA, lastA));
+        baseB = _mm256_sub_epi32(baseB, _mm256_cmpgt_epi32(keyB, lastB));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(results + i), baseA);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(results + i + 8), baseB);
+    }
+    search_detail::lowerBoundManyScalar(arr, n, keys + i, results + i, count - i);
+}
+
+inline int linearSearch(const int* arr, int n, int target) {
+    __m256i t = _mm256_set1_epi32(target);
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i a = _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(arr + i)), t);
+        __m256i b = _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(arr + i + 8)), t);
+        __m256i c = _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(arr + i + 16)), t);
+        __m256i d = _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(arr + i + 24)), t);
+        __m256i any = _mm256_or_si256(_mm256_or_si256(a, b), _mm256_or_si256(c, d));
+        if (!_mm256_testz_si256(any, any)) {
+            // One bit per element, in order
+            uint64_t mask = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(a))) |
+                            static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(b))) << 8 |
+                            static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(c))) << 16 |
+                            static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(d))) << 24;
+            return i + static_cast<int>(search_detail::trailingZeros(mask));
+        }
+    }
+    for (; i + 8 <= n; i += 8) {
+        __m256i a = _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(arr + i)), t);
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(a));
+        if (mask != 0) return i + static_cast<int>(search_detail::trailingZeros(static_cast<uint64_t>(mask)));
+    }
+    int rest = search_detail::linearSearchScalar(arr + i, n - i, target);
+    return rest < 0 ? -1 : i + rest;
+}
+
+} // namespace search_avx2
+SIMD_END_TARGET
+#endif
+
+inline void lowerBoundMany(const int* arr, int n, const int* keys, int* results, size_t count, SimdLevel level) {
+#ifdef SIMD_X86
+    if (level == SimdLevel::AVX2 && n > 0) {
+        search_avx2::lowerBoundMany(arr, n, keys, results, count);
+        return;
+    }
+#endif
+    static_cast<void>(level);
+    search_detail::lowerBoundManyScalar(arr, n, keys, results, count);
+}
+
+inline int linearSearchSimd(const int* arr, int n, int target, SimdLevel level) {
+#ifdef SIMD_X86
+    if (level == SimdLevel::AVX2) return search_avx2::linearSearch(arr, n, target);
+#endif
+    static_cast<void>(level);
+    return search_detail::linearSearchScalar(arr, n, target);
+}
+
+#endif // SEARCH_KERNELS_H
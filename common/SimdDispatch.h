@@ -0,0 +1,86 @@
+// SimdDispatch.h
+//
+// Run-time choice of instruction set for the SIMD kernels.
+//
+// A program built for plain x86-64 may only assume SSE2, yet most CPUs it
+// runs on have SSE4.1 or AVX2. Rather than build for the newest CPU and
+// crash on older ones, each kernel is compiled for its instruction set
+// between SIMD_BEGIN_AVX2 / SIMD_BEGIN_SSE41 and SIMD_END_TARGET, and the
+// caller picks one at run time:
+//
+//   detectSimdLevel()     the best level this CPU and OS support, probed once
+//   simdLevelName(level)  "AVX2", "SSE4.1" or "scalar", for reports
+//
+// SIMD_X86 is defined on x86 and x64, where <immintrin.h> is included; on
+// other CPUs every level but Scalar is unavailable.
+
+#ifndef SIMD_DISPATCH_H
+#define SIMD_DISPATCH_H
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// Compile the code between BEGIN and END for a given instruction set even
+// when the rest of the program is not. MSVC needs nothing: it accepts every
+// intrinsic and it is up to us to only call them on a capable CPU.
+#if defined(__clang__)
+#define SIMD_BEGIN_AVX2 _Pragma("clang attribute push(__attribute__((target(\"avx2\"))), apply_to = function)")
+#define SIMD_BEGIN_SSE41 _Pragma("clang attribute push(__attribute__((target(\"sse4.1\"))), apply_to = function)")
+#define SIMD_END_TARGET _Pragma("clang attribute pop")
+#elif defined(__GNUC__)
+#define SIMD_BEGIN_AVX2 _Pragma("GCC push_options") _Pragma("GCC target(\"avx2\")")
+#define SIMD_BEGIN_SSE41 _Pragma("GCC push_options") _Pragma("GCC target(\"sse4.1\")")
+#define SIMD_END_TARGET _Pragma("GCC pop_options")
+#else
+#define SIMD_BEGIN_AVX2
+#define SIMD_BEGIN_SSE41
+#define SIMD_END_TARGET
+#endif
+
+enum class SimdLevel { Scalar, SSE41, AVX2 };
+
+inline const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::AVX2: return "AVX2";
+    case SimdLevel::SSE41: return "SSE4.1";
+    default: return "scalar";
+    }
+}
+
+/**
+ * @brief The best instruction set this CPU (and OS) supports, probed once.
+ */
+inline SimdLevel detectSimdLevel() {
+    static const SimdLevel level = []() {
+#ifdef SIMD_X86
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        int maxLeaf = info[0];
+        __cpuid(info, 1);
+        bool sse41 = (info[2] >> 19) & 1;
+        bool osSavesAvx = ((info[2] >> 27) & 1) && ((info[2] >> 28) & 1) && (_xgetbv(0) & 6) == 6;
+        bool avx2 = false;
+        if (maxLeaf >= 7 && osSavesAvx) {
+            __cpuidex(info, 7, 0);
+            avx2 = (info[1] >> 5) & 1;
+        }
+#else
+        __builtin_cpu_init();
+        bool sse41 = __builtin_cpu_supports("sse4.1");
+        bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+        return avx2 ? SimdLevel::AVX2 : sse41 ? SimdLevel::SSE41 : SimdLevel::Scalar;
+#else
+        return SimdLevel::Scalar;
+#endif
+    }();
+    return level;
+}
+
+#endif // SIMD_DISPATCH_H
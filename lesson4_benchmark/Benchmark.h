@@ -0,0 +1,635 @@
+// Benchmark.h
+//
+// Measures how the running time of a function grows with the input size,
+// so the Big O claims of the lesson4 programs can be checked on a real
+// machine.
+//
+// Timing one call of a fast function is not enough. The clock is coarser
+// than the call, the first calls are slower (cold caches, page faults,
+// CPU frequency still ramping up), and now and then the operating system
+// interrupts the program. Benchmark::run() therefore does, for every size
+// n in a geometric sequence (minSize, minSize * growth, ...):
+//
+//   1. prepare(n) builds the input and returns the body to time
+//   2. calibration: the number of calls per sample is doubled until one
+//      sample takes at least minSampleSeconds, so clock resolution does
+//      not matter
+//   3. warm-up: `warmups` samples that are thrown away
+//   4. `repetitions` timed samples, each giving ns per call
+//   5. outliers are rejected with Tukey's fences (further than 1.5 times
+//      the interquartile range beyond the quartiles) and the rest are
+//      summarized as mean, median, standard deviation and a 95%
+//      confidence interval for the mean (Student's t)
+//
+// Sizes stop growing once one call takes longer than maxSecondsPerCall, so
+// an O(n^2) function simply stops earlier than an O(n) one.
+//
+// Across the sizes, fitComplexity() fits time = c * f(n) for f in 1,
+// log n, n, n log n, n^2 and n^3 by least squares on the relative errors
+// and picks the f with the smallest error. It also reports the slope of log(time)
+// against log(n), which is the empirical exponent (1 for O(n), 2 for
+// O(n^2)).
+//
+// The compiler removes calculations whose results are never used, which
+// would make the function look free. doNotOptimize(value) makes the
+// compiler believe the value is read, and clobberMemory() that all memory
+// may have been read and written.
+//
+// On Linux, PerfCounters reads the CPU's hardware counters through
+// perf_event_open: cycles, instructions, cache misses and branch misses,
+// reported per call. Elsewhere, or when the kernel does not allow it (see
+// /proc/sys/kernel/perf_event_paranoid), the counters are reported as
+// unavailable and the timings are unaffected.
+//
+// Results can be printed as a table or written as JSON or CSV, one row
+// per (benchmark, n), to keep and compare between versions.
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iomanip>
+#include <limits>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+namespace benchmark_detail {
+
+#if defined(_MSC_VER)
+inline volatile const void* sink = nullptr;
+#endif
+
+// Two-sided 95% Student t quantile for the given degrees of freedom
+inline double tQuantile95(size_t degrees) {
+    static const double table[] = {
+        0.0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+    if (degrees == 0) return std::numeric_limits<double>::infinity();
+    if (degrees <= 30) return table[degrees];
+    if (degrees <= 60) return 2.000 + (2.042 - 2.000) * (60.0 - degrees) / 30.0;
+    if (degrees <= 120) return 1.980 + (2.000 - 1.980) * (120.0 - degrees) / 60.0;
+    return 1.960;
+}
+
+// Linear interpolation between the order statistics of a sorted vector
+inline double quantileOfSorted(const std::vector<double>& sorted, double q) {
+    double position = q * static_cast<double>(sorted.size() - 1);
+    size_t below = static_cast<size_t>(position);
+    if (below + 1 >= sorted.size()) return sorted.back();
+    double fraction = position - static_cast<double>(below);
+    return sorted[below] + fraction * (sorted[below + 1] - sorted[below]);
+}
+
+inline std::string jsonEscape(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char buffer[8];
+            std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+            escaped += buffer;
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+inline std::string csvEscape(const std::string& text) {
+    if (text.find_first_of(",\"\n") == std::string::npos) return text;
+    std::string escaped = "\"";
+    for (char c : text) {
+        if (c == '"') escaped += '"';
+        escaped += c;
+    }
+    return escaped + "\"";
+}
+
+} // namespace benchmark_detail
+
+/**
+ * @brief Makes the compiler assume value is read, so the calculation that
+ * produced it cannot be removed.
+ */
+template<typename T>
+inline void doNotOptimize(const T& value) {
+#if defined(_MSC_VER)
+    benchmark_detail::sink = &value;
+    _ReadWriteBarrier();
+#else
+    asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+/**
+ * @brief Makes the compiler assume all memory may have been read and
+ * written, so stores before it are kept and loads after it are repeated.
+ */
+inline void clobberMemory() {
+#if defined(_MSC_VER)
+    _ReadWriteBarrier();
+#else
+    asm volatile("" : : : "memory");
+#endif
+}
+
+/**
+ * @brief Hardware counter totals; valid only when available is true.
+ */
+struct HardwareCounters {
+    bool available = false;
+    double cycles = 0;
+    double instructions = 0;
+    double cacheMisses = 0;
+    double branchMisses = 0;
+};
+
+/**
+ * @brief Cycles, instructions, cache misses and branch misses of the
+ * calling thread between start() and stop(), via perf_event_open (Linux).
+ */
+class PerfCounters {
+private:
+    static constexpr int kEvents = 4;
+    int fds[kEvents] = { -1, -1, -1, -1 };
+    std::string reason;
+
+public:
+    PerfCounters() {
+#if defined(__linux__)
+        const uint64_t configs[kEvents] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                            PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+        for (int i = 0; i < kEvents; i++) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.size = sizeof(attr);
+            attr.config = configs[i];
+            attr.disabled = i == 0;             // the group starts with its leader
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP;
+            long fd = syscall(SYS_perf_event_open, &attr, 0, -1, i == 0 ? -1 : fds[0], 0);
+            if (fd < 0) {
+                reason = std::string("perf_event_open: ") + std::strerror(errno);
+                close();
+                return;
+            }
+            fds[i] = static_cast<int>(fd);
+        }
+#else
+        reason = "hardware counters need Linux perf_event_open";
+#endif
+    }
+
+    ~PerfCounters() { close(); }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available() const { return fds[0] >= 0; }
+
+    /**
+     * @brief Why the counters are not available; empty when they are.
+     */
+    const std::string& unavailableReason() const { return reason; }
+
+    void start() {
+#if defined(__linux__)
+        if (!available()) return;
+        ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+    }
+
+    HardwareCounters stop() {
+        HardwareCounters counters;
+#if defined(__linux__)
+        if (!available()) return counters;
+        ioctl(fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        uint64_t values[1 + kEvents];
+        if (read(fds[0], values, sizeof(values)) != static_cast<ssize_t>(sizeof(values)) || values[0] != kEvents) {
+            return counters;
+        }
+        counters.available = true;
+        counters.cycles = static_cast<double>(values[1]);
+        counters.instructions = static_cast<double>(values[2]);
+        counters.cacheMisses = static_cast<double>(values[3]);
+        counters.branchMisses = static_cast<double>(values[4]);
+#endif
+        return counters;
+    }
+
+private:
+    void close() {
+#if defined(__linux__)
+        for (int& fd : fds) {
+            if (fd >= 0) ::close(fd);
+            fd = -1;
+        }
+#endif
+    }
+};
+
+/**
+ * @brief Summary of repeated measurements after outlier rejection.
+ */
+struct SampleSummary {
+    size_t samples = 0;         // kept
+    size_t rejected = 0;        // outside Tukey's fences
+    double mean = 0;
+    double median = 0;
+    double stddev = 0;
+    double ciLow = 0;           // 95% confidence interval for the mean
+    double ciHigh = 0;
+    double min = 0;
+    double max = 0;
+};
+
+/**
+ * @brief Rejects values outside [Q1 - 1.5 IQR, Q3 + 1.5 IQR] and
+ * summarizes the rest.
+ * @throws std::invalid_argument if values is empty.
+ */
+inline SampleSummary summarize(std::vector<double> values) {
+    if (values.empty()) throw std::invalid_argument("summarize: no values");
+    std::sort(values.begin(), values.end());
+    double q1 = benchmark_detail::quantileOfSorted(values, 0.25);
+    double q3 = benchmark_detail::quantileOfSorted(values, 0.75);
+    double low = q1 - 1.5 * (q3 - q1), high = q3 + 1.5 * (q3 - q1);
+    std::vector<double> kept;
+    for (double v : values) {
+        if (v >= low && v <= high) kept.push_back(v);
+    }
+
+    SampleSummary summary;
+    summary.samples = kept.size();
+    summary.rejected = values.size() - kept.size();
+    double sum = 0;
+    for (double v : kept) sum += v;
+    summary.mean = sum / static_cast<double>(kept.size());
+    double squares = 0;
+    for (double v : kept) squares += (v - summary.mean) * (v - summary.mean);
+    summary.stddev = kept.size() > 1 ? std::sqrt(squares / static_cast<double>(kept.size() - 1)) : 0.0;
+    summary.median = benchmark_detail::quantileOfSorted(kept, 0.5);
+    double halfWidth = kept.size() > 1
+        ? benchmark_detail::tQuantile95(kept.size() - 1) * summary.stddev / std::sqrt(static_cast<double>(kept.size()))
+        : 0.0;
+    summary.ciLow = summary.mean - halfWidth;
+    summary.ciHigh = summary.mean + halfWidth;
+    summary.min = kept.front();
+    summary.max = kept.back();
+    return summary;
+}
+
+enum class Complexity { Constant, Logarithmic, Linear, Linearithmic, Quadratic, Cubic };
+
+inline const char* complexityName(Complexity complexity) {
+    switch (complexity) {
+    case Complexity::Constant: return "O(1)";
+    case Complexity::Logarithmic: return "O(log n)";
+    case Complexity::Linear: return "O(n)";
+    case Complexity::Linearithmic: return "O(n log n)";
+    case Complexity::Quadratic: return "O(n^2)";
+    case Complexity::Cubic: return "O(n^3)";
+    }
+    return "?";
+}
+
+inline double complexityCurve(Complexity complexity, double n) {
+    switch (complexity) {
+    case Complexity::Constant: return 1.0;
+    case Complexity::Logarithmic: return std::log2(n);
+    case Complexity::Linear: return n;
+    case Complexity::Linearithmic: return n * std::log2(n);
+    case Complexity::Quadratic: return n * n;
+    case Complexity::Cubic: return n * n * n;
+    }
+    return 1.0;
+}
+
+/**
+ * @brief Best fitting curve time = coefficient * f(n).
+ */
+struct ComplexityFit {
+    Complexity complexity = Complexity::Constant;
+    double coefficient = 0;     // ns per unit of f(n)
+    double rms = 0;             // root mean square of the errors relative to the times
+    double exponent = 0;        // slope of log(time) against log(n)
+};
+
+/**
+ * @brief Fits the candidate curves to (n, time) points by least squares.
+ * @throws std::invalid_argument with fewer than two points or a time that
+ * is not positive.
+ */
+inline ComplexityFit fitComplexity(const std::vector<double>& sizes, const std::vector<double>& times) {
+    if (sizes.size() != times.size() || sizes.size() < 2) {
+        throw std::invalid_argument("fitComplexity: need at least two (n, time) points");
+    }
+    for (size_t i = 0; i < sizes.size(); i++) {
+        if (!(times[i] > 0) || !(sizes[i] > 0)) throw std::invalid_argument("fitComplexity: n and times must be positive");
+    }
+    ComplexityFit best;
+    best.rms = std::numeric_limits<double>::infinity();
+    const Complexity candidates[] = { Complexity::Constant, Complexity::Logarithmic, Complexity::Linear,
+                                      Complexity::Linearithmic, Complexity::Quadratic, Complexity::Cubic };
+    for (Complexity candidate : candidates) {
+        // Errors relative to the measured time, so that the small sizes
+        // count as much as the large ones: minimizing sum (1 - c f / t)^2
+        // gives c = sum(f / t) / sum((f / t)^2)
+        double sum = 0, squares = 0;
+        for (size_t i = 0; i < sizes.size(); i++) {
+            double ratio = complexityCurve(candidate, sizes[i]) / times[i];
+            sum += ratio;
+            squares += ratio * ratio;
+        }
+        double coefficient = sum / squares;
+        double errors = 0;
+        for (size_t i = 0; i < sizes.size(); i++) {
+            double error = 1.0 - coefficient * complexityCurve(candidate, sizes[i]) / times[i];
+            errors += error * error;
+        }
+        double rms = std::sqrt(errors / static_cast<double>(sizes.size()));
+        if (rms < best.rms) {
+            best.complexity = candidate;
+            best.coefficient = coefficient;
+            best.rms = rms;
+        }
+    }
+
+    double meanX = 0, meanY = 0;
+    for (size_t i = 0; i < sizes.size(); i++) {
+        meanX += std::log(sizes[i]);
+        meanY += std::log(times[i]);
+    }
+    meanX /= static_cast<double>(sizes.size());
+    meanY /= static_cast<double>(sizes.size());
+    double xy = 0, xx = 0;
+    for (size_t i = 0; i < sizes.size(); i++) {
+        double x = std::log(sizes[i]) - meanX;
+        xy += x * (std::log(times[i]) - meanY);
+        xx += x * x;
+    }
+    best.exponent = xx > 0 ? xy / xx : 0.0;
+    return best;
+}
+
+struct BenchmarkConfig {
+    size_t minSize = 16;
+    size_t maxSize = size_t(1) << 20;
+    double growth = 2.0;                // next size = size * growth
+    size_t warmups = 3;                 // samples thrown away per size
+    size_t repetitions = 15;            // timed samples per size
+    double minSampleSeconds = 1e-3;     // calls per sample are doubled until reached
+    double maxSecondsPerCall = 0.05;    // no larger sizes once one call takes longer
+    bool hardwareCounters = true;
+};
+
+struct SizeResult {
+    size_t n = 0;
+    size_t callsPerSample = 0;
+    SampleSummary nsPerCall;
+    HardwareCounters perCall;           // averaged over every timed call
+};
+
+struct BenchmarkResult {
+    std::string name;
+    std::vector<SizeResult> sizes;
+    ComplexityFit fit;                  // over the mean ns per call; valid with two or more sizes
+};
+
+/**
+ * @brief Runs benchmarks over geometric input sizes and collects their
+ * results.
+ */
+class Benchmark {
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    BenchmarkConfig config;
+    PerfCounters counters;
+    std::vector<BenchmarkResult> all;
+
+    template<typename Body>
+    static double secondsFor(Body& body, size_t calls) {
+        auto start = Clock::now();
+        for (size_t i = 0; i < calls; i++) {
+            body();
+            clobberMemory();
+        }
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+public:
+    /**
+     * @throws std::invalid_argument if the sizes cannot grow or there are
+     * no repetitions.
+     */
+    explicit Benchmark(const BenchmarkConfig& config = BenchmarkConfig()) : config(config) {
+        if (config.minSize == 0 || config.growth <= 1.0 || config.repetitions == 0) {
+            throw std::invalid_argument("Benchmark: minSize and repetitions must be positive and growth above 1");
+        }
+    }
+
+    /**
+     * @brief Times prepare(n)() for every size.
+     * @param prepare called once per size, untimed; returns a callable with
+     * no arguments that runs the code to measure on an input of size n.
+     * The callable should pass its result to doNotOptimize().
+     */
+    template<typename Prepare>
+    const BenchmarkResult& run(const std::string& name, Prepare prepare) {
+        BenchmarkResult result;
+        result.name = name;
+        double size = static_cast<double>(config.minSize);
+        size_t n = config.minSize;
+        while (n <= config.maxSize) {
+            auto body = prepare(n);
+
+            size_t calls = 1;
+            double seconds = secondsFor(body, calls);
+            while (seconds < config.minSampleSeconds) {
+                calls *= 2;
+                seconds = secondsFor(body, calls);
+            }
+            for (size_t i = 0; i < config.warmups; i++) secondsFor(body, calls);
+
+            std::vector<double> samples;
+            if (config.hardwareCounters) counters.start();
+            for (size_t i = 0; i < config.repetitions; i++) {
+                samples.push_back(secondsFor(body, calls) * 1e9 / static_cast<double>(calls));
+            }
+            HardwareCounters totals = config.hardwareCounters ? counters.stop() : HardwareCounters();
+
+            SizeResult sizeResult;
+            sizeResult.n = n;
+            sizeResult.callsPerSample = calls;
+            sizeResult.nsPerCall = summarize(samples);
+            if (totals.available) {
+                double totalCalls = static_cast<double>(calls * config.repetitions);
+                sizeResult.perCall.available = true;
+                sizeResult.perCall.cycles = totals.cycles / totalCalls;
+                sizeResult.perCall.instructions = totals.instructions / totalCalls;
+                sizeResult.perCall.cacheMisses = totals.cacheMisses / totalCalls;
+                sizeResult.perCall.branchMisses = totals.branchMisses / totalCalls;
+            }
+            result.sizes.push_back(sizeResult);
+            if (sizeResult.nsPerCall.median > config.maxSecondsPerCall * 1e9) break;
+
+            // The next distinct size of the geometric sequence
+            while (static_cast<size_t>(size) <= n) size *= config.growth;
+            n = static_cast<size_t>(size);
+        }
+
+        if (result.sizes.size() >= 2) {
+            std::vector<double> sizes, times;
+            for (const SizeResult& s : result.sizes) {
+                sizes.push_back(static_cast<double>(s.n));
+                times.push_back(s.nsPerCall.mean);
+            }
+            result.fit = fitComplexity(sizes, times);
+        }
+        all.push_back(result);
+        return all.back();
+    }
+
+    const std::vector<BenchmarkResult>& results() const { return all; }
+
+    bool countersAvailable() const { return counters.available(); }
+
+    const std::string& countersUnavailableReason() const { return counters.unavailableReason(); }
+};
+
+/**
+ * @brief One table per benchmark: n, ns per call with its confidence
+ * interval, rejected samples and, if available, counters per call.
+ */
+inline void printResults(std::ostream& out, const std::vector<BenchmarkResult>& results) {
+    std::ios state(nullptr);
+    state.copyfmt(out);
+    for (const BenchmarkResult& result : results) {
+        out << result.name << "\n";
+        out << std::right << std::setw(10) << "n" << std::setw(14) << "ns/call" << std::setw(22) << "95% CI"
+            << std::setw(9) << "outliers" << std::setw(13) << "cycles" << std::setw(13) << "cache miss"
+            << std::setw(13) << "branch miss" << "\n";
+        for (const SizeResult& s : result.sizes) {
+            std::ostringstream interval;
+            interval << std::fixed << std::setprecision(s.nsPerCall.mean < 100 ? 2 : 0) << s.nsPerCall.ciLow << " - "
+                     << s.nsPerCall.ciHigh;
+            out << std::setw(10) << s.n << std::fixed << std::setprecision(s.nsPerCall.mean < 100 ? 2 : 0)
+                << std::setw(14) << s.nsPerCall.mean << std::setw(22) << interval.str() << std::setw(9)
+                << s.nsPerCall.rejected;
+            if (s.perCall.available) {
+                out << std::setprecision(1) << std::setw(13) << s.perCall.cycles << std::setw(13)
+                    << s.perCall.cacheMisses << std::setw(13) << s.perCall.branchMisses;
+            } else {
+                out << std::setw(13) << "-" << std::setw(13) << "-" << std::setw(13) << "-";
+            }
+            out << "\n";
+        }
+        if (result.sizes.size() >= 2) {
+            out << "fit: " << complexityName(result.fit.complexity) << ", " << std::setprecision(4)
+                << std::defaultfloat << result.fit.coefficient << " ns per unit, rms " << std::fixed
+                << std::setprecision(1) << result.fit.rms * 100 << "%, exponent " << std::setprecision(2)
+                << result.fit.exponent << "\n";
+        }
+        out << "\n";
+    }
+    out.copyfmt(state);
+}
+
+/**
+ * @brief {"benchmarks": [{"name", "complexity", "coefficient", "rms",
+ * "exponent", "sizes": [{"n", "calls_per_sample", "samples", "rejected",
+ * "mean_ns", ..., "cycles", ...}]}]}; counters are null when unavailable.
+ */
+inline void writeJson(std::ostream& out, const std::vector<BenchmarkResult>& results) {
+    std::ios state(nullptr);
+    state.copyfmt(out);
+    out << std::setprecision(17) << "{\"benchmarks\": [";
+    for (size_t r = 0; r < results.size(); r++) {
+        const BenchmarkResult& result = results[r];
+        out << (r == 0 ? "\n" : ",\n") << "  {\"name\": \"" << benchmark_detail::jsonEscape(result.name) << "\"";
+        if (result.sizes.size() >= 2) {
+            out << ", \"complexity\": \"" << complexityName(result.fit.complexity) << "\", \"coefficient\": "
+                << result.fit.coefficient << ", \"rms\": " << result.fit.rms << ", \"exponent\": "
+                << result.fit.exponent;
+        }
+        out << ", \"sizes\": [";
+        for (size_t i = 0; i < result.sizes.size(); i++) {
+            const SizeResult& s = result.sizes[i];
+            const SampleSummary& t = s.nsPerCall;
+            out << (i == 0 ? "\n" : ",\n") << "    {\"n\": " << s.n << ", \"calls_per_sample\": " << s.callsPerSample
+                << ", \"samples\": " << t.samples << ", \"rejected\": " << t.rejected << ", \"mean_ns\": " << t.mean
+                << ", \"median_ns\": " << t.median << ", \"stddev_ns\": " << t.stddev << ", \"ci_low_ns\": "
+                << t.ciLow << ", \"ci_high_ns\": " << t.ciHigh << ", \"min_ns\": " << t.min << ", \"max_ns\": "
+                << t.max;
+            const char* names[] = { "cycles", "instructions", "cache_misses", "branch_misses" };
+            const double values[] = { s.perCall.cycles, s.perCall.instructions, s.perCall.cacheMisses,
+                                      s.perCall.branchMisses };
+            for (int c = 0; c < 4; c++) {
+                out << ", \"" << names[c] << "\": ";
+                if (s.perCall.available) out << values[c];
+                else out << "null";
+            }
+            out << "}";
+        }
+        out << "\n  ]}";
+    }
+    out << "\n]}\n";
+    out.copyfmt(state);
+}
+
+/**
+ * @brief A header line, then one line per (benchmark, n); counters are
+ * empty when unavailable.
+ */
+inline void writeCsv(std::ostream& out, const std::vector<BenchmarkResult>& results) {
+    std::ios state(nullptr);
+    state.copyfmt(out);
+    out << std::setprecision(17);
+    out << "name,n,calls_per_sample,samples,rejected,mean_ns,median_ns,stddev_ns,ci_low_ns,ci_high_ns,min_ns,max_ns,"
+           "cycles,instructions,cache_misses,branch_misses\n";
+    for (const BenchmarkResult& result : results) {
+        for (const SizeResult& s : result.sizes) {
+            const SampleSummary& t = s.nsPerCall;
+            out << benchmark_detail::csvEscape(result.name) << "," << s.n << "," << s.callsPerSample << ","
+                << t.samples << "," << t.rejected << "," << t.mean << "," << t.median << "," << t.stddev << ","
+                << t.ciLow << "," << t.ciHigh << "," << t.min << "," << t.max;
+            if (s.perCall.available) {
+                out << "," << s.perCall.cycles << "," << s.perCall.instructions << "," << s.perCall.cacheMisses
+                    << "," << s.perCall.branchMisses << "\n";
+            } else {
+                out << ",,,,\n";
+            }
+        }
+    }
+    out.copyfmt(state);
+}
+
+#endif // BENCHMARK_H
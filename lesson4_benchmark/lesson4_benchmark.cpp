@@ -0,0 +1,253 @@
+// lesson4_benchmark.cpp : This file contains the 'main' function. Program execution begins and ends there.
+//
+// Measures the growth rates claimed in lesson4. printFirstElement,
+// printAllElements and printPairs mostly measure cout, so the benchmark
+// times the same access patterns without printing: the first element
+// (O(1)), a sum over all elements (O(n)) and a count over all pairs
+// (O(n^2)). It also times the README's Challenge, counting the pairs with
+// a given sum, by checking every pair (O(n^2)), by binary search in a
+// sorted copy (O(n log n)) and with a hash table (O(n)). Each benchmark
+// prints the fitted complexity next to the one in its name. They can
+// differ: once the hash table outgrows the caches every lookup costs more,
+// and for small n the branch predictor learns the outcome of every
+// comparison of the sorted version, because each call sorts the same data.
+//
+// Usage: lesson4_benchmark [results.json] [results.csv]
+//   Defaults: lesson4_benchmark.json and lesson4_benchmark.csv.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Benchmark.h"
+
+// The lesson4 functions without the printing
+
+int firstElement(const int arr[], int size) {
+    return size > 0 ? arr[0] : 0;
+}
+
+long long sumAllElements(const int arr[], int size) {
+    long long sum = 0;
+    for (int i = 0; i < size; i++) {
+        sum += arr[i];
+    }
+    return sum;
+}
+
+long long countOrderedPairs(const int arr[], int size) {
+    long long count = 0;
+    for (int i = 0; i < size; i++) {
+        for (int j = 0; j < size; j++) {
+            count += arr[i] < arr[j];
+        }
+    }
+    return count;
+}
+
+// The Challenge: pairs i < j with arr[i] + arr[j] == target
+
+long long pairsWithSumBruteForce(const int arr[], int size, int target) {
+    long long count = 0;
+    for (int i = 0; i < size; i++) {
+        for (int j = i + 1; j < size; j++) {
+            count += arr[i] + arr[j] == target;
+        }
+    }
+    return count;
+}
+
+long long pairsWithSumSorted(const int arr[], int size, int target) {
+    std::vector<int> sorted(arr, arr + size);
+    std::sort(sorted.begin(), sorted.end());
+    long long count = 0;
+    for (auto it = sorted.begin(); it != sorted.end(); ++it) {
+        auto range = std::equal_range(it + 1, sorted.end(), target - *it);
+        count += range.second - range.first;
+    }
+    return count;
+}
+
+long long pairsWithSumHashed(const int arr[], int size, int target) {
+    std::unordered_map<int, int> seen;
+    seen.reserve(static_cast<size_t>(size));
+    long long count = 0;
+    for (int i = 0; i < size; i++) {
+        auto it = seen.find(target - arr[i]);
+        if (it != seen.end()) count += it->second;
+        seen[arr[i]]++;
+    }
+    return count;
+}
+
+std::vector<int> randomArray(size_t n, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> value(0, static_cast<int>(n));
+    std::vector<int> arr(n);
+    for (int& v : arr) v = value(rng);
+    return arr;
+}
+
+void sanityCheck() {
+    // The three pair counters agree
+    for (size_t n : { 0, 1, 2, 7, 100, 1000 }) {
+        std::vector<int> arr = randomArray(n, static_cast<unsigned>(n));
+        int size = static_cast<int>(n), target = size;
+        long long expected = pairsWithSumBruteForce(arr.data(), size, target);
+        if (pairsWithSumSorted(arr.data(), size, target) != expected ||
+            pairsWithSumHashed(arr.data(), size, target) != expected) {
+            throw std::logic_error("pair counts differ for n = " + std::to_string(n));
+        }
+    }
+    int small[] = { 1, 2, 3, 4, 5 };
+    if (firstElement(small, 5) != 1 || sumAllElements(small, 5) != 15 || countOrderedPairs(small, 5) != 10 ||
+        pairsWithSumBruteForce(small, 5, 6) != 2) {
+        throw std::logic_error("lesson4 functions wrong");
+    }
+
+    // Outlier rejection: one sample ten times the others goes
+    SampleSummary summary = summarize({ 10, 11, 10, 12, 11, 10, 11, 100 });
+    if (summary.rejected != 1 || summary.samples != 7 || summary.max != 12 || summary.ciLow > summary.mean ||
+        summary.ciHigh < summary.mean || std::abs(summary.median - 11) > 1e-12) {
+        throw std::logic_error("summarize wrong");
+    }
+    // Mean 2, stddev 1, n = 3: half width t(2) / sqrt(3)
+    summary = summarize({ 1, 2, 3 });
+    if (std::abs(summary.ciHigh - summary.mean - 4.303 / std::sqrt(3.0)) > 1e-9) {
+        throw std::logic_error("confidence interval wrong");
+    }
+
+    // Exact curves are recognized, with noise too
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> noise(0.95, 1.05);
+    const Complexity expected[] = { Complexity::Constant, Complexity::Logarithmic, Complexity::Linear,
+                                    Complexity::Linearithmic, Complexity::Quadratic, Complexity::Cubic };
+    for (Complexity complexity : expected) {
+        std::vector<double> sizes, times;
+        for (double n = 16; n <= 65536; n *= 2) {
+            sizes.push_back(n);
+            times.push_back((3.0 * complexityCurve(complexity, n) + 0.5) * noise(rng));
+        }
+        ComplexityFit fit = fitComplexity(sizes, times);
+        if (fit.complexity != complexity) {
+            throw std::logic_error(std::string("fitted ") + complexityName(fit.complexity) + " to " +
+                                   complexityName(complexity));
+        }
+    }
+
+    // The empirical exponent of noisy power laws
+    for (double power : { 1.0, 2.0 }) {
+        std::vector<double> sizes, times;
+        for (double n = 1024; n <= 65536; n *= 2) {
+            sizes.push_back(n);
+            times.push_back(2.0 * std::pow(n, power) * noise(rng));
+        }
+        ComplexityFit fit = fitComplexity(sizes, times);
+        if (std::abs(fit.exponent - power) > 0.05) {
+            throw std::logic_error("exponent " + std::to_string(fit.exponent) + " fitted to n^" + std::to_string(power));
+        }
+    }
+
+    // A small run is measured and written out. Its exponent depends on the
+    // machine's load and clock speed, so an unexpected one is only reported
+    BenchmarkConfig config;
+    config.minSize = 1024;
+    config.maxSize = 65536;
+    config.repetitions = 5;
+    config.warmups = 1;
+    Benchmark benchmark(config);
+    const BenchmarkResult& result = benchmark.run("sum, \"check\"", [](size_t n) {
+        std::vector<int> arr = randomArray(n, 1);
+        return [arr]() { doNotOptimize(sumAllElements(arr.data(), static_cast<int>(arr.size()))); };
+    });
+    if (result.sizes.size() != 7 || result.sizes.back().n != 65536) {
+        throw std::logic_error("linear benchmark measured the wrong sizes");
+    }
+    if (result.fit.exponent < 0.7 || result.fit.exponent > 1.3) {
+        std::cout << "Warning: linear benchmark measured exponent " << result.fit.exponent
+                  << " (timings may be disturbed by load or frequency scaling)\n";
+    }
+    std::ostringstream jsonStream, csvStream;
+    writeJson(jsonStream, benchmark.results());
+    writeCsv(csvStream, benchmark.results());
+    std::string json = jsonStream.str(), csv = csvStream.str();
+    if (json.find("\"name\": \"sum, \\\"check\\\"\"") == std::string::npos ||
+        std::count(csv.begin(), csv.end(), '\n') != 8 || csv.find("\"sum, \"\"check\"\"\",1024,") == std::string::npos) {
+        throw std::logic_error("JSON or CSV output wrong");
+    }
+
+    std::cout << "Sanity check passed\n\n";
+}
+
+int main(int argc, char* argv[]) {
+    std::string jsonPath = argc > 1 ? argv[1] : "lesson4_benchmark.json";
+    std::string csvPath = argc > 2 ? argv[2] : "lesson4_benchmark.csv";
+
+    sanityCheck();
+
+    Benchmark benchmark;
+    std::cout << "Hardware threads: " << std::thread::hardware_concurrency() << "\n";
+    if (benchmark.countersAvailable()) std::cout << "Hardware counters: available\n\n";
+    else std::cout << "Hardware counters: unavailable (" << benchmark.countersUnavailableReason() << ")\n\n";
+
+    benchmark.run("firstElement O(1)", [](size_t n) {
+        std::vector<int> arr = randomArray(n, 1);
+        return [arr]() { doNotOptimize(firstElement(arr.data(), static_cast<int>(arr.size()))); };
+    });
+    benchmark.run("sumAllElements O(n)", [](size_t n) {
+        std::vector<int> arr = randomArray(n, 2);
+        return [arr]() { doNotOptimize(sumAllElements(arr.data(), static_cast<int>(arr.size()))); };
+    });
+    benchmark.run("countOrderedPairs O(n^2)", [](size_t n) {
+        std::vector<int> arr = randomArray(n, 3);
+        return [arr]() { doNotOptimize(countOrderedPairs(arr.data(), static_cast<int>(arr.size()))); };
+    });
+    benchmark.run("pairsWithSumBruteForce O(n^2)", [](size_t n) {
+        std::vector<int> arr = randomArray(n, 4);
+        return [arr]() {
+            doNotOptimize(pairsWithSumBruteForce(arr.data(), static_cast<int>(arr.size()), static_cast<int>(arr.size())));
+        };
+    });
+    benchmark.run("pairsWithSumSorted O(n log n)", [](size_t n) {
+        std::vector<int> arr = randomArray(n, 5);
+        return [arr]() {
+            doNotOptimize(pairsWithSumSorted(arr.data(), static_cast<int>(arr.size()), static_cast<int>(arr.size())));
+        };
+    });
+    benchmark.run("pairsWithSumHashed O(n)", [](size_t n) {
+        std::vector<int> arr = randomArray(n, 6);
+        return [arr]() {
+            doNotOptimize(pairsWithSumHashed(arr.data(), static_cast<int>(arr.size()), static_cast<int>(arr.size())));
+        };
+    });
+
+    printResults(std::cout, benchmark.results());
+
+    std::ofstream json(jsonPath);
+    writeJson(json, benchmark.results());
+    std::ofstream csv(csvPath);
+    writeCsv(csv, benchmark.results());
+    std::cout << "Results written to " << jsonPath << " and " << csvPath << "\n";
+
+    return 0;
+}
+
+// Run program: Ctrl + F5 or Debug > Start Without Debugging menu
+// Debug program: F5 or Debug > Start Debugging menu
+
+// Tips for Getting Started:
+//   1. Use the Solution Explorer window to add/manage files
+//   2. Use the Team Explorer window to connect to source control
+//   3. Use the Output window to see build output and other messages
+//   4. Use the Error List window to view errors
+//   5. Go to Project > Add New Item to create new code files, or Project > Add Existing Item to add existing code files to the project
+//   6. In the future, to open this project again, go to File > Open > Project and select the .sln file